@@ -0,0 +1,44 @@
+//
+// Scratch Arena Header
+//
+// One block of memory handed out front to back: an allocation is a pointer
+// bump, and everything allocated since a mark is released at once by
+// rewinding to it. The engine contexts in monte_carlo.h keep one arena per
+// context so that pricing calls never go through malloc.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_ARENA_H
+#define MONTE_CARLO_OPTION_PRICING_ARENA_H
+
+#include <stddef.h>
+
+// Alignment of every arena allocation (a cache line, so per-chunk slots
+// written by different threads never share one)
+#define MC_ARENA_ALIGN 64u
+
+typedef struct {
+    unsigned char *base;    // NULL for an empty arena (every allocation fails)
+    size_t capacity;        // Bytes in the block
+    size_t used;            // Bytes handed out
+    size_t peak;            // Most bytes ever in use at once
+} mc_arena;
+
+// Reserve capacity bytes. Returns 0, or -1 out of memory (the arena is then empty)
+int mc_arena_init(mc_arena *arena, size_t capacity);
+
+// Release the block
+void mc_arena_free(mc_arena *arena);
+
+// Bytes one allocation of `bytes` takes up, alignment included
+size_t mc_arena_footprint(size_t bytes);
+
+// Uninitialized, MC_ARENA_ALIGN-aligned memory, or NULL if the arena is full
+void *mc_arena_alloc(mc_arena *arena, size_t bytes);
+
+// Position to rewind to later
+size_t mc_arena_mark(const mc_arena *arena);
+
+// Release everything allocated since `mark`
+void mc_arena_rewind(mc_arena *arena, size_t mark);
+
+#endif //MONTE_CARLO_OPTION_PRICING_ARENA_H
@@ -0,0 +1,41 @@
+//
+// Batch Black-Scholes Header
+//
+// Closed-form prices and Greeks for many European options at once. Inputs
+// and outputs are structure-of-arrays: one contiguous array per field, so
+// four quotes fill one AVX2 register with no gathers or shuffles.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_BLACK_SCHOLES_H
+#define MONTE_CARLO_OPTION_PRICING_BLACK_SCHOLES_H
+
+#include <stddef.h>
+
+// Element i of every array describes quote i (all n entries must be set)
+typedef struct {
+    const double *S0;       // Spot prices
+    const double *K;        // Strikes
+    const double *r;        // Risk-free rates
+    const double *sigma;    // Volatilities (> 0)
+    const double *T;        // Times to maturity in years (> 0)
+} bs_batch_inputs;
+
+// Output columns; any pointer may be NULL to skip that column.
+// Units match greeks_european_bs(): per unit σ and r, theta per year
+typedef struct {
+    double *call;
+    double *put;
+    double *call_delta;
+    double *put_delta;
+    double *gamma;          // Same for calls and puts
+    double *vega;           // Same for calls and puts
+    double *call_rho;
+    double *put_rho;
+    double *call_theta;
+    double *put_theta;
+} bs_batch_outputs;
+
+// Price n options (SIMD when available; see black_scholes.c for accuracy)
+void black_scholes_batch(const bs_batch_inputs *in, size_t n, const bs_batch_outputs *out);
+
+#endif //MONTE_CARLO_OPTION_PRICING_BLACK_SCHOLES_H
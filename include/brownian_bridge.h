@@ -0,0 +1,39 @@
+//
+// Brownian Bridge Path Construction Header
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_BROWNIAN_BRIDGE_H
+#define MONTE_CARLO_OPTION_PRICING_BROWNIAN_BRIDGE_H
+
+#include <stddef.h>
+#include "include/arena.h"
+
+// Precomputed construction order and weights for one time grid
+typedef struct {
+    unsigned n_steps;
+    double dt;                // Step length (equally spaced grid)
+    unsigned *bridge_index;   // Grid point filled by normal i
+    unsigned *left_index;     // Left neighbour used (0 = time 0, else index+1)
+    unsigned *right_index;    // Right neighbour used
+    double *left_weight;
+    double *right_weight;
+    double *std_dev;          // Conditional standard deviation for normal i
+    int heap;                 // Nonzero if the arrays are malloc-ed (else they live in an arena)
+} brownian_bridge;
+
+// Set up a bridge for n_steps equal steps up to T. Returns 0, or -1 if out of memory
+int brownian_bridge_init(brownian_bridge *bb, unsigned n_steps, double T);
+
+// Arena bytes brownian_bridge_init_arena() takes for n_steps steps
+size_t brownian_bridge_bytes(unsigned n_steps);
+
+// brownian_bridge_init() with the arrays taken from `arena` (released by rewinding it)
+int brownian_bridge_init_arena(brownian_bridge *bb, unsigned n_steps, double T, mc_arena *arena);
+
+// Release the arrays allocated by brownian_bridge_init (nothing for an arena bridge)
+void brownian_bridge_free(brownian_bridge *bb);
+
+// Turn n_steps normals (most important first) into Brownian increments dW
+void brownian_bridge_build(const brownian_bridge *bb, const double *z, double *dW);
+
+#endif //MONTE_CARLO_OPTION_PRICING_BROWNIAN_BRIDGE_H
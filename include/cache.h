@@ -0,0 +1,80 @@
+//
+// Result Cache Header
+//
+// Memoizes European Monte Carlo prices. An entry is keyed by the contract
+// (type, S0, K, r, sigma, T, compared bit for bit), the seed, the
+// variance-reduction flags and the precision, and keeps the run's
+// accumulated statistics as well as its estimate. A request the entry
+// already satisfies (enough paths, or a standard error within the
+// tolerance) is answered without
+// simulating; one that asks for more extends the entry with paths from
+// the substreams after the ones it used (price_european_resume_mc()).
+//
+// A cache is not thread-safe: give each thread its own, or lock around it.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_CACHE_H
+#define MONTE_CARLO_OPTION_PRICING_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "include/option.h"
+#include "include/monte_carlo.h"
+
+// Occupied entries sampled to pick the least recently used one to evict
+#define MC_CACHE_EVICTION_SAMPLES 8u
+
+typedef struct {
+    uint64_t hash;
+    uint64_t last_used;         // Lookup clock of the last request (0 = empty slot)
+    option_type type;
+    unsigned variance_reduction;
+    mc_precision precision;
+    uint64_t seed;
+    double S0, K, r, sigma, T;
+    mc_run_state state;         // Statistics of every path simulated for this key
+    mc_result result;           // Estimate from state
+} mc_cache_entry;
+
+typedef struct {
+    uint64_t hits;              // Answered from an entry without simulating
+    uint64_t extensions;        // Entries extended with more paths
+    uint64_t misses;            // New entries
+    uint64_t bypassed;          // Requests the cache does not hold (Sobol sampler)
+    uint64_t evictions;
+    uint64_t paths_simulated;   // Paths run on behalf of cached requests
+    uint64_t paths_reused;      // Paths answered from entries instead of rerun
+} mc_cache_stats;
+
+typedef struct {
+    mc_cache_entry *slots;      // Open addressing, linear probing
+    size_t capacity;            // Power of two, at least twice max_entries
+    size_t max_entries;
+    size_t n_entries;
+    uint64_t clock;
+    mc_cache_stats stats;
+} mc_cache;
+
+// Room for up to max_entries contracts. Returns 0, or -1 on invalid size or out of memory
+int mc_cache_init(mc_cache *cache, size_t max_entries);
+
+// Release the table
+void mc_cache_free(mc_cache *cache);
+
+// Drop every entry (statistics are kept)
+void mc_cache_clear(mc_cache *cache);
+
+// price_european_mc() through the cache (opts->n_threads is not part of the key:
+// results do not depend on it). A hit may be more precise than the request needs
+mc_result mc_cache_price(
+    mc_cache *cache,
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_CACHE_H
@@ -0,0 +1,97 @@
+//
+// Distributed (MPI) Backend Header
+//
+// Only built by `make mpi`, which compiles every source with mpicc and
+// defines MC_MPI. Two ways to spread work over the ranks of a communicator:
+//
+//   mpi_price_chain      - one chain, its paths split across ranks. Each batch
+//                          of chunks is divided between the ranks, every rank
+//                          receives the statistics of every chunk, and all of
+//                          them reduce in chunk order - so the result matches
+//                          price_european_chain_greeks_mc() bit for bit.
+//   mpi_price_portfolio  - a book, whole (S0, sigma, r, T) groups per rank.
+//                          Each group is priced exactly as
+//                          price_portfolio_greeks_mc() would price it.
+//
+// Chunk c of a run always draws from substream c of the seed (the seed's
+// xoshiro256** state jumped c times), whichever rank simulates it, so the
+// ranks' shocks are disjoint and together form the single-node run.
+//
+// Every rank must make the same calls with the same arguments; results are
+// returned on every rank. The statistics travel as raw bytes, so all ranks
+// must share one architecture (the usual case within a cluster).
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_DISTRIBUTED_H
+#define MONTE_CARLO_OPTION_PRICING_DISTRIBUTED_H
+
+#include <stddef.h>
+#include <mpi.h>
+#include "include/monte_carlo.h"
+#include "include/portfolio.h"
+
+// Slot sizes one shard context can exchange (a chain run uses two: statistics and Greeks)
+#define MPI_SHARD_MAX_SLOTS 2u
+
+// MPI side of an mc_shard: everything an exchange needs, set up once by
+// mpi_shard_init() so that a batch's exchange has nothing left to allocate
+typedef struct {
+    MPI_Comm comm;
+    int n_ranks;
+    int *counts;                                    // counts[q] = chunks rank q owns in the batch
+    int *displs;                                    // displs[q] = first chunk of rank q
+    unsigned n_slots;
+    size_t slot_bytes[MPI_SHARD_MAX_SLOTS];         // Registered slot sizes
+    MPI_Datatype slot_types[MPI_SHARD_MAX_SLOTS];   // One committed datatype per slot size
+} mpi_shard_ctx;
+
+// mc_shard exchange over an MPI communicator (ctx = mpi_shard_ctx *): an
+// all-gather of each rank's chunk slots. Returns 0, or -1 on an MPI error or
+// a slot size not registered with mpi_shard_init() (then -1 on every rank)
+int mpi_shard_exchange(void *ctx, void *slots, size_t slot_bytes, uint32_t n_chunks);
+
+// mc_shard agree over an MPI communicator (ctx = mpi_shard_ctx *): 1 if ok
+// is 1 on every rank, 0 otherwise (or on an MPI error)
+int mpi_shard_agree(void *ctx, int ok);
+
+// Shard of the calling process on comm, able to exchange slots of the
+// n_slots sizes in slot_bytes. Collective: every rank of comm calls it, and
+// it returns 0 on all of them, or -1 on all of them if it failed on any
+// (invalid sizes, out of memory, an MPI error). Release with mpi_shard_free()
+int mpi_shard_init(mc_shard *shard, mpi_shard_ctx *ctx, MPI_Comm comm,
+                   const size_t *slot_bytes, unsigned n_slots);
+
+// Release a shard context (safe after a failed mpi_shard_init)
+void mpi_shard_free(mpi_shard_ctx *ctx);
+
+// Price a chain with its paths split across comm's ranks (greeks and greeks_se
+// may be NULL). Returns 0, or -1 on invalid input, Sobol, MPI errors or out of memory
+int mpi_price_chain(
+    MPI_Comm comm,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+// Price a book with its (S0, sigma, r, T) groups split across comm's ranks
+// (greeks and greeks_se may be NULL). Returns 0, or -1 if any group failed
+// on any rank (its results are NAN)
+int mpi_price_portfolio(
+    MPI_Comm comm,
+    const option_contract *contracts,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_DISTRIBUTED_H
@@ -1 +1,132 @@
-double simulate_gbm(double S0, double r, double sigma, double T);
\ No newline at end of file
+//
+// Geometric Brownian Motion Header
+//
+// Three ways to simulate:
+//   - terminal prices only (gbm_terminal_*), for European payoffs
+//   - whole paths on an equal time grid (gbm_path_*), for path-dependent
+//     payoffs. Paths are stored timestep-major: row t holds the price of
+//     every path at time t*dt, so each time step is one contiguous,
+//     vectorizable loop over paths.
+//   - terminal prices of several correlated assets (gbm_basket_*). Blocks
+//     are asset-major the same way: row a holds asset a for every path.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_GBM_H
+#define MONTE_CARLO_OPTION_PRICING_GBM_H
+
+#include <stddef.h>
+#include "include/arena.h"
+#include "include/rng.h"
+
+// Per-contract constants for S(T) = S0 * exp(drift + vol * Z), computed once
+typedef struct {
+    double S0;      // Initial stock price
+    double drift;   // (r - σ²/2) * T
+    double vol;     // σ * √T
+} gbm_terminal;
+
+// Simulate the terminal stock price S(T), drawing the shock from `rng`
+double simulate_gbm(rng_state *rng, double S0, double r, double sigma, double T);
+
+// Precompute the terminal-price constants for one contract
+gbm_terminal gbm_terminal_init(double S0, double r, double sigma, double T);
+
+// Map n normal shocks to terminal prices (out may alias z; SIMD when available)
+void gbm_terminal_fill(const gbm_terminal *g, const double *z, double *out, size_t n);
+
+// Single-precision version for the float32 engine (out may alias z)
+void gbm_terminal_fill_f32(const gbm_terminal *g, const float *z, float *out, size_t n);
+
+// Per-contract constants for a path of n_steps equal steps
+typedef struct {
+    double S0;          // Initial stock price
+    size_t n_steps;     // Number of time steps
+    double dt;          // T / n_steps
+    double drift;       // (r - σ²/2) * dt, per step
+    double vol;         // σ * √dt, per step
+} gbm_path;
+
+// Caller-owned path storage, reusable across calls (no allocation per path).
+// Row t (0..n_steps) starts at data + t * capacity; row 0 holds S0.
+typedef struct {
+    size_t n_steps;     // Time steps per path
+    size_t capacity;    // Maximum paths per fill (row length)
+    double *data;       // (n_steps + 1) * capacity prices
+} gbm_path_buffer;
+
+// Called once per time step by gbm_path_stream(): S[i] = price of path i at step * dt
+typedef void (*gbm_step_hook)(void *ctx, size_t step, const double *S, size_t n_paths);
+
+// Running per-path statistics over the monitoring dates t = dt, 2dt, ..., T
+typedef struct {
+    double *sum;        // Σ S(t_j), for arithmetic averages (may be NULL)
+    double *max;        // max S(t_j) (may be NULL)
+    double *min;        // min S(t_j) (may be NULL)
+} gbm_path_stats;
+
+// Precompute the per-step constants of a path
+gbm_path gbm_path_init(double S0, double r, double sigma, double T, size_t n_steps);
+
+// Allocate a buffer for up to `capacity` paths. Returns 0, or -1 if out of memory
+int gbm_path_buffer_init(gbm_path_buffer *buf, size_t n_steps, size_t capacity);
+
+// Release a buffer's storage
+void gbm_path_buffer_free(gbm_path_buffer *buf);
+
+// Pointer to row t (prices at time t * dt) of a buffer
+double *gbm_path_row(const gbm_path_buffer *buf, size_t t);
+
+// Advance n paths by one step: S_next[i] = S_prev[i] * exp(drift + vol * z[i]) (may alias)
+void gbm_path_step(const gbm_path *g, const double *S_prev, const double *z, double *S_next, size_t n);
+
+// Simulate n_paths whole paths into the buffer
+void gbm_path_fill(const gbm_path *g, rng_state *rng, gbm_path_buffer *buf, size_t n_paths);
+
+// Turn standard normals already in rows 1..n_steps into prices, in place
+void gbm_path_build(const gbm_path *g, gbm_path_buffer *buf, size_t n_paths);
+
+// Simulate n_paths paths keeping only the current time step; `hook` sees every step.
+// S and z are caller scratch rows of n_paths doubles. Same draws as gbm_path_fill()
+void gbm_path_stream(const gbm_path *g, rng_state *rng, double *S, double *z, size_t n_paths,
+                     gbm_step_hook hook, void *ctx);
+
+// Reset running statistics before a new set of paths
+void gbm_path_stats_reset(const gbm_path_stats *stats, size_t n_paths);
+
+// gbm_step_hook that updates a gbm_path_stats (pass it as ctx)
+void gbm_path_stats_update(void *ctx, size_t step, const double *S, size_t n_paths);
+
+// Most assets a gbm_basket may hold
+#define GBM_BASKET_MAX_ASSETS 64u
+
+// Per-contract constants for n_assets correlated terminal prices
+typedef struct {
+    size_t n_assets;
+    gbm_terminal *assets;   // S0, (r - σ²/2) T and σ √T of each asset
+    double *chol;           // Lower Cholesky factor L of the correlation matrix (row-major, n × n)
+    int heap;               // Nonzero if assets and chol are malloc-ed (else they live in an arena)
+} gbm_basket;
+
+// Factor the correlation matrix (row-major n_assets × n_assets) and set up
+// the per-asset constants. Returns 0, or -1 on invalid input, a matrix that
+// is not positive semi-definite, or out of memory
+int gbm_basket_init(gbm_basket *g, size_t n_assets, const double *S0, const double *sigma,
+                    const double *corr, double r, double T);
+
+// Arena bytes gbm_basket_init_arena() takes for n_assets assets
+size_t gbm_basket_bytes(size_t n_assets);
+
+// gbm_basket_init() with the constants and factor taken from `arena` (released by rewinding it)
+int gbm_basket_init_arena(gbm_basket *g, size_t n_assets, const double *S0, const double *sigma,
+                          const double *corr, double r, double T, mc_arena *arena);
+
+// Release a basket's storage (nothing for an arena basket)
+void gbm_basket_free(gbm_basket *g);
+
+// Correlate a block: eps[a * n + i] = Σ_{j <= a} L[a][j] z[j * n + i] (eps must not alias z)
+void gbm_basket_correlate(const gbm_basket *g, const double *z, double *eps, size_t n);
+
+// Terminal prices of a block from correlated shocks (sign = -1 negates them; S may alias eps)
+void gbm_basket_terminal_fill(const gbm_basket *g, const double *eps, double sign, double *S, size_t n);
+
+#endif //MONTE_CARLO_OPTION_PRICING_GBM_H
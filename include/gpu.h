@@ -0,0 +1,42 @@
+//
+// GPU (CUDA) Backend Header
+//
+// Only built by `make gpu`, which compiles src/gpu_european.cu with nvcc and
+// defines MC_GPU for the C sources. The engine then sends fixed-length
+// pseudo-random European runs to the device through the usual entry points
+// (price_european_call_mc, price_european_mc, price_european_chain_mc,
+// price_portfolio_mc), and falls back to the CPU when no device is found.
+//
+// Each device thread draws its shocks from a Philox counter (see philox.h),
+// payoffs are reduced on the device, and only a handful of sums per
+// contract are copied back.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_GPU_H
+#define MONTE_CARLO_OPTION_PRICING_GPU_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "include/gbm.h"
+#include "include/option.h"
+#include "include/stats.h"
+
+// 1 if a CUDA device is present and usable, 0 otherwise
+int gpu_available(void);
+
+// Simulate n_samples terminal samples for n_contracts strikes on the device.
+// forward = E[S(T)] (centres the control variate when MC_VR_CONTROL is set).
+// Returns 0 with per-contract sample moments in `out`, or -1 on a CUDA error
+int gpu_european_moments(
+    const gbm_terminal *g,
+    double forward,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    uint64_t n_samples,
+    uint64_t seed,
+    unsigned variance_reduction,
+    mc_moments *out
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_GPU_H
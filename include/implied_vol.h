@@ -0,0 +1,38 @@
+//
+// Implied Volatility Header
+//
+// Backs out the Black-Scholes volatility that reproduces each market price,
+// for whole chains at once. Inputs are structure-of-arrays like
+// black_scholes_batch(), and quotes are solved four at a time with AVX2.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_IMPLIED_VOL_H
+#define MONTE_CARLO_OPTION_PRICING_IMPLIED_VOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "include/option.h"
+
+// Element i of every array describes quote i
+typedef struct {
+    const double *price;        // Market option prices
+    const double *S0;           // Spot prices
+    const double *K;            // Strikes
+    const double *r;            // Risk-free rates
+    const double *T;            // Times to maturity in years (> 0)
+    const option_type *types;   // Call or put per quote (NULL = all calls)
+} iv_batch_inputs;
+
+// Work done by one implied_vol_batch() call
+typedef struct {
+    uint64_t newton_steps;      // Black-Scholes evaluations in the Newton phase
+    size_t brent_fallbacks;     // Quotes Newton did not settle (finished by Brent)
+    size_t no_solution;         // Prices outside the no-arbitrage bounds (vol = NAN)
+} iv_stats;
+
+// Solve vol[i] for every quote (n_threads = 0: all cores). Returns the number
+// of quotes without a solution; stats may be NULL
+size_t implied_vol_batch(const iv_batch_inputs *in, size_t n, unsigned n_threads,
+                         double *vol, iv_stats *stats);
+
+#endif //MONTE_CARLO_OPTION_PRICING_IMPLIED_VOL_H
@@ -0,0 +1,79 @@
+//
+// Specialized Kernel Header
+//
+// Header-only building blocks for inner loops specialized at compile time.
+// A generator macro takes the payoff, the precision and the antithetic
+// flag as macro arguments and expands to a loop with all three fixed:
+// no function pointer, no call/put branch per path, no test of the
+// variance-reduction flags. The compiler can then inline and vectorize it
+// like a loop written out by hand.
+//
+// monte_carlo.c builds its European chain kernels from these (one per
+// precision and variance-reduction combination, picked once per run from
+// a dispatch table); bench_suite instantiates them next to hand-written
+// loops to check that the generated code is as fast.
+//
+// The arithmetic is exactly that of payoff_fill() / payoff_fill_f32()
+// followed by the antithetic average, so results do not change bit for bit.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_KERNEL_H
+#define MONTE_CARLO_OPTION_PRICING_KERNEL_H
+
+#include <stdint.h>
+
+/**
+ * max(v, 0) as payoff_fill() computes it (the ternary, not fmax).
+ */
+static inline double mc_kernel_positive_double(double v) {
+    return (v > 0.0) ? v : 0.0;
+}
+
+static inline float mc_kernel_positive_float(float v) {
+    return (v > 0.0f) ? v : 0.0f;
+}
+
+// Payoff expressions; `real` is double or float
+#define MC_PAYOFF_CALL(real, S, K) mc_kernel_positive_##real((S) - (K))
+#define MC_PAYOFF_PUT(real, S, K) mc_kernel_positive_##real((K) - (S))
+
+/**
+ * Define `static inline void name(s_up, s_down, n, K, y)`: the payoffs of
+ * one contract over a block of terminal prices,
+ *   y[i] = f(s_up[i])                            ANTITHETIC = 0 (s_down unused)
+ *   y[i] = (f(s_up[i]) + f(s_down[i])) / 2       ANTITHETIC = 1
+ *
+ * @param name        Function to define
+ * @param real        double or float
+ * @param PAYOFF      MC_PAYOFF_CALL or MC_PAYOFF_PUT
+ * @param ANTITHETIC  0 or 1 (a constant, so the branch is compiled out)
+ */
+#define MC_DEFINE_PAYOFF_BLOCK(name, real, PAYOFF, ANTITHETIC)                              \
+    static inline void name(const real *restrict s_up, const real *restrict s_down,         \
+                            uint32_t n, real K, real *restrict y) {                         \
+        (void)s_down;                                                                       \
+        for (uint32_t i = 0; i < n; i++) {                                                  \
+            real v = PAYOFF(real, s_up[i], K);                                              \
+            if (ANTITHETIC) {                                                               \
+                v = (real)0.5 * (v + PAYOFF(real, s_down[i], K));                           \
+            }                                                                               \
+            y[i] = v;                                                                       \
+        }                                                                                   \
+    }
+
+/**
+ * Define `static inline void name(s_up, s_down, n, forward, x)`: the control
+ * variate S(T) - E[S(T)] over a block, S(T) being the pair average when
+ * ANTITHETIC is 1.
+ */
+#define MC_DEFINE_CONTROL_BLOCK(name, real, ANTITHETIC)                                     \
+    static inline void name(const real *restrict s_up, const real *restrict s_down,         \
+                            uint32_t n, real forward, real *restrict x) {                   \
+        (void)s_down;                                                                       \
+        for (uint32_t i = 0; i < n; i++) {                                                  \
+            real ST = ANTITHETIC ? (real)0.5 * (s_up[i] + s_down[i]) : s_up[i];             \
+            x[i] = ST - forward;                                                            \
+        }                                                                                   \
+    }
+
+#endif //MONTE_CARLO_OPTION_PRICING_KERNEL_H
@@ -0,0 +1,61 @@
+//
+// Longstaff-Schwartz American Option Pricing Header
+//
+// Least-squares Monte Carlo: walk the exercise dates backward, regress the
+// discounted future cash flow on a basis in S/K over the in-the-money
+// paths, and exercise where the intrinsic value beats the fit. Paths are
+// regenerated backward by a Brownian bridge, so memory is O(paths) for
+// any number of dates.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_LSM_H
+#define MONTE_CARLO_OPTION_PRICING_LSM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "include/option.h"
+#include "include/monte_carlo.h"
+
+// Highest basis degree supported (the regression has degree + 1 terms)
+#define LSM_MAX_DEGREE 4u
+
+// Regression basis in x = S / K
+typedef enum {
+    LSM_BASIS_POLYNOMIAL = 0,   // 1, x, x², ...
+    LSM_BASIS_LAGUERRE = 1      // 1, e^(-x/2) L_0(x), e^(-x/2) L_1(x), ... (Longstaff-Schwartz)
+} lsm_basis;
+
+// An American (Bermudan) call or put exercisable at t_j = j * T / n_steps
+typedef struct {
+    option_type type;
+    double strike;
+    size_t n_steps;     // Exercise dates (more dates -> closer to American)
+    lsm_basis basis;
+    unsigned degree;    // 1..LSM_MAX_DEGREE
+} american_option;
+
+// Price by least-squares Monte Carlo (variance reduction, QMC and tolerances are ignored)
+mc_result price_american_lsm(
+    const american_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+);
+
+// Arena bytes one LSM run of n_sim paths takes (see mc_engine_limits.max_american_paths)
+size_t lsm_scratch_bytes(uint32_t n_sim);
+
+// price_american_lsm() on an engine (NAN if opts->n_sim paths do not fit in its arena)
+mc_result mc_engine_price_american(
+    mc_engine *engine,
+    const american_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_LSM_H
@@ -0,0 +1,139 @@
+//
+// Market Data Header
+//
+// Contract files for whole end-of-day books. The binary format is
+// columnar: one contiguous, 64-byte aligned array per field, so a file
+// that is mmap()ed can be handed to black_scholes_batch() and
+// implied_vol_batch() without copying or parsing. CSV feeds are read with
+// a streaming parser and can be converted once into that format.
+//
+// File layout (native byte order, checked on open):
+//   market_file_header
+//   column arrays, each at header.column[c], n_contracts entries
+//   ticker table at header.tickers, n_tickers names of MARKET_TICKER_LEN bytes
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_MARKET_DATA_H
+#define MONTE_CARLO_OPTION_PRICING_MARKET_DATA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "include/option.h"
+#include "include/black_scholes.h"
+#include "include/implied_vol.h"
+
+// Bytes per ticker name, including the terminating NUL
+#define MARKET_TICKER_LEN 16u
+
+// Columns of a contract file
+typedef enum {
+    MARKET_COL_TICKER = 0,      // uint32_t index into the ticker table
+    MARKET_COL_S0 = 1,          // double spot price
+    MARKET_COL_K = 2,           // double strike
+    MARKET_COL_R = 3,           // double risk-free rate
+    MARKET_COL_SIGMA = 4,       // double volatility
+    MARKET_COL_T = 5,           // double time to expiry in years
+    MARKET_COL_PRICE = 6,       // double market price (0 = none)
+    MARKET_COL_TYPE = 7,        // option_type, stored as int32_t
+    MARKET_N_COLUMNS = 8
+} market_column;
+
+typedef struct {
+    char magic[8];              // "MCMKT01" + NUL
+    uint32_t byte_order;        // 0x01020304 as written by the producer
+    uint32_t n_tickers;
+    uint64_t n_contracts;
+    uint64_t column[MARKET_N_COLUMNS];  // Byte offset of each column
+    uint64_t tickers;           // Byte offset of the ticker table
+    uint64_t file_size;
+} market_file_header;
+
+// One contract, as parsed from CSV or appended to a writer
+typedef struct {
+    char ticker[MARKET_TICKER_LEN];
+    double S0;
+    double K;
+    double r;
+    double sigma;
+    double T;                   // Years (CSV holds calendar days; T = days / 365)
+    double market_price;
+    option_type type;
+} market_record;
+
+// A mapped contract file: every pointer points into the mapping (read-only)
+typedef struct {
+    size_t n_contracts;
+    size_t n_tickers;
+    const uint32_t *ticker_id;
+    const double *S0;
+    const double *K;
+    const double *r;
+    const double *sigma;
+    const double *T;
+    const double *market_price;
+    const option_type *type;
+    const char (*tickers)[MARKET_TICKER_LEN];
+    void *map;                  // Base of the mapping
+    size_t map_size;
+} market_data;
+
+// Map and validate a contract file. Returns 0, or -1 if it cannot be read or is malformed
+int market_data_open(market_data *md, const char *path);
+
+// Unmap a contract file
+void market_data_close(market_data *md);
+
+// Zero-copy batch inputs over the mapped columns (sigma = the file's volatilities)
+bs_batch_inputs market_data_bs_inputs(const market_data *md);
+iv_batch_inputs market_data_iv_inputs(const market_data *md);
+
+// Builds a contract file in memory, column by column
+typedef struct {
+    size_t n_contracts;
+    size_t capacity;
+    size_t n_tickers;
+    size_t ticker_capacity;
+    uint32_t *ticker_id;
+    double *values[MARKET_COL_PRICE];   // values[c - 1] = column c, for MARKET_COL_S0..MARKET_COL_PRICE
+    int32_t *type;
+    char (*tickers)[MARKET_TICKER_LEN];
+    uint32_t *ticker_slots;             // Open-addressing table: ticker index + 1, 0 = empty
+    size_t n_slots;
+} market_writer;
+
+// Start an empty writer
+void market_writer_init(market_writer *w);
+
+// Append one contract. Returns 0, or -1 if out of memory or there are too many tickers
+int market_writer_add(market_writer *w, const market_record *rec);
+
+// Write everything added so far as a contract file. Returns 0, or -1 on I/O error
+int market_writer_save(const market_writer *w, const char *path);
+
+// Release a writer's storage
+void market_writer_free(market_writer *w);
+
+// Streaming CSV reader: ticker,S0,K,r,sigma,days,market_price[,call|put]
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;                 // Bytes in buf
+    size_t pos;                 // Start of the next unread line
+    int eof;
+    size_t n_bad;               // Lines skipped as malformed (comments and blanks excluded)
+} csv_stream;
+
+// Open a CSV file for streaming. Returns 0, or -1 if it cannot be opened
+int csv_stream_open(csv_stream *cs, const char *path);
+
+// Next valid record: 1 = rec filled, 0 = end of file, -1 = read error
+int csv_stream_next(csv_stream *cs, market_record *rec);
+
+// Close the stream
+void csv_stream_close(csv_stream *cs);
+
+// Convert a CSV file into a contract file. Returns the number of contracts, or -1 on error
+long market_data_convert_csv(const char *csv_path, const char *out_path, size_t *n_bad);
+
+#endif //MONTE_CARLO_OPTION_PRICING_MARKET_DATA_H
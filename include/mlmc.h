@@ -0,0 +1,69 @@
+//
+// Multilevel Monte Carlo Header
+//
+// Prices the continuous-time limit of a path option (average over the
+// whole life, continuously monitored barrier) without simulating every
+// path on a fine grid. Level l simulates on base_steps * M^l steps; the
+// estimate is E[P_0] + Σ E[P_l - P_(l-1)], where each correction comes
+// from a fine and a coarse path driven by the same Brownian increments.
+// The corrections shrink quickly, so most paths run on the cheap coarse
+// grids: for a target RMSE ε the cost is near O(ε^-2) instead of the
+// O(ε^-3) of one fine grid with enough paths.
+//
+// Reference: Giles, "Multilevel Monte Carlo Path Simulation" (2008)
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_MLMC_H
+#define MONTE_CARLO_OPTION_PRICING_MLMC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "include/option.h"
+#include "include/monte_carlo.h"
+
+// Most levels one run can use
+#define MLMC_MAX_LEVELS 12u
+
+// Path-steps per chunk task: coarse levels get long chunks, fine levels
+// short ones, so every task costs about the same
+#define MLMC_CHUNK_STEPS 65536u
+
+typedef struct {
+    size_t base_steps;      // Time steps on level 0 (>= 1)
+    unsigned refinement;    // M: steps multiply by this per level (>= 2)
+    unsigned max_levels;    // Most levels (1..MLMC_MAX_LEVELS)
+    uint32_t pilot_paths;   // Samples per level before its variance is used (> 0)
+} mlmc_options;
+
+// What a run did, level by level (discounted)
+typedef struct {
+    unsigned n_levels;
+    uint64_t n_paths[MLMC_MAX_LEVELS];      // Samples of P_l - P_(l-1)
+    double mean[MLMC_MAX_LEVELS];           // Mean correction (level 0: mean of P_0)
+    double variance[MLMC_MAX_LEVELS];       // Variance of one sample of the correction
+    double bias;                            // Estimated |E[P_(L-1)] - E[P]| of the finest level
+    double cost;                            // Time steps simulated, fine and coarse
+    int converged;                          // 1 if the RMSE target was met within n_sim
+} mlmc_report;
+
+// Two steps on level 0, each level twice as fine, up to 10 levels, 1024 pilot paths
+mlmc_options mlmc_options_default(void);
+
+// Price opt's continuous-time limit under GBM to RMSE opts->abs_tol (or
+// opts->rel_tol × price): half the MSE for sampling error, half for bias.
+// opts->n_sim caps the samples of any one level (rounded up to whole
+// chunks); opt->n_steps, variance reduction and the sampler are ignored.
+// report may be NULL.
+// Returns NAN on invalid input or out of memory
+mc_result price_path_mlmc(
+    const path_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    const mlmc_options *mlmc,
+    mlmc_report *report
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_MLMC_H
@@ -0,0 +1,126 @@
+//
+// Market Models Header
+//
+// What drives the stock between monitoring dates. A market_model names the
+// dynamics and their parameters; model_path_init() turns it into per-step
+// constants for one contract and picks the block simulator for that model
+// once. Every simulator runs a whole block of paths through every step, so
+// the hot loop makes no indirect call per step or per path.
+//
+//   MODEL_GBM        dS = r S dt + σ S dW                (exact log step)
+//   MODEL_HESTON     dS = r S dt + √v S dW,  dv = κ(θ - v) dt + ξ √v dW_v,
+//                    corr(dW, dW_v) = ρ                  (QE or truncated Euler)
+//   MODEL_LOCAL_VOL  dS = r S dt + σ(t, S) S dW          (log-Euler on a grid)
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_MODEL_H
+#define MONTE_CARLO_OPTION_PRICING_MODEL_H
+
+#include <stddef.h>
+#include "include/arena.h"
+#include "include/rng.h"
+#include "include/gbm.h"
+#include "include/option.h"
+
+// Most paths one model_path_simulate() call may run
+#define MODEL_BLOCK_PATHS 256u
+
+// Uniform ln S nodes per time step in the precomputed local-vol table
+#define MODEL_LV_NODES 512u
+
+typedef enum {
+    MODEL_GBM = 0,
+    MODEL_HESTON = 1,
+    MODEL_LOCAL_VOL = 2
+} model_kind;
+
+typedef enum {
+    HESTON_QE = 0,          // Andersen's quadratic-exponential variance step
+    HESTON_EULER = 1        // Full-truncation Euler (v+ = max(v, 0) in drift and diffusion)
+} heston_scheme;
+
+typedef struct {
+    double v0;              // Initial variance
+    double kappa;           // Mean-reversion speed κ
+    double theta;           // Long-run variance θ
+    double xi;              // Volatility of variance ξ
+    double rho;             // Correlation of the stock and variance shocks ρ
+    heston_scheme scheme;
+} heston_params;
+
+// σ(t, S) on a rectangular grid: bilinear in (t, ln S), flat beyond the edges
+typedef struct {
+    size_t n_times;
+    size_t n_spots;
+    const double *times;    // Increasing, n_times entries
+    const double *spots;    // Increasing, n_spots entries (> 0)
+    const double *sigma;    // sigma[i * n_spots + j] = σ(times[i], spots[j])
+} local_vol_surface;
+
+typedef struct {
+    model_kind kind;
+    double S0;                          // Initial stock price
+    double r;                           // Risk-free interest rate
+    double sigma;                       // MODEL_GBM: volatility
+    heston_params heston;               // MODEL_HESTON
+    const local_vol_surface *local_vol; // MODEL_LOCAL_VOL (caller keeps it alive)
+} market_model;
+
+typedef struct model_path model_path;
+
+// Block simulator: n paths through every step, each step folded into up
+// (and into down with negated shocks, if down is not NULL)
+typedef void (*model_block_fn)(const model_path *p, rng_state *rng, size_t n,
+                               path_accumulator *up, path_accumulator *down);
+
+// Per-contract constants for one model on an equal grid of n_steps steps
+struct model_path {
+    model_kind kind;
+    model_block_fn simulate;    // Chosen once by model_path_init()
+    double S0;
+    size_t n_steps;
+    double dt;
+    double bridge_sigma;        // σ for the continuous-barrier correction (GBM only, else 0)
+    gbm_path gbm;               // MODEL_GBM
+    // MODEL_HESTON: per-step constants of the variance and log-price steps
+    heston_params heston;
+    double h_decay;             // e^(-κ dt)
+    double h_s2_v, h_s2_c;      // Conditional variance of v(t+dt): h_s2_v v + h_s2_c
+    double h_k0, h_k1, h_k2, h_k3, h_k4;
+    double r_dt;                // r dt
+    double sqrt_dt;
+    // MODEL_LOCAL_VOL: lv_table[t * MODEL_LV_NODES + j] = σ(t dt, e^(lv_x0 + j / lv_inv_dx))
+    double lv_x0;
+    double lv_inv_dx;
+    double *lv_table;
+    int lv_heap;                // Nonzero if lv_table is malloc-ed (else it lives in an arena)
+};
+
+// Constructors for the three models
+market_model model_gbm(double S0, double r, double sigma);
+market_model model_heston(double S0, double r, const heston_params *params);
+market_model model_local_vol(double S0, double r, const local_vol_surface *surface);
+
+// Semi-analytic Heston price of a European call (reference for the simulators)
+double heston_call_price(double S0, double K, double r, double T, const heston_params *h);
+
+// σ(t, S) interpolated on a surface (the reference the precomputed table samples)
+double local_vol_at(const local_vol_surface *surface, double t, double S);
+
+// Precompute the per-step constants. Returns 0, or -1 on invalid input or out of memory
+int model_path_init(model_path *p, const market_model *m, double T, size_t n_steps);
+
+// Arena bytes model_path_init_arena() takes for this model and step count
+size_t model_path_bytes(const market_model *m, size_t n_steps);
+
+// model_path_init() with any tables taken from `arena` (released by rewinding it)
+int model_path_init_arena(model_path *p, const market_model *m, double T, size_t n_steps, mc_arena *arena);
+
+// Release a model_path's storage (nothing for an arena one)
+void model_path_free(model_path *p);
+
+// Run n <= MODEL_BLOCK_PATHS paths through every step (accumulators already initialized)
+void model_path_simulate(const model_path *p, rng_state *rng, size_t n,
+                         path_accumulator *up, path_accumulator *down);
+
+#endif //MONTE_CARLO_OPTION_PRICING_MODEL_H
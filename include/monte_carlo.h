@@ -5,16 +5,329 @@
 #ifndef MONTE_CARLO_OPTION_PRICING_MC_H
 #define MONTE_CARLO_OPTION_PRICING_MC_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include "include/rng.h"
+#include "include/option.h"
+#include "include/model.h"
+#include "include/stats.h"
+#include "include/arena.h"
 
-// Monte Carlo pricing for European call option
+// Monte Carlo pricing for European call option (draws all shocks from `rng`)
 double price_european_call_mc(
     double S0,
     double K,
     double r,
     double sigma,
     double T,
-    uint32_t n_sim
+    uint32_t n_sim,
+    rng_state *rng
+);
+
+// Paths per chunk in the threaded engine. Each chunk draws from its own RNG
+// substream, so changing this value changes results for a given seed.
+#define MC_CHUNK_PATHS 16384u
+
+// Threaded Monte Carlo pricing for European call option.
+// Bit-identical for a given seed regardless of n_threads (0 = all cores).
+double price_european_call_mc_mt(
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    uint32_t n_sim,
+    uint64_t seed,
+    unsigned n_threads
+);
+
+// Variance reduction flags for mc_options.variance_reduction (may be OR-ed)
+#define MC_VR_NONE        0u
+#define MC_VR_ANTITHETIC  (1u << 0)   // (Z, -Z) path pairs
+#define MC_VR_CONTROL     (1u << 1)   // Terminal price S(T) as control variate
+
+// Where the shocks come from (mc_options.sampler)
+typedef enum {
+    MC_SAMPLER_PSEUDO = 0,   // xoshiro256** + Box-Muller
+    MC_SAMPLER_SOBOL = 1     // Randomized QMC: digitally shifted Sobol + inverse CDF
+} mc_sampler;
+
+// Arithmetic of the European pseudo-random kernels (mc_options.precision)
+typedef enum {
+    MC_PRECISION_DOUBLE = 0, // Double throughout
+    MC_PRECISION_FLOAT = 1   // Float shocks, prices and payoffs; double statistics
+} mc_precision;
+
+// Engine options - start from mc_options_default() and override fields
+typedef struct {
+    uint32_t n_sim;               // Paths to simulate (in total over all replicates)
+    uint64_t seed;                // Seed for the RNG substreams
+    unsigned n_threads;           // Worker threads (0 = all cores)
+    unsigned variance_reduction;  // MC_VR_* flags (pseudo-random sampler only)
+    mc_sampler sampler;           // Pseudo-random or quasi-random shocks
+    unsigned n_replicates;        // Independent QMC replicates for the error estimate (Sobol: >= 2,
+                                  // fewer fails with NAN - one replicate has no spread to measure)
+    double abs_tol;               // Stop once std error <= abs_tol (0 = off)
+    double rel_tol;               // Stop once std error <= rel_tol * price (0 = off)
+    uint32_t batch_paths;         // Paths between tolerance checks (0 = MC_DEFAULT_BATCH_PATHS)
+    mc_precision precision;       // European pseudo-random engine only; others use double
+} mc_options;
+
+// Paths between early-stopping checks unless mc_options.batch_paths says otherwise
+#define MC_DEFAULT_BATCH_PATHS (4u * MC_CHUNK_PATHS)
+
+// Engine output
+typedef struct {
+    double price;       // Discounted price estimate
+    double std_error;   // Standard error of the estimate
+    uint64_t n_paths;   // Paths actually simulated
+} mc_result;
+
+// Option sensitivities (vega and rho per unit of sigma and r, theta per year)
+typedef struct {
+    double delta;       // dV/dS0
+    double gamma;       // d²V/dS0²
+    double vega;        // dV/dsigma
+    double rho;         // dV/dr
+    double theta;       // -dV/dT (value lost per year as expiry approaches)
+} option_greeks;
+
+mc_options mc_options_default(void);
+
+// Full MC engine: European call or put with optional variance reduction
+mc_result price_european_mc(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+);
+
+// Price n European options sharing (S0, r, sigma, T) from one set of paths.
+// Returns 0, or -1 on failure (results set to NAN)
+int price_european_chain_mc(
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results
+);
+
+// Statistics of a pseudo-random run, kept so the run can be extended later
+typedef struct {
+    mc_moments moments;     // Every sample so far
+    uint32_t n_chunks;      // Substreams used; an extension starts at the next one
+} mc_run_state;
+
+// Continue a run of one option until it holds opts->n_sim paths in total (or
+// meets opts' tolerance). A zeroed state starts a run exactly like
+// price_european_mc(). Returns 0, or -1 on invalid input, Sobol, or out of memory
+int price_european_resume_mc(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    mc_run_state *state,
+    mc_result *result
+);
+
+// Price and Greeks of one option from a single simulation
+mc_result price_european_greeks_mc(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+// Chain pricing plus per-contract Greeks and their standard errors (greeks_se may be NULL)
+int price_european_chain_greeks_mc(
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+// One of n_ranks cooperating processes sharing each batch of a chain run
+// (see distributed.h for the MPI transport)
+typedef struct {
+    unsigned rank;          // This process, 0..n_ranks-1
+    unsigned n_ranks;
+    // Called by every rank once it has filled the chunk slots it owns (see
+    // mc_shard_range): make all n_chunks slots of slot_bytes each, chunk-major,
+    // identical on every rank. Returns 0, or -1 on failure
+    int (*exchange)(void *ctx, void *slots, size_t slot_bytes, uint32_t n_chunks);
+    void *ctx;
+    // Called by every rank once, after its buffers are allocated and before
+    // the first exchange, with ok = 1 if they were: returns 1 only if ok is 1
+    // on every rank. Without it (NULL), a rank that runs out of memory
+    // returns -1 alone and leaves the others waiting in their exchange
+    int (*agree)(void *ctx, int ok);
+} mc_shard;
+
+// Chunks [*first, *first + *count) of a batch of n_chunks belong to `rank`
+void mc_shard_range(uint32_t n_chunks, unsigned rank, unsigned n_ranks, uint32_t *first, uint32_t *count);
+
+// slot_bytes a sharded chain run passes to exchange: the statistics of
+// n_contracts contracts (greeks = 0) or their Greek accumulators (greeks = 1)
+size_t mc_shard_slot_bytes(size_t n_contracts, int greeks);
+
+// price_european_chain_greeks_mc() with the paths of every batch split across
+// shard's ranks; every rank gets results bit-identical to the single-process
+// run (greeks may be NULL). Pseudo-random sampler only. Returns 0, or -1 on
+// invalid input, Sobol, a failed exchange, or out of memory
+int price_european_chain_sharded_mc(
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    const mc_shard *shard,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+// Path-dependent option (Asian, barrier) on opt->n_steps monitoring dates
+mc_result price_path_mc(
+    const path_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+);
+
+// Path-dependent option under a market model (GBM, Heston, local vol; see model.h)
+mc_result price_path_model_mc(
+    const path_option *opt,
+    const market_model *model,
+    double T,
+    const mc_options *opts
+);
+
+// European basket, spread, best-of or worst-of option on opt->n_assets
+// correlated GBM assets (corr: row-major n_assets × n_assets correlation matrix)
+mc_result price_basket_mc(
+    const basket_option *opt,
+    const double *S0,
+    const double *sigma,
+    const double *corr,
+    double r,
+    double T,
+    const mc_options *opts
+);
+
+// Largest request a reusable engine context (mc_engine) is sized for
+typedef struct {
+    size_t max_contracts;        // Contracts per chain call
+    uint32_t max_paths;          // Paths per call (per batch when a tolerance is set)
+    unsigned max_replicates;     // Sobol replicates per call (0 = pseudo-random only)
+    int greeks;                  // Nonzero: room for the Greek accumulators too
+    size_t max_steps;            // Monitoring dates of a local-vol or Sobol path option (its tables)
+    size_t max_assets;           // Assets per basket (its constants and Cholesky factor)
+    uint32_t max_american_paths; // Paths per mc_engine_price_american() call (0 = none; lsm.h)
+} mc_engine_limits;
+
+// Reusable pricing context. Every per-call buffer comes from one arena,
+// reserved by mc_engine_init() and rewound at the end of each call: the
+// statistics slots and substreams, the Brownian bridge and local-vol
+// tables of path options, a basket's Cholesky factor, and the per-path
+// state and normal equations of the LSM pricer. Within its limits a call
+// on an engine does not allocate; the only memory outside the arena is the
+// task pool's queues, which grow to their peak depth once per process, and
+// the CUDA backend's device sums (GPU=1 builds). The price_* functions run
+// on a temporary arena sized for their request. Not thread-safe: give each
+// pricing thread its own
+typedef struct {
+    mc_arena arena;
+} mc_engine;
+
+// Reserve the arena for requests up to `limits`. Returns 0, or -1 out of memory
+int mc_engine_init(mc_engine *engine, const mc_engine_limits *limits);
+
+// Release the arena
+void mc_engine_free(mc_engine *engine);
+
+// Nonzero if the engine has room for a request (greeks: with Greek accumulators)
+int mc_engine_fits(const mc_engine *engine, size_t n_contracts, const mc_options *opts, int greeks);
+
+// Nonzero if `bytes` more fit in the engine's arena (for drivers built on an engine, e.g. lsm.h)
+int mc_engine_room(const mc_engine *engine, size_t bytes);
+
+// price_european_chain_mc() (greeks = NULL) or price_european_chain_greeks_mc().
+// Returns -1 with NAN outputs if the request does not fit
+int mc_engine_price_chain(
+    mc_engine *engine,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+// price_european_resume_mc() on an engine
+int mc_engine_resume(
+    mc_engine *engine,
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    mc_run_state *state,
+    mc_result *result
+);
+
+// price_path_model_mc() on an engine
+mc_result mc_engine_price_path(
+    mc_engine *engine,
+    const path_option *opt,
+    const market_model *model,
+    double T,
+    const mc_options *opts
+);
+
+// price_basket_mc() on an engine
+mc_result mc_engine_price_basket(
+    mc_engine *engine,
+    const basket_option *opt,
+    const double *S0,
+    const double *sigma,
+    const double *corr,
+    double r,
+    double T,
+    const mc_options *opts
 );
 
 // Analytical Black-Scholes price for European call option
@@ -26,4 +339,25 @@ double price_european_call_bs(
     double T
 );
 
+// Analytical Black-Scholes Greeks for a European call or put
+option_greeks greeks_european_bs(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T
+);
+
+// Exact price of a discretely monitored geometric-average Asian option
+double price_geometric_asian_bs(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    size_t n_steps
+);
+
 #endif //MONTE_CARLO_OPTION_PRICING_MC_H
\ No newline at end of file
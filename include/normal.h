@@ -8,4 +8,10 @@
 // Standard normal CDF - P(Z ≤ x) where Z ~ N(0,1)
 double normal_cdf(double x);
 
+// Standard normal density φ(x)
+double normal_pdf(double x);
+
+// Inverse standard normal CDF - the x with P(Z ≤ x) = p, for p in (0, 1)
+double normal_inv_cdf(double p);
+
 #endif //MONTE_CARLO_OPTION_PRICING_NORMAL_H
\ No newline at end of file
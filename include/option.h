@@ -1,3 +1,119 @@
+//
+// Option Payoff Functions Header
+//
+// European payoffs look only at S(T). Path-dependent payoffs (Asian,
+// barrier) are evaluated incrementally with a path_accumulator: it is
+// updated once per time step and keeps O(1) state per path. Basket
+// payoffs read the terminal prices of several assets, one row per asset.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_OPTION_H
+#define MONTE_CARLO_OPTION_PRICING_OPTION_H
+
+#include <stddef.h>
+
+typedef enum {
+    OPTION_CALL = 0,    // Right to buy at K:  max(S - K, 0)
+    OPTION_PUT = 1      // Right to sell at K: max(K - S, 0)
+} option_type;
+
 double call_payoff(double S, double K);
 double put_payoff(double S, double K);
 
+// Sum of payoffs over a block of terminal prices (branch-free, SIMD when available)
+double call_payoff_sum(const double *S, size_t n, double K);
+double put_payoff_sum(const double *S, size_t n, double K);
+
+// Per-path payoffs for a block of terminal prices: out[i] = payoff(S[i], K)
+void payoff_fill(option_type type, const double *S, size_t n, double K, double *out);
+
+// Single-precision version for the float32 engine
+void payoff_fill_f32(option_type type, const float *S, size_t n, float K, float *out);
+
+// What a path-dependent payoff averages over the monitoring dates
+typedef enum {
+    AVERAGE_NONE = 0,           // Payoff on S(T)
+    AVERAGE_ARITHMETIC = 1,     // Payoff on (1/n) Σ S(t_j)
+    AVERAGE_GEOMETRIC = 2       // Payoff on (Π S(t_j))^(1/n)
+} average_type;
+
+typedef enum {
+    BARRIER_NONE = 0,
+    BARRIER_UP_OUT = 1,         // Worthless once S >= H
+    BARRIER_UP_IN = 2,          // Worthless unless S >= H at some point
+    BARRIER_DOWN_OUT = 3,       // Worthless once S <= H
+    BARRIER_DOWN_IN = 4         // Worthless unless S <= H at some point
+} barrier_type;
+
+typedef enum {
+    MONITOR_DISCRETE = 0,       // Barrier checked only at the time steps
+    MONITOR_CONTINUOUS = 1      // Checked between steps too (Brownian-bridge correction)
+} barrier_monitoring;
+
+// A path-dependent European-style option on an equal grid of n_steps dates
+typedef struct {
+    option_type type;           // Call or put on the (averaged) price
+    double strike;
+    average_type average;
+    barrier_type barrier;
+    double barrier_level;       // H (ignored for BARRIER_NONE)
+    barrier_monitoring monitoring;
+    size_t n_steps;             // Monitoring dates t_j = j * T / n_steps
+} path_option;
+
+// Per-path running state for a block of paths (arrays owned by the caller)
+typedef struct {
+    const path_option *opt;
+    double log_barrier;         // ln H
+    double bridge_var;          // σ² dt, for the bridge crossing probability
+    size_t steps_seen;
+    double *sum;                // Σ S(t_j)
+    double *log_sum;            // Σ ln S(t_j)
+    double *log_last;           // ln S at the previous step
+    double *survival;           // P(barrier not hit so far | sampled points)
+    double *last;               // S at the latest step
+} path_accumulator;
+
+// Number of double arrays of length n_paths that a path_accumulator needs
+#define PATH_ACCUMULATOR_ARRAYS 5
+
+// Point acc's arrays into `storage` (PATH_ACCUMULATOR_ARRAYS * n_paths doubles) and reset
+void path_accumulator_init(path_accumulator *acc, const path_option *opt, double S0,
+                           double sigma, double dt, double *storage, size_t n_paths);
+
+// Fold one time step into the running state (a gbm_step_hook; ctx = path_accumulator)
+void path_accumulator_update(void *ctx, size_t step, const double *S, size_t n_paths);
+
+// Undiscounted payoff of every path once all steps are in
+void path_payoff_fill(const path_accumulator *acc, size_t n_paths, double *out);
+
+// Undiscounted geometric-average payoff (no barrier): the Asian control variate
+void path_geometric_payoff_fill(const path_accumulator *acc, size_t n_paths, double *out);
+
+// What a multi-asset payoff is written on (w = basket_option.weights)
+typedef enum {
+    BASKET_AVERAGE = 0,         // Σ w_a S_a
+    BASKET_SPREAD = 1,          // w_0 S_0 - w_1 S_1 (exactly two assets)
+    BASKET_BEST_OF = 2,         // max_a w_a S_a
+    BASKET_WORST_OF = 3         // min_a w_a S_a
+} basket_kind;
+
+// A European call or put on a combination of n_assets terminal prices
+typedef struct {
+    option_type type;
+    basket_kind kind;
+    double strike;
+    size_t n_assets;
+    const double *weights;      // n_assets weights (NULL = all 1)
+} basket_option;
+
+// Per-path payoffs: S holds n_assets rows of n terminal prices (row a = asset a)
+void basket_payoff_fill(const basket_option *opt, const double *S, size_t n, double *out);
+
+// Per-path Σ c_a S_a with c = basket_linear_weights(); out may not alias S
+void basket_linear_fill(const basket_option *opt, const double *S, size_t n, double *out);
+
+// Coefficients c of the linear part of a basket payoff (the control variate)
+void basket_linear_weights(const basket_option *opt, double *c);
+
+#endif //MONTE_CARLO_OPTION_PRICING_OPTION_H
@@ -0,0 +1,26 @@
+//
+// Parallel Execution Helpers Header
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_PARALLEL_H
+#define MONTE_CARLO_OPTION_PRICING_PARALLEL_H
+
+#include <stdint.h>
+
+// Most threads the work-stealing pool will start
+#define PARALLEL_MAX_WORKERS 255u
+
+// Work item callback: process task number `task` using shared context `ctx`
+typedef void (*parallel_task_fn)(void *ctx, uint32_t task);
+
+// Number of online CPU cores (used when a caller asks for 0 threads)
+unsigned parallel_default_threads(void);
+
+// Run fn(ctx, 0..n_tasks-1) on up to n_threads threads, returning when all are done.
+// Tasks may call parallel_for() themselves; nested tasks are stolen by idle threads
+void parallel_for(uint32_t n_tasks, unsigned n_threads, parallel_task_fn fn, void *ctx);
+
+// Pool threads started so far (the pool grows on demand and is never shut down)
+unsigned parallel_pool_workers(void);
+
+#endif //MONTE_CARLO_OPTION_PRICING_PARALLEL_H
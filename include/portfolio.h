@@ -0,0 +1,42 @@
+//
+// Portfolio Pricing Header
+//
+// Prices many European contracts at once. Contracts on the same
+// underlying and maturity share one set of simulated terminal prices.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_PORTFOLIO_H
+#define MONTE_CARLO_OPTION_PRICING_PORTFOLIO_H
+
+#include <stddef.h>
+#include "include/stock.h"
+#include "include/option.h"
+#include "include/monte_carlo.h"
+
+// One European contract: the underlying's parameters plus the option terms
+typedef struct {
+    stock_params stock;
+    double strike;
+    option_type type;
+} option_contract;
+
+// Price n contracts; results[i] belongs to contracts[i].
+// Returns 0, or -1 on failure (failed results are NAN)
+int price_portfolio_mc(
+    const option_contract *contracts,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results
+);
+
+// Same, plus the Greeks of every contract (greeks_se may be NULL)
+int price_portfolio_greeks_mc(
+    const option_contract *contracts,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_PORTFOLIO_H
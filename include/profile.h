@@ -0,0 +1,111 @@
+//
+// Hot-Path Profiling Header
+//
+// Scoped timers and event counters for the engine's hot paths, compiled in
+// only when MC_PROFILE is defined (`make profile`). Otherwise every macro
+// below expands to nothing, so normal builds carry no timing code at all.
+//
+//   PROFILE_SCOPE(PROFILE_GBM);          // Times the rest of the enclosing block
+//   PROFILE_COUNT(PROFILE_PATHS, n);     // Adds n to a counter
+//
+// Timers read the TSC on x86 (the monotonic clock elsewhere). Totals are
+// kept per lane - the pool thread number of parallel_for(), 0 outside the pool -
+// and, with MC_PROFILE_HIST (`make profile PROFILE_HIST=1`), as a per-lane
+// log2 histogram of cycles per scope. Phases nest (a chunk contains its
+// RNG, GBM and payoff scopes), so phase times are inclusive.
+//
+// At exit the totals go to stderr as a table, or as JSON to the file named
+// by MC_PROFILE_OUT ("-" for stderr).
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_PROFILE_H
+#define MONTE_CARLO_OPTION_PRICING_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "include/simd.h"
+
+typedef enum {
+    PROFILE_RNG = 0,        // normal_random, normal_fill
+    PROFILE_GBM = 1,        // exp() in simulate_gbm, gbm_terminal_fill, gbm_path_step
+    PROFILE_PAYOFF = 2,     // Payoff sums and per-path payoffs
+    PROFILE_CHUNK = 3,      // One engine chunk, end to end
+    PROFILE_CSV = 4,        // csv_stream_next (parsing one record)
+    PROFILE_N_PHASES = 5
+} profile_phase;
+
+typedef enum {
+    PROFILE_PATHS = 0,      // Paths simulated by the engines
+    PROFILE_NORMALS = 1,    // Normal shocks drawn from the pseudo-random streams
+    PROFILE_CHUNKS = 2,     // Engine chunks run
+    PROFILE_BATCHES = 3,    // Batches between early-stopping checks
+    PROFILE_CSV_ROWS = 4,   // Records parsed from CSV
+    PROFILE_N_COUNTERS = 5
+} profile_counter;
+
+// Lanes with their own totals (workers beyond the last share it)
+#define PROFILE_MAX_LANES 64u
+
+// Histogram bucket b counts scopes that took [2^b, 2^(b+1)) ticks
+#define PROFILE_HIST_BUCKETS 48u
+
+// 1 if this build was compiled with MC_PROFILE
+int profile_enabled(void);
+
+// Zero every timer, counter and histogram
+void profile_reset(void);
+
+// Totals so far as one JSON document ({"enabled": false} without MC_PROFILE)
+void profile_write_json(FILE *out);
+
+// Totals so far as a table
+void profile_print(FILE *out);
+
+#ifdef MC_PROFILE
+
+#if !defined(__GNUC__)
+#error "MC_PROFILE needs GCC or Clang (scoped timers use __attribute__((cleanup)))"
+#endif
+
+#ifdef MC_SIMD_X86
+#include <x86intrin.h>
+static inline uint64_t profile_now(void) {
+    return __rdtsc();
+}
+#else
+uint64_t profile_clock_ns(void);
+static inline uint64_t profile_now(void) {
+    return profile_clock_ns();
+}
+#endif
+
+typedef struct {
+    profile_phase phase;
+    uint64_t start;
+} profile_scope;
+
+// Record a finished scope (called by the cleanup attribute of PROFILE_SCOPE)
+void profile_scope_end(const profile_scope *scope);
+
+// Add n to a counter of the calling thread's lane
+void profile_count(profile_counter counter, uint64_t n);
+
+// Make `lane` the calling thread's lane; returns the previous one
+unsigned profile_lane_set(unsigned lane);
+
+#define PROFILE_SCOPE(phase) \
+    __attribute__((cleanup(profile_scope_end))) profile_scope profile_scope_##phase = { (phase), profile_now() }
+#define PROFILE_COUNT(counter, n) profile_count((counter), (uint64_t)(n))
+#define PROFILE_LANE_BEGIN(lane) unsigned profile_prev_lane = profile_lane_set(lane)
+#define PROFILE_LANE_END() profile_lane_set(profile_prev_lane)
+
+#else
+
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#define PROFILE_LANE_BEGIN(lane) ((void)0)
+#define PROFILE_LANE_END() ((void)0)
+
+#endif
+
+#endif //MONTE_CARLO_OPTION_PRICING_PROFILE_H
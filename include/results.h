@@ -0,0 +1,146 @@
+//
+// Results Output Header
+//
+// Per-contract results leave the pricers through a results_writer: the
+// caller pushes rows, and a dedicated writer thread hands full batches to
+// one or more sinks. Pricing threads only copy rows into a buffer; they
+// wait only when every buffer is still queued for a slow sink.
+//
+// Sinks provided here:
+//   columnar - binary record batches (layout below), readable in place
+//   CSV      - one header line, then one line per row, written per batch
+// Anything else (the human-readable table of test_real_stocks, say) is a
+// results_sink with its own write callback.
+//
+// Columnar file layout (native byte order, checked on open):
+//   results_file_header
+//   record batches, each a results_batch_header followed by its columns;
+//   every batch and every column starts on a 64-byte boundary, so a
+//   mapped batch's columns can be used as arrays (or wrapped by Arrow)
+//   without copying
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_RESULTS_H
+#define MONTE_CARLO_OPTION_PRICING_RESULTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "include/option.h"
+#include "include/monte_carlo.h"
+
+// Bytes per ticker name, including the terminating NUL
+#define RESULTS_TICKER_LEN 16u
+
+// Most sinks one writer feeds
+#define RESULTS_MAX_SINKS 4u
+
+// Batches a writer buffers before producers wait
+#define RESULTS_WRITER_BUFFERS 4u
+
+// Rows per batch when the caller passes 0
+#define RESULTS_DEFAULT_BATCH 4096u
+
+// One priced contract: its inputs, the estimate, and what it cost
+typedef struct {
+    uint64_t id;                        // Caller's contract number
+    char ticker[RESULTS_TICKER_LEN];
+    option_type type;
+    double S0;
+    double K;
+    double r;
+    double sigma;
+    double T;                           // Years
+    double market_price;                // 0 = none
+    double price;
+    double std_error;
+    uint64_t n_paths;
+    option_greeks greeks;               // NAN when not computed
+    double seconds;                     // Wall time spent pricing it
+} result_row;
+
+// Columns of a columnar results file, in file order
+typedef enum {
+    RESULTS_COL_ID = 0,                 // uint64_t
+    RESULTS_COL_TICKER = 1,             // char[RESULTS_TICKER_LEN]
+    RESULTS_COL_TYPE = 2,               // option_type, stored as int32_t
+    RESULTS_COL_S0 = 3,                 // double (this and the rest, except n_paths)
+    RESULTS_COL_K = 4,
+    RESULTS_COL_R = 5,
+    RESULTS_COL_SIGMA = 6,
+    RESULTS_COL_T = 7,
+    RESULTS_COL_MARKET_PRICE = 8,
+    RESULTS_COL_PRICE = 9,
+    RESULTS_COL_STD_ERROR = 10,
+    RESULTS_COL_N_PATHS = 11,           // uint64_t
+    RESULTS_COL_DELTA = 12,
+    RESULTS_COL_GAMMA = 13,
+    RESULTS_COL_VEGA = 14,
+    RESULTS_COL_RHO = 15,
+    RESULTS_COL_THETA = 16,
+    RESULTS_COL_SECONDS = 17,
+    RESULTS_N_COLUMNS = 18
+} results_column;
+
+typedef struct {
+    char magic[8];                      // "MCRES01" + NUL
+    uint32_t byte_order;                // 0x01020304 as written by the producer
+    uint32_t n_columns;                 // RESULTS_N_COLUMNS
+    uint64_t reserved[6];               // Zero (pads the header to 64 bytes)
+} results_file_header;
+
+typedef struct {
+    uint64_t n_rows;
+    uint64_t bytes;                     // This header, the columns and padding
+    uint64_t column[RESULTS_N_COLUMNS]; // Byte offset of each column from the batch start
+} results_batch_header;
+
+// Where a writer's batches go. write() runs on the writer thread only, one
+// batch at a time; close() (may be NULL) flushes and frees ctx
+typedef struct {
+    int (*write)(void *ctx, const result_row *rows, size_t n_rows);  // 0, or -1 on error
+    int (*close)(void *ctx);                                         // 0, or -1 on error
+    void *ctx;
+} results_sink;
+
+// Sinks writing to `path`. Return 0, or -1 if the file cannot be created
+int results_sink_columnar(results_sink *sink, const char *path);
+int results_sink_csv(results_sink *sink, const char *path);
+
+typedef struct results_writer results_writer;
+
+// Start a writer thread feeding n_sinks sinks (1..RESULTS_MAX_SINKS) with
+// batches of batch_rows rows (0 = RESULTS_DEFAULT_BATCH). The writer owns the
+// sinks from here on. Returns NULL on invalid input or failure (sinks closed)
+results_writer *results_writer_open(const results_sink *sinks, size_t n_sinks, size_t batch_rows);
+
+// Queue rows for writing, in push order. May be called from any thread.
+// Returns 0, or -1 once a sink has failed (rows are then dropped)
+int results_writer_push(results_writer *w, const result_row *rows, size_t n_rows);
+
+// Write everything pushed, stop the thread and close the sinks.
+// Returns 0, or -1 if any write or close failed
+int results_writer_close(results_writer *w);
+
+// A mapped columnar results file, read batch by batch
+typedef struct {
+    void *map;
+    size_t map_size;
+    size_t offset;                      // Next batch
+} results_file;
+
+// Columns of one record batch (pointers into the mapping; cast per results_column)
+typedef struct {
+    size_t n_rows;
+    const void *column[RESULTS_N_COLUMNS];
+} results_batch;
+
+// Map a columnar results file. Returns 0, or -1 if it cannot be read or is not one
+int results_file_open(results_file *f, const char *path);
+
+// Next batch: 1 = batch filled, 0 = end of file, -1 = malformed batch
+int results_file_next(results_file *f, results_batch *batch);
+
+// Unmap the file
+void results_file_close(results_file *f);
+
+#endif //MONTE_CARLO_OPTION_PRICING_RESULTS_H
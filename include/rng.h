@@ -2,14 +2,44 @@
 // Created by b2 on 12/28/25.
 //
 //Random Number Generator
+//
+// Every generator is an explicit rng_state object owned by the caller.
+// There is no hidden global state, so each thread can run its own stream.
+//
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifndef MONTE_CARLO_OPTION_PRICING_RNG_H
 #define MONTE_CARLO_OPTION_PRICING_RNG_H
 
-void rng_seed(uint32_t seed);
-double rng_lcg(void);
-double normal_random(void);
+// xoshiro256** generator state (256 bits, period 2^256 - 1)
+typedef struct {
+    uint64_t s[4];
+} rng_state;
+
+// Seed a stream (SplitMix64 expands the 64-bit seed into 256 bits of state)
+void rng_seed(rng_state *rng, uint64_t seed);
+
+// Advance the stream by 2^128 draws - used to carve out non-overlapping substreams
+void rng_jump(rng_state *rng);
+
+// Seed, then jump `stream` times: substream number `stream` of `seed`
+void rng_stream(rng_state *rng, uint64_t seed, uint64_t stream);
+
+// Raw 64-bit output
+uint64_t rng_next(rng_state *rng);
+
+// Uniform double in [0.0, 1.0)
+double random_double(rng_state *rng);
+
+// Standard normal N(0,1) sample
+double normal_random(rng_state *rng);
+
+// Batch of n standard normals (uses both Box-Muller outputs, SIMD when available)
+void normal_fill(rng_state *rng, double *out, size_t n);
+
+// Batch of n single-precision normals: one 64-bit draw per pair (float32 engine)
+void normal_fill_f32(rng_state *rng, float *out, size_t n);
 
-#endif //MONTE_CARLO_OPTION_PRICING_RNG_H
\ No newline at end of file
+#endif //MONTE_CARLO_OPTION_PRICING_RNG_H
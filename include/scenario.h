@@ -0,0 +1,38 @@
+//
+// Scenario Grid Pricing Header
+//
+// Reprices a book of European contracts under a grid of spot and
+// volatility shocks. Every scenario sees the same normal shocks (common
+// random numbers), so differences between grid points carry no sampling
+// noise beyond that of the repricing itself.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_SCENARIO_H
+#define MONTE_CARLO_OPTION_PRICING_SCENARIO_H
+
+#include <stddef.h>
+#include "include/portfolio.h"
+#include "include/monte_carlo.h"
+
+// One point of a stress grid, applied to every contract of the book
+typedef struct {
+    double spot_shift;      // S0 -> S0 * (1 + spot_shift)
+    double vol_shift;       // σ -> σ + vol_shift (absolute vol points)
+} scenario_shock;
+
+// Dense grid: out[i * n_vol + j] = { spot_shifts[i], vol_shifts[j] }
+void scenario_grid(const double *spot_shifts, size_t n_spot, const double *vol_shifts, size_t n_vol,
+                   scenario_shock *out);
+
+// Price every contract under every scenario: results[s * n_contracts + k] is
+// contract k under shocks[s]. Returns 0, or -1 on failure (results are NAN)
+int price_scenarios_mc(
+    const option_contract *contracts,
+    size_t n_contracts,
+    const scenario_shock *shocks,
+    size_t n_scenarios,
+    const mc_options *opts,
+    mc_result *results
+);
+
+#endif //MONTE_CARLO_OPTION_PRICING_SCENARIO_H
@@ -0,0 +1,110 @@
+//
+// Pricing Server Header
+//
+// A long-lived pricing daemon on a Unix stream socket. Clients write
+// fixed-size pricing_request records and read pricing_reply records back
+// (host byte order, matched by id; replies to one connection come back in
+// the order its requests arrived).
+//
+// Requests that arrive within a short window are coalesced into one batch.
+// The batch is split into groups that share an underlying and maturity
+// (S0, r, sigma, T) and path settings (n_sim, seed, variance reduction),
+// and each group is priced as one chain from one set of paths by a pool
+// of worker threads that lives as long as the server. A contract's price
+// does not depend on what it was batched with: it is bit-identical to
+// price_european_mc() with the same inputs and seed.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_SERVER_H
+#define MONTE_CARLO_OPTION_PRICING_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One contract to price (64 bytes on the wire)
+typedef struct {
+    uint64_t id;                    // Chosen by the client, echoed in the reply
+    double S0;                      // Spot price
+    double K;                       // Strike
+    double r;                       // Risk-free rate
+    double sigma;                   // Volatility
+    double T;                       // Time to maturity in years
+    uint64_t seed;                  // RNG seed of the paths
+    uint32_t n_sim;                 // Paths (0 = the server's default)
+    uint8_t type;                   // option_type: OPTION_CALL or OPTION_PUT
+    uint8_t variance_reduction;     // MC_VR_* flags
+    uint16_t reserved;              // Must be 0
+} pricing_request;
+
+// Result for one request (40 bytes on the wire)
+typedef struct {
+    uint64_t id;                    // pricing_request.id
+    double price;                   // NAN if status != 0
+    double std_error;
+    uint64_t n_paths;
+    int32_t status;                 // 0, or -1 for invalid input (n_sim over the server's
+                                    // max_n_sim included) or a failed engine call
+    uint32_t group_size;            // Contracts priced from the same paths (including this one)
+} pricing_reply;
+
+typedef struct {
+    const char *socket_path;        // Filesystem path of the listening socket
+    unsigned n_threads;             // Pricing threads (0 = all cores)
+    uint32_t window_us;             // How long the first request of a batch waits for company
+    uint32_t max_batch;             // Flush early once this many requests are waiting
+    uint32_t default_n_sim;         // Paths for requests with n_sim = 0
+    uint32_t max_n_sim;             // Requests asking for more paths get status -1
+                                    // (at least default_n_sim)
+    uint32_t max_backlog;           // Replies queued for a client that is not reading before
+                                    // it is dropped (at least max_batch)
+    double report_seconds;          // Print a latency line to stderr this often (0 = never)
+} pricing_server_config;
+
+// Requests served so far; latency is receipt of the request to its reply being
+// written (or queued, when the client's socket is full)
+typedef struct {
+    uint64_t n_requests;
+    uint64_t n_batches;
+    uint64_t n_groups;              // Engine calls (one per group)
+    double p50_us;                  // Over the last PRICING_LATENCY_SAMPLES requests
+    double p99_us;
+    double max_us;
+} pricing_server_stats;
+
+// Latencies kept for the percentiles
+#define PRICING_LATENCY_SAMPLES 65536u
+
+typedef struct pricing_server pricing_server;
+
+pricing_server_config pricing_server_config_default(void);
+
+// Bind the socket (replacing a stale one) and start the worker threads.
+// Returns NULL on invalid configuration or failure
+pricing_server *pricing_server_open(const pricing_server_config *config);
+
+// Serve until pricing_server_stop(). Returns 0, or -1 on a socket error
+int pricing_server_run(pricing_server *srv);
+
+// Run pricing_server_run() on a background thread. Returns 0 or -1
+int pricing_server_start(pricing_server *srv);
+
+// Ask the server to stop (safe to call from a signal handler)
+void pricing_server_stop(pricing_server *srv);
+
+// Stop, join every thread, remove the socket file and free the server
+void pricing_server_close(pricing_server *srv);
+
+// Counters and latency percentiles so far
+void pricing_server_get_stats(pricing_server *srv, pricing_server_stats *stats);
+
+// Client side: connect to a server. Returns a socket descriptor, or -1
+int pricing_client_connect(const char *socket_path);
+
+// Write n requests / read n replies in full. Return 0, or -1 on error or EOF
+int pricing_client_send(int fd, const pricing_request *requests, size_t n);
+int pricing_client_recv(int fd, pricing_reply *replies, size_t n);
+
+// Close a client connection
+void pricing_client_close(int fd);
+
+#endif //MONTE_CARLO_OPTION_PRICING_SERVER_H
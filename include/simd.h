@@ -0,0 +1,33 @@
+//
+// SIMD Dispatch Header
+//
+// Kernels with a vectorized variant ask simd_active() once per call and
+// pick the widest instruction set both the CPU and the caller allow.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_SIMD_H
+#define MONTE_CARLO_OPTION_PRICING_SIMD_H
+
+// Vectorized kernels are only compiled on x86 with GCC/Clang
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MC_SIMD_X86 1
+#endif
+
+typedef enum {
+    SIMD_SCALAR = 0,    // Portable C, one value at a time
+    SIMD_AVX2 = 1       // AVX2 + FMA, four doubles per instruction
+} simd_level;
+
+// Best level the running CPU supports
+simd_level simd_detect(void);
+
+// Level kernels should use: simd_detect() capped by simd_limit()
+simd_level simd_active(void);
+
+// Cap the level used by kernels (e.g. SIMD_SCALAR to benchmark the fallback)
+void simd_limit(simd_level max_level);
+
+// Human-readable name ("scalar", "avx2")
+const char *simd_level_name(simd_level level);
+
+#endif //MONTE_CARLO_OPTION_PRICING_SIMD_H
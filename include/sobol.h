@@ -0,0 +1,37 @@
+//
+// Sobol Low-Discrepancy Sequence Header
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_SOBOL_H
+#define MONTE_CARLO_OPTION_PRICING_SOBOL_H
+
+#include <stdint.h>
+#include "include/rng.h"
+
+// Dimensions with built-in direction numbers (Joe-Kuo new-joe-kuo-6.21201)
+#define SOBOL_MAX_DIM 21u
+
+// Bits per coordinate: up to 2^32 points per sequence
+#define SOBOL_BITS 32u
+
+typedef struct {
+    unsigned dim;                                 // Number of coordinates per point
+    uint32_t index;                               // Index of the next point
+    uint32_t x[SOBOL_MAX_DIM];                    // Current point (before shift)
+    uint32_t shift[SOBOL_MAX_DIM];                // Random digital shift (0 = unscrambled)
+    uint32_t v[SOBOL_MAX_DIM][SOBOL_BITS];        // Direction numbers
+} sobol_state;
+
+// Set up a `dim`-dimensional sequence at point 0. Returns 0, or -1 if dim is unsupported
+int sobol_init(sobol_state *s, unsigned dim);
+
+// Scramble with a random digital shift drawn from `rng` (randomized QMC)
+void sobol_scramble(sobol_state *s, rng_state *rng);
+
+// Jump to point number `index` (O(SOBOL_BITS * dim), for splitting work across threads)
+void sobol_skip(sobol_state *s, uint32_t index);
+
+// Write the next point (dim coordinates, each in (0, 1)) and advance
+void sobol_next(sobol_state *s, double *point);
+
+#endif //MONTE_CARLO_OPTION_PRICING_SOBOL_H
@@ -0,0 +1,41 @@
+//
+// Sample Statistics Header
+//
+// Online (Welford-style) statistics for an MC estimator Y and an optional
+// control variate X. Each chunk of paths fills its own accumulator; chunks
+// are merged in a fixed order, so results do not depend on thread scheduling.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_STATS_H
+#define MONTE_CARLO_OPTION_PRICING_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t n;       // Number of samples
+    double mean_y;    // Running mean of y
+    double m2_y;      // Σ (y - mean_y)²
+    double mean_x;    // Running mean of x (control variate, 0 if unused)
+    double m2_x;      // Σ (x - mean_x)²
+    double c_xy;      // Σ (x - mean_x)(y - mean_y)
+} mc_moments;
+
+// Add a block of samples (x may be NULL when there is no control variate)
+void moments_add_block(mc_moments *m, const double *y, const double *x, size_t n);
+
+// Same for float samples; every sum is still accumulated in double
+void moments_add_block_f32(mc_moments *m, const float *y, const float *x, size_t n);
+
+// Fold `from` into `into`
+void moments_merge(mc_moments *into, const mc_moments *from);
+
+// Sample mean and unbiased variance of y
+double moments_mean(const mc_moments *m);
+double moments_variance(const mc_moments *m);
+
+// Control-variate estimate: mean(y) - beta*(mean(x) - 0), with beta and the
+// residual variance estimated from the same samples (x must be centred on E[X])
+void moments_control(const mc_moments *m, double *mean, double *variance);
+
+#endif //MONTE_CARLO_OPTION_PRICING_STATS_H
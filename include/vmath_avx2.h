@@ -0,0 +1,319 @@
+//
+// AVX2 Vector Math Header
+//
+// Four-wide double-precision versions of the libm functions used by the
+// hot loops (log, sin/cos, exp). Polynomials are the fdlibm ones, so results
+// agree with glibc to within 1-2 ulp over the input ranges the kernels use.
+// The eight-wide float versions (v_logf, v_sincos_2pif, v_expf) use the
+// Cephes single-precision polynomials, for the float32 engine.
+//
+// Only include this from translation units that dispatch on simd_active();
+// every function is compiled for AVX2+FMA regardless of -march.
+//
+
+#ifndef MONTE_CARLO_OPTION_PRICING_VMATH_AVX2_H
+#define MONTE_CARLO_OPTION_PRICING_VMATH_AVX2_H
+
+#include "include/simd.h"
+
+#ifdef MC_SIMD_X86
+
+#include <immintrin.h>
+
+#define VMATH_AVX2 static inline __attribute__((target("avx2,fma"), always_inline))
+
+/**
+ * Natural logarithm for finite x > 0 (no denormal, zero or NaN handling).
+ *
+ * Split x = m * 2^e with m in [√½, √2), then evaluate log(m) with the
+ * fdlibm rational approximation in s = (m-1)/(m+1):
+ *   log(x) = e*ln2 + f - f²/2 + s*(f²/2 + R(s²))     where f = m - 1
+ */
+VMATH_AVX2 __m256d v_log(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+
+    // Exponent and mantissa straight from the IEEE-754 bits
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256i exp_bits = _mm256_srli_epi64(bits, 52);
+    __m256i mant_bits = _mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll)),
+        _mm256_set1_epi64x(0x3FF0000000000000ll));
+    __m256d m = _mm256_castsi256_pd(mant_bits);   // m in [1, 2)
+
+    // Exponent as a double: 2^52 + e_bits reinterpreted, minus (2^52 + 1023)
+    __m256d e = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(exp_bits, _mm256_castpd_si256(_mm256_set1_pd(0x1.0p52)))),
+        _mm256_set1_pd(0x1.0p52 + 1023.0));
+
+    // Move m into [√½, √2) so f = m - 1 stays small
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.41421356237309504880), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, half), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, one));
+
+    __m256d f = _mm256_sub_pd(m, one);
+    __m256d s = _mm256_div_pd(f, _mm256_add_pd(f, _mm256_set1_pd(2.0)));
+    __m256d z = _mm256_mul_pd(s, s);
+    __m256d w = _mm256_mul_pd(z, z);
+
+    // R(z) split into odd and even powers of w, as in fdlibm's __ieee754_log
+    __m256d t1 = _mm256_fmadd_pd(w, _mm256_set1_pd(1.479819860511658591e-01), _mm256_set1_pd(1.818357216161805012e-01));
+    t1 = _mm256_fmadd_pd(w, t1, _mm256_set1_pd(2.857142874366239149e-01));
+    t1 = _mm256_fmadd_pd(w, t1, _mm256_set1_pd(6.666666666666735130e-01));
+    t1 = _mm256_mul_pd(z, t1);
+    __m256d t2 = _mm256_fmadd_pd(w, _mm256_set1_pd(1.531383769920937332e-01), _mm256_set1_pd(2.222219843214978396e-01));
+    t2 = _mm256_fmadd_pd(w, t2, _mm256_set1_pd(3.999999999940941908e-01));
+    t2 = _mm256_mul_pd(w, t2);
+    __m256d R = _mm256_add_pd(t1, t2);
+
+    __m256d hfsq = _mm256_mul_pd(half, _mm256_mul_pd(f, f));
+    const __m256d ln2_hi = _mm256_set1_pd(6.93147180369123816490e-01);
+    const __m256d ln2_lo = _mm256_set1_pd(1.90821492927058770002e-10);
+
+    // log(x) = e*ln2_hi - ((hfsq - (s*(hfsq+R) + e*ln2_lo)) - f)
+    __m256d inner = _mm256_fmadd_pd(s, _mm256_add_pd(hfsq, R), _mm256_mul_pd(e, ln2_lo));
+    return _mm256_fmsub_pd(e, ln2_hi, _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+}
+
+/**
+ * sin(2πu) and cos(2πu) for u in [0, 1).
+ *
+ * Working in turns instead of radians makes range reduction exact:
+ * n = round(4u) picks the quadrant and y = u - n/4 in [-⅛, ⅛] has no
+ * rounding error, so only the kernel polynomials on [-π/4, π/4] remain.
+ */
+VMATH_AVX2 void v_sincos_2pi(__m256d u, __m256d *sin_out, __m256d *cos_out) {
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(u, _mm256_set1_pd(4.0)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d y = _mm256_fnmadd_pd(n, _mm256_set1_pd(0.25), u);
+    __m256d a = _mm256_mul_pd(y, _mm256_set1_pd(6.28318530717958647692));
+    __m256d z = _mm256_mul_pd(a, a);
+
+    // fdlibm __kernel_sin: a + a*z*(S1 + z*(S2 + ... + z*S6))
+    __m256d ps = _mm256_fmadd_pd(z, _mm256_set1_pd(1.58969099521155010221e-10), _mm256_set1_pd(-2.50507602534068634195e-08));
+    ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(2.75573137070700676789e-06));
+    ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(-1.98412698298579493134e-04));
+    ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(8.33333333332248946124e-03));
+    ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(-1.66666666666666324348e-01));
+    __m256d s = _mm256_fmadd_pd(_mm256_mul_pd(a, z), ps, a);
+
+    // fdlibm __kernel_cos: 1 - z/2 + z²*(C1 + z*(C2 + ... + z*C6))
+    __m256d pc = _mm256_fmadd_pd(z, _mm256_set1_pd(-1.13596475577881948265e-11), _mm256_set1_pd(2.08757232129817482790e-09));
+    pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(-2.75573143513906633035e-07));
+    pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(2.48015872894767294178e-05));
+    pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(-1.38888888888741095749e-03));
+    pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(4.16666666666666019037e-02));
+    __m256d c = _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc,
+                                _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+    // Quadrant fix-up: odd n swaps sin/cos; bit 1 of n (or n+1) flips signs
+    __m256i q = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    __m256d swap = _mm256_castsi256_pd(_mm256_slli_epi64(q, 63));
+    __m256d sin_sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_srli_epi64(q, 1), 63));
+    __m256d cos_sign = _mm256_castsi256_pd(_mm256_slli_epi64(
+        _mm256_srli_epi64(_mm256_add_epi64(q, _mm256_set1_epi64x(1)), 1), 63));
+
+    __m256d sin_val = _mm256_blendv_pd(s, c, swap);
+    __m256d cos_val = _mm256_blendv_pd(c, s, swap);
+    *sin_out = _mm256_xor_pd(sin_val, sin_sign);
+    *cos_out = _mm256_xor_pd(cos_val, cos_sign);
+}
+
+/**
+ * Exponential, clamped to the finite double range (no NaN handling).
+ *
+ * Write x = k*ln2 + r with |r| <= ln2/2, evaluate exp(r) with the fdlibm
+ * rational approximation, then scale by 2^k by building the exponent bits.
+ */
+VMATH_AVX2 __m256d v_exp(__m256d x) {
+    x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-708.0)), _mm256_set1_pd(709.0));
+
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.44269504088896338700e+00)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d hi = _mm256_fnmadd_pd(k, _mm256_set1_pd(6.93147180369123816490e-01), x);
+    __m256d lo = _mm256_mul_pd(k, _mm256_set1_pd(1.90821492927058770002e-10));
+    __m256d r = _mm256_sub_pd(hi, lo);
+
+    // c = r - r²*(P1 + r²*(P2 + ... + r²*P5))
+    __m256d t = _mm256_mul_pd(r, r);
+    __m256d p = _mm256_fmadd_pd(t, _mm256_set1_pd(4.13813679705723846039e-08), _mm256_set1_pd(-1.65339022054652515390e-06));
+    p = _mm256_fmadd_pd(t, p, _mm256_set1_pd(6.61375632143793436117e-05));
+    p = _mm256_fmadd_pd(t, p, _mm256_set1_pd(-2.77777777770155933842e-03));
+    p = _mm256_fmadd_pd(t, p, _mm256_set1_pd(1.66666666666666019037e-01));
+    __m256d c = _mm256_fnmadd_pd(t, p, r);
+
+    // exp(r) = 1 - ((lo - r*c/(2-c)) - hi)
+    __m256d q = _mm256_div_pd(_mm256_mul_pd(r, c), _mm256_sub_pd(_mm256_set1_pd(2.0), c));
+    __m256d y = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_sub_pd(_mm256_sub_pd(lo, q), hi));
+
+    // 2^k: place k + 1023 in the exponent field
+    __m256i ki = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k));
+    __m256i scale = _mm256_slli_epi64(_mm256_add_epi64(ki, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(y, _mm256_castsi256_pd(scale));
+}
+
+/**
+ * Standard normal CDF at x and at -x, without cancellation in either tail.
+ *
+ * Hart's double-precision algorithm (as given in G. West, "Better
+ * approximations to cumulative normal functions", 2005) computes the
+ * smaller tail c = N(-|x|) directly:
+ *   |x| < 7.07   c = e^(-x²/2) P(|x|) / Q(|x|)     degree 6 / 7 rationals
+ *   |x| >= 7.07  c = e^(-x²/2) / (√(2π) CF(|x|))    continued fraction
+ *   |x| > 37     c = 0
+ * and the other tail is 1 - c.
+ *
+ * Accuracy against 0.5 * erfc(-x/√2): absolute error below 3e-16
+ * everywhere; relative error of the small tail below 2e-14 for |x| < 3,
+ * growing to about 1e-8 near |x| = 8, where c itself is below 1e-15.
+ *
+ * e must be e^(-x²/2); callers that already have the density (Black-Scholes
+ * has it for d1 and, by a ratio, for d2) save the exp. See v_normal_cdf().
+ */
+VMATH_AVX2 void v_normal_cdf_exp(__m256d x, __m256d e, __m256d *cdf, __m256d *cdf_neg) {
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    __m256d a = _mm256_andnot_pd(sign_mask, x);
+
+    __m256d num = _mm256_fmadd_pd(a, _mm256_set1_pd(3.52624965998911e-02), _mm256_set1_pd(0.700383064443688));
+    num = _mm256_fmadd_pd(num, a, _mm256_set1_pd(6.37396220353165));
+    num = _mm256_fmadd_pd(num, a, _mm256_set1_pd(33.912866078383));
+    num = _mm256_fmadd_pd(num, a, _mm256_set1_pd(112.079291497871));
+    num = _mm256_fmadd_pd(num, a, _mm256_set1_pd(221.213596169931));
+    num = _mm256_fmadd_pd(num, a, _mm256_set1_pd(220.206867912376));
+    __m256d den = _mm256_fmadd_pd(a, _mm256_set1_pd(8.83883476483184e-02), _mm256_set1_pd(1.75566716318264));
+    den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(16.064177579207));
+    den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(86.7807322029461));
+    den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(296.564248779674));
+    den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(637.333633378831));
+    den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(793.826512519948));
+    den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(440.413735824752));
+    __m256d c = _mm256_div_pd(_mm256_mul_pd(e, num), den);
+
+    // Continued fraction a + 1/(a + 2/(a + 3/(a + 4/(a + 0.65)))), only
+    // worked out when some lane is that far out (five divides saved otherwise)
+    __m256d far = _mm256_cmp_pd(a, _mm256_set1_pd(7.07106781186547), _CMP_GE_OQ);
+    if (_mm256_movemask_pd(far)) {
+        __m256d cf = _mm256_add_pd(a, _mm256_set1_pd(0.65));
+        cf = _mm256_add_pd(a, _mm256_div_pd(_mm256_set1_pd(4.0), cf));
+        cf = _mm256_add_pd(a, _mm256_div_pd(_mm256_set1_pd(3.0), cf));
+        cf = _mm256_add_pd(a, _mm256_div_pd(_mm256_set1_pd(2.0), cf));
+        cf = _mm256_add_pd(a, _mm256_div_pd(_mm256_set1_pd(1.0), cf));
+        __m256d c_tail = _mm256_div_pd(e, _mm256_mul_pd(cf, _mm256_set1_pd(2.506628274631)));
+        c = _mm256_blendv_pd(c, c_tail, far);
+    }
+    c = _mm256_andnot_pd(_mm256_cmp_pd(a, _mm256_set1_pd(37.0), _CMP_GT_OQ), c);
+    __m256d other = _mm256_sub_pd(_mm256_set1_pd(1.0), c);
+
+    __m256d positive = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GT_OQ);
+    *cdf = _mm256_blendv_pd(c, other, positive);
+    *cdf_neg = _mm256_blendv_pd(other, c, positive);
+}
+
+/**
+ * Standard normal CDF at x and at -x (see v_normal_cdf_exp for accuracy).
+ */
+VMATH_AVX2 void v_normal_cdf(__m256d x, __m256d *cdf, __m256d *cdf_neg) {
+    __m256d e = v_exp(_mm256_mul_pd(_mm256_set1_pd(-0.5), _mm256_mul_pd(x, x)));
+    v_normal_cdf_exp(x, e, cdf, cdf_neg);
+}
+
+/**
+ * Eight-wide single-precision log for finite x > 0 (Cephes logf).
+ *
+ * Same split as v_log() with m in [√½, √2); log(1 + f) is a degree-9
+ * polynomial in f, good to about 1 ulp in float.
+ */
+VMATH_AVX2 __m256 v_logf(__m256 x) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                                                   _mm256_set1_epi32(0x3F800000)));   // m in [1, 2)
+
+    __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+    e = _mm256_add_ps(e, _mm256_and_ps(big, one));
+
+    __m256 f = _mm256_sub_ps(m, one);
+    __m256 z = _mm256_mul_ps(f, f);
+    __m256 p = _mm256_fmadd_ps(f, _mm256_set1_ps(7.0376836292e-2f), _mm256_set1_ps(-1.1514610310e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.1676998740e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-1.2420140846e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.4249322787e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-1.6668057665e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(2.0000714765e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-2.4999993993e-1f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(3.3333331174e-1f));
+    __m256 y = _mm256_mul_ps(_mm256_mul_ps(p, f), z);
+
+    // log(x) = e*ln2 + f - f²/2 + y, with ln2 split so e*ln2_hi is exact
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), y);
+    y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(f, y));
+}
+
+/**
+ * Eight-wide single-precision sin(2πu) and cos(2πu) for u in [0, 1).
+ *
+ * Exact quadrant reduction in turns as in v_sincos_2pi(), then the Cephes
+ * sinf/cosf kernels on [-π/4, π/4].
+ */
+VMATH_AVX2 void v_sincos_2pif(__m256 u, __m256 *sin_out, __m256 *cos_out) {
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(u, _mm256_set1_ps(4.0f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 y = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.25f), u);
+    __m256 a = _mm256_mul_ps(y, _mm256_set1_ps(6.28318530718f));
+    __m256 z = _mm256_mul_ps(a, a);
+
+    __m256 ps = _mm256_fmadd_ps(z, _mm256_set1_ps(-1.9515295891e-4f), _mm256_set1_ps(8.3321608736e-3f));
+    ps = _mm256_fmadd_ps(z, ps, _mm256_set1_ps(-1.6666654611e-1f));
+    __m256 s = _mm256_fmadd_ps(_mm256_mul_ps(a, z), ps, a);
+
+    __m256 pc = _mm256_fmadd_ps(z, _mm256_set1_ps(2.443315711809948e-5f), _mm256_set1_ps(-1.388731625493765e-3f));
+    pc = _mm256_fmadd_ps(z, pc, _mm256_set1_ps(4.166664568298827e-2f));
+    __m256 c = _mm256_fmadd_ps(_mm256_mul_ps(z, z), pc, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_set1_ps(1.0f)));
+
+    __m256i q = _mm256_cvtps_epi32(n);
+    __m256 swap = _mm256_castsi256_ps(_mm256_slli_epi32(q, 31));
+    __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(q, 1), 31));
+    __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_srli_epi32(_mm256_add_epi32(q, _mm256_set1_epi32(1)), 1), 31));
+
+    __m256 sin_val = _mm256_blendv_ps(s, c, swap);
+    __m256 cos_val = _mm256_blendv_ps(c, s, swap);
+    *sin_out = _mm256_xor_ps(sin_val, sin_sign);
+    *cos_out = _mm256_xor_ps(cos_val, cos_sign);
+}
+
+/**
+ * Eight-wide single-precision exp, clamped to the finite float range (Cephes expf).
+ */
+VMATH_AVX2 __m256 v_expf(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.0f)), _mm256_set1_ps(88.0f));
+
+    __m256 k = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504089f)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(k, _mm256_set1_ps(-2.12194440e-4f), r);
+
+    __m256 p = _mm256_fmadd_ps(r, _mm256_set1_ps(1.9875691500e-4f), _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    __m256 y = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+    __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(scale));
+}
+
+/**
+ * Sum of the four lanes.
+ */
+VMATH_AVX2 double v_hsum(__m256d v) {
+    __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+#endif //MC_SIMD_X86
+
+#endif //MONTE_CARLO_OPTION_PRICING_VMATH_AVX2_H
@@ -0,0 +1,82 @@
+//
+// Scratch Arena
+// Bump allocation from one block (see arena.h).
+//
+// The block is not touched when it is reserved. Large blocks come straight
+// from the kernel as untouched pages, and on Linux a page is placed on the
+// NUMA node of the thread that first writes it - so an arena used by one
+// pricing thread ends up in that thread's local memory without any
+// explicit NUMA calls.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "include/arena.h"
+
+/**
+ * Reserve the arena's block (rounded up to whole MC_ARENA_ALIGN units).
+ *
+ * @param arena     Arena to set up
+ * @param capacity  Bytes to reserve
+ * @return          0, or -1 out of memory (the arena is left empty)
+ */
+int mc_arena_init(mc_arena *arena, size_t capacity) {
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+    arena->peak = 0;
+    if (capacity > SIZE_MAX - MC_ARENA_ALIGN) {
+        return -1;
+    }
+    size_t bytes = mc_arena_footprint(capacity ? capacity : 1);
+    arena->base = aligned_alloc(MC_ARENA_ALIGN, bytes);
+    if (!arena->base) {
+        return -1;
+    }
+    arena->capacity = bytes;
+    return 0;
+}
+
+void mc_arena_free(mc_arena *arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+size_t mc_arena_footprint(size_t bytes) {
+    return (bytes + MC_ARENA_ALIGN - 1) & ~(size_t)(MC_ARENA_ALIGN - 1);
+}
+
+/**
+ * Hand out the next `bytes` of the block.
+ *
+ * @param arena  Arena from mc_arena_init()
+ * @param bytes  Size wanted
+ * @return       Aligned, uninitialized memory, or NULL if it does not fit
+ */
+void *mc_arena_alloc(mc_arena *arena, size_t bytes) {
+    if (!arena->base || bytes > arena->capacity - arena->used) {
+        return NULL;
+    }
+    size_t size = mc_arena_footprint(bytes);
+    if (size > arena->capacity - arena->used) {
+        return NULL;
+    }
+    void *p = arena->base + arena->used;
+    arena->used += size;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+    return p;
+}
+
+size_t mc_arena_mark(const mc_arena *arena) {
+    return arena->used;
+}
+
+void mc_arena_rewind(mc_arena *arena, size_t mark) {
+    if (mark < arena->used) {
+        arena->used = mark;
+    }
+}
@@ -0,0 +1,157 @@
+//
+// Batch Black-Scholes Pricing
+// price_european_call_bs() prices one option with scalar libm calls. When
+// BS is the fast path for whole chains (or the inner loop of an implied
+// volatility solver) the same formulas run four quotes at a time instead,
+// with vector log/exp and a vector normal CDF.
+//
+
+#include <math.h>
+#include "include/black_scholes.h"
+#include "include/normal.h"
+#include "include/simd.h"
+#include "include/vmath_avx2.h"
+
+// 1 / √(2π), the normal density's constant
+#define BS_INV_SQRT_2PI 0.39894228040143267794
+
+/**
+ * Price quote i with scalar libm calls and write the requested columns.
+ *
+ * Puts use N(-d1) and N(-d2) directly instead of put-call parity, so
+ * deep out-of-the-money puts keep their relative accuracy.
+ */
+static void bs_scalar(const bs_batch_inputs *in, size_t i, const bs_batch_outputs *out) {
+    double S = in->S0[i], K = in->K[i], r = in->r[i], sigma = in->sigma[i], T = in->T[i];
+
+    double sqrt_T = sqrt(T);
+    double vol = sigma * sqrt_T;
+    double d1 = (log(S / K) + (r + 0.5 * sigma * sigma) * T) / vol;
+    double d2 = d1 - vol;
+    double discounted_K = K * exp(-r * T);
+    double density = BS_INV_SQRT_2PI * exp(-0.5 * d1 * d1);
+    double n_d1 = normal_cdf(d1), n_minus_d1 = normal_cdf(-d1);
+    double n_d2 = normal_cdf(d2), n_minus_d2 = normal_cdf(-d2);
+    double time_decay = -S * density * sigma / (2.0 * sqrt_T);
+
+    if (out->call) out->call[i] = S * n_d1 - discounted_K * n_d2;
+    if (out->put) out->put[i] = discounted_K * n_minus_d2 - S * n_minus_d1;
+    if (out->call_delta) out->call_delta[i] = n_d1;
+    if (out->put_delta) out->put_delta[i] = -n_minus_d1;
+    if (out->gamma) out->gamma[i] = density / (S * vol);
+    if (out->vega) out->vega[i] = S * density * sqrt_T;
+    if (out->call_rho) out->call_rho[i] = discounted_K * T * n_d2;
+    if (out->put_rho) out->put_rho[i] = -discounted_K * T * n_minus_d2;
+    if (out->call_theta) out->call_theta[i] = time_decay - r * discounted_K * n_d2;
+    if (out->put_theta) out->put_theta[i] = time_decay + r * discounted_K * n_minus_d2;
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 batch: the same formulas as bs_scalar(), four quotes per iteration.
+ *
+ * log and exp are the fdlibm polynomials from vmath_avx2.h (1-2 ulp);
+ * N(x) is Hart's algorithm (absolute error below 3e-16), so prices agree
+ * with the scalar path to about 1e-14 relative for ordinary quotes.
+ *
+ * @return  Number of quotes done (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t bs_batch_avx2(const bs_batch_inputs *in, size_t n, const bs_batch_outputs *out) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d S = _mm256_loadu_pd(in->S0 + i);
+        __m256d K = _mm256_loadu_pd(in->K + i);
+        __m256d r = _mm256_loadu_pd(in->r + i);
+        __m256d sigma = _mm256_loadu_pd(in->sigma + i);
+        __m256d T = _mm256_loadu_pd(in->T + i);
+
+        __m256d sqrt_T = _mm256_sqrt_pd(T);
+        __m256d vol = _mm256_mul_pd(sigma, sqrt_T);
+        __m256d carry = _mm256_mul_pd(_mm256_fmadd_pd(_mm256_mul_pd(half, sigma), sigma, r), T);
+        __m256d d1 = _mm256_div_pd(_mm256_add_pd(v_log(_mm256_div_pd(S, K)), carry), vol);
+        __m256d d2 = _mm256_sub_pd(d1, vol);
+        __m256d discounted_K = _mm256_mul_pd(K, v_exp(_mm256_mul_pd(_mm256_set1_pd(-1.0), _mm256_mul_pd(r, T))));
+        // One exp serves both CDFs: e^(-d2²/2) = e^(-d1²/2) S / (K e^(-rT))
+        __m256d e1 = v_exp(_mm256_mul_pd(_mm256_set1_pd(-0.5), _mm256_mul_pd(d1, d1)));
+        __m256d e2 = _mm256_div_pd(_mm256_mul_pd(e1, S), discounted_K);
+        __m256d density = _mm256_mul_pd(_mm256_set1_pd(BS_INV_SQRT_2PI), e1);
+
+        __m256d n_d1, n_minus_d1, n_d2, n_minus_d2;
+        v_normal_cdf_exp(d1, e1, &n_d1, &n_minus_d1);
+        v_normal_cdf_exp(d2, e2, &n_d2, &n_minus_d2);
+
+        if (out->call) {
+            _mm256_storeu_pd(out->call + i, _mm256_fmsub_pd(S, n_d1, _mm256_mul_pd(discounted_K, n_d2)));
+        }
+        if (out->put) {
+            _mm256_storeu_pd(out->put + i, _mm256_fmsub_pd(discounted_K, n_minus_d2, _mm256_mul_pd(S, n_minus_d1)));
+        }
+        if (out->call_delta) {
+            _mm256_storeu_pd(out->call_delta + i, n_d1);
+        }
+        if (out->put_delta) {
+            _mm256_storeu_pd(out->put_delta + i, _mm256_sub_pd(_mm256_setzero_pd(), n_minus_d1));
+        }
+        if (out->gamma) {
+            _mm256_storeu_pd(out->gamma + i, _mm256_div_pd(density, _mm256_mul_pd(S, vol)));
+        }
+        if (out->vega) {
+            _mm256_storeu_pd(out->vega + i, _mm256_mul_pd(_mm256_mul_pd(S, density), sqrt_T));
+        }
+        __m256d rho_scale = _mm256_mul_pd(discounted_K, T);
+        if (out->call_rho) {
+            _mm256_storeu_pd(out->call_rho + i, _mm256_mul_pd(rho_scale, n_d2));
+        }
+        if (out->put_rho) {
+            _mm256_storeu_pd(out->put_rho + i, _mm256_sub_pd(_mm256_setzero_pd(), _mm256_mul_pd(rho_scale, n_minus_d2)));
+        }
+        if (out->call_theta || out->put_theta) {
+            // -S φ(d1) σ / (2√T), then ∓ r K e^(-rT) N(±d2)
+            __m256d time_decay = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(S, density), sigma),
+                                               _mm256_mul_pd(_mm256_set1_pd(-2.0), sqrt_T));
+            __m256d carry_cost = _mm256_mul_pd(r, discounted_K);
+            if (out->call_theta) {
+                _mm256_storeu_pd(out->call_theta + i, _mm256_fnmadd_pd(carry_cost, n_d2, time_decay));
+            }
+            if (out->put_theta) {
+                _mm256_storeu_pd(out->put_theta + i, _mm256_fmadd_pd(carry_cost, n_minus_d2, time_decay));
+            }
+        }
+    }
+    return i;
+}
+#endif
+
+/**
+ * Black-Scholes prices and Greeks for a batch of European options.
+ *
+ * Same formulas as price_european_call_bs() and greeks_european_bs(),
+ * for calls and puts at once: d1 and d2, the discount factor, the
+ * density and the four normal CDF values are computed once per quote
+ * and shared by every output column.
+ *
+ * Only the columns the caller asks for are stored, but the arithmetic
+ * for all of them is done anyway - it is a handful of multiplies next to
+ * the log, the two exps and the two CDF evaluations.
+ *
+ * With AVX2 four quotes are priced per instruction; N(x) then uses Hart's
+ * rational approximation instead of erfc (absolute error below 3e-16, see
+ * v_normal_cdf_exp). Without it each quote goes through libm.
+ *
+ * @param in   Quote parameters, n entries per array (σ > 0, T > 0)
+ * @param n    Number of quotes
+ * @param out  Output columns (NULL columns are skipped)
+ */
+void black_scholes_batch(const bs_batch_inputs *in, size_t n, const bs_batch_outputs *out) {
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = bs_batch_avx2(in, n, out);
+    }
+#endif
+    for (; i < n; i++) {
+        bs_scalar(in, i, out);
+    }
+}
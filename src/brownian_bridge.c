@@ -0,0 +1,180 @@
+//
+// Brownian Bridge Path Construction
+// Builds discretized Brownian paths "coarse to fine" instead of step by step.
+//
+// The first normal fixes the end point W(T), the second the midpoint, the
+// next two the quarter points, and so on. Most of a path's variance (and of
+// a typical payoff's) is then decided by the first few normals. That matters
+// for quasi-Monte Carlo: low Sobol dimensions are the best distributed ones,
+// so they should drive the most important directions.
+//
+// Reference: P. Jäckel, "Monte Carlo Methods in Finance", Wiley 2002, ch. 10
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include "include/brownian_bridge.h"
+
+/**
+ * Fill in a bridge's construction order and weights.
+ *
+ * @param indices  4 * n_steps unsigneds (the last n_steps are scratch)
+ * @param weights  3 * n_steps doubles
+ */
+static void bridge_setup(brownian_bridge *bb, unsigned n_steps, double T, unsigned *indices, double *weights) {
+    size_t n = n_steps;
+    unsigned *filled = indices + 3 * n;   // Scratch: which grid points are set
+
+    bb->n_steps = n_steps;
+    bb->dt = T / n_steps;
+    bb->bridge_index = indices;
+    bb->left_index = indices + n;
+    bb->right_index = indices + 2 * n;
+    bb->left_weight = weights;
+    bb->right_weight = weights + n;
+    bb->std_dev = weights + 2 * n;
+
+    for (size_t i = 0; i < n; i++) {
+        filled[i] = 0;
+    }
+
+    // Normal 0 sets the end point directly: W(T) = sqrt(T) * z
+    filled[n - 1] = 1;
+    bb->bridge_index[0] = n_steps - 1;
+    bb->left_index[0] = bb->right_index[0] = 0;
+    bb->left_weight[0] = bb->right_weight[0] = 0.0;
+    bb->std_dev[0] = sqrt(T);
+
+    // Grid point k sits at time (k + 1) * dt
+    unsigned j = 0;
+    for (unsigned i = 1; i < n_steps; i++) {
+        while (filled[j]) {
+            j++;                            // First unfilled point
+        }
+        unsigned k = j;
+        while (!filled[k]) {
+            k++;                            // Next filled point to the right
+        }
+        unsigned l = j + ((k - 1 - j) >> 1);  // Middle of the gap [j, k-1]
+        filled[l] = 1;
+
+        double tl = j * bb->dt;             // Time of the left neighbour (or 0)
+        double t = (l + 1) * bb->dt;
+        double tr = (k + 1) * bb->dt;
+
+        bb->bridge_index[i] = l;
+        bb->left_index[i] = j;
+        bb->right_index[i] = k;
+        bb->left_weight[i] = (tr - t) / (tr - tl);
+        bb->right_weight[i] = (t - tl) / (tr - tl);
+        bb->std_dev[i] = sqrt((t - tl) * (tr - t) / (tr - tl));
+
+        j = k + 1;
+        if (j >= n_steps) {
+            j = 0;
+        }
+    }
+}
+
+/**
+ * Precompute the construction order for an equally spaced grid.
+ *
+ * Given W at a left time tl and right time tr, the Brownian value at a
+ * time t in between is normal with
+ *   mean     = W(tl) * (tr - t)/(tr - tl) + W(tr) * (t - tl)/(tr - tl)
+ *   variance = (t - tl)(tr - t) / (tr - tl)
+ * Each step of the construction picks the middle of the largest gap still
+ * unfilled and stores these weights for it.
+ *
+ * The arrays are allocated once per grid rather than per path.
+ *
+ * @param bb       Bridge to initialize
+ * @param n_steps  Number of time steps (>= 1)
+ * @param T        Final time
+ * @return         0 on success, -1 on invalid input or allocation failure
+ */
+int brownian_bridge_init(brownian_bridge *bb, unsigned n_steps, double T) {
+    bb->n_steps = 0;
+    if (n_steps == 0) {
+        return -1;
+    }
+    unsigned *indices = malloc(4 * (size_t)n_steps * sizeof(unsigned));
+    double *weights = malloc(3 * (size_t)n_steps * sizeof(double));
+    if (!indices || !weights) {
+        free(indices);
+        free(weights);
+        return -1;
+    }
+    bridge_setup(bb, n_steps, T, indices, weights);
+    bb->heap = 1;
+    return 0;
+}
+
+size_t brownian_bridge_bytes(unsigned n_steps) {
+    return mc_arena_footprint(4 * (size_t)n_steps * sizeof(unsigned))
+           + mc_arena_footprint(3 * (size_t)n_steps * sizeof(double));
+}
+
+/**
+ * Set up a bridge like brownian_bridge_init(), with its arrays taken from
+ * an arena instead of the heap. brownian_bridge_free() is then a no-op;
+ * rewinding the arena releases them.
+ *
+ * @param bb       Bridge to initialize
+ * @param n_steps  Number of time steps (>= 1)
+ * @param T        Final time
+ * @param arena    Arena with room for brownian_bridge_bytes(n_steps)
+ * @return         0 on success, -1 on invalid input or a full arena
+ */
+int brownian_bridge_init_arena(brownian_bridge *bb, unsigned n_steps, double T, mc_arena *arena) {
+    bb->n_steps = 0;
+    if (n_steps == 0) {
+        return -1;
+    }
+    size_t mark = mc_arena_mark(arena);
+    unsigned *indices = mc_arena_alloc(arena, 4 * (size_t)n_steps * sizeof(unsigned));
+    double *weights = mc_arena_alloc(arena, 3 * (size_t)n_steps * sizeof(double));
+    if (!indices || !weights) {
+        mc_arena_rewind(arena, mark);
+        return -1;
+    }
+    bridge_setup(bb, n_steps, T, indices, weights);
+    bb->heap = 0;
+    return 0;
+}
+
+/**
+ * Free the bridge's arrays (safe to call on a failed init or an arena bridge).
+ */
+void brownian_bridge_free(brownian_bridge *bb) {
+    if (bb->n_steps && bb->heap) {
+        free(bb->bridge_index);
+        free(bb->left_weight);
+    }
+    bb->n_steps = 0;
+}
+
+/**
+ * Build one path's Brownian increments from n_steps standard normals.
+ *
+ * @param bb  Precomputed bridge
+ * @param z   Normals in order of importance (z[0] decides W(T))
+ * @param dW  Receives increments W(t_k) - W(t_{k-1}), k = 0..n_steps-1
+ */
+void brownian_bridge_build(const brownian_bridge *bb, const double *z, double *dW) {
+    unsigned n = bb->n_steps;
+
+    // First fill dW with the path values W(t_k), then difference in place
+    dW[n - 1] = bb->std_dev[0] * z[0];
+    for (unsigned i = 1; i < n; i++) {
+        unsigned j = bb->left_index[i];
+        unsigned k = bb->right_index[i];
+        unsigned l = bb->bridge_index[i];
+        double w_left = j ? dW[j - 1] : 0.0;
+        dW[l] = bb->left_weight[i] * w_left + bb->right_weight[i] * dW[k] + bb->std_dev[i] * z[i];
+    }
+
+    for (unsigned k = n - 1; k > 0; k--) {
+        dW[k] -= dW[k - 1];
+    }
+}
@@ -0,0 +1,226 @@
+//
+// Result Cache
+// Open-addressing table of European MC runs (see cache.h).
+//
+// Keys hash their 64-bit words with a multiply-xorshift mix. Slots are
+// probed linearly and deleted by shifting later entries back, so the table
+// never fills with tombstones. When it holds max_entries, a few occupied
+// slots are sampled and the least recently used of them is evicted.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "include/cache.h"
+
+/**
+ * Raw bits of a double, so keys compare and hash exactly.
+ */
+static uint64_t cache_bits(double x) {
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+/**
+ * Fold one 64-bit word into a hash.
+ */
+static uint64_t cache_mix(uint64_t h, uint64_t word) {
+    h ^= word;
+    h *= 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+static uint64_t cache_hash(option_type type, double S0, double K, double r, double sigma, double T,
+                           uint64_t seed, unsigned variance_reduction, mc_precision precision) {
+    uint64_t h = 0x243F6A8885A308D3ull;
+    h = cache_mix(h, ((uint64_t)type << 48) | ((uint64_t)precision << 32) | variance_reduction);
+    h = cache_mix(h, seed);
+    h = cache_mix(h, cache_bits(S0));
+    h = cache_mix(h, cache_bits(K));
+    h = cache_mix(h, cache_bits(r));
+    h = cache_mix(h, cache_bits(sigma));
+    h = cache_mix(h, cache_bits(T));
+    return h ^ (h >> 32);
+}
+
+static int cache_matches(const mc_cache_entry *e, uint64_t hash, option_type type, double S0, double K,
+                         double r, double sigma, double T, uint64_t seed, unsigned variance_reduction,
+                         mc_precision precision) {
+    return e->hash == hash && e->type == type && e->seed == seed && e->variance_reduction == variance_reduction
+           && e->precision == precision
+           && cache_bits(e->S0) == cache_bits(S0) && cache_bits(e->K) == cache_bits(K)
+           && cache_bits(e->r) == cache_bits(r) && cache_bits(e->sigma) == cache_bits(sigma)
+           && cache_bits(e->T) == cache_bits(T);
+}
+
+/**
+ * Allocate the table: the smallest power of two at least 2 * max_entries.
+ *
+ * @param cache        Cache to set up
+ * @param max_entries  Most contracts held before evicting (> 0)
+ * @return             0, or -1 on invalid size or out of memory
+ */
+int mc_cache_init(mc_cache *cache, size_t max_entries) {
+    memset(cache, 0, sizeof(*cache));
+    if (max_entries == 0 || max_entries > SIZE_MAX / 4 / sizeof(mc_cache_entry)) {
+        return -1;
+    }
+    size_t capacity = 16;
+    while (capacity < 2 * max_entries) {
+        capacity *= 2;
+    }
+    cache->slots = calloc(capacity, sizeof(*cache->slots));
+    if (!cache->slots) {
+        return -1;
+    }
+    cache->capacity = capacity;
+    cache->max_entries = max_entries;
+    return 0;
+}
+
+void mc_cache_free(mc_cache *cache) {
+    free(cache->slots);
+    memset(cache, 0, sizeof(*cache));
+}
+
+void mc_cache_clear(mc_cache *cache) {
+    memset(cache->slots, 0, cache->capacity * sizeof(*cache->slots));
+    cache->n_entries = 0;
+}
+
+/**
+ * Empty slot i, shifting back later entries of its probe run so that
+ * every remaining key is still reachable from its home slot.
+ */
+static void cache_remove(mc_cache *cache, size_t i) {
+    size_t mask = cache->capacity - 1;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (cache->slots[j].last_used == 0) {
+            break;
+        }
+        // The entry at j may fill the hole unless its home lies cyclically in (i, j]
+        size_t home = (size_t)cache->slots[j].hash & mask;
+        int stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            cache->slots[i] = cache->slots[j];
+            i = j;
+        }
+    }
+    memset(&cache->slots[i], 0, sizeof(cache->slots[i]));
+    cache->n_entries--;
+}
+
+/**
+ * Evict the least recently used of MC_CACHE_EVICTION_SAMPLES occupied
+ * slots, taken at spread-out positions that move with the clock.
+ */
+static void cache_evict(mc_cache *cache) {
+    size_t mask = cache->capacity - 1;
+    size_t victim = 0;
+    uint64_t oldest = UINT64_MAX;
+    size_t pos = (size_t)(cache->clock * 0x9E3779B97F4A7C15ull) & mask;
+    for (unsigned s = 0; s < MC_CACHE_EVICTION_SAMPLES; s++) {
+        // Walk to the next occupied slot (the table is at most half full)
+        while (cache->slots[pos].last_used == 0) {
+            pos = (pos + 1) & mask;
+        }
+        if (cache->slots[pos].last_used < oldest) {
+            oldest = cache->slots[pos].last_used;
+            victim = pos;
+        }
+        pos = (pos + cache->capacity / MC_CACHE_EVICTION_SAMPLES + 1) & mask;
+    }
+    cache_remove(cache, victim);
+    cache->stats.evictions++;
+}
+
+/**
+ * Price a European option, reusing and extending cached runs.
+ *
+ * With opts->n_sim paths and no tolerance, an entry that already has at
+ * least n_sim paths answers directly; with a tolerance, one whose standard
+ * error already meets it does. Otherwise the entry is extended to n_sim
+ * paths (or until the tolerance is met). A new key runs exactly like
+ * price_european_mc(). Sobol requests are passed straight through.
+ *
+ * @param cache  Cache from mc_cache_init()
+ * @param type   OPTION_CALL or OPTION_PUT
+ * @param S0     Initial stock price
+ * @param K      Strike price
+ * @param r      Risk-free interest rate
+ * @param sigma  Volatility
+ * @param T      Time to maturity in years
+ * @param opts   Engine options (n_sim is the total paths wanted)
+ * @return       Estimate from every path the entry holds (NAN on failure)
+ */
+mc_result mc_cache_price(
+    mc_cache *cache,
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+) {
+    if (opts->sampler != MC_SAMPLER_PSEUDO) {
+        cache->stats.bypassed++;
+        return price_european_mc(type, S0, K, r, sigma, T, opts);
+    }
+
+    uint64_t hash = cache_hash(type, S0, K, r, sigma, T, opts->seed, opts->variance_reduction, opts->precision);
+    size_t mask = cache->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (cache->slots[i].last_used != 0
+           && !cache_matches(&cache->slots[i], hash, type, S0, K, r, sigma, T, opts->seed,
+                              opts->variance_reduction, opts->precision)) {
+        i = (i + 1) & mask;
+    }
+    cache->clock++;
+
+    mc_result result;
+    mc_cache_entry *e = &cache->slots[i];
+    if (e->last_used != 0) {
+        e->last_used = cache->clock;
+        uint64_t before = e->result.n_paths;
+        uint64_t samples = e->state.moments.n;
+        if (price_european_resume_mc(type, S0, K, r, sigma, T, opts, &e->state, &result) != 0) {
+            return result;
+        }
+        if (e->state.moments.n == samples) {
+            cache->stats.hits++;
+        } else {
+            cache->stats.extensions++;
+            cache->stats.paths_simulated += result.n_paths - before;
+        }
+        cache->stats.paths_reused += before;
+        e->result = result;
+        return result;
+    }
+
+    mc_run_state state;
+    memset(&state, 0, sizeof(state));
+    if (price_european_resume_mc(type, S0, K, r, sigma, T, opts, &state, &result) != 0) {
+        return result;
+    }
+    if (cache->n_entries >= cache->max_entries) {
+        cache_evict(cache);
+        // Eviction may have shifted entries; find the key's empty slot again
+        i = (size_t)hash & mask;
+        while (cache->slots[i].last_used != 0) {
+            i = (i + 1) & mask;
+        }
+    }
+    cache->slots[i] = (mc_cache_entry){
+        .hash = hash, .last_used = cache->clock, .type = type,
+        .variance_reduction = opts->variance_reduction, .precision = opts->precision, .seed = opts->seed,
+        .S0 = S0, .K = K, .r = r, .sigma = sigma, .T = T,
+        .state = state, .result = result
+    };
+    cache->n_entries++;
+    cache->stats.misses++;
+    cache->stats.paths_simulated += result.n_paths;
+    return result;
+}
@@ -0,0 +1,397 @@
+//
+// Distributed Pricing
+// MPI drivers for chains and books too big for one node (see distributed.h).
+//
+// A chain run is split through the engine's mc_shard hook: each rank
+// simulates a contiguous range of every batch of chunks and the exchange
+// below all-gathers the per-chunk statistics, so every rank ends up with
+// exactly the slots a single process would have filled. A chunk's
+// statistics are 48 bytes per contract, so 10^9 paths (about 61k chunks)
+// move about 3 MB per contract - next to nothing beside the simulation.
+//
+// A book is split by whole groups instead: groups are dealt out largest
+// first, round robin, every rank prices its share with
+// price_portfolio_greeks_mc(), and the results are all-gathered.
+//
+// Every rank must reach every collective: a rank that fails on its own
+// (out of memory inside a run) leaves the others waiting, so the drivers
+// allocate what they can before the first collective and agree on success
+// (for chains, once in mpi_shard_init() for the exchange's own arrays and
+// datatypes, then through the shard's agree callback once the engine's
+// buffers are reserved). A batch's exchange allocates nothing.
+//
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/distributed.h"
+
+/**
+ * All-gather the chunk slots of every rank (mc_shard exchange callback).
+ *
+ * Rank q owns the chunks mc_shard_range() gives it for this batch; its
+ * slots are sent in place, and every other rank's arrive in theirs. The
+ * count and displacement arrays and the slot datatype were made by
+ * mpi_shard_init(), so the only way this fails is through MPI itself or
+ * arguments that are the same on every rank - no rank can fail alone and
+ * leave the others in the all-gather.
+ *
+ * @param ctx         mpi_shard_ctx * of the shard
+ * @param slots       n_chunks slots, chunk-major; this rank's range filled in
+ * @param slot_bytes  Bytes per chunk (one of the sizes given to mpi_shard_init)
+ * @param n_chunks    Chunks in the batch
+ * @return            0, or -1 on an MPI error, an unregistered slot size or too many chunks
+ */
+int mpi_shard_exchange(void *ctx, void *slots, size_t slot_bytes, uint32_t n_chunks) {
+    mpi_shard_ctx *c = ctx;
+    unsigned t = 0;
+    while (t < c->n_slots && c->slot_bytes[t] != slot_bytes) {
+        t++;
+    }
+    if (t == c->n_slots || n_chunks > INT_MAX) {
+        return -1;
+    }
+    for (int q = 0; q < c->n_ranks; q++) {
+        uint32_t first, count;
+        mc_shard_range(n_chunks, (unsigned)q, (unsigned)c->n_ranks, &first, &count);
+        c->counts[q] = (int)count;
+        c->displs[q] = (int)first;
+    }
+    int status = MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, slots, c->counts, c->displs,
+                                c->slot_types[t], c->comm);
+    return (status == MPI_SUCCESS) ? 0 : -1;
+}
+
+/**
+ * Agree on success across the ranks (mc_shard agree callback).
+ *
+ * @param ctx  mpi_shard_ctx * of the shard
+ * @param ok   1 if this rank's buffers were allocated
+ * @return     1 if every rank passed 1, otherwise 0
+ */
+int mpi_shard_agree(void *ctx, int ok) {
+    const mpi_shard_ctx *c = ctx;
+    int all = 0;
+    if (MPI_Allreduce(&ok, &all, 1, MPI_INT, MPI_MIN, c->comm) != MPI_SUCCESS) {
+        return 0;
+    }
+    return all == 1;
+}
+
+/**
+ * Set up a shard and its MPI context: the per-rank count and displacement
+ * arrays and one committed datatype per slot size (one datatype per chunk
+ * keeps the all-gather's counts small for huge batches).
+ *
+ * Everything that can fail on one rank alone happens here, and the ranks
+ * then agree on the outcome, so either all of them go on to the run or
+ * none does.
+ *
+ * @param shard       Shard to fill in (ctx points at `ctx`)
+ * @param ctx         Context to set up (must outlive the shard)
+ * @param comm        Ranks sharing the run (all of them make this call)
+ * @param slot_bytes  Slot sizes the run will exchange
+ * @param n_slots     Number of sizes (1..MPI_SHARD_MAX_SLOTS)
+ * @return            0 on every rank, or -1 on every rank if any failed
+ */
+int mpi_shard_init(mc_shard *shard, mpi_shard_ctx *ctx, MPI_Comm comm,
+                   const size_t *slot_bytes, unsigned n_slots) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->comm = comm;
+    int rank, n_ranks;
+    if (MPI_Comm_rank(comm, &rank) != MPI_SUCCESS || MPI_Comm_size(comm, &n_ranks) != MPI_SUCCESS) {
+        return -1;
+    }
+    ctx->n_ranks = n_ranks;
+
+    int ok = (n_slots >= 1 && n_slots <= MPI_SHARD_MAX_SLOTS);
+    if (ok) {
+        ctx->counts = malloc(2 * (size_t)n_ranks * sizeof(*ctx->counts));
+        ok = (ctx->counts != NULL);
+    }
+    if (ok) {
+        ctx->displs = ctx->counts + n_ranks;
+    }
+    for (unsigned t = 0; ok && t < n_slots; t++) {
+        if (slot_bytes[t] == 0 || slot_bytes[t] > INT_MAX
+            || MPI_Type_contiguous((int)slot_bytes[t], MPI_BYTE, &ctx->slot_types[t]) != MPI_SUCCESS) {
+            ok = 0;
+            break;
+        }
+        ctx->slot_bytes[t] = slot_bytes[t];
+        ctx->n_slots = t + 1;
+        ok = (MPI_Type_commit(&ctx->slot_types[t]) == MPI_SUCCESS);
+    }
+    if (!mpi_shard_agree(ctx, ok)) {
+        mpi_shard_free(ctx);
+        return -1;
+    }
+
+    shard->rank = (unsigned)rank;
+    shard->n_ranks = (unsigned)n_ranks;
+    shard->exchange = mpi_shard_exchange;
+    shard->ctx = ctx;
+    shard->agree = mpi_shard_agree;
+    return 0;
+}
+
+void mpi_shard_free(mpi_shard_ctx *ctx) {
+    for (unsigned t = 0; t < ctx->n_slots; t++) {
+        MPI_Type_free(&ctx->slot_types[t]);
+    }
+    ctx->n_slots = 0;
+    free(ctx->counts);
+    ctx->counts = NULL;
+    ctx->displs = NULL;
+}
+
+/**
+ * Price a chain with its paths split across the ranks of comm.
+ *
+ * See price_european_chain_sharded_mc(): results, standard errors, Greeks
+ * and early-stopping decisions are bit-identical to the single-process
+ * run, on every rank. opts->n_threads is per rank.
+ *
+ * @param comm  Ranks sharing the run (all of them make this call)
+ * @return      0 on success, -1 on invalid input, Sobol, MPI errors or out of memory
+ */
+int mpi_price_chain(
+    MPI_Comm comm,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    mc_shard shard;
+    mpi_shard_ctx ctx;
+    const size_t slot_bytes[2] = { mc_shard_slot_bytes(n_contracts, 0), mc_shard_slot_bytes(n_contracts, 1) };
+    if (mpi_shard_init(&shard, &ctx, comm, slot_bytes, greeks ? 2u : 1u) != 0) {
+        const option_greeks failed = { NAN, NAN, NAN, NAN, NAN };
+        for (size_t k = 0; k < n_contracts; k++) {
+            results[k] = (mc_result){ NAN, NAN, 0 };
+            if (greeks) {
+                greeks[k] = failed;
+            }
+            if (greeks && greeks_se) {
+                greeks_se[k] = failed;
+            }
+        }
+        return -1;
+    }
+    int status = price_european_chain_sharded_mc(S0, r, sigma, T, types, strikes, n_contracts, opts, &shard,
+                                                 results, greeks, greeks_se);
+    mpi_shard_free(&ctx);
+    return status;
+}
+
+// Sort key of a contract: its path parameters, then its index
+typedef struct {
+    double key[4];              // S0, sigma, r, T
+    size_t index;
+} mpi_contract_key;
+
+// One priced contract on its way to every rank
+typedef struct {
+    uint64_t index;
+    mc_result result;
+    option_greeks greeks;
+    option_greeks greeks_se;
+} mpi_record;
+
+// A group of the book: sorted positions [begin, begin + size)
+typedef struct {
+    size_t begin;
+    size_t size;
+} mpi_group;
+
+/**
+ * Order contracts by underlying and maturity, then by index (as portfolio.c).
+ */
+static int mpi_compare_keys(const void *a, const void *b) {
+    const mpi_contract_key *ka = a;
+    const mpi_contract_key *kb = b;
+    for (int i = 0; i < 4; i++) {
+        if (ka->key[i] < kb->key[i]) return -1;
+        if (ka->key[i] > kb->key[i]) return 1;
+    }
+    return (ka->index > kb->index) - (ka->index < kb->index);
+}
+
+/**
+ * Do two sorted contracts share their paths (the grouping of portfolio.c)?
+ */
+static int mpi_same_group(const mpi_contract_key *a, const mpi_contract_key *b) {
+    return a->key[0] == b->key[0] && a->key[1] == b->key[1] && a->key[2] == b->key[2] && a->key[3] == b->key[3];
+}
+
+/**
+ * Largest group first; ties in sorted order, so every rank deals the same way.
+ */
+static int mpi_compare_groups(const void *a, const void *b) {
+    const mpi_group *ga = a;
+    const mpi_group *gb = b;
+    if (ga->size != gb->size) {
+        return (ga->size < gb->size) - (ga->size > gb->size);
+    }
+    return (ga->begin > gb->begin) - (ga->begin < gb->begin);
+}
+
+/**
+ * Price a book with its groups split across the ranks of comm.
+ *
+ * Contracts are grouped by (S0, sigma, r, T) as in price_portfolio_mc(),
+ * and the groups are dealt out largest first, round robin, so ranks get
+ * about the same number of simulations. A group is never split, and its
+ * contracts keep their relative order, so each one is priced exactly as
+ * price_portfolio_greeks_mc() prices it on one node - early stopping
+ * included. Every rank receives every result.
+ *
+ * @param comm         Ranks sharing the book (all of them make this call)
+ * @param contracts    Contracts to price (the same array on every rank)
+ * @param n_contracts  Number of contracts
+ * @param opts         Engine options used for every group (n_threads per rank)
+ * @param results      Receives results[i] for contracts[i]
+ * @param greeks       Receives greeks[i] for contracts[i] (NULL = prices only)
+ * @param greeks_se    Receives their standard errors (may be NULL)
+ * @return             0 on success, -1 if any rank failed (failed outputs are NAN)
+ */
+int mpi_price_portfolio(
+    MPI_Comm comm,
+    const option_contract *contracts,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    const option_greeks failed = { NAN, NAN, NAN, NAN, NAN };
+    for (size_t i = 0; i < n_contracts; i++) {
+        results[i] = (mc_result){ NAN, NAN, 0 };
+        if (greeks) {
+            greeks[i] = failed;
+        }
+        if (greeks_se) {
+            greeks_se[i] = failed;
+        }
+    }
+    int rank, n_ranks;
+    if (n_contracts == 0) {
+        return 0;
+    }
+    if (MPI_Comm_rank(comm, &rank) != MPI_SUCCESS || MPI_Comm_size(comm, &n_ranks) != MPI_SUCCESS
+        || n_contracts * sizeof(mpi_record) > INT_MAX) {
+        return -1;
+    }
+
+    mpi_contract_key *order = malloc(n_contracts * sizeof(*order));
+    mpi_group *groups = malloc(n_contracts * sizeof(*groups));
+    int *owner = malloc(n_contracts * sizeof(*owner));
+    int *counts = malloc(2 * (size_t)n_ranks * sizeof(*counts));
+    option_contract *local = malloc(n_contracts * sizeof(*local));
+    mc_result *local_results = malloc(n_contracts * sizeof(*local_results));
+    option_greeks *local_greeks = malloc(2 * n_contracts * sizeof(*local_greeks));
+    mpi_record *records = malloc(n_contracts * sizeof(*records));
+    int ok = (order && groups && owner && counts && local && local_results && local_greeks && records);
+
+    // Agree on the allocations before anything else, so no rank is left waiting
+    int all_ok = 0;
+    if (MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, comm) != MPI_SUCCESS || !all_ok) {
+        free(order);
+        free(groups);
+        free(owner);
+        free(counts);
+        free(local);
+        free(local_results);
+        free(local_greeks);
+        free(records);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_contracts; i++) {
+        const stock_params *s = &contracts[i].stock;
+        order[i] = (mpi_contract_key){ { s->initial_price, s->volatility, s->interest_rate, s->maturity }, i };
+    }
+    qsort(order, n_contracts, sizeof(*order), mpi_compare_keys);
+    size_t n_groups = 0;
+    for (size_t i = 0; i < n_contracts; i++) {
+        if (i == 0 || !mpi_same_group(&order[i], &order[i - 1])) {
+            groups[n_groups++] = (mpi_group){ i, 0 };
+        }
+        groups[n_groups - 1].size++;
+    }
+    qsort(groups, n_groups, sizeof(*groups), mpi_compare_groups);
+    for (size_t g = 0; g < n_groups; g++) {
+        for (size_t j = 0; j < groups[g].size; j++) {
+            owner[order[groups[g].begin + j].index] = (int)(g % (size_t)n_ranks);
+        }
+    }
+
+    // Records are laid out by rank; this rank fills its own block in place
+    int *displs = counts + n_ranks;
+    for (int q = 0; q < n_ranks; q++) {
+        counts[q] = 0;
+    }
+    for (size_t i = 0; i < n_contracts; i++) {
+        counts[owner[i]]++;
+    }
+    int offset = 0;
+    for (int q = 0; q < n_ranks; q++) {
+        displs[q] = offset;
+        offset += counts[q];
+    }
+    mpi_record *mine = records + displs[rank];
+    size_t n_local = 0;
+    for (size_t i = 0; i < n_contracts; i++) {
+        if (owner[i] == rank) {
+            mine[n_local].index = i;
+            local[n_local++] = contracts[i];
+        }
+    }
+    option_greeks *local_se = local_greeks + n_contracts;
+    int status = price_portfolio_greeks_mc(local, n_local, opts, local_results, greeks ? local_greeks : NULL,
+                                           greeks ? local_se : NULL);
+    for (size_t j = 0; j < n_local; j++) {
+        mine[j].result = local_results[j];
+        mine[j].greeks = greeks ? local_greeks[j] : failed;
+        mine[j].greeks_se = greeks ? local_se[j] : failed;
+    }
+
+    for (int q = 0; q < n_ranks; q++) {
+        counts[q] *= (int)sizeof(mpi_record);
+        displs[q] *= (int)sizeof(mpi_record);
+    }
+    int all_status = -1;
+    if (MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, records, counts, displs, MPI_BYTE, comm) != MPI_SUCCESS
+        || MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, comm) != MPI_SUCCESS) {
+        all_status = -1;
+    } else {
+        for (size_t i = 0; i < n_contracts; i++) {
+            const mpi_record *rec = &records[i];
+            results[rec->index] = rec->result;
+            if (greeks) {
+                greeks[rec->index] = rec->greeks;
+            }
+            if (greeks && greeks_se) {
+                greeks_se[rec->index] = rec->greeks_se;
+            }
+        }
+    }
+
+    free(order);
+    free(groups);
+    free(owner);
+    free(counts);
+    free(local);
+    free(local_results);
+    free(local_greeks);
+    free(records);
+    return (all_status == 0) ? 0 : -1;
+}
@@ -6,7 +6,13 @@
 
 #include "include/stock.h"
 #include "include/rng.h"
+#include "include/gbm.h"
+#include "include/simd.h"
+#include "include/profile.h"
+#include "include/vmath_avx2.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 /**
  * Simulate a stock price at maturity using Geometric Brownian Motion (GBM).
@@ -24,16 +30,18 @@
  *
  * Reference: https://en.wikipedia.org/wiki/Geometric_Brownian_motion
  *
+ * @param rng    Random stream that supplies the normal shock
  * @param S0     Initial stock price (e.g., $100)
  * @param r      Risk-free interest rate (e.g., 0.05 for 5%)
  * @param sigma  Volatility (standard deviation of returns, e.g., 0.2 for 20%)
  * @param T      Time to maturity in years (e.g., 1.0 for one year)
  * @return       Simulated stock price at maturity
  */
-double simulate_gbm(double S0, double r, double sigma, double T) {
+double simulate_gbm(rng_state *rng, double S0, double r, double sigma, double T) {
     // Generate a standard normal random variable Z ~ N(0,1)
     // This represents the random "shock" to the stock price
-    double Z = normal_random();
+    double Z = normal_random(rng);
+    PROFILE_SCOPE(PROFILE_GBM);
 
     // Apply the GBM formula:
     // - (r - 0.5*σ²)*T is the deterministic drift (adjusted for log-normal distribution)
@@ -42,3 +50,557 @@ double simulate_gbm(double S0, double r, double sigma, double T) {
     return S0 * exp((r - 0.5 * sigma * sigma) * T + sigma * sqrt(T) * Z);
 }
 
+/**
+ * Precompute the parts of the GBM formula that do not depend on Z.
+ *
+ * simulate_gbm() recomputes (r - σ²/2)*T and σ*√T on every call. When the
+ * same contract is simulated millions of times, it is much cheaper to
+ * compute them once and reuse them for every path.
+ *
+ * @param S0     Initial stock price
+ * @param r      Risk-free interest rate
+ * @param sigma  Volatility
+ * @param T      Time to maturity in years
+ * @return       Constants for gbm_terminal_fill()
+ */
+gbm_terminal gbm_terminal_init(double S0, double r, double sigma, double T) {
+    gbm_terminal g = {
+        .S0 = S0,
+        .drift = (r - 0.5 * sigma * sigma) * T,
+        .vol = sigma * sqrt(T)
+    };
+    return g;
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 variant: four terminal prices per iteration with a vector exp().
+ *
+ * @return  Number of outputs written (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t gbm_terminal_fill_avx2(const gbm_terminal *g, const double *z, double *out, size_t n) {
+    __m256d S0 = _mm256_set1_pd(g->S0);
+    __m256d drift = _mm256_set1_pd(g->drift);
+    __m256d vol = _mm256_set1_pd(g->vol);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d log_return = _mm256_fmadd_pd(vol, _mm256_loadu_pd(z + i), drift);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(S0, v_exp(log_return)));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Turn a block of standard normal shocks into terminal stock prices.
+ *
+ * Same formula as simulate_gbm(), but the constants are precomputed and
+ * the loop has no calls or branches, so the AVX2 variant can process four
+ * paths per instruction.
+ *
+ * @param g    Constants from gbm_terminal_init()
+ * @param z    Standard normal shocks
+ * @param out  Terminal prices S(T); may be the same buffer as z
+ * @param n    Number of paths
+ */
+void gbm_terminal_fill(const gbm_terminal *g, const double *z, double *out, size_t n) {
+    PROFILE_SCOPE(PROFILE_GBM);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = gbm_terminal_fill_avx2(g, z, out, n);
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = g->S0 * exp(g->drift + g->vol * z[i]);
+    }
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 float variant: eight terminal prices per iteration.
+ *
+ * @return  Number of outputs written
+ */
+__attribute__((target("avx2,fma")))
+static size_t gbm_terminal_fill_f32_avx2(const gbm_terminal *g, const float *z, float *out, size_t n) {
+    __m256 S0 = _mm256_set1_ps((float)g->S0);
+    __m256 drift = _mm256_set1_ps((float)g->drift);
+    __m256 vol = _mm256_set1_ps((float)g->vol);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 log_return = _mm256_fmadd_ps(vol, _mm256_loadu_ps(z + i), drift);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(S0, v_expf(log_return)));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Single-precision gbm_terminal_fill() for the float32 engine.
+ *
+ * The constants are rounded to float once; the relative error of each
+ * price is a few float ulps (~1e-7), far below the MC standard error.
+ *
+ * @param g    Constants from gbm_terminal_init()
+ * @param z    Standard normal shocks
+ * @param out  Terminal prices S(T); may be the same buffer as z
+ * @param n    Number of paths
+ */
+void gbm_terminal_fill_f32(const gbm_terminal *g, const float *z, float *out, size_t n) {
+    PROFILE_SCOPE(PROFILE_GBM);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = gbm_terminal_fill_f32_avx2(g, z, out, n);
+    }
+#endif
+    float S0 = (float)g->S0, drift = (float)g->drift, vol = (float)g->vol;
+    for (; i < n; i++) {
+        out[i] = S0 * expf(drift + vol * z[i]);
+    }
+}
+
+/**
+ * Precompute the per-step constants of a discretely monitored path.
+ *
+ * Over one step of length dt the exact GBM solution is
+ *   S(t + dt) = S(t) * exp((r - σ²/2)*dt + σ*√dt*Z)
+ * so, unlike an Euler scheme, the path has no discretization error at
+ * the grid points, however few steps are used.
+ *
+ * @param S0       Initial stock price
+ * @param r        Risk-free interest rate
+ * @param sigma    Volatility
+ * @param T        Time to maturity in years
+ * @param n_steps  Number of equal time steps (monitoring dates)
+ * @return         Constants for gbm_path_fill() / gbm_path_stream()
+ */
+gbm_path gbm_path_init(double S0, double r, double sigma, double T, size_t n_steps) {
+    double dt = T / (double)n_steps;
+    gbm_path g = {
+        .S0 = S0,
+        .n_steps = n_steps,
+        .dt = dt,
+        .drift = (r - 0.5 * sigma * sigma) * dt,
+        .vol = sigma * sqrt(dt)
+    };
+    return g;
+}
+
+/**
+ * Allocate storage for whole paths.
+ *
+ * The buffer is allocated once and reused for every block of paths, so
+ * the simulation loop itself never calls malloc.
+ *
+ * @param buf       Buffer to initialize
+ * @param n_steps   Time steps per path
+ * @param capacity  Maximum number of paths per fill
+ * @return          0 on success, -1 if out of memory
+ */
+int gbm_path_buffer_init(gbm_path_buffer *buf, size_t n_steps, size_t capacity) {
+    buf->n_steps = n_steps;
+    buf->capacity = capacity;
+    buf->data = malloc((n_steps + 1) * capacity * sizeof(double));
+    return buf->data ? 0 : -1;
+}
+
+/**
+ * Release a path buffer.
+ *
+ * @param buf  Buffer from gbm_path_buffer_init()
+ */
+void gbm_path_buffer_free(gbm_path_buffer *buf) {
+    free(buf->data);
+    buf->data = NULL;
+}
+
+/**
+ * Row t of a path buffer: the prices of all paths at time t * dt.
+ *
+ * @param buf  Path buffer
+ * @param t    Time step (0 = today, n_steps = maturity)
+ * @return     Pointer to capacity prices
+ */
+double *gbm_path_row(const gbm_path_buffer *buf, size_t t) {
+    return buf->data + t * buf->capacity;
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 variant of gbm_path_step(): four paths per iteration.
+ *
+ * @return  Number of outputs written (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t gbm_path_step_avx2(const gbm_path *g, const double *S_prev, const double *z,
+                                 double *S_next, size_t n) {
+    __m256d drift = _mm256_set1_pd(g->drift);
+    __m256d vol = _mm256_set1_pd(g->vol);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d growth = v_exp(_mm256_fmadd_pd(vol, _mm256_loadu_pd(z + i), drift));
+        _mm256_storeu_pd(S_next + i, _mm256_mul_pd(_mm256_loadu_pd(S_prev + i), growth));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Advance every path by one time step.
+ *
+ * @param g       Path constants
+ * @param S_prev  Prices at the start of the step
+ * @param z       Standard normal shocks for the step
+ * @param S_next  Prices at the end of the step; may be the same buffer as S_prev or z
+ * @param n       Number of paths
+ */
+void gbm_path_step(const gbm_path *g, const double *S_prev, const double *z,
+                   double *S_next, size_t n) {
+    PROFILE_SCOPE(PROFILE_GBM);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = gbm_path_step_avx2(g, S_prev, z, S_next, n);
+    }
+#endif
+    for (; i < n; i++) {
+        S_next[i] = S_prev[i] * exp(g->drift + g->vol * z[i]);
+    }
+}
+
+/**
+ * Turn the shocks stored in a path buffer into prices, in place.
+ *
+ * Rows 1..n_steps must hold standard normal shocks (e.g. from a Brownian
+ * bridge or Sobol points); afterwards row t holds S(t * dt) and row 0
+ * holds S0.
+ *
+ * @param g        Path constants (g->n_steps must equal buf->n_steps)
+ * @param buf      Buffer holding the shocks
+ * @param n_paths  Number of paths (at most buf->capacity)
+ */
+void gbm_path_build(const gbm_path *g, gbm_path_buffer *buf, size_t n_paths) {
+    double *S0_row = gbm_path_row(buf, 0);
+    for (size_t i = 0; i < n_paths; i++) {
+        S0_row[i] = g->S0;
+    }
+    for (size_t t = 1; t <= g->n_steps; t++) {
+        double *row = gbm_path_row(buf, t);
+        gbm_path_step(g, gbm_path_row(buf, t - 1), row, row, n_paths);
+    }
+}
+
+/**
+ * Simulate whole paths into a buffer.
+ *
+ * Shocks are drawn one time step at a time (all paths for step 1, then
+ * all paths for step 2, ...), the same order gbm_path_stream() uses.
+ *
+ * @param g        Path constants
+ * @param rng      Random stream for the shocks
+ * @param buf      Buffer to fill (n_steps must match g)
+ * @param n_paths  Number of paths (at most buf->capacity)
+ */
+void gbm_path_fill(const gbm_path *g, rng_state *rng, gbm_path_buffer *buf, size_t n_paths) {
+    for (size_t t = 1; t <= g->n_steps; t++) {
+        normal_fill(rng, gbm_path_row(buf, t), n_paths);
+    }
+    gbm_path_build(g, buf, n_paths);
+}
+
+/**
+ * Simulate paths without storing them.
+ *
+ * Only the current time step is kept: after each step `hook` is called
+ * with the prices of all paths, and it folds them into whatever running
+ * statistics the payoff needs (average, maximum, barrier hit, ...).
+ * Memory is O(n_paths) instead of O(n_paths * n_steps), so thousands of
+ * monitoring dates cost no extra memory.
+ *
+ * The shocks are drawn in the same order as gbm_path_fill(), so for the
+ * same stream both produce exactly the same paths.
+ *
+ * @param g        Path constants
+ * @param rng      Random stream for the shocks
+ * @param S        Scratch row of n_paths doubles (holds the current prices)
+ * @param z        Scratch row of n_paths doubles (holds the current shocks)
+ * @param n_paths  Number of paths
+ * @param hook     Called for steps 1..n_steps with the prices at that step
+ * @param ctx      Passed through to hook
+ */
+void gbm_path_stream(const gbm_path *g, rng_state *rng, double *S, double *z, size_t n_paths,
+                     gbm_step_hook hook, void *ctx) {
+    for (size_t i = 0; i < n_paths; i++) {
+        S[i] = g->S0;
+    }
+    for (size_t t = 1; t <= g->n_steps; t++) {
+        normal_fill(rng, z, n_paths);
+        gbm_path_step(g, S, z, S, n_paths);
+        hook(ctx, t, S, n_paths);
+    }
+}
+
+/**
+ * Reset running path statistics.
+ *
+ * @param stats    Statistics to reset (NULL members are skipped)
+ * @param n_paths  Number of paths
+ */
+void gbm_path_stats_reset(const gbm_path_stats *stats, size_t n_paths) {
+    for (size_t i = 0; i < n_paths; i++) {
+        if (stats->sum) stats->sum[i] = 0.0;
+        if (stats->max) stats->max[i] = -INFINITY;
+        if (stats->min) stats->min[i] = INFINITY;
+    }
+}
+
+/**
+ * Fold one time step into the running statistics.
+ *
+ * Matches gbm_step_hook, so it can be passed straight to gbm_path_stream()
+ * with a gbm_path_stats as ctx. S0 itself is not a monitoring date.
+ *
+ * @param ctx      gbm_path_stats to update
+ * @param step     Time step (unused)
+ * @param S        Prices of all paths at this step
+ * @param n_paths  Number of paths
+ */
+void gbm_path_stats_update(void *ctx, size_t step, const double *S, size_t n_paths) {
+    const gbm_path_stats *stats = ctx;
+    (void)step;
+    if (stats->sum) {
+        for (size_t i = 0; i < n_paths; i++) {
+            stats->sum[i] += S[i];
+        }
+    }
+    if (stats->max) {
+        for (size_t i = 0; i < n_paths; i++) {
+            stats->max[i] = (S[i] > stats->max[i]) ? S[i] : stats->max[i];
+        }
+    }
+    if (stats->min) {
+        for (size_t i = 0; i < n_paths; i++) {
+            stats->min[i] = (S[i] < stats->min[i]) ? S[i] : stats->min[i];
+        }
+    }
+}
+
+/**
+ * Set up a basket of correlated GBM assets.
+ *
+ * The correlation matrix C is factored once as C = L Lᵀ (Cholesky). For
+ * independent standard normals z, the shocks ε = L z then have exactly
+ * the correlations C, and asset a ends at S0_a exp(drift_a + vol_a ε_a).
+ *
+ * Semi-definite matrices are accepted (e.g. two assets with ρ = 1): a
+ * zero pivot leaves that column of L empty, since the asset is then a
+ * combination of the ones before it.
+ *
+ * @param g         Basket to initialize
+ * @param n_assets  Number of assets (1..GBM_BASKET_MAX_ASSETS)
+ * @param S0        Initial prices (> 0)
+ * @param sigma     Volatilities (>= 0)
+ * @param corr      Correlation matrix, row-major, symmetric with a unit diagonal
+ * @param r         Risk-free interest rate
+ * @param T         Time to maturity in years
+ * @param arena     Arena to take the storage from, or NULL to malloc it
+ * @return          0 on success, -1 on invalid input or out of memory
+ */
+static int gbm_basket_setup(gbm_basket *g, size_t n_assets, const double *S0, const double *sigma,
+                            const double *corr, double r, double T, mc_arena *arena) {
+    g->n_assets = 0;
+    g->assets = NULL;
+    g->chol = NULL;
+    g->heap = (arena == NULL);
+    if (n_assets == 0 || n_assets > GBM_BASKET_MAX_ASSETS || !(T > 0.0)) {
+        return -1;
+    }
+    for (size_t a = 0; a < n_assets; a++) {
+        if (!(S0[a] > 0.0) || !(sigma[a] >= 0.0) || corr[a * n_assets + a] != 1.0) {
+            return -1;
+        }
+        for (size_t b = 0; b < a; b++) {
+            double c = corr[a * n_assets + b];
+            if (!(fabs(c) <= 1.0) || c != corr[b * n_assets + a]) {
+                return -1;
+            }
+        }
+    }
+
+    size_t mark = arena ? mc_arena_mark(arena) : 0;
+    if (arena) {
+        g->assets = mc_arena_alloc(arena, n_assets * sizeof(*g->assets));
+        g->chol = mc_arena_alloc(arena, n_assets * n_assets * sizeof(double));
+        if (g->chol) {
+            memset(g->chol, 0, n_assets * n_assets * sizeof(double));
+        }
+    } else {
+        g->assets = malloc(n_assets * sizeof(*g->assets));
+        g->chol = calloc(n_assets * n_assets, sizeof(double));
+    }
+    if (!g->assets || !g->chol) {
+        gbm_basket_free(g);
+        if (arena) {
+            mc_arena_rewind(arena, mark);
+        }
+        return -1;
+    }
+    g->n_assets = n_assets;
+    for (size_t a = 0; a < n_assets; a++) {
+        g->assets[a] = gbm_terminal_init(S0[a], r, sigma[a], T);
+    }
+
+    // Cholesky-Banachiewicz, row by row
+    double *L = g->chol;
+    for (size_t a = 0; a < n_assets; a++) {
+        for (size_t b = 0; b <= a; b++) {
+            double sum = corr[a * n_assets + b];
+            for (size_t k = 0; k < b; k++) {
+                sum -= L[a * n_assets + k] * L[b * n_assets + k];
+            }
+            if (b < a) {
+                double pivot = L[b * n_assets + b];
+                L[a * n_assets + b] = (pivot > 0.0) ? sum / pivot : 0.0;
+            } else if (sum > 1e-12) {
+                L[a * n_assets + a] = sqrt(sum);
+            } else if (sum < -1e-10) {
+                gbm_basket_free(g);
+                if (arena) {
+                    mc_arena_rewind(arena, mark);
+                }
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Set up a basket of correlated GBM assets (see gbm_basket_setup); the
+ * per-asset constants and the Cholesky factor are malloc-ed.
+ *
+ * @return  0 on success, -1 on invalid input or out of memory
+ */
+int gbm_basket_init(gbm_basket *g, size_t n_assets, const double *S0, const double *sigma,
+                    const double *corr, double r, double T) {
+    return gbm_basket_setup(g, n_assets, S0, sigma, corr, r, T, NULL);
+}
+
+size_t gbm_basket_bytes(size_t n_assets) {
+    return mc_arena_footprint(n_assets * sizeof(gbm_terminal))
+           + mc_arena_footprint(n_assets * n_assets * sizeof(double));
+}
+
+/**
+ * gbm_basket_init() with the per-asset constants and the Cholesky factor
+ * taken from an arena, so that an engine context prices baskets without
+ * allocating. They are released by rewinding the arena; gbm_basket_free()
+ * leaves them alone.
+ *
+ * @param arena  Arena with room for gbm_basket_bytes(n_assets)
+ * @return       0 on success, -1 on invalid input or a full arena
+ */
+int gbm_basket_init_arena(gbm_basket *g, size_t n_assets, const double *S0, const double *sigma,
+                          const double *corr, double r, double T, mc_arena *arena) {
+    return gbm_basket_setup(g, n_assets, S0, sigma, corr, r, T, arena);
+}
+
+/**
+ * Release a basket (a no-op for one built by gbm_basket_init_arena).
+ *
+ * @param g  Basket from gbm_basket_init()
+ */
+void gbm_basket_free(gbm_basket *g) {
+    if (g->heap) {
+        free(g->assets);
+        free(g->chol);
+    }
+    g->assets = NULL;
+    g->chol = NULL;
+    g->n_assets = 0;
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 variant of gbm_basket_correlate(): four paths per iteration.
+ *
+ * The accumulator for one asset stays in a register while the row of L
+ * is applied, so each output is stored once.
+ *
+ * @return  Number of paths done in every row (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t gbm_basket_correlate_avx2(const gbm_basket *g, const double *z, double *eps, size_t n) {
+    size_t m = g->n_assets;
+    size_t done = n & ~(size_t)3;
+    for (size_t a = 0; a < m; a++) {
+        const double *L = g->chol + a * m;
+        double *out = eps + a * n;
+        for (size_t i = 0; i < done; i += 4) {
+            __m256d acc = _mm256_mul_pd(_mm256_set1_pd(L[0]), _mm256_loadu_pd(z + i));
+            for (size_t j = 1; j <= a; j++) {
+                acc = _mm256_fmadd_pd(_mm256_set1_pd(L[j]), _mm256_loadu_pd(z + j * n + i), acc);
+            }
+            _mm256_storeu_pd(out + i, acc);
+        }
+    }
+    return done;
+}
+#endif
+
+/**
+ * Turn a block of independent normals into correlated shocks.
+ *
+ * Both blocks are asset-major (row a = asset a, n paths per row), so this
+ * is the small dense product ε = L z with the paths as the long, unit-stride
+ * dimension. A block of a few thousand values stays in cache for the whole
+ * product however many paths are simulated in total.
+ *
+ * @param g    Basket constants
+ * @param z    n_assets rows of n independent standard normals
+ * @param eps  n_assets rows of n correlated shocks (must not alias z)
+ * @param n    Paths in the block
+ */
+void gbm_basket_correlate(const gbm_basket *g, const double *z, double *eps, size_t n) {
+    size_t m = g->n_assets;
+    size_t i0 = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i0 = gbm_basket_correlate_avx2(g, z, eps, n);
+    }
+#endif
+    for (size_t a = 0; a < m; a++) {
+        const double *L = g->chol + a * m;
+        double *out = eps + a * n;
+        for (size_t i = i0; i < n; i++) {
+            double sum = 0.0;
+            for (size_t j = 0; j <= a; j++) {
+                sum += L[j] * z[j * n + i];
+            }
+            out[i] = sum;
+        }
+    }
+}
+
+/**
+ * Terminal prices of every asset in a block.
+ *
+ * @param g     Basket constants
+ * @param eps   n_assets rows of n correlated shocks
+ * @param sign  +1, or -1 for the antithetic block (shocks negated)
+ * @param S     n_assets rows of n terminal prices (may be the same buffer as eps)
+ * @param n     Paths in the block
+ */
+void gbm_basket_terminal_fill(const gbm_basket *g, const double *eps, double sign, double *S, size_t n) {
+    for (size_t a = 0; a < g->n_assets; a++) {
+        gbm_terminal asset = g->assets[a];
+        asset.vol *= sign;
+        gbm_terminal_fill(&asset, eps + a * n, S + a * n, n);
+    }
+}
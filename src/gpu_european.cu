@@ -0,0 +1,307 @@
+//
+// GPU (CUDA) European Pricing Kernels
+//
+// Built only by `make gpu`. One pass of the device engine:
+//   1. european_sums_kernel - every thread turns Philox counters into pairs
+//      of normal shocks, prices up to GPU_PASS_CONTRACTS strikes on each
+//      terminal price, and keeps running sums in registers. Each block then
+//      reduces its threads' sums (warp shuffles, then shared memory).
+//   2. reduce_sums_kernel   - one block per sum adds up the per-block sums.
+// Only the final GPU_SUMS doubles are copied back to the host. Longer
+// chains run several passes over the same counters, so every contract sees
+// exactly the same paths.
+//
+// The grid size is fixed and no atomics are used, so the result for a seed
+// is the same on every run and every device.
+//
+
+extern "C" {
+#include "include/gpu.h"
+#include "include/monte_carlo.h"
+}
+#include "include/philox.h"
+
+#include <cuda_runtime.h>
+
+// Launch shape: fixed, so the summation order (and the result) never changes
+#define GPU_THREADS 256
+#define GPU_BLOCKS 1024
+#define GPU_WARPS (GPU_THREADS / 32)
+
+// Contracts priced per pass; their sums live in registers
+#define GPU_PASS_CONTRACTS 8
+
+// Σx, Σx², then Σd, Σd², Σxd for each contract of the pass, d = y - shift
+// (shifted sums, see gpu_moments)
+#define GPU_SUMS (2 + 3 * GPU_PASS_CONTRACTS)
+
+// Everything a pass needs, passed by value as a kernel argument
+typedef struct {
+    double S0;
+    double drift;
+    double vol;
+    double forward;
+    int n_contracts;
+    int types[GPU_PASS_CONTRACTS];
+    double strikes[GPU_PASS_CONTRACTS];
+    double shifts[GPU_PASS_CONTRACTS];  // Subtracted from each payoff before it is summed
+    int antithetic;
+    int control;
+    unsigned long long n_samples;
+    philox_key key;
+} gpu_pass;
+
+/**
+ * Payoff of one terminal price (branch-free max).
+ */
+__device__ static inline double gpu_payoff(int type, double S, double K) {
+    return (type == OPTION_CALL) ? fmax(S - K, 0.0) : fmax(K - S, 0.0);
+}
+
+/**
+ * Fold one shock into a thread's running sums.
+ *
+ * Same estimator as the CPU engine: with antithetic pairs the sample is
+ * the average over (Z, -Z), and the control variate is S(T) - E[S(T)].
+ */
+__device__ static inline void gpu_add_sample(const gpu_pass *p, double z, double *acc) {
+    double up = p->S0 * exp(p->drift + p->vol * z);
+    double down = p->antithetic ? p->S0 * exp(p->drift - p->vol * z) : 0.0;
+
+    double x = 0.0;
+    if (p->control) {
+        x = (p->antithetic ? 0.5 * (up + down) : up) - p->forward;
+    }
+    acc[0] += x;
+    acc[1] += x * x;
+
+#pragma unroll
+    for (int k = 0; k < GPU_PASS_CONTRACTS; k++) {
+        if (k < p->n_contracts) {
+            double y = gpu_payoff(p->types[k], up, p->strikes[k]);
+            if (p->antithetic) {
+                y = 0.5 * (y + gpu_payoff(p->types[k], down, p->strikes[k]));
+            }
+            double d = y - p->shifts[k];
+            acc[2 + 3 * k] += d;
+            acc[3 + 3 * k] += d * d;
+            acc[4 + 3 * k] += x * d;
+        }
+    }
+}
+
+/**
+ * Sum a value over the 32 lanes of a warp (result valid in lane 0).
+ */
+__device__ static inline double gpu_warp_sum(double v) {
+    for (int offset = 16; offset > 0; offset >>= 1) {
+        v += __shfl_down_sync(0xffffffffu, v, offset);
+    }
+    return v;
+}
+
+/**
+ * Simulate the pass's samples and write one row of GPU_SUMS sums per block.
+ *
+ * Sample pair m (samples 2m and 2m+1) comes from Philox counter m: two
+ * uniforms, then both Box-Muller normals. Threads stride through the
+ * pairs, so any n_samples works with the fixed grid.
+ *
+ * @param p           Contract and sampling parameters
+ * @param block_sums  GPU_BLOCKS x GPU_SUMS per-block sums (output)
+ */
+__global__ void european_sums_kernel(gpu_pass p, double *block_sums) {
+    double acc[GPU_SUMS];
+#pragma unroll
+    for (int j = 0; j < GPU_SUMS; j++) {
+        acc[j] = 0.0;
+    }
+
+    unsigned long long n_pairs = (p.n_samples + 1) / 2;
+    unsigned long long stride = (unsigned long long)gridDim.x * blockDim.x;
+    for (unsigned long long m = (unsigned long long)blockIdx.x * blockDim.x + threadIdx.x; m < n_pairs; m += stride) {
+        philox_ctr c = {{ (uint32_t)m, (uint32_t)(m >> 32), 0u, 0u }};
+        philox_ctr bits = philox4x32_10(c, p.key);
+        double u1 = philox_uniform(bits.v[0], bits.v[1]);
+        double u2 = philox_uniform(bits.v[2], bits.v[3]);
+
+        double radius = sqrt(-2.0 * log(u1));
+        double s, co;
+        sincospi(2.0 * u2, &s, &co);
+
+        gpu_add_sample(&p, radius * co, acc);
+        if (2 * m + 1 < p.n_samples) {
+            gpu_add_sample(&p, radius * s, acc);
+        }
+    }
+
+    // Block reduction: warps first, then the per-warp totals
+    __shared__ double warp_sums[GPU_WARPS][GPU_SUMS];
+    int lane = threadIdx.x % 32, warp = threadIdx.x / 32;
+#pragma unroll
+    for (int j = 0; j < GPU_SUMS; j++) {
+        double v = gpu_warp_sum(acc[j]);
+        if (lane == 0) {
+            warp_sums[warp][j] = v;
+        }
+    }
+    __syncthreads();
+    if (threadIdx.x < GPU_SUMS) {
+        double total = 0.0;
+        for (int w = 0; w < GPU_WARPS; w++) {
+            total += warp_sums[w][threadIdx.x];
+        }
+        block_sums[blockIdx.x * GPU_SUMS + threadIdx.x] = total;
+    }
+}
+
+/**
+ * Add up column blockIdx.x of the per-block sums (one block per column).
+ *
+ * @param block_sums  n_blocks x GPU_SUMS per-block sums
+ * @param n_blocks    Rows in block_sums
+ * @param sums        GPU_SUMS totals (output)
+ */
+__global__ void reduce_sums_kernel(const double *block_sums, int n_blocks, double *sums) {
+    double v = 0.0;
+    for (int i = threadIdx.x; i < n_blocks; i += blockDim.x) {
+        v += block_sums[i * GPU_SUMS + blockIdx.x];
+    }
+
+    __shared__ double warp_sums[GPU_WARPS];
+    v = gpu_warp_sum(v);
+    if (threadIdx.x % 32 == 0) {
+        warp_sums[threadIdx.x / 32] = v;
+    }
+    __syncthreads();
+    if (threadIdx.x == 0) {
+        double total = 0.0;
+        for (int w = 0; w < GPU_WARPS; w++) {
+            total += warp_sums[w];
+        }
+        sums[blockIdx.x] = total;
+    }
+}
+
+/**
+ * Shift for a contract's payoff sums: its payoff at the forward, a
+ * constant close to the mean payoff (exactly so for a deep in-the-money
+ * option, the case where raw sums fail).
+ */
+static double gpu_payoff_shift(int type, double forward, double K) {
+    return (type == OPTION_CALL) ? fmax(forward - K, 0.0) : fmax(K - forward, 0.0);
+}
+
+/**
+ * Turn shifted sums into the engine's centred moments.
+ *
+ * Raw Σy² - Σy·mean subtracts two numbers of size n·mean², which for a
+ * deep in-the-money option at 10^8+ paths cancels most of the digits of a
+ * small variance - the same trap stats.c avoids on the CPU. The device
+ * sums d = y - c instead, with c = the payoff at the forward: the
+ * variance is unchanged by the shift, and the cancellation is now only
+ * against n·(mean - c)², which is small when c is near the mean. The
+ * control x = S(T) - E[S(T)] is already centred on its exact mean, so it
+ * needs no shift of its own (and the covariance is shift-invariant).
+ *
+ * @param sums   GPU_SUMS totals of one pass
+ * @param k      Contract within the pass
+ * @param shift  Shift the device subtracted from contract k's payoffs
+ * @param n      Number of samples
+ */
+static mc_moments gpu_moments(const double *sums, int k, double shift, uint64_t n) {
+    double sx = sums[0], sxx = sums[1];
+    double sd = sums[2 + 3 * k], sdd = sums[3 + 3 * k], sxd = sums[4 + 3 * k];
+
+    mc_moments m;
+    m.n = n;
+    double mean_d = sd / (double)n;
+    m.mean_y = shift + mean_d;
+    m.mean_x = sx / (double)n;
+    // Rounding can still leave a variance a few ulps below zero when it is zero
+    m.m2_y = fmax(sdd - sd * mean_d, 0.0);
+    m.m2_x = fmax(sxx - sx * m.mean_x, 0.0);
+    m.c_xy = sxd - sx * mean_d;
+    return m;
+}
+
+extern "C" int gpu_available(void) {
+    int n_devices = 0;
+    return cudaGetDeviceCount(&n_devices) == cudaSuccess && n_devices > 0;
+}
+
+/**
+ * Simulate on the device and return per-contract moments.
+ *
+ * Contracts are processed GPU_PASS_CONTRACTS at a time; every pass
+ * replays the same Philox counters, so the whole chain shares one set of
+ * paths just like the CPU engine.
+ *
+ * @return  0 on success, -1 on any CUDA error (out is then undefined)
+ */
+extern "C" int gpu_european_moments(
+    const gbm_terminal *g,
+    double forward,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    uint64_t n_samples,
+    uint64_t seed,
+    unsigned variance_reduction,
+    mc_moments *out
+) {
+    if (n_samples == 0) {
+        return -1;
+    }
+
+    double *d_block_sums = NULL, *d_sums = NULL;
+    if (cudaMalloc((void **)&d_block_sums, GPU_BLOCKS * GPU_SUMS * sizeof(double)) != cudaSuccess) {
+        return -1;
+    }
+    if (cudaMalloc((void **)&d_sums, GPU_SUMS * sizeof(double)) != cudaSuccess) {
+        cudaFree(d_block_sums);
+        return -1;
+    }
+
+    gpu_pass pass;
+    pass.S0 = g->S0;
+    pass.drift = g->drift;
+    pass.vol = g->vol;
+    pass.forward = forward;
+    pass.antithetic = (variance_reduction & MC_VR_ANTITHETIC) != 0;
+    pass.control = (variance_reduction & MC_VR_CONTROL) != 0;
+    pass.n_samples = n_samples;
+    pass.key.v[0] = (uint32_t)seed;
+    pass.key.v[1] = (uint32_t)(seed >> 32);
+
+    int status = 0;
+    for (size_t first = 0; first < n_contracts && status == 0; first += GPU_PASS_CONTRACTS) {
+        size_t n = n_contracts - first;
+        if (n > GPU_PASS_CONTRACTS) {
+            n = GPU_PASS_CONTRACTS;
+        }
+        pass.n_contracts = (int)n;
+        for (size_t k = 0; k < n; k++) {
+            pass.types[k] = (int)types[first + k];
+            pass.strikes[k] = strikes[first + k];
+            pass.shifts[k] = gpu_payoff_shift(pass.types[k], forward, pass.strikes[k]);
+        }
+
+        european_sums_kernel<<<GPU_BLOCKS, GPU_THREADS>>>(pass, d_block_sums);
+        reduce_sums_kernel<<<GPU_SUMS, GPU_THREADS>>>(d_block_sums, GPU_BLOCKS, d_sums);
+
+        double sums[GPU_SUMS];
+        if (cudaGetLastError() != cudaSuccess ||
+            cudaMemcpy(sums, d_sums, sizeof(sums), cudaMemcpyDeviceToHost) != cudaSuccess) {
+            status = -1;
+            break;
+        }
+        for (size_t k = 0; k < n; k++) {
+            out[first + k] = gpu_moments(sums, (int)k, pass.shifts[k], n_samples);
+        }
+    }
+
+    cudaFree(d_block_sums);
+    cudaFree(d_sums);
+    return status;
+}
@@ -0,0 +1,527 @@
+//
+// Longstaff-Schwartz (least-squares Monte Carlo) American option pricing
+//
+// At each exercise date the holder compares the exercise value with the
+// value of continuing. The continuation value is estimated by regressing
+// the realized future cashflows of the in-the-money paths on a few basis
+// functions of the current price, then the dates are processed backwards
+// from maturity to today.
+//
+// Memory: backward induction needs, at date t_j, only S(t_j) and each
+// path's future cashflow. Instead of storing whole paths (1M paths x 252
+// steps would be 2 GB of doubles), the paths are generated *backwards*
+// with a Brownian bridge: W(T) is drawn first, then W(t_j) given
+// W(t_{j+1}). Each path therefore keeps two float32 numbers - its
+// standardized position and its cashflow - and the chunk's RNG stream
+// carries on from date to date. Memory is 8 bytes per path, independent
+// of the number of steps.
+//
+// Reference: Longstaff & Schwartz, "Valuing American Options by
+// Simulation: A Simple Least-Squares Approach" (2001)
+//
+
+#include <math.h>
+#include <string.h>
+#include "include/lsm.h"
+#include "include/gbm.h"
+#include "include/parallel.h"
+#include "include/stats.h"
+#include "include/simd.h"
+#include "include/vmath_avx2.h"
+
+#define LSM_BLOCK_PATHS 256u
+#define LSM_MAX_BASIS (LSM_MAX_DEGREE + 1u)
+
+// Least-squares normal equations X'X β = X'y, summed over in-the-money paths
+typedef struct {
+    double xtx[LSM_MAX_BASIS][LSM_MAX_BASIS];
+    double xty[LSM_MAX_BASIS];
+    uint64_t n;
+} lsm_normal_eq;
+
+// Shared state of one LSM run
+typedef struct {
+    const american_option *opt;
+    double S0, r, sigma, dt;
+    unsigned n_basis;
+    uint32_t n_sim;
+    size_t step;                // Date the paths are at (n_steps at maturity, 0 = today)
+    const double *beta;         // Exercise rule at `step` (NULL = no early exercise there)
+    rng_state *streams;         // streams[c] = chunk c's stream, advanced date by date
+    float *position;            // W(t_step) / √t_step per path (a standard normal)
+    float *cash;                // Cashflow per path, discounted to t_step
+    lsm_normal_eq *partial_eq;  // Per-chunk regression sums for the next date
+    mc_moments *partial;        // Per-chunk statistics of the discounted cashflow at t = 0
+} lsm_job;
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 Laguerre weights e^(-x/2), four at a time.
+ *
+ * @return  Number of outputs written (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t lsm_weight_fill_avx2(const double *x, size_t n, double *out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d arg = _mm256_mul_pd(_mm256_set1_pd(-0.5), _mm256_loadu_pd(x + i));
+        _mm256_storeu_pd(out + i, v_exp(arg));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Evaluate the regression basis for a block of prices.
+ *
+ * The basis is in x = S / K: scaling by K keeps x near 1, so the normal
+ * equations stay well conditioned whatever the price level.
+ *
+ * Laguerre terms are the weighted polynomials e^(-x/2) L_k(x) of the
+ * original paper, built with the recurrence
+ *   (k+1) L_{k+1} = (2k+1-x) L_k - k L_{k-1},   L_0 = 1, L_1 = 1 - x
+ *
+ * @param basis    Polynomial or Laguerre
+ * @param n_basis  Number of terms (degree + 1)
+ * @param x        S / K for each path
+ * @param n        Number of paths (at most LSM_BLOCK_PATHS)
+ * @param phi      phi[k][i] = basis term k of path i
+ */
+static void lsm_basis_fill(lsm_basis basis, unsigned n_basis, const double *x, size_t n,
+                           double phi[LSM_MAX_BASIS][LSM_BLOCK_PATHS]) {
+    for (size_t i = 0; i < n; i++) {
+        phi[0][i] = 1.0;
+    }
+    if (basis == LSM_BASIS_POLYNOMIAL) {
+        for (unsigned k = 1; k < n_basis; k++) {
+            for (size_t i = 0; i < n; i++) {
+                phi[k][i] = phi[k - 1][i] * x[i];
+            }
+        }
+        return;
+    }
+
+    // phi[1] holds the weight; higher terms multiply it by L_k
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = lsm_weight_fill_avx2(x, n, phi[1]);
+    }
+#endif
+    for (; i < n; i++) {
+        phi[1][i] = exp(-0.5 * x[i]);
+    }
+    for (i = 0; i < n; i++) {
+        double prev = 1.0, cur = 1.0 - x[i];
+        for (unsigned k = 2; k < n_basis; k++) {
+            phi[k][i] = phi[1][i] * cur;
+            double next = ((2.0 * (k - 1) + 1.0 - x[i]) * cur - (k - 1) * prev) / (double)k;
+            prev = cur;
+            cur = next;
+        }
+    }
+}
+
+/**
+ * Solve the small normal-equation system by Gaussian elimination.
+ *
+ * The system is at most LSM_MAX_BASIS x LSM_MAX_BASIS, so partial
+ * pivoting is plenty once the rows and columns are scaled to a unit
+ * diagonal (basis terms can differ in size by orders of magnitude). A
+ * (near-)singular system means too few in-the-money paths to say
+ * anything, and the date is skipped.
+ *
+ * @param eq    Summed normal equations (upper triangle filled)
+ * @param n     Number of basis terms
+ * @param beta  Receives the coefficients
+ * @return      0 on success, -1 if the system is singular
+ */
+static int lsm_solve(const lsm_normal_eq *eq, unsigned n, double *beta) {
+    double a[LSM_MAX_BASIS][LSM_MAX_BASIS + 1];
+    double scale[LSM_MAX_BASIS];
+    for (unsigned i = 0; i < n; i++) {
+        if (!(eq->xtx[i][i] > 0.0)) {
+            return -1;
+        }
+        scale[i] = 1.0 / sqrt(eq->xtx[i][i]);
+    }
+    for (unsigned i = 0; i < n; i++) {
+        for (unsigned j = 0; j < n; j++) {
+            double v = (j >= i) ? eq->xtx[i][j] : eq->xtx[j][i];
+            a[i][j] = v * scale[i] * scale[j];
+        }
+        a[i][n] = eq->xty[i] * scale[i];
+    }
+
+    for (unsigned col = 0; col < n; col++) {
+        unsigned pivot = col;
+        for (unsigned row = col + 1; row < n; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(a[pivot][col]) < 1e-14) {
+            return -1;
+        }
+        if (pivot != col) {
+            for (unsigned j = 0; j <= n; j++) {
+                double t = a[col][j];
+                a[col][j] = a[pivot][j];
+                a[pivot][j] = t;
+            }
+        }
+        for (unsigned row = col + 1; row < n; row++) {
+            double f = a[row][col] / a[col][col];
+            for (unsigned j = col; j <= n; j++) {
+                a[row][j] -= f * a[col][j];
+            }
+        }
+    }
+    for (unsigned i = n; i-- > 0; ) {
+        double v = a[i][n];
+        for (unsigned j = i + 1; j < n; j++) {
+            v -= a[i][j] * beta[j];
+        }
+        beta[i] = v / a[i][i];
+    }
+    for (unsigned i = 0; i < n; i++) {
+        beta[i] *= scale[i];
+    }
+    return 0;
+}
+
+/**
+ * Dot product with four independent partial sums (no single dependency chain).
+ */
+static double lsm_dot(const double *a, const double *b, size_t n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+/**
+ * Exercise value of a block of prices.
+ */
+static void lsm_exercise_fill(const american_option *opt, const double *S, size_t n, double *out) {
+    payoff_fill(opt->type, S, n, opt->strike, out);
+}
+
+/**
+ * Process one chunk of paths for one backward step.
+ *
+ * With the paths at date `step`:
+ *   1. apply the exercise rule at `step` (if any): exercise where the
+ *      exercise value beats the regression's continuation value
+ *   2. discount the cashflows one step and move the paths to step - 1
+ *      with the backward Brownian bridge
+ *   3. at step - 1 > 0, add the in-the-money paths to this chunk's
+ *      regression sums; at step - 1 = 0, record the discounted cashflows
+ */
+static void lsm_chunk(void *ctx, uint32_t chunk) {
+    lsm_job *job = ctx;
+    const american_option *opt = job->opt;
+    size_t begin = (size_t)chunk * MC_CHUNK_PATHS;
+    size_t count = job->n_sim - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+
+    float *position = job->position + begin;
+    float *cash = job->cash + begin;
+    rng_state *rng = &job->streams[chunk];
+    double step_discount = exp(-job->r * job->dt);
+    size_t step = job->step;
+    size_t next = step - 1;
+
+    // Standardized bridge: Z_j = √(j/(j+1)) Z_{j+1} + √(1/(j+1)) ε  keeps Z_j ~ N(0,1)
+    double keep = sqrt((double)next / (double)step);
+    double fresh = sqrt(1.0 / (double)step);
+    gbm_terminal now = gbm_terminal_init(job->S0, job->r, job->sigma, step * job->dt);
+    gbm_terminal then = gbm_terminal_init(job->S0, job->r, job->sigma, next * job->dt);
+
+    lsm_normal_eq eq;
+    memset(&eq, 0, sizeof(eq));
+    mc_moments m = {0};
+    unsigned n_basis = job->n_basis;
+    double inv_K = 1.0 / opt->strike;
+
+    double z[LSM_BLOCK_PATHS], S[LSM_BLOCK_PATHS], ex[LSM_BLOCK_PATHS], y[LSM_BLOCK_PATHS];
+    double x[LSM_BLOCK_PATHS], w[LSM_BLOCK_PATHS];
+    double phi[LSM_MAX_BASIS][LSM_BLOCK_PATHS];
+    for (size_t b = 0; b < count; b += LSM_BLOCK_PATHS) {
+        size_t n = (count - b < LSM_BLOCK_PATHS) ? count - b : LSM_BLOCK_PATHS;
+
+        // 1. Exercise decision at the current date (branch-free: ITM is a coin flip)
+        if (job->beta) {
+            for (size_t i = 0; i < n; i++) {
+                z[i] = position[b + i];
+            }
+            gbm_terminal_fill(&now, z, S, n);
+            lsm_exercise_fill(opt, S, n, ex);
+            for (size_t i = 0; i < n; i++) {
+                x[i] = S[i] * inv_K;
+            }
+            lsm_basis_fill(opt->basis, n_basis, x, n, phi);
+            for (size_t i = 0; i < n; i++) {
+                double continuation = 0.0;
+                for (unsigned k = 0; k < n_basis; k++) {
+                    continuation += job->beta[k] * phi[k][i];
+                }
+                int exercise = (ex[i] > 0.0) & (ex[i] > continuation);
+                cash[b + i] = exercise ? (float)ex[i] : cash[b + i];
+            }
+        }
+
+        // 2. Discount and step back one date
+        if (next == 0) {
+            for (size_t i = 0; i < n; i++) {
+                y[i] = step_discount * cash[b + i];
+            }
+            moments_add_block(&m, y, NULL, n);
+            continue;
+        }
+        normal_fill(rng, z, n);
+        for (size_t i = 0; i < n; i++) {
+            z[i] = keep * position[b + i] + fresh * z[i];
+            position[b + i] = (float)z[i];
+            cash[b + i] = (float)(step_discount * cash[b + i]);
+            y[i] = cash[b + i];
+        }
+
+        // 3. Regression sums over the in-the-money paths at the new date
+        gbm_terminal_fill(&then, z, S, n);
+        lsm_exercise_fill(opt, S, n, ex);
+        for (size_t i = 0; i < n; i++) {
+            x[i] = S[i] * inv_K;
+            w[i] = (ex[i] > 0.0) ? 1.0 : 0.0;
+        }
+        lsm_basis_fill(opt->basis, n_basis, x, n, phi);
+        for (unsigned j = 0; j < n_basis; j++) {
+            // Mask once per row; each sum below is then a plain dot product
+            for (size_t i = 0; i < n; i++) {
+                z[i] = w[i] * phi[j][i];
+            }
+            for (unsigned k = j; k < n_basis; k++) {
+                eq.xtx[j][k] += lsm_dot(z, phi[k], n);
+            }
+            eq.xty[j] += lsm_dot(z, y, n);
+        }
+        for (size_t i = 0; i < n; i++) {
+            eq.n += (uint64_t)w[i];
+        }
+    }
+
+    job->partial_eq[chunk] = eq;
+    job->partial[chunk] = m;
+}
+
+/**
+ * Start every path at maturity: draw W(T) and pay the terminal payoff.
+ */
+static void lsm_init_chunk(void *ctx, uint32_t chunk) {
+    lsm_job *job = ctx;
+    size_t begin = (size_t)chunk * MC_CHUNK_PATHS;
+    size_t count = job->n_sim - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+
+    rng_state *rng = &job->streams[chunk];
+    gbm_terminal at_maturity = gbm_terminal_init(job->S0, job->r, job->sigma, job->step * job->dt);
+    double z[LSM_BLOCK_PATHS], S[LSM_BLOCK_PATHS], payoff[LSM_BLOCK_PATHS];
+    for (size_t b = 0; b < count; b += LSM_BLOCK_PATHS) {
+        size_t n = (count - b < LSM_BLOCK_PATHS) ? count - b : LSM_BLOCK_PATHS;
+        normal_fill(rng, z, n);
+        gbm_terminal_fill(&at_maturity, z, S, n);
+        lsm_exercise_fill(job->opt, S, n, payoff);
+        for (size_t i = 0; i < n; i++) {
+            job->position[begin + b + i] = (float)z[i];
+            job->cash[begin + b + i] = (float)payoff[i];
+        }
+    }
+}
+
+/**
+ * Arena bytes of one run: a stream, regression sums and statistics slot
+ * per chunk, and the position and cashflow of every path.
+ *
+ * @param n_sim  Number of paths
+ * @return       Bytes, alignment included
+ */
+size_t lsm_scratch_bytes(uint32_t n_sim) {
+    size_t n_chunks = ((size_t)n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS;
+    return mc_arena_footprint(n_chunks * sizeof(rng_state))
+           + 2 * mc_arena_footprint((size_t)n_sim * sizeof(float))
+           + mc_arena_footprint(n_chunks * sizeof(lsm_normal_eq))
+           + mc_arena_footprint(n_chunks * sizeof(mc_moments));
+}
+
+/**
+ * Engine core behind price_american_lsm() and mc_engine_price_american();
+ * every buffer comes from `arena` and is released before returning.
+ */
+static mc_result lsm_price(
+    mc_arena *arena,
+    const american_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+) {
+    mc_result result = { NAN, NAN, 0 };
+    if (opts->n_sim == 0 || opt->n_steps == 0 || opt->degree < 1 || opt->degree > LSM_MAX_DEGREE) {
+        return result;
+    }
+
+    uint32_t n_chunks = (uint32_t)(((uint64_t)opts->n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    size_t mark = mc_arena_mark(arena);
+    lsm_job job = {
+        .opt = opt,
+        .S0 = S0,
+        .r = r,
+        .sigma = sigma,
+        .dt = T / (double)opt->n_steps,
+        .n_basis = opt->degree + 1,
+        .n_sim = opts->n_sim,
+        .step = opt->n_steps,
+        .beta = NULL,
+        .streams = mc_arena_alloc(arena, n_chunks * sizeof(rng_state)),
+        .position = mc_arena_alloc(arena, (size_t)opts->n_sim * sizeof(float)),
+        .cash = mc_arena_alloc(arena, (size_t)opts->n_sim * sizeof(float)),
+        .partial_eq = mc_arena_alloc(arena, n_chunks * sizeof(lsm_normal_eq)),
+        .partial = mc_arena_alloc(arena, n_chunks * sizeof(mc_moments))
+    };
+    if (!job.streams || !job.position || !job.cash || !job.partial_eq || !job.partial) {
+        mc_arena_rewind(arena, mark);
+        return result;
+    }
+
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+    for (uint32_t c = 0; c < n_chunks; c++) {
+        job.streams[c] = rng;
+        rng_jump(&rng);
+    }
+    parallel_for(n_chunks, opts->n_threads, lsm_init_chunk, &job);
+
+    // At maturity exercise is automatic; earlier dates use the fitted rule
+    double beta[LSM_MAX_BASIS];
+    for (; job.step >= 1; job.step--) {
+        parallel_for(n_chunks, opts->n_threads, lsm_chunk, &job);
+        if (job.step == 1) {
+            break;
+        }
+
+        lsm_normal_eq total;
+        memset(&total, 0, sizeof(total));
+        for (uint32_t c = 0; c < n_chunks; c++) {
+            const lsm_normal_eq *eq = &job.partial_eq[c];
+            for (unsigned j = 0; j < job.n_basis; j++) {
+                for (unsigned k = j; k < job.n_basis; k++) {
+                    total.xtx[j][k] += eq->xtx[j][k];
+                }
+                total.xty[j] += eq->xty[j];
+            }
+            total.n += eq->n;
+        }
+        int solved = total.n > job.n_basis && lsm_solve(&total, job.n_basis, beta) == 0;
+        job.beta = solved ? beta : NULL;
+    }
+
+    mc_moments total = {0};
+    for (uint32_t c = 0; c < n_chunks; c++) {
+        moments_merge(&total, &job.partial[c]);
+    }
+    result.price = moments_mean(&total);
+    result.std_error = sqrt(moments_variance(&total) / (double)total.n);
+    result.n_paths = total.n;
+
+    // Exercising immediately is also allowed
+    double S_now = S0, intrinsic;
+    payoff_fill(opt->type, &S_now, 1, opt->strike, &intrinsic);
+    if (intrinsic > result.price) {
+        result.price = intrinsic;
+        result.std_error = 0.0;
+    }
+
+    mc_arena_rewind(arena, mark);
+    return result;
+}
+
+/**
+ * Price an American (Bermudan) option with the Longstaff-Schwartz method.
+ *
+ * Paths run backwards from maturity. At each exercise date the cashflows
+ * of the in-the-money paths are regressed on the basis functions of S/K;
+ * the fitted value is the continuation value, and a path exercises where
+ * the exercise value beats it. Only in-the-money paths enter the
+ * regression, as in the original paper: they are the only ones where the
+ * decision matters, and it gives a much better fit where it counts.
+ *
+ * Each date is one parallel_for over MC_CHUNK_PATHS chunks. The chunks'
+ * regression sums are added in chunk order before solving, so, exactly
+ * like the European engine, the result for a seed does not depend on the
+ * thread count.
+ *
+ * The estimate uses the same paths for the regression and the price.
+ * Fitting the exercise rule in-sample gives it some foresight, which
+ * biases the price up, while the rule being suboptimal biases it down;
+ * at 10^5+ paths the net bias is well below the standard error.
+ *
+ * @param opt    Option terms, exercise dates and regression basis
+ * @param S0     Initial stock price
+ * @param r      Risk-free interest rate
+ * @param sigma  Volatility
+ * @param T      Time to maturity in years
+ * @param opts   Engine options (n_sim, seed and n_threads are used)
+ * @return       Price, standard error and paths used (NAN on invalid input or out of memory)
+ */
+mc_result price_american_lsm(
+    const american_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+) {
+    mc_arena arena;
+    mc_arena_init(&arena, lsm_scratch_bytes(opts->n_sim));
+    mc_result result = lsm_price(&arena, opt, S0, r, sigma, T, opts);
+    mc_arena_free(&arena);
+    return result;
+}
+
+/**
+ * price_american_lsm() on a reusable engine: the per-path positions and
+ * cashflows, the chunk streams and the regression sums all come from the
+ * engine's arena, so repeated calls do not allocate.
+ *
+ * Same result, bit for bit, as price_american_lsm() with the same options.
+ *
+ * @return  Price, standard error and paths used (NAN on invalid input or
+ *          more paths than the engine was sized for)
+ */
+mc_result mc_engine_price_american(
+    mc_engine *engine,
+    const american_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+) {
+    if (!mc_engine_room(engine, lsm_scratch_bytes(opts->n_sim))) {
+        return (mc_result){ NAN, NAN, 0 };
+    }
+    return lsm_price(&engine->arena, opt, S0, r, sigma, T, opts);
+}
@@ -1,8 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
 #include <math.h>
 #include "include/rng.h"
 #include "include/monte_carlo.h"
+#include "include/portfolio.h"
+#include "include/server.h"
 
 
 //
@@ -11,6 +18,75 @@
 // This program prices European options using Monte Carlo simulation.
 // It simulates thousands of possible stock price paths and averages
 // the payoffs to estimate the option's fair value.
+//
+// With --serve it runs as a pricing daemon instead (see server.h):
+//   monte_carlo_option_pricing --serve SOCKET [--threads N] [--window-us N]
+//                              [--max-batch N] [--n-sim N] [--max-n-sim N]
+//                              [--report SECONDS]
+
+// Server stopped by SIGINT/SIGTERM
+static pricing_server *g_server;
+
+static void stop_server(int sig) {
+    (void)sig;
+    pricing_server_stop(g_server);
+}
+
+/**
+ * Daemon mode: serve until interrupted, then print the latency summary.
+ *
+ * @return  0 on a clean stop, 1 on bad arguments or a socket error
+ */
+static int serve(int argc, char *argv[]) {
+    pricing_server_config config = pricing_server_config_default();
+    config.socket_path = argv[2];
+    config.report_seconds = 10.0;
+    for (int i = 3; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        unsigned long v = strtoul(argv[i + 1], NULL, 10);
+        if (strcmp(argv[i], "--threads") == 0) config.n_threads = (unsigned)v;
+        else if (strcmp(argv[i], "--window-us") == 0) config.window_us = (uint32_t)v;
+        else if (strcmp(argv[i], "--max-batch") == 0) config.max_batch = (uint32_t)v;
+        else if (strcmp(argv[i], "--n-sim") == 0) config.default_n_sim = (uint32_t)v;
+        else if (strcmp(argv[i], "--max-n-sim") == 0) config.max_n_sim = (uint32_t)v;
+        else if (strcmp(argv[i], "--report") == 0) config.report_seconds = strtod(argv[i + 1], NULL);
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    g_server = pricing_server_open(&config);
+    if (!g_server) {
+        fprintf(stderr, "Cannot serve on %s\n", config.socket_path);
+        return 1;
+    }
+    // No SA_RESTART: the signal interrupts pselect() with EINTR, and the
+    // loop sees the stop flag straight away
+    struct sigaction stop = { 0 };
+    stop.sa_handler = stop_server;
+    sigemptyset(&stop.sa_mask);
+    stop.sa_flags = 0;
+    if (sigaction(SIGINT, &stop, NULL) != 0 || sigaction(SIGTERM, &stop, NULL) != 0) {
+        fprintf(stderr, "Cannot install signal handlers\n");
+        pricing_server_close(g_server);
+        return 1;
+    }
+    fprintf(stderr, "Pricing server listening on %s (window %u us, batches up to %u)\n",
+            config.socket_path, config.window_us, config.max_batch);
+    int status = pricing_server_run(g_server);
+
+    pricing_server_stats st;
+    pricing_server_get_stats(g_server, &st);
+    fprintf(stderr, "Served %llu requests in %llu batches (%llu engine calls): p50 %.1f us, p99 %.1f us\n",
+            (unsigned long long)st.n_requests, (unsigned long long)st.n_batches,
+            (unsigned long long)st.n_groups, st.p50_us, st.p99_us);
+    pricing_server_close(g_server);
+    return (status == 0) ? 0 : 1;
+}
 
 /**
  * Main entry point for the Monte Carlo option pricer.
@@ -25,8 +101,13 @@
  *
  * @return  0 on success, non-zero on error
  */
-int main(void) {
-    rng_seed(123456u);  // Fixed seed for reproducibility
+int main(int argc, char *argv[]) {
+    if (argc > 2 && strcmp(argv[1], "--serve") == 0) {
+        return serve(argc, argv);
+    }
+
+    rng_state rng;
+    rng_seed(&rng, 123456u);  // Fixed seed for reproducibility
 
     // Example parameters for a European call option
     double S0 = 100.0;      // Initial stock price
@@ -37,7 +118,7 @@ int main(void) {
     uint32_t n_sim = 1000000; // Number of Monte Carlo simulations
 
     // Price using Monte Carlo simulation
-    double mc_price = price_european_call_mc(S0, K, r, sigma, T, n_sim);
+    double mc_price = price_european_call_mc(S0, K, r, sigma, T, n_sim, &rng);
     
     // Price using analytical Black-Scholes formula
     double bs_price = price_european_call_bs(S0, K, r, sigma, T);
@@ -68,5 +149,73 @@ int main(void) {
         printf("\nWARNING: Large discrepancy detected! Check for bugs.\n");
     }
 
+    // Same contract with the full engine: how many paths does each
+    // variance-reduction mode need to match plain MC's standard error?
+    static const struct { unsigned flags; const char *name; } modes[] = {
+        { MC_VR_NONE,                       "Plain" },
+        { MC_VR_ANTITHETIC,                 "Antithetic" },
+        { MC_VR_CONTROL,                    "Control variate" },
+        { MC_VR_ANTITHETIC | MC_VR_CONTROL, "Antithetic + control" },
+    };
+
+    mc_options opts = mc_options_default();
+    opts.seed = 123456u;
+    double plain_se = 0.0;
+
+    printf("\n=== Variance Reduction (%u paths each) ===\n", opts.n_sim);
+    printf("  %-22s %10s %10s %14s\n", "Mode", "Price", "Std err", "Path savings");
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        opts.variance_reduction = modes[i].flags;
+        mc_result res = price_european_mc(OPTION_CALL, S0, K, r, sigma, T, &opts);
+        if (i == 0) {
+            plain_se = res.std_error;
+        }
+        // Variance ratio = how many times fewer paths give the same error
+        double savings = (plain_se * plain_se) / (res.std_error * res.std_error);
+        printf("  %-22s $%9.4f %10.5f %13.1fx\n", modes[i].name, res.price, res.std_error, savings);
+    }
+
+    // A small option chain: calls and puts at five strikes, all priced
+    // from one set of paths because they share the underlying and expiry
+    enum { N_STRIKES = 5 };
+    option_contract chain[2 * N_STRIKES];
+    mc_result chain_res[2 * N_STRIKES];
+    stock_params stock = { S0, r, sigma, T };
+    for (int i = 0; i < N_STRIKES; i++) {
+        double strike = 80.0 + 10.0 * i;
+        chain[2 * i] = (option_contract){ stock, strike, OPTION_CALL };
+        chain[2 * i + 1] = (option_contract){ stock, strike, OPTION_PUT };
+    }
+    opts.variance_reduction = MC_VR_NONE;
+    price_portfolio_mc(chain, 2 * N_STRIKES, &opts, chain_res);
+
+    printf("\n=== Option Chain (%d contracts, one set of %u paths) ===\n", 2 * N_STRIKES, opts.n_sim);
+    printf("  %8s %10s %10s %10s %16s\n", "Strike", "Call", "Put", "BS call", "Parity gap");
+    for (int i = 0; i < N_STRIKES; i++) {
+        double strike = chain[2 * i].strike;
+        double call = chain_res[2 * i].price;
+        double put = chain_res[2 * i + 1].price;
+        // Put-call parity: C - P = S0 - K e^(-rT)
+        double parity_gap = call - put - (S0 - strike * exp(-r * T));
+        printf("  $%7.2f $%9.4f $%9.4f $%9.4f %16.5f\n", strike, call, put,
+               price_european_call_bs(S0, strike, r, sigma, T), parity_gap);
+    }
+
+    // Greeks of the ATM call from the same single pass that prices it
+    option_greeks mc_greeks, mc_greeks_se;
+    price_european_greeks_mc(OPTION_CALL, S0, K, r, sigma, T, &opts, &mc_greeks, &mc_greeks_se);
+    option_greeks bs_greeks = greeks_european_bs(OPTION_CALL, S0, K, r, sigma, T);
+
+    static const char *greek_names[] = { "Delta", "Gamma", "Vega", "Rho", "Theta" };
+    const double mc_g[] = { mc_greeks.delta, mc_greeks.gamma, mc_greeks.vega, mc_greeks.rho, mc_greeks.theta };
+    const double se_g[] = { mc_greeks_se.delta, mc_greeks_se.gamma, mc_greeks_se.vega,
+                            mc_greeks_se.rho, mc_greeks_se.theta };
+    const double bs_g[] = { bs_greeks.delta, bs_greeks.gamma, bs_greeks.vega, bs_greeks.rho, bs_greeks.theta };
+    printf("\n=== Greeks (one pass, %u paths) ===\n", opts.n_sim);
+    printf("  %-8s %12s %12s %12s\n", "Greek", "Monte Carlo", "Std err", "Black-Scholes");
+    for (int i = 0; i < 5; i++) {
+        printf("  %-8s %12.5f %12.5f %12.5f\n", greek_names[i], mc_g[i], se_g[i], bs_g[i]);
+    }
+
     return 0;
 }
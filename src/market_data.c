@@ -0,0 +1,621 @@
+//
+// Market data files
+//
+// End-of-day books run to millions of contracts. Reading them with fgets()
+// and sscanf() parses every number through the locale machinery and fills
+// one struct per contract, which the batch pricers then have to scatter
+// back into columns. The binary format stores the columns themselves: open
+// is one mmap() plus a validation pass, and the batch APIs read the pages
+// in place.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/market_data.h"
+#include "include/profile.h"
+
+#define MARKET_MAGIC "MCMKT01"
+#define MARKET_BYTE_ORDER 0x01020304u
+
+// Every column starts on a cache line (and so on a SIMD boundary)
+#define MARKET_ALIGN 64u
+
+// Read size of the CSV stream; lines longer than this are skipped as malformed
+#define CSV_STREAM_BUFFER (1u << 16)
+
+_Static_assert(sizeof(option_type) == sizeof(int32_t), "option_type column is stored as int32_t");
+
+/**
+ * Size in bytes of one entry of column c.
+ */
+static size_t market_column_width(int c) {
+    return (c == MARKET_COL_TICKER || c == MARKET_COL_TYPE) ? 4 : 8;
+}
+
+/**
+ * Round a file offset up to the column alignment.
+ */
+static uint64_t market_align(uint64_t offset) {
+    return (offset + MARKET_ALIGN - 1) & ~(uint64_t)(MARKET_ALIGN - 1);
+}
+
+/**
+ * Compute where every column and the ticker table go in a file.
+ *
+ * @param h  Header with n_contracts and n_tickers set; receives the offsets and file size
+ */
+static void market_layout(market_file_header *h) {
+    uint64_t offset = market_align(sizeof(*h));
+    for (int c = 0; c < MARKET_N_COLUMNS; c++) {
+        h->column[c] = offset;
+        offset = market_align(offset + h->n_contracts * market_column_width(c));
+    }
+    h->tickers = offset;
+    h->file_size = offset + (uint64_t)h->n_tickers * MARKET_TICKER_LEN;
+}
+
+/**
+ * Map a contract file and check it before anything reads through it.
+ *
+ * The header must match this build (magic, byte order) and describe
+ * exactly the layout market_writer_save() produces for its counts, which
+ * bounds every column inside the file. The ticker and type columns and
+ * the ticker names are scanned once so later lookups need no checks. The
+ * double columns are not touched, so open reads 8 of the ~60 bytes per
+ * contract.
+ *
+ * @param md    Receives the mapped columns
+ * @param path  Contract file
+ * @return      0 on success, -1 if the file cannot be mapped or is malformed
+ */
+int market_data_open(market_data *md, const char *path) {
+    memset(md, 0, sizeof(*md));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(market_file_header)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const market_file_header *h = map;
+    market_file_header expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.n_contracts = h->n_contracts;
+    expected.n_tickers = h->n_tickers;
+    int valid = memcmp(h->magic, MARKET_MAGIC, sizeof(MARKET_MAGIC)) == 0
+             && h->byte_order == MARKET_BYTE_ORDER
+             && h->n_contracts <= (uint64_t)SIZE_MAX / 64;
+    if (valid) {
+        market_layout(&expected);
+        valid = h->file_size == expected.file_size && expected.file_size == size
+             && h->tickers == expected.tickers
+             && memcmp(h->column, expected.column, sizeof(h->column)) == 0;
+    }
+
+    const char *base = map;
+    const uint32_t *ticker_id = (const uint32_t *)(base + expected.column[MARKET_COL_TICKER]);
+    const int32_t *type = (const int32_t *)(base + expected.column[MARKET_COL_TYPE]);
+    uint32_t bad = 0;
+    for (size_t i = 0; valid && i < h->n_contracts; i++) {
+        bad |= (ticker_id[i] >= h->n_tickers) | ((uint32_t)type[i] > (uint32_t)OPTION_PUT);
+    }
+    for (size_t t = 0; valid && t < h->n_tickers; t++) {
+        bad |= (base[expected.tickers + (t + 1) * MARKET_TICKER_LEN - 1] != '\0');
+    }
+    if (!valid || bad) {
+        munmap(map, size);
+        return -1;
+    }
+
+    md->n_contracts = (size_t)h->n_contracts;
+    md->n_tickers = h->n_tickers;
+    md->ticker_id = ticker_id;
+    md->S0 = (const double *)(base + h->column[MARKET_COL_S0]);
+    md->K = (const double *)(base + h->column[MARKET_COL_K]);
+    md->r = (const double *)(base + h->column[MARKET_COL_R]);
+    md->sigma = (const double *)(base + h->column[MARKET_COL_SIGMA]);
+    md->T = (const double *)(base + h->column[MARKET_COL_T]);
+    md->market_price = (const double *)(base + h->column[MARKET_COL_PRICE]);
+    md->type = (const option_type *)type;
+    md->tickers = (const char (*)[MARKET_TICKER_LEN])(base + h->tickers);
+    md->map = map;
+    md->map_size = size;
+    return 0;
+}
+
+/**
+ * Unmap a contract file; its column pointers become invalid.
+ *
+ * @param md  File from market_data_open()
+ */
+void market_data_close(market_data *md) {
+    if (md->map) {
+        munmap(md->map, md->map_size);
+    }
+    memset(md, 0, sizeof(*md));
+}
+
+/**
+ * Black-Scholes batch inputs that read the mapped columns in place.
+ *
+ * @param md  Open contract file
+ * @return    Inputs for black_scholes_batch(md->n_contracts quotes)
+ */
+bs_batch_inputs market_data_bs_inputs(const market_data *md) {
+    return (bs_batch_inputs){ md->S0, md->K, md->r, md->sigma, md->T };
+}
+
+/**
+ * Implied-volatility batch inputs that read the mapped columns in place.
+ *
+ * @param md  Open contract file
+ * @return    Inputs for implied_vol_batch(md->n_contracts quotes)
+ */
+iv_batch_inputs market_data_iv_inputs(const market_data *md) {
+    return (iv_batch_inputs){ md->market_price, md->S0, md->K, md->r, md->T, md->type };
+}
+
+/**
+ * Start an empty writer (no allocation until the first contract).
+ *
+ * @param w  Writer to initialize
+ */
+void market_writer_init(market_writer *w) {
+    memset(w, 0, sizeof(*w));
+}
+
+/**
+ * FNV-1a hash of a ticker name.
+ */
+static uint64_t market_ticker_hash(const char *name) {
+    uint64_t h = 1469598103934665603ull;
+    for (; *name; name++) {
+        h = (h ^ (unsigned char)*name) * 1099511628211ull;
+    }
+    return h;
+}
+
+/**
+ * Index of a ticker name, adding it to the table if it is new.
+ *
+ * @return  Ticker index, or -1 if out of memory
+ */
+static long market_writer_ticker(market_writer *w, const char *name) {
+    // Keep the open-addressing table at most half full
+    if (2 * (w->n_tickers + 1) > w->n_slots) {
+        size_t n_slots = w->n_slots ? 2 * w->n_slots : 64;
+        uint32_t *slots = calloc(n_slots, sizeof(*slots));
+        if (!slots) {
+            return -1;
+        }
+        for (size_t t = 0; t < w->n_tickers; t++) {
+            size_t s = market_ticker_hash(w->tickers[t]) & (n_slots - 1);
+            while (slots[s]) {
+                s = (s + 1) & (n_slots - 1);
+            }
+            slots[s] = (uint32_t)(t + 1);
+        }
+        free(w->ticker_slots);
+        w->ticker_slots = slots;
+        w->n_slots = n_slots;
+    }
+
+    size_t s = market_ticker_hash(name) & (w->n_slots - 1);
+    while (w->ticker_slots[s]) {
+        size_t t = w->ticker_slots[s] - 1;
+        if (strcmp(w->tickers[t], name) == 0) {
+            return (long)t;
+        }
+        s = (s + 1) & (w->n_slots - 1);
+    }
+
+    if (w->n_tickers == UINT32_MAX - 1) {
+        return -1;
+    }
+    if (w->n_tickers == w->ticker_capacity) {
+        size_t capacity = w->ticker_capacity ? 2 * w->ticker_capacity : 64;
+        char (*tickers)[MARKET_TICKER_LEN] = realloc(w->tickers, capacity * MARKET_TICKER_LEN);
+        if (!tickers) {
+            return -1;
+        }
+        w->tickers = tickers;
+        w->ticker_capacity = capacity;
+    }
+    memset(w->tickers[w->n_tickers], 0, MARKET_TICKER_LEN);
+    memcpy(w->tickers[w->n_tickers], name, strnlen(name, MARKET_TICKER_LEN - 1));
+    w->ticker_slots[s] = (uint32_t)(w->n_tickers + 1);
+    return (long)w->n_tickers++;
+}
+
+/**
+ * Grow every column to hold at least one more contract.
+ *
+ * @return  0 on success, -1 if out of memory (the writer is unchanged)
+ */
+static int market_writer_reserve(market_writer *w) {
+    if (w->n_contracts < w->capacity) {
+        return 0;
+    }
+    size_t capacity = w->capacity ? 2 * w->capacity : 1024;
+    uint32_t *ticker_id = realloc(w->ticker_id, capacity * sizeof(*ticker_id));
+    if (!ticker_id) {
+        return -1;
+    }
+    w->ticker_id = ticker_id;
+    for (int c = 0; c < MARKET_COL_PRICE; c++) {
+        double *column = realloc(w->values[c], capacity * sizeof(double));
+        if (!column) {
+            return -1;
+        }
+        w->values[c] = column;
+    }
+    int32_t *type = realloc(w->type, capacity * sizeof(*type));
+    if (!type) {
+        return -1;
+    }
+    w->type = type;
+    w->capacity = capacity;
+    return 0;
+}
+
+/**
+ * Append one contract to the columns.
+ *
+ * Tickers are interned: each distinct name is stored once and contracts
+ * keep its index.
+ *
+ * @param w    Writer
+ * @param rec  Contract to append
+ * @return     0 on success, -1 if out of memory
+ */
+int market_writer_add(market_writer *w, const market_record *rec) {
+    if (market_writer_reserve(w) != 0) {
+        return -1;
+    }
+    long ticker = market_writer_ticker(w, rec->ticker);
+    if (ticker < 0) {
+        return -1;
+    }
+    size_t i = w->n_contracts++;
+    w->ticker_id[i] = (uint32_t)ticker;
+    w->values[MARKET_COL_S0 - 1][i] = rec->S0;
+    w->values[MARKET_COL_K - 1][i] = rec->K;
+    w->values[MARKET_COL_R - 1][i] = rec->r;
+    w->values[MARKET_COL_SIGMA - 1][i] = rec->sigma;
+    w->values[MARKET_COL_T - 1][i] = rec->T;
+    w->values[MARKET_COL_PRICE - 1][i] = rec->market_price;
+    w->type[i] = (int32_t)rec->type;
+    return 0;
+}
+
+/**
+ * Write one column and pad up to the next offset.
+ *
+ * @return  0 on success, -1 on I/O error
+ */
+static int market_write_at(FILE *fp, uint64_t *written, uint64_t offset, const void *data, size_t bytes) {
+    static const char zeros[MARKET_ALIGN] = {0};
+    while (*written < offset) {
+        size_t pad = (offset - *written < MARKET_ALIGN) ? (size_t)(offset - *written) : MARKET_ALIGN;
+        if (fwrite(zeros, 1, pad, fp) != pad) {
+            return -1;
+        }
+        *written += pad;
+    }
+    if (bytes && fwrite(data, 1, bytes, fp) != bytes) {
+        return -1;
+    }
+    *written += bytes;
+    return 0;
+}
+
+/**
+ * Save the contracts added so far as a contract file.
+ *
+ * @param w     Writer
+ * @param path  Output file (replaced)
+ * @return      0 on success, -1 on I/O error
+ */
+int market_writer_save(const market_writer *w, const char *path) {
+    market_file_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MARKET_MAGIC, sizeof(MARKET_MAGIC));
+    h.byte_order = MARKET_BYTE_ORDER;
+    h.n_tickers = (uint32_t)w->n_tickers;
+    h.n_contracts = w->n_contracts;
+    market_layout(&h);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        return -1;
+    }
+    uint64_t written = 0;
+    int status = market_write_at(fp, &written, 0, &h, sizeof(h));
+    for (int c = 0; c < MARKET_N_COLUMNS && status == 0; c++) {
+        const void *data = (c == MARKET_COL_TICKER) ? (const void *)w->ticker_id
+                         : (c == MARKET_COL_TYPE) ? (const void *)w->type
+                         : (const void *)w->values[c - 1];
+        status = market_write_at(fp, &written, h.column[c], data, w->n_contracts * market_column_width(c));
+    }
+    if (status == 0) {
+        status = market_write_at(fp, &written, h.tickers, w->tickers, w->n_tickers * MARKET_TICKER_LEN);
+    }
+    if (fclose(fp) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+/**
+ * Release a writer's storage.
+ *
+ * @param w  Writer from market_writer_init()
+ */
+void market_writer_free(market_writer *w) {
+    free(w->ticker_id);
+    for (int c = 0; c < MARKET_COL_PRICE; c++) {
+        free(w->values[c]);
+    }
+    free(w->type);
+    free(w->tickers);
+    free(w->ticker_slots);
+    market_writer_init(w);
+}
+
+/**
+ * Open a CSV file for streaming.
+ *
+ * @param cs    Stream to initialize
+ * @param path  CSV file
+ * @return      0 on success, -1 if the file cannot be opened or out of memory
+ */
+int csv_stream_open(csv_stream *cs, const char *path) {
+    memset(cs, 0, sizeof(*cs));
+    cs->fp = fopen(path, "rb");
+    cs->buf = malloc(CSV_STREAM_BUFFER + 1);
+    if (!cs->fp || !cs->buf) {
+        csv_stream_close(cs);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Close a CSV stream.
+ *
+ * @param cs  Stream from csv_stream_open()
+ */
+void csv_stream_close(csv_stream *cs) {
+    if (cs->fp) {
+        fclose(cs->fp);
+    }
+    free(cs->buf);
+    memset(cs, 0, sizeof(*cs));
+}
+
+/**
+ * Parse a decimal number at *p, advancing *p past it.
+ *
+ * Plain decimals with at most 15 significant digits and fewer than 23
+ * fraction digits (every price and rate in practice) take the exact fast
+ * path: the digits as an integer, which is exact in a double, divided by
+ * an exact power of ten, so the single rounding of the division gives the
+ * correctly rounded value, the same as strtod(). Anything else
+ * (exponents, long mantissas) falls back to strtod(), which would also
+ * take "inf", "nan" and overflowing exponents; those are rejected.
+ *
+ * @return  0 on success, -1 if no finite number starts at *p
+ */
+static int csv_parse_double(const char **p, double *out) {
+    static const double pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *s = *p;
+    int negative = (*s == '-');
+    s += (*s == '-' || *s == '+');
+
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0, any = 0;
+    for (; *s >= '0' && *s <= '9'; s++, any = 1) {
+        if (mantissa || *s != '0') {
+            digits++;
+        }
+        mantissa = 10 * mantissa + (uint64_t)(*s - '0');
+    }
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++, any = 1) {
+            if (mantissa || *s != '0') {
+                digits++;
+            }
+            mantissa = 10 * mantissa + (uint64_t)(*s - '0');
+            fraction++;
+        }
+    }
+    if (any && digits <= 15 && fraction <= 22 && *s != 'e' && *s != 'E') {
+        double value = (double)mantissa / pow10[fraction];
+        *out = negative ? -value : value;
+        *p = s;
+        return 0;
+    }
+
+    char *end;
+    *out = strtod(*p, &end);
+    if (end == *p || !isfinite(*out)) {
+        return -1;
+    }
+    *p = end;
+    return 0;
+}
+
+/**
+ * Whether the field at p (up to the next comma, CR or end of line) is
+ * word, ignoring case.
+ */
+static int csv_field_is(const char *p, const char *word) {
+    size_t len = strcspn(p, ",\r");
+    return len == strlen(word) && strncasecmp(p, word, len) == 0;
+}
+
+/**
+ * Parse one CSV line (NUL-terminated, no newline) into a record.
+ *
+ * @return  1 for a record, 0 for a comment or blank line, -1 if malformed
+ */
+static int csv_parse_line(const char *line, market_record *rec) {
+    if (line[0] == '#' || line[0] == '\0' || line[0] == '\r') {
+        return 0;
+    }
+    const char *comma = strchr(line, ',');
+    if (!comma || comma == line || (size_t)(comma - line) >= MARKET_TICKER_LEN) {
+        return -1;
+    }
+    memset(rec->ticker, 0, MARKET_TICKER_LEN);
+    memcpy(rec->ticker, line, (size_t)(comma - line));
+
+    double fields[6];
+    const char *p = comma + 1;
+    for (int f = 0; f < 6; f++) {
+        if (csv_parse_double(&p, &fields[f]) != 0) {
+            return -1;
+        }
+        if (f < 5 && *p++ != ',') {
+            return -1;
+        }
+    }
+    rec->S0 = fields[0];
+    rec->K = fields[1];
+    rec->r = fields[2];
+    rec->sigma = fields[3];
+    rec->T = fields[4] / 365.0;     // Calendar days
+    rec->market_price = fields[5];
+    rec->type = OPTION_CALL;
+
+    // Optional eighth field: call or put
+    if (*p == ',') {
+        p++;
+        if (csv_field_is(p, "put") || csv_field_is(p, "p")) {
+            rec->type = OPTION_PUT;
+        } else if (!(csv_field_is(p, "call") || csv_field_is(p, "c"))) {
+            return -1;
+        }
+        while (*p && *p != '\r') {
+            p++;
+        }
+    }
+    return (*p == '\0' || *p == '\r') ? 1 : -1;
+}
+
+/**
+ * Read the next valid record.
+ *
+ * The file is read in CSV_STREAM_BUFFER blocks; a line cut by the end of
+ * a block is moved to the front before the next read, so memory stays
+ * constant however large the file is. Comments and blank lines are
+ * skipped, malformed lines are skipped and counted in cs->n_bad, and CRLF
+ * line endings are accepted.
+ *
+ * @param cs   Stream
+ * @param rec  Receives the record
+ * @return     1 if rec was filled, 0 at end of file, -1 on read error
+ */
+int csv_stream_next(csv_stream *cs, market_record *rec) {
+    PROFILE_SCOPE(PROFILE_CSV);
+    for (;;) {
+        char *start = cs->buf + cs->pos;
+        char *newline = memchr(start, '\n', cs->len - cs->pos);
+        if (!newline) {
+            if (cs->eof) {
+                if (cs->pos == cs->len) {
+                    return 0;
+                }
+                // Last line without a newline
+                newline = cs->buf + cs->len;
+            } else {
+                size_t rest = cs->len - cs->pos;
+                if (rest == CSV_STREAM_BUFFER) {
+                    // A line longer than the buffer: drop it up to its newline
+                    cs->n_bad++;
+                    int ch;
+                    while ((ch = fgetc(cs->fp)) != EOF && ch != '\n') {
+                    }
+                    cs->pos = cs->len = 0;
+                    cs->eof = (ch == EOF);
+                    continue;
+                }
+                memmove(cs->buf, start, rest);
+                cs->pos = 0;
+                cs->len = rest + fread(cs->buf + rest, 1, CSV_STREAM_BUFFER - rest, cs->fp);
+                if (ferror(cs->fp)) {
+                    return -1;
+                }
+                cs->eof = feof(cs->fp);
+                continue;
+            }
+        }
+
+        *newline = '\0';
+        cs->pos = (size_t)(newline - cs->buf) + (newline < cs->buf + cs->len);
+        int parsed = csv_parse_line(start, rec);
+        if (parsed == 1) {
+            PROFILE_COUNT(PROFILE_CSV_ROWS, 1);
+            return 1;
+        }
+        if (parsed < 0) {
+            cs->n_bad++;
+        }
+    }
+}
+
+/**
+ * Convert a CSV file into a contract file.
+ *
+ * @param csv_path  Input in the real_stocks.csv format
+ * @param out_path  Contract file to write
+ * @param n_bad     Receives the number of malformed lines skipped (may be NULL)
+ * @return          Number of contracts written, or -1 on error
+ */
+long market_data_convert_csv(const char *csv_path, const char *out_path, size_t *n_bad) {
+    csv_stream cs;
+    if (csv_stream_open(&cs, csv_path) != 0) {
+        return -1;
+    }
+    market_writer w;
+    market_writer_init(&w);
+    market_record rec;
+    int status;
+    while ((status = csv_stream_next(&cs, &rec)) == 1) {
+        if (market_writer_add(&w, &rec) != 0) {
+            status = -1;
+            break;
+        }
+    }
+    if (n_bad) {
+        *n_bad = cs.n_bad;
+    }
+    csv_stream_close(&cs);
+
+    long n = (long)w.n_contracts;
+    if (status != 0 || market_writer_save(&w, out_path) != 0) {
+        n = -1;
+    }
+    market_writer_free(&w);
+    return n;
+}
@@ -0,0 +1,417 @@
+//
+// Multilevel Monte Carlo
+// Giles' adaptive MLMC for path options under GBM (see mlmc.h).
+//
+// A sample on level l > 0 is one fine path of base_steps * M^l steps and
+// the coarse path of the level below it: every M fine shocks z_1..z_M are
+// summed into one coarse shock (z_1 + ... + z_M) / √M, so both paths see
+// the same Brownian motion and their payoffs differ only through the grid.
+// Each grid runs through its own path_accumulator, which averages over
+// its own dates and applies the bridge correction for its own step size.
+//
+// The driver works in rounds. It starts with three levels and
+// pilot_paths samples on each, then repeatedly
+//   1. sets each level's sample count to N_l = 2 ε^-2 √(V_l / C_l) Σ √(V_k C_k),
+//      which puts the sampling variance at ε²/2 for the least work,
+//   2. simulates what is missing, and
+//   3. once no level needs more, estimates the bias of the finest level from
+//      how fast the corrections decay, adding a level if it exceeds ε/√2.
+//
+// Chunk c of level l draws from substream l + c * MLMC_MAX_LEVELS of the
+// seed, and chunks are merged in (level, chunk) order, so the sample counts
+// chosen and the price are the same for any thread count.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include "include/mlmc.h"
+#include "include/gbm.h"
+#include "include/rng.h"
+#include "include/parallel.h"
+#include "include/profile.h"
+#include "include/stats.h"
+
+// Paths per inner block (shocks, prices and accumulator state stay in L1)
+#define MLMC_BLOCK_PATHS 256u
+
+// Longest chunk, in paths, whatever the level
+#define MLMC_MAX_CHUNK_PATHS 16384u
+
+// Finest grid allowed, in steps
+#define MLMC_MAX_STEPS (1u << 24)
+
+// Grids and chunking of one level
+typedef struct {
+    gbm_path fine;          // This level's grid
+    gbm_path coarse;        // The grid of the level below (unused on level 0)
+    uint32_t chunk_paths;   // Samples per chunk task (a multiple of MLMC_BLOCK_PATHS)
+    double cost;            // Time steps per sample, fine plus coarse
+} mlmc_level;
+
+// Shared inputs and outputs of one round
+typedef struct {
+    const path_option *opt;
+    double sigma;               // For the continuous-barrier correction
+    unsigned refinement;
+    const mlmc_level *levels;
+    const unsigned *task_level; // task_level[t] = level of task t
+    const rng_state *streams;   // streams[t] = substream of task t
+    mc_moments *partial;        // partial[t] = statistics of task t's corrections
+} mlmc_job;
+
+/**
+ * Defaults: a 2-step level 0, each level twice as fine as the last, up to
+ * 10 levels (1024 steps), and 1024 pilot samples per level.
+ */
+mlmc_options mlmc_options_default(void) {
+    mlmc_options mlmc = {
+        .base_steps = 2,
+        .refinement = 2,
+        .max_levels = 10,
+        .pilot_paths = 1024
+    };
+    return mlmc;
+}
+
+/**
+ * Simulate one chunk of corrections P_l - P_(l-1) (just P_0 on level 0).
+ */
+static void mlmc_chunk(void *ctx, uint32_t task) {
+    const mlmc_job *job = ctx;
+    unsigned l = job->task_level[task];
+    const mlmc_level *lv = &job->levels[l];
+    PROFILE_SCOPE(PROFILE_CHUNK);
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, lv->chunk_paths);
+
+    unsigned M = (l > 0) ? job->refinement : 1;
+    size_t coarse_steps = lv->fine.n_steps / M;
+    double inv_sqrt_M = 1.0 / sqrt((double)M);
+    double S0 = lv->fine.S0;
+
+    double z[MLMC_BLOCK_PATHS], z_sum[MLMC_BLOCK_PATHS];
+    double S_fine[MLMC_BLOCK_PATHS], S_coarse[MLMC_BLOCK_PATHS];
+    double y_fine[MLMC_BLOCK_PATHS], y_coarse[MLMC_BLOCK_PATHS];
+    double state_fine[PATH_ACCUMULATOR_ARRAYS * MLMC_BLOCK_PATHS];
+    double state_coarse[PATH_ACCUMULATOR_ARRAYS * MLMC_BLOCK_PATHS];
+    rng_state rng = job->streams[task];
+    mc_moments *m = &job->partial[task];
+    *m = (mc_moments){0};
+
+    for (uint32_t done = 0; done < lv->chunk_paths; done += MLMC_BLOCK_PATHS) {
+        const size_t n = MLMC_BLOCK_PATHS;
+        path_accumulator fine, coarse;
+        path_accumulator_init(&fine, job->opt, S0, job->sigma, lv->fine.dt, state_fine, n);
+        if (l > 0) {
+            path_accumulator_init(&coarse, job->opt, S0, job->sigma, lv->coarse.dt, state_coarse, n);
+        }
+        for (size_t i = 0; i < n; i++) {
+            S_fine[i] = S0;
+            S_coarse[i] = S0;
+        }
+
+        for (size_t t = 0; t < coarse_steps; t++) {
+            for (size_t i = 0; i < n; i++) {
+                z_sum[i] = 0.0;
+            }
+            for (unsigned k = 0; k < M; k++) {
+                normal_fill(&rng, z, n);
+                gbm_path_step(&lv->fine, S_fine, z, S_fine, n);
+                path_accumulator_update(&fine, t * M + k + 1, S_fine, n);
+                for (size_t i = 0; i < n; i++) {
+                    z_sum[i] += z[i];
+                }
+            }
+            if (l > 0) {
+                for (size_t i = 0; i < n; i++) {
+                    z_sum[i] *= inv_sqrt_M;
+                }
+                gbm_path_step(&lv->coarse, S_coarse, z_sum, S_coarse, n);
+                path_accumulator_update(&coarse, t + 1, S_coarse, n);
+            }
+        }
+
+        path_payoff_fill(&fine, n, y_fine);
+        if (l > 0) {
+            path_payoff_fill(&coarse, n, y_coarse);
+            for (size_t i = 0; i < n; i++) {
+                y_fine[i] -= y_coarse[i];
+            }
+        }
+        moments_add_block(m, y_fine, NULL, n);
+    }
+}
+
+/**
+ * Bias of the finest of n_levels levels, from the decay of the corrections.
+ *
+ * The weak order α is fitted to log|E[P_l - P_(l-1)]| over levels 1.. (at
+ * least 0.5; 1 if there are too few nonzero corrections for a fit), and
+ * the remaining corrections are taken as a geometric series:
+ * bias ≈ |E[P_L - P_(L-1)]| / (M^α - 1), using the previous level as well
+ * in case the last correction happens to be small.
+ *
+ * @return  Undiscounted bias estimate, NAN with a single level
+ */
+static double mlmc_bias(const mc_moments *m, unsigned n_levels, unsigned refinement) {
+    if (n_levels < 2) {
+        return NAN;
+    }
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    unsigned n_fit = 0;
+    for (unsigned l = 1; l < n_levels; l++) {
+        double y = fabs(moments_mean(&m[l]));
+        if (y > 0.0) {
+            sx += l;
+            sy += log(y);
+            sxx += (double)l * l;
+            sxy += l * log(y);
+            n_fit++;
+        }
+    }
+    double alpha = 1.0;
+    if (n_fit >= 2) {
+        double slope = (n_fit * sxy - sx * sy) / (n_fit * sxx - sx * sx);
+        alpha = fmax(0.5, -slope / log((double)refinement));
+    }
+
+    double decay = pow((double)refinement, alpha);
+    double last = fabs(moments_mean(&m[n_levels - 1]));
+    if (n_levels >= 3) {
+        last = fmax(last, fabs(moments_mean(&m[n_levels - 2])) / decay);
+    }
+    return last / (decay - 1.0);
+}
+
+/**
+ * Make room for n tasks in the round buffers.
+ *
+ * @return  0, or -1 out of memory (buffers unchanged)
+ */
+static int mlmc_reserve(size_t n, size_t *capacity, unsigned **task_level, rng_state **streams,
+                        mc_moments **partial) {
+    if (n <= *capacity) {
+        return 0;
+    }
+    size_t grown = *capacity ? *capacity : 64;
+    while (grown < n) {
+        grown *= 2;
+    }
+    unsigned *levels = realloc(*task_level, grown * sizeof(*levels));
+    if (!levels) {
+        return -1;
+    }
+    *task_level = levels;
+    rng_state *s = realloc(*streams, grown * sizeof(*s));
+    if (!s) {
+        return -1;
+    }
+    *streams = s;
+    mc_moments *p = realloc(*partial, grown * sizeof(*p));
+    if (!p) {
+        return -1;
+    }
+    *partial = p;
+    *capacity = grown;
+    return 0;
+}
+
+/**
+ * Multilevel Monte Carlo price of a path option under GBM.
+ *
+ * The target is the option on a continuous grid: an average over the whole
+ * life, and a barrier watched at every instant (with MONITOR_CONTINUOUS the
+ * bridge correction already removes most of the grid bias, so few levels
+ * are needed). Level l uses mlmc->base_steps * M^l dates; opt->n_steps is
+ * ignored. The root-mean-square error is held to ε = opts->abs_tol, or
+ * ε = opts->rel_tol × price, whichever is larger if both are set.
+ *
+ * @param opt     Option terms (payoff, barrier; the grid comes from mlmc)
+ * @param S0      Initial stock price
+ * @param r       Risk-free interest rate
+ * @param sigma   Volatility
+ * @param T       Time to maturity in years
+ * @param opts    seed, n_threads, the tolerance, and n_sim as the most samples per level
+ * @param mlmc    Grid and pilot settings (start from mlmc_options_default())
+ * @param report  Receives the per-level statistics (may be NULL)
+ * @return        Price and sampling standard error; n_paths counts samples on all
+ *                levels (NAN on invalid input or out of memory)
+ */
+mc_result price_path_mlmc(
+    const path_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    const mlmc_options *mlmc,
+    mlmc_report *report
+) {
+    mc_result result = { NAN, NAN, 0 };
+    if (report) {
+        *report = (mlmc_report){ .bias = NAN };
+    }
+    if (opts->n_sim == 0 || !(opts->abs_tol > 0.0 || opts->rel_tol > 0.0) || !(S0 > 0.0) || !(sigma >= 0.0)
+        || !(T > 0.0) || mlmc->base_steps == 0 || mlmc->refinement < 2 || mlmc->max_levels == 0
+        || mlmc->max_levels > MLMC_MAX_LEVELS || mlmc->pilot_paths == 0) {
+        return result;
+    }
+
+    mlmc_level levels[MLMC_MAX_LEVELS];
+    rng_state cursor[MLMC_MAX_LEVELS];
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+    size_t steps = mlmc->base_steps;
+    for (unsigned l = 0; l < mlmc->max_levels; l++) {
+        if (steps > MLMC_MAX_STEPS) {
+            return result;
+        }
+        levels[l].fine = gbm_path_init(S0, r, sigma, T, steps);
+        levels[l].coarse = (l > 0) ? levels[l - 1].fine : levels[l].fine;
+        uint32_t chunk = (uint32_t)(MLMC_CHUNK_STEPS / steps) / MLMC_BLOCK_PATHS * MLMC_BLOCK_PATHS;
+        levels[l].chunk_paths = (chunk < MLMC_BLOCK_PATHS) ? MLMC_BLOCK_PATHS
+                              : (chunk > MLMC_MAX_CHUNK_PATHS) ? MLMC_MAX_CHUNK_PATHS : chunk;
+        levels[l].cost = (double)steps + ((l > 0) ? (double)(steps / mlmc->refinement) : 0.0);
+        cursor[l] = rng;
+        rng_jump(&rng);
+        steps *= mlmc->refinement;
+    }
+
+    mc_moments m[MLMC_MAX_LEVELS] = {{0}};
+    uint64_t n[MLMC_MAX_LEVELS] = {0}, target[MLMC_MAX_LEVELS] = {0};
+    unsigned n_levels = (mlmc->max_levels < 3) ? mlmc->max_levels : 3;
+    for (unsigned l = 0; l < n_levels; l++) {
+        target[l] = mlmc->pilot_paths;
+    }
+
+    double discount = exp(-r * T);
+    unsigned *task_level = NULL;
+    rng_state *streams = NULL;
+    mc_moments *partial = NULL;
+    size_t capacity = 0;
+    double bias = NAN, eps = 0.0;
+    int converged = 0, failed = 0;
+
+    for (;;) {
+        // Simulate whatever the targets ask for, all levels in one parallel round
+        uint64_t chunks[MLMC_MAX_LEVELS], n_tasks = 0;
+        for (unsigned l = 0; l < n_levels; l++) {
+            uint64_t missing = (target[l] > n[l]) ? target[l] - n[l] : 0;
+            chunks[l] = (missing + levels[l].chunk_paths - 1) / levels[l].chunk_paths;
+            n_tasks += chunks[l];
+        }
+        if (n_tasks > 0) {
+            if (n_tasks > UINT32_MAX
+                || mlmc_reserve((size_t)n_tasks, &capacity, &task_level, &streams, &partial) != 0) {
+                failed = 1;
+                break;
+            }
+            size_t t = 0;
+            for (unsigned l = 0; l < n_levels; l++) {
+                for (uint64_t c = 0; c < chunks[l]; c++, t++) {
+                    task_level[t] = l;
+                    streams[t] = cursor[l];
+                    for (unsigned j = 0; j < MLMC_MAX_LEVELS; j++) {
+                        rng_jump(&cursor[l]);
+                    }
+                }
+            }
+            mlmc_job job = {
+                .opt = opt,
+                .sigma = sigma,
+                .refinement = mlmc->refinement,
+                .levels = levels,
+                .task_level = task_level,
+                .streams = streams,
+                .partial = partial
+            };
+            parallel_for((uint32_t)n_tasks, opts->n_threads, mlmc_chunk, &job);
+            PROFILE_COUNT(PROFILE_BATCHES, 1);
+
+            // Deterministic reduction: level by level, chunk by chunk
+            t = 0;
+            for (unsigned l = 0; l < n_levels; l++) {
+                for (uint64_t c = 0; c < chunks[l]; c++, t++) {
+                    moments_merge(&m[l], &partial[t]);
+                }
+                n[l] += chunks[l] * levels[l].chunk_paths;
+            }
+        }
+
+        // Tolerance in undiscounted units (a relative one follows the estimate)
+        double price = 0.0;
+        for (unsigned l = 0; l < n_levels; l++) {
+            price += moments_mean(&m[l]);
+        }
+        eps = fmax(opts->abs_tol / discount, opts->rel_tol * fabs(price));
+
+        // Sample counts that bring the sampling variance to ε²/2 for the least work
+        double sum = 0.0;
+        for (unsigned l = 0; l < n_levels; l++) {
+            sum += sqrt(moments_variance(&m[l]) * levels[l].cost);
+        }
+        int more = 0;
+        for (unsigned l = 0; eps > 0.0 && l < n_levels; l++) {
+            double want = ceil(2.0 / (eps * eps) * sqrt(moments_variance(&m[l]) / levels[l].cost) * sum);
+            uint64_t wanted = (want < (double)opts->n_sim) ? (uint64_t)want : opts->n_sim;
+            if (wanted > n[l] && n[l] < opts->n_sim) {
+                target[l] = wanted;
+                more = 1;
+            }
+        }
+        if (more) {
+            continue;
+        }
+
+        // Variance done: refine the grid while the finest level is too biased
+        double variance = 0.0;
+        for (unsigned l = 0; l < n_levels; l++) {
+            variance += moments_variance(&m[l]) / (double)n[l];
+        }
+        bias = mlmc_bias(m, n_levels, mlmc->refinement);
+        int variance_ok = (variance <= 0.5 * eps * eps * (1.0 + 1e-9));
+        if (isnan(bias) || bias <= eps / sqrt(2.0)) {
+            converged = variance_ok && !isnan(bias);
+            if (!isnan(bias) || n_levels == mlmc->max_levels) {
+                break;
+            }
+        }
+        if (n_levels == mlmc->max_levels) {
+            break;
+        }
+        target[n_levels] = mlmc->pilot_paths;
+        n_levels++;
+    }
+
+    free(task_level);
+    free(streams);
+    free(partial);
+    if (failed) {
+        return result;
+    }
+
+    double price = 0.0, variance = 0.0, cost = 0.0;
+    uint64_t n_paths = 0;
+    for (unsigned l = 0; l < n_levels; l++) {
+        price += moments_mean(&m[l]);
+        variance += moments_variance(&m[l]) / (double)n[l];
+        cost += (double)n[l] * levels[l].cost;
+        n_paths += n[l];
+    }
+    result.price = discount * price;
+    result.std_error = discount * sqrt(variance);
+    result.n_paths = n_paths;
+
+    if (report) {
+        report->n_levels = n_levels;
+        for (unsigned l = 0; l < n_levels; l++) {
+            report->n_paths[l] = n[l];
+            report->mean[l] = discount * moments_mean(&m[l]);
+            report->variance[l] = discount * discount * moments_variance(&m[l]);
+        }
+        report->bias = discount * bias;
+        report->cost = cost;
+        report->converged = converged;
+    }
+    return result;
+}
@@ -0,0 +1,670 @@
+//
+// Market Models
+// GBM, Heston and local volatility behind one interface. model_path_init()
+// precomputes everything that depends only on the contract and the grid:
+// the exact GBM step constants, Andersen's QE coefficients for Heston, and
+// for local vol a table of σ on a uniform ln S grid at every time step, so
+// a step is two loads and a multiply-add instead of a search. It also
+// picks the block simulator, once; the loops over steps and paths below
+// then call nothing indirectly.
+//
+
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+#include "include/model.h"
+#include "include/normal.h"
+#include "include/simd.h"
+#include "include/vmath_avx2.h"
+
+// QE switches from the quadratic to the exponential variance step above this ψ
+#define MODEL_QE_PSI_SWITCH 1.5
+
+// Simpson intervals and upper limit for the Heston pricing integral
+#define HESTON_INTEGRAL_STEPS 4000
+#define HESTON_INTEGRAL_MAX 400.0
+
+#define MODEL_PI 3.14159265358979323846
+
+/**
+ * GBM model with constant volatility.
+ */
+market_model model_gbm(double S0, double r, double sigma) {
+    market_model m = { .kind = MODEL_GBM, .S0 = S0, .r = r, .sigma = sigma };
+    return m;
+}
+
+/**
+ * Heston stochastic-volatility model.
+ */
+market_model model_heston(double S0, double r, const heston_params *params) {
+    market_model m = { .kind = MODEL_HESTON, .S0 = S0, .r = r, .heston = *params };
+    return m;
+}
+
+/**
+ * Local-volatility model on a caller-owned surface.
+ */
+market_model model_local_vol(double S0, double r, const local_vol_surface *surface) {
+    market_model m = { .kind = MODEL_LOCAL_VOL, .S0 = S0, .r = r, .local_vol = surface };
+    return m;
+}
+
+/**
+ * Locate x on increasing nodes: index of the left node and the weight of
+ * the right one, both clamped so values beyond the edges are flat.
+ */
+static size_t locate(const double *nodes, size_t n, double x, double *weight) {
+    if (n < 2 || x <= nodes[0]) {
+        *weight = 0.0;
+        return 0;
+    }
+    if (x >= nodes[n - 1]) {
+        *weight = 1.0;
+        return n - 2;
+    }
+    size_t lo = 0, hi = n - 1;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (nodes[mid] <= x) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *weight = (x - nodes[lo]) / (nodes[hi] - nodes[lo]);
+    return lo;
+}
+
+/**
+ * Local volatility σ(t, S), bilinear in t and ln S between grid nodes and
+ * flat beyond the edges of the grid.
+ *
+ * @param surface  Volatility grid
+ * @param t        Time in years
+ * @param S        Stock price (> 0)
+ * @return         Interpolated volatility
+ */
+double local_vol_at(const local_vol_surface *surface, double t, double S) {
+    size_t n_s = surface->n_spots;
+    double wt, ws;
+    size_t it = locate(surface->times, surface->n_times, t, &wt);
+    size_t is = locate(surface->spots, n_s, S, &ws);
+    if (ws > 0.0 && ws < 1.0) {
+        // Between two spot nodes: the weight is linear in ln S
+        ws = log(S / surface->spots[is]) / log(surface->spots[is + 1] / surface->spots[is]);
+    }
+    size_t it1 = (surface->n_times > 1) ? it + 1 : it;
+    size_t is1 = (n_s > 1) ? is + 1 : is;
+    const double *row0 = surface->sigma + it * n_s, *row1 = surface->sigma + it1 * n_s;
+    double s0 = row0[is] + ws * (row0[is1] - row0[is]);
+    double s1 = row1[is] + ws * (row1[is1] - row1[is]);
+    return s0 + wt * (s1 - s0);
+}
+
+/**
+ * Heston characteristic function of X = ln(S(T)/S0) - rT at complex u, in
+ * the "little trap" form of Albrecher et al. (2007), which stays on the
+ * principal branch of the logarithm for long maturities.
+ */
+static double complex heston_cf(const heston_params *h, double T, double complex u) {
+    double complex iu = I * u;
+    double complex beta = h->kappa - h->rho * h->xi * iu;
+    double complex d = csqrt(beta * beta + h->xi * h->xi * (iu + u * u));
+    double complex g = (beta - d) / (beta + d);
+    double complex e = cexp(-d * T);
+    double complex C = h->kappa * h->theta / (h->xi * h->xi)
+                     * ((beta - d) * T - 2.0 * clog((1.0 - g * e) / (1.0 - g)));
+    double complex D = (beta - d) / (h->xi * h->xi) * (1.0 - e) / (1.0 - g * e);
+    return cexp(C + D * h->v0);
+}
+
+/**
+ * Semi-analytic Heston price of a European call (Lewis 2000):
+ *   C = S0 - √(S0 K) e^(-rT/2) / π ∫₀^∞ Re[e^(iuk) φ(u - i/2)] / (u² + 1/4) du
+ * with k = ln(S0/K) + rT and φ the characteristic function above. The
+ * integrand decays exponentially; Simpson's rule on [0, 400] is accurate
+ * to about 1e-8 of S0 for ordinary parameters.
+ *
+ * This is the reference the Heston simulators are tested against.
+ *
+ * @param S0  Initial stock price
+ * @param K   Strike price
+ * @param r   Risk-free interest rate
+ * @param T   Time to maturity in years
+ * @param h   Heston parameters (scheme is ignored)
+ * @return    Call price
+ */
+double heston_call_price(double S0, double K, double r, double T, const heston_params *h) {
+    double k = log(S0 / K) + r * T;
+    double du = HESTON_INTEGRAL_MAX / HESTON_INTEGRAL_STEPS;
+    double sum = 0.0;
+    for (int j = 0; j <= HESTON_INTEGRAL_STEPS; j++) {
+        double u = j * du;
+        double complex phi = heston_cf(h, T, u - 0.5 * I);
+        double f = creal(cexp(I * u * k) * phi) / (u * u + 0.25);
+        double w = (j == 0 || j == HESTON_INTEGRAL_STEPS) ? 1.0 : ((j & 1) ? 4.0 : 2.0);
+        sum += w * f;
+    }
+    double integral = sum * du / 3.0;
+    return S0 - sqrt(S0 * K) * exp(-0.5 * r * T) * integral / MODEL_PI;
+}
+
+/**
+ * GBM block: the exact log step, S <- S * exp(drift + vol * Z).
+ */
+static void model_gbm_block(const model_path *p, rng_state *rng, size_t n,
+                            path_accumulator *up, path_accumulator *down) {
+    double z[MODEL_BLOCK_PATHS], z_down[MODEL_BLOCK_PATHS];
+    double s_up[MODEL_BLOCK_PATHS], s_down[MODEL_BLOCK_PATHS];
+    for (size_t i = 0; i < n; i++) {
+        s_up[i] = s_down[i] = p->S0;
+    }
+    for (size_t t = 1; t <= p->n_steps; t++) {
+        normal_fill(rng, z, n);
+        gbm_path_step(&p->gbm, s_up, z, s_up, n);
+        path_accumulator_update(up, t, s_up, n);
+        if (down) {
+            for (size_t i = 0; i < n; i++) {
+                z_down[i] = -z[i];
+            }
+            gbm_path_step(&p->gbm, s_down, z_down, s_down, n);
+            path_accumulator_update(down, t, s_down, n);
+        }
+    }
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 variant of heston_qe_step(): four paths per iteration.
+ *
+ * Both variance branches are computed as vectors and blended; the
+ * exponential branch (two logs and a normal CDF) only when some lane
+ * needs it, which away from v ≈ 0 is rare.
+ *
+ * @return  Number of paths done (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t heston_qe_step_avx2(const model_path *p, const double *z_v, const double *z_s, double sign,
+                                  double *x, double *v, double *S, size_t n) {
+    const heston_params *h = &p->heston;
+    const __m256d one = _mm256_set1_pd(1.0), half = _mm256_set1_pd(0.5), zero = _mm256_setzero_pd();
+    const __m256d theta = _mm256_set1_pd(h->theta), decay = _mm256_set1_pd(p->h_decay);
+    const __m256d s2_v = _mm256_set1_pd(p->h_s2_v), s2_c = _mm256_set1_pd(p->h_s2_c);
+    const __m256d A = _mm256_set1_pd(p->h_k2 + 0.5 * p->h_k4);
+    const __m256d k0_plain = _mm256_set1_pd(p->h_k0), k1 = _mm256_set1_pd(p->h_k1), k2 = _mm256_set1_pd(p->h_k2);
+    const __m256d k3 = _mm256_set1_pd(p->h_k3), k4 = _mm256_set1_pd(p->h_k4);
+    const __m256d k_var = _mm256_set1_pd(p->h_k1 + 0.5 * p->h_k3);
+    const __m256d r_dt = _mm256_set1_pd(p->r_dt), sgn = _mm256_set1_pd(sign);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v_now = _mm256_loadu_pd(v + i);
+        __m256d zv = _mm256_mul_pd(sgn, _mm256_loadu_pd(z_v + i));
+        __m256d m = _mm256_fmadd_pd(_mm256_sub_pd(v_now, theta), decay, theta);
+        __m256d s2 = _mm256_fmadd_pd(v_now, s2_v, s2_c);
+        __m256d psi = _mm256_div_pd(s2, _mm256_mul_pd(m, m));
+        __m256d quad = _mm256_cmp_pd(psi, _mm256_set1_pd(MODEL_QE_PSI_SWITCH), _CMP_LE_OQ);
+
+        // Quadratic branch; lanes that take the other one see ψ clamped to the switch point
+        __m256d inv_psi = _mm256_div_pd(_mm256_set1_pd(2.0), _mm256_min_pd(psi, _mm256_set1_pd(MODEL_QE_PSI_SWITCH)));
+        __m256d b2 = _mm256_add_pd(_mm256_sub_pd(inv_psi, one),
+                                   _mm256_mul_pd(_mm256_sqrt_pd(inv_psi), _mm256_sqrt_pd(_mm256_sub_pd(inv_psi, one))));
+        __m256d a = _mm256_div_pd(m, _mm256_add_pd(one, b2));
+        __m256d bz = _mm256_add_pd(_mm256_sqrt_pd(b2), zv);
+        __m256d v_next = _mm256_mul_pd(a, _mm256_mul_pd(bz, bz));
+        __m256d one_m_2Aa = _mm256_fnmadd_pd(_mm256_add_pd(A, A), a, one);
+        __m256d ok = _mm256_cmp_pd(one_m_2Aa, zero, _CMP_GT_OQ);
+        __m256d k0 = _mm256_fmadd_pd(half, v_log(_mm256_blendv_pd(one, one_m_2Aa, ok)),
+                                     _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(A, b2), a),
+                                                   _mm256_sub_pd(zero, one_m_2Aa)));
+        k0 = _mm256_blendv_pd(k0_plain, _mm256_fnmadd_pd(k_var, v_now, k0), ok);
+
+        if (_mm256_movemask_pd(quad) != 0xF) {
+            // Exponential branch: point mass at 0 with probability `prob`, then an exponential tail
+            __m256d prob = _mm256_div_pd(_mm256_sub_pd(psi, one), _mm256_add_pd(psi, one));
+            __m256d beta = _mm256_div_pd(_mm256_sub_pd(one, prob), m);
+            __m256d u, u_neg;
+            v_normal_cdf(zv, &u, &u_neg);
+            __m256d tail = _mm256_cmp_pd(u, prob, _CMP_GT_OQ);
+            __m256d ratio = _mm256_div_pd(_mm256_sub_pd(one, prob), _mm256_blendv_pd(one, u_neg, tail));
+            __m256d v_exp_branch = _mm256_and_pd(tail, _mm256_div_pd(v_log(_mm256_blendv_pd(one, ratio, tail)), beta));
+            __m256d beta_ok = _mm256_cmp_pd(A, beta, _CMP_LT_OQ);
+            __m256d mgf = _mm256_add_pd(prob, _mm256_div_pd(_mm256_mul_pd(beta, _mm256_sub_pd(one, prob)),
+                                                            _mm256_sub_pd(beta, A)));
+            __m256d k0_exp = _mm256_fnmadd_pd(k_var, v_now,
+                                              _mm256_sub_pd(zero, v_log(_mm256_blendv_pd(one, mgf, beta_ok))));
+            k0_exp = _mm256_blendv_pd(k0_plain, k0_exp, beta_ok);
+            v_next = _mm256_blendv_pd(v_exp_branch, v_next, quad);
+            k0 = _mm256_blendv_pd(k0_exp, k0, quad);
+        }
+
+        __m256d var = _mm256_fmadd_pd(k3, v_now, _mm256_mul_pd(k4, v_next));
+        __m256d shock = _mm256_mul_pd(_mm256_sqrt_pd(var), _mm256_mul_pd(sgn, _mm256_loadu_pd(z_s + i)));
+        __m256d dx = _mm256_add_pd(_mm256_add_pd(r_dt, k0), _mm256_fmadd_pd(k1, v_now, _mm256_fmadd_pd(k2, v_next, shock)));
+        __m256d x_next = _mm256_add_pd(_mm256_loadu_pd(x + i), dx);
+        _mm256_storeu_pd(x + i, x_next);
+        _mm256_storeu_pd(v + i, v_next);
+        _mm256_storeu_pd(S + i, v_exp(x_next));
+    }
+    return i;
+}
+
+/**
+ * AVX2 variant of heston_euler_step(): four paths per iteration.
+ *
+ * @return  Number of paths done (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t heston_euler_step_avx2(const model_path *p, const double *z_v, const double *z_s, double sign,
+                                     double *x, double *v, double *S, size_t n) {
+    const heston_params *h = &p->heston;
+    const __m256d zero = _mm256_setzero_pd(), sgn = _mm256_set1_pd(sign);
+    const __m256d rho = _mm256_set1_pd(h->rho), rho_bar = _mm256_set1_pd(sqrt(1.0 - h->rho * h->rho));
+    const __m256d kappa_dt = _mm256_set1_pd(h->kappa * p->dt), theta = _mm256_set1_pd(h->theta);
+    const __m256d xi = _mm256_set1_pd(h->xi), sqrt_dt = _mm256_set1_pd(p->sqrt_dt);
+    const __m256d r_dt = _mm256_set1_pd(p->r_dt), half_dt = _mm256_set1_pd(0.5 * p->dt);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v_now = _mm256_loadu_pd(v + i);
+        __m256d v_pos = _mm256_max_pd(v_now, zero);
+        __m256d sd = _mm256_mul_pd(_mm256_sqrt_pd(v_pos), sqrt_dt);
+        __m256d zv = _mm256_mul_pd(sgn, _mm256_loadu_pd(z_v + i));
+        __m256d zs = _mm256_fmadd_pd(rho, zv, _mm256_mul_pd(rho_bar, _mm256_mul_pd(sgn, _mm256_loadu_pd(z_s + i))));
+        __m256d x_next = _mm256_add_pd(_mm256_loadu_pd(x + i),
+                                       _mm256_fmadd_pd(sd, zs, _mm256_fnmadd_pd(half_dt, v_pos, r_dt)));
+        __m256d v_next = _mm256_fmadd_pd(kappa_dt, _mm256_sub_pd(theta, v_pos),
+                                         _mm256_fmadd_pd(_mm256_mul_pd(xi, sd), zv, v_now));
+        _mm256_storeu_pd(x + i, x_next);
+        _mm256_storeu_pd(v + i, v_next);
+        _mm256_storeu_pd(S + i, v_exp(x_next));
+    }
+    return i;
+}
+
+/**
+ * AVX2 variant of local_vol_step(): four paths per iteration, the two
+ * table nodes around each path fetched with gathers.
+ *
+ * @return  Number of paths done (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t local_vol_step_avx2(const model_path *p, const double *row, const double *z, double sign,
+                                  double *x, double *S, size_t n) {
+    const __m256d zero = _mm256_setzero_pd(), last = _mm256_set1_pd((double)(MODEL_LV_NODES - 1));
+    const __m256d x0 = _mm256_set1_pd(p->lv_x0), inv_dx = _mm256_set1_pd(p->lv_inv_dx);
+    const __m256d r_dt = _mm256_set1_pd(p->r_dt), half_dt = _mm256_set1_pd(0.5 * p->dt);
+    const __m256d vol_dt = _mm256_set1_pd(sign * p->sqrt_dt);
+    const __m128i top = _mm_set1_epi32((int)MODEL_LV_NODES - 2);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x_now = _mm256_loadu_pd(x + i);
+        __m256d u = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(x_now, x0), inv_dx), zero), last);
+        __m128i j = _mm_min_epi32(_mm256_cvttpd_epi32(u), top);
+        __m256d lo = _mm256_i32gather_pd(row, j, 8);
+        __m256d hi = _mm256_i32gather_pd(row + 1, j, 8);
+        __m256d w = _mm256_sub_pd(u, _mm256_cvtepi32_pd(j));
+        __m256d sigma = _mm256_fmadd_pd(w, _mm256_sub_pd(hi, lo), lo);
+        __m256d drift = _mm256_fnmadd_pd(_mm256_mul_pd(half_dt, sigma), sigma, r_dt);
+        __m256d x_next = _mm256_add_pd(x_now, _mm256_fmadd_pd(_mm256_mul_pd(sigma, vol_dt), _mm256_loadu_pd(z + i), drift));
+        _mm256_storeu_pd(x + i, x_next);
+        _mm256_storeu_pd(S + i, v_exp(x_next));
+    }
+    return i;
+}
+#endif
+
+/**
+ * One QE step (Andersen 2008) for n paths: variance v and log price x.
+ *
+ * The variance is moment-matched to its exact conditional mean m and
+ * variance s²: a scaled non-central χ²-like square a(b + Z)² when
+ * ψ = s²/m² is small, and a point mass at 0 plus an exponential tail when
+ * it is large (v near 0). The log price uses the trapezoidal integral of
+ * v over the step, and its drift K0* is chosen per path so that
+ * E[S(t+dt) | S(t), v(t)] = S(t) e^(r dt) exactly: the discounted price
+ * stays a martingale however coarse the grid.
+ *
+ * @param sign  +1, or -1 for the antithetic path (shocks negated)
+ */
+static void heston_qe_step(const model_path *p, const double *z_v, const double *z_s, double sign,
+                           double *x, double *v, double *S, size_t n) {
+    const heston_params *h = &p->heston;
+    double A = p->h_k2 + 0.5 * p->h_k4;
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = heston_qe_step_avx2(p, z_v, z_s, sign, x, v, S, n);
+    }
+#endif
+    for (; i < n; i++) {
+        double v_now = v[i];
+        double m = h->theta + (v_now - h->theta) * p->h_decay;
+        double s2 = v_now * p->h_s2_v + p->h_s2_c;
+        double psi = s2 / (m * m);
+        double zv = sign * z_v[i];
+        double v_next, k0;
+        if (psi <= MODEL_QE_PSI_SWITCH) {
+            double inv_psi = 2.0 / psi;
+            double b2 = inv_psi - 1.0 + sqrt(inv_psi) * sqrt(inv_psi - 1.0);
+            double a = m / (1.0 + b2);
+            double b = sqrt(b2);
+            v_next = a * (b + zv) * (b + zv);
+            k0 = (2.0 * A * a < 1.0)
+                ? -A * b2 * a / (1.0 - 2.0 * A * a) + 0.5 * log(1.0 - 2.0 * A * a) - (p->h_k1 + 0.5 * p->h_k3) * v_now
+                : p->h_k0;
+        } else {
+            double prob = (psi - 1.0) / (psi + 1.0);
+            double beta = (1.0 - prob) / m;
+            // U = N(Z) keeps one normal per step; -Z gives 1 - U
+            double u = normal_cdf(zv);
+            v_next = (u <= prob) ? 0.0 : log((1.0 - prob) / (1.0 - u)) / beta;
+            k0 = (A < beta)
+                ? -log(prob + beta * (1.0 - prob) / (beta - A)) - (p->h_k1 + 0.5 * p->h_k3) * v_now
+                : p->h_k0;
+        }
+        x[i] += p->r_dt + k0 + p->h_k1 * v_now + p->h_k2 * v_next
+              + sqrt(p->h_k3 * v_now + p->h_k4 * v_next) * sign * z_s[i];
+        v[i] = v_next;
+        S[i] = exp(x[i]);
+    }
+}
+
+/**
+ * One full-truncation Euler step for n paths: the variance may go
+ * negative, but only v+ = max(v, 0) enters the drift and the diffusion.
+ *
+ * @param sign  +1, or -1 for the antithetic path (shocks negated)
+ */
+static void heston_euler_step(const model_path *p, const double *z_v, const double *z_s, double sign,
+                              double *x, double *v, double *S, size_t n) {
+    const heston_params *h = &p->heston;
+    double rho_bar = sqrt(1.0 - h->rho * h->rho);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = heston_euler_step_avx2(p, z_v, z_s, sign, x, v, S, n);
+    }
+#endif
+    for (; i < n; i++) {
+        double v_pos = fmax(v[i], 0.0);
+        double sd = sqrt(v_pos) * p->sqrt_dt;
+        double zv = sign * z_v[i];
+        double zs = h->rho * zv + rho_bar * sign * z_s[i];
+        x[i] += p->r_dt - 0.5 * v_pos * p->dt + sd * zs;
+        v[i] += h->kappa * (h->theta - v_pos) * p->dt + h->xi * sd * zv;
+        S[i] = exp(x[i]);
+    }
+}
+
+/**
+ * Heston block: two normal shocks per path and step, Z_v driving the
+ * variance and Z_s the part of the stock shock independent of it.
+ */
+static void model_heston_block(const model_path *p, rng_state *rng, size_t n,
+                               path_accumulator *up, path_accumulator *down) {
+    double z_v[MODEL_BLOCK_PATHS], z_s[MODEL_BLOCK_PATHS];
+    double x_up[MODEL_BLOCK_PATHS], v_up[MODEL_BLOCK_PATHS], s_up[MODEL_BLOCK_PATHS];
+    double x_down[MODEL_BLOCK_PATHS], v_down[MODEL_BLOCK_PATHS], s_down[MODEL_BLOCK_PATHS];
+    double x0 = log(p->S0);
+    for (size_t i = 0; i < n; i++) {
+        x_up[i] = x_down[i] = x0;
+        v_up[i] = v_down[i] = p->heston.v0;
+    }
+    int qe = (p->heston.scheme == HESTON_QE);
+    for (size_t t = 1; t <= p->n_steps; t++) {
+        normal_fill(rng, z_v, n);
+        normal_fill(rng, z_s, n);
+        if (qe) {
+            heston_qe_step(p, z_v, z_s, 1.0, x_up, v_up, s_up, n);
+        } else {
+            heston_euler_step(p, z_v, z_s, 1.0, x_up, v_up, s_up, n);
+        }
+        path_accumulator_update(up, t, s_up, n);
+        if (down) {
+            if (qe) {
+                heston_qe_step(p, z_v, z_s, -1.0, x_down, v_down, s_down, n);
+            } else {
+                heston_euler_step(p, z_v, z_s, -1.0, x_down, v_down, s_down, n);
+            }
+            path_accumulator_update(down, t, s_down, n);
+        }
+    }
+}
+
+/**
+ * One log-Euler step under local vol, σ read off the table row for the
+ * step's start time: linear interpolation between uniform ln S nodes, so
+ * finding the node is a multiply and a truncation.
+ *
+ * @param sign  +1, or -1 for the antithetic path (shocks negated)
+ */
+static void local_vol_step(const model_path *p, const double *row, const double *z, double sign,
+                           double *x, double *S, size_t n) {
+    const double last = (double)(MODEL_LV_NODES - 1);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = local_vol_step_avx2(p, row, z, sign, x, S, n);
+    }
+#endif
+    for (; i < n; i++) {
+        double u = fmin(fmax((x[i] - p->lv_x0) * p->lv_inv_dx, 0.0), last);
+        size_t j = (size_t)u;
+        j -= (j == MODEL_LV_NODES - 1);
+        double sigma = row[j] + (u - (double)j) * (row[j + 1] - row[j]);
+        x[i] += p->r_dt - 0.5 * sigma * sigma * p->dt + sigma * p->sqrt_dt * sign * z[i];
+        S[i] = exp(x[i]);
+    }
+}
+
+/**
+ * Local-vol block: one normal per path and step.
+ */
+static void model_local_vol_block(const model_path *p, rng_state *rng, size_t n,
+                                  path_accumulator *up, path_accumulator *down) {
+    double z[MODEL_BLOCK_PATHS];
+    double x_up[MODEL_BLOCK_PATHS], s_up[MODEL_BLOCK_PATHS];
+    double x_down[MODEL_BLOCK_PATHS], s_down[MODEL_BLOCK_PATHS];
+    double x0 = log(p->S0);
+    for (size_t i = 0; i < n; i++) {
+        x_up[i] = x_down[i] = x0;
+    }
+    for (size_t t = 1; t <= p->n_steps; t++) {
+        const double *row = p->lv_table + (t - 1) * MODEL_LV_NODES;
+        normal_fill(rng, z, n);
+        local_vol_step(p, row, z, 1.0, x_up, s_up, n);
+        path_accumulator_update(up, t, s_up, n);
+        if (down) {
+            local_vol_step(p, row, z, -1.0, x_down, s_down, n);
+            path_accumulator_update(down, t, s_down, n);
+        }
+    }
+}
+
+/**
+ * Heston constants: QE moment coefficients and the log-price coefficients
+ * K0..K4 of Andersen's scheme with trapezoidal weights γ1 = γ2 = 1/2.
+ */
+static void heston_init(model_path *p) {
+    const heston_params *h = &p->heston;
+    double dt = p->dt;
+    double decay = exp(-h->kappa * dt);
+    double xi2 = h->xi * h->xi;
+    p->h_decay = decay;
+    p->h_s2_v = xi2 * decay * (1.0 - decay) / h->kappa;
+    p->h_s2_c = h->theta * xi2 * (1.0 - decay) * (1.0 - decay) / (2.0 * h->kappa);
+
+    double rho_xi = h->rho / h->xi;
+    p->h_k0 = -rho_xi * h->kappa * h->theta * dt;
+    p->h_k1 = 0.5 * dt * (h->kappa * rho_xi - 0.5) - rho_xi;
+    p->h_k2 = 0.5 * dt * (h->kappa * rho_xi - 0.5) + rho_xi;
+    p->h_k3 = 0.5 * dt * (1.0 - h->rho * h->rho);
+    p->h_k4 = p->h_k3;
+}
+
+/**
+ * Sample the local-vol surface at every step's start time on
+ * MODEL_LV_NODES uniform ln S nodes spanning the surface's spot range.
+ *
+ * @param arena  Arena to take the table from, or NULL to malloc it
+ * @return       0, or -1 if out of memory
+ */
+static int local_vol_init(model_path *p, const local_vol_surface *s, mc_arena *arena) {
+    double x_lo = log(s->spots[0]), x_hi = log(s->spots[s->n_spots - 1]);
+    if (!(x_hi > x_lo)) {
+        // One spot node: σ does not depend on S, any range will do
+        x_lo -= 1.0;
+        x_hi += 1.0;
+    }
+    p->lv_x0 = x_lo;
+    p->lv_inv_dx = (double)(MODEL_LV_NODES - 1) / (x_hi - x_lo);
+    size_t bytes = p->n_steps * MODEL_LV_NODES * sizeof(double);
+    p->lv_table = arena ? mc_arena_alloc(arena, bytes) : malloc(bytes);
+    if (!p->lv_table) {
+        return -1;
+    }
+    p->lv_heap = (arena == NULL);
+    double dx = (x_hi - x_lo) / (double)(MODEL_LV_NODES - 1);
+    for (size_t t = 0; t < p->n_steps; t++) {
+        for (size_t j = 0; j < MODEL_LV_NODES; j++) {
+            p->lv_table[t * MODEL_LV_NODES + j] = local_vol_at(s, (double)t * p->dt, exp(x_lo + (double)j * dx));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Check a local-vol surface: non-empty, increasing nodes, positive spots.
+ */
+static int local_vol_valid(const local_vol_surface *s) {
+    if (!s || s->n_times == 0 || s->n_spots == 0 || !s->times || !s->spots || !s->sigma) {
+        return 0;
+    }
+    for (size_t i = 1; i < s->n_times; i++) {
+        if (!(s->times[i] > s->times[i - 1])) return 0;
+    }
+    for (size_t j = 0; j < s->n_spots; j++) {
+        if (!(s->spots[j] > 0.0) || (j > 0 && !(s->spots[j] > s->spots[j - 1]))) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Precompute a model's per-step constants for one contract.
+ *
+ * This is where the model is chosen: p->simulate is set to the block
+ * simulator for m->kind, and everything after that is direct calls.
+ *
+ * @param p        Path constants to fill
+ * @param m        Market model
+ * @param T        Time to maturity in years
+ * @param n_steps  Number of equal time steps
+ * @param arena    Arena for the local-vol table, or NULL to malloc it
+ * @return         0, or -1 on invalid parameters or out of memory
+ */
+static int model_path_setup(model_path *p, const market_model *m, double T, size_t n_steps, mc_arena *arena) {
+    *p = (model_path){0};
+    if (n_steps == 0 || !(T > 0.0) || !(m->S0 > 0.0)) {
+        return -1;
+    }
+    p->kind = m->kind;
+    p->S0 = m->S0;
+    p->n_steps = n_steps;
+    p->dt = T / (double)n_steps;
+    p->r_dt = m->r * p->dt;
+    p->sqrt_dt = sqrt(p->dt);
+
+    switch (m->kind) {
+    case MODEL_GBM:
+        if (!(m->sigma >= 0.0)) {
+            return -1;
+        }
+        p->gbm = gbm_path_init(m->S0, m->r, m->sigma, T, n_steps);
+        p->bridge_sigma = m->sigma;
+        p->simulate = model_gbm_block;
+        return 0;
+    case MODEL_HESTON: {
+        const heston_params *h = &m->heston;
+        if (!(h->v0 >= 0.0 && h->kappa > 0.0 && h->theta >= 0.0 && h->xi > 0.0 && fabs(h->rho) <= 1.0)) {
+            return -1;
+        }
+        p->heston = *h;
+        heston_init(p);
+        p->simulate = model_heston_block;
+        return 0;
+    }
+    case MODEL_LOCAL_VOL:
+        if (!local_vol_valid(m->local_vol) || local_vol_init(p, m->local_vol, arena) != 0) {
+            return -1;
+        }
+        p->simulate = model_local_vol_block;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Precompute a model's per-step constants for one contract (see
+ * model_path_setup); the local-vol table, if any, is malloc-ed.
+ *
+ * @param p        Path constants to fill (release with model_path_free)
+ * @param m        Market model
+ * @param T        Time to maturity in years
+ * @param n_steps  Number of equal time steps
+ * @return         0, or -1 on invalid parameters or out of memory
+ */
+int model_path_init(model_path *p, const market_model *m, double T, size_t n_steps) {
+    return model_path_setup(p, m, T, n_steps, NULL);
+}
+
+/**
+ * Arena bytes model_path_init_arena() needs: the local-vol table, or
+ * nothing for models without one.
+ */
+size_t model_path_bytes(const market_model *m, size_t n_steps) {
+    return (m->kind == MODEL_LOCAL_VOL) ? mc_arena_footprint(n_steps * MODEL_LV_NODES * sizeof(double)) : 0;
+}
+
+/**
+ * model_path_init() with the local-vol table taken from an arena, so that
+ * an engine context prices path options without allocating. The table is
+ * released by rewinding the arena; model_path_free() leaves it alone.
+ *
+ * @param arena  Arena with room for model_path_bytes(m, n_steps)
+ * @return       0, or -1 on invalid parameters or a full arena
+ */
+int model_path_init_arena(model_path *p, const market_model *m, double T, size_t n_steps, mc_arena *arena) {
+    return model_path_setup(p, m, T, n_steps, arena);
+}
+
+/**
+ * Release the storage of a model_path (safe on a zeroed or failed one,
+ * and a no-op for one built by model_path_init_arena).
+ */
+void model_path_free(model_path *p) {
+    if (p->lv_heap) {
+        free(p->lv_table);
+    }
+    p->lv_table = NULL;
+    p->lv_heap = 0;
+}
+
+/**
+ * Simulate a block of paths under the model chosen at model_path_init().
+ *
+ * One indirect call per block; inside, the simulator loops over steps
+ * and paths with the model's kernels called directly.
+ *
+ * @param p     Path constants
+ * @param rng   Random stream (advanced in place)
+ * @param n     Number of paths (at most MODEL_BLOCK_PATHS)
+ * @param up    Accumulator for the paths
+ * @param down  Accumulator for the antithetic paths, or NULL
+ */
+void model_path_simulate(const model_path *p, rng_state *rng, size_t n,
+                         path_accumulator *up, path_accumulator *down) {
+    p->simulate(p, rng, n, up, down);
+}
@@ -5,13 +5,64 @@
 //
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include "include/stock.h"
 #include "include/option.h"
 #include "include/monte_carlo.h"
 #include "include/gbm.h"
+#include "include/model.h"
 #include "include/normal.h"
+#include "include/parallel.h"
+#include "include/profile.h"
+#include "include/stats.h"
+#include "include/sobol.h"
+#include "include/brownian_bridge.h"
+#include "include/kernel.h"
+#include "include/lsm.h"
+#ifdef MC_GPU
+#include "include/gpu.h"
+#endif
 
 
+// Paths simulated per inner block: small enough that the shocks and
+// terminal prices stay in L1 cache between the three passes
+#define MC_BLOCK_PATHS 256u
+
+// Shocks per basket block (assets × paths): the independent normals, the
+// correlated shocks and the prices of one block all stay in L1/L2
+#define MC_BASKET_BLOCK_VALUES 4096u
+
+/**
+ * Simulate n_paths terminal prices and return the sum of their call payoffs.
+ *
+ * Instead of three out-of-line calls per path (normal, GBM, payoff), each
+ * block of MC_BLOCK_PATHS paths goes through three tight loops:
+ *   1. normal_fill()        - shocks Z, both Box-Muller halves
+ *   2. gbm_terminal_fill()  - S(T) = S0 * exp(drift + vol*Z), in place
+ *   3. call_payoff_sum()    - Σ max(S(T) - K, 0), branch-free
+ * Each loop is vectorized when the CPU supports it.
+ *
+ * @param rng      Random stream (advanced in place)
+ * @param g        Precomputed GBM constants
+ * @param K        Strike price
+ * @param n_paths  Number of paths to simulate
+ * @return         Undiscounted payoff sum
+ */
+static double mc_call_payoff_sum(rng_state *rng, const gbm_terminal *g, double K, uint32_t n_paths) {
+    double block[MC_BLOCK_PATHS];
+    double payoff_sum = 0.0;
+
+    while (n_paths > 0) {
+        uint32_t n = (n_paths < MC_BLOCK_PATHS) ? n_paths : MC_BLOCK_PATHS;
+        normal_fill(rng, block, n);
+        gbm_terminal_fill(g, block, block, n);
+        payoff_sum += call_payoff_sum(block, n, K);
+        n_paths -= n;
+    }
+    return payoff_sum;
+}
+
 /**
  * Price a European call option using Monte Carlo simulation.
  *
@@ -35,6 +86,7 @@
  * @param sigma   Volatility (e.g., 0.2 for 20% annual volatility)
  * @param T       Time to maturity in years (e.g., 1.0 for one year)
  * @param n_sim   Number of simulations (more = more accurate, but slower)
+ * @param rng     Random stream for this pricing run (advanced in place)
  * @return        Estimated fair price of the call option
  */
 double price_european_call_mc(
@@ -43,23 +95,24 @@ double price_european_call_mc(
     double r,
     double sigma,
     double T,
-    uint32_t n_sim
+    uint32_t n_sim,
+    rng_state *rng
 ){
-    double payoff_sum = 0.0;
+    // Step 1: Precompute the per-contract GBM constants once
+    gbm_terminal g = gbm_terminal_init(S0, r, sigma, T);
 
-    // Run n_sim independent simulations
-    for (uint32_t i = 0; i < n_sim; i++) {
-        // Step 1: Simulate where the stock price ends up at maturity
-        // Each call gives us a different random outcome
-        double ST = simulate_gbm(S0, r, sigma, T);
-
-        // Step 2: Calculate how much money we'd make with this outcome
-        // For a call: max(ST - K, 0) - we profit if stock > strike
-        double payoff = call_payoff(ST, K);
-
-        // Step 3: Add to our running total
-        payoff_sum += payoff;
+#ifdef MC_GPU
+    // GPU build: one draw from `rng` keys the device's counter-based stream
+    mc_moments m;
+    option_type call = OPTION_CALL;
+    if (n_sim > 0 && gpu_available() &&
+        gpu_european_moments(&g, 0.0, &call, &K, 1, n_sim, rng_next(rng), MC_VR_NONE, &m) == 0) {
+        return moments_mean(&m) * exp(-r * T);
     }
+#endif
+
+    // Steps 2-3: Simulate terminal prices block by block and sum the payoffs
+    double payoff_sum = mc_call_payoff_sum(rng, &g, K, n_sim);
 
     // Step 4: Calculate the average payoff across all simulations
     // This estimates E[payoff] under the risk-neutral measure
@@ -74,41 +127,2136 @@ double price_european_call_mc(
 }
 
 /**
- * Price a European call option using the analytical Black-Scholes formula.
+ * Engine options with sensible defaults: 100k plain paths, seed 42, all cores,
+ * no early stopping, and 16 replicates if the Sobol sampler is switched on.
  *
- * The Black-Scholes formula gives the exact theoretical price:
- *   C = S0 * N(d1) - K * e^(-rT) * N(d2)
+ * Start from this and override the fields you care about, so that new
+ * options added later keep working for existing callers.
+ */
+mc_options mc_options_default(void) {
+    mc_options opts = {
+        .n_sim = 100000u,
+        .seed = 42u,
+        .n_threads = 0,
+        .variance_reduction = MC_VR_NONE,
+        .sampler = MC_SAMPLER_PSEUDO,
+        .n_replicates = 16,
+        .abs_tol = 0.0,
+        .rel_tol = 0.0,
+        .batch_paths = 0,
+        .precision = MC_PRECISION_DOUBLE
+    };
+    return opts;
+}
+
+// Greeks accumulated per contract, in the order of option_greeks' fields
+enum { GREEK_DELTA, GREEK_GAMMA, GREEK_VEGA, GREEK_RHO, GREEK_THETA, MC_N_GREEKS };
+
+/**
+ * Model inputs the Greek estimators need beyond the terminal prices.
+ */
+typedef struct {
+    double S0, r, sigma, T;
+    double discount;            // e^(-rT)
+} mc_greek_params;
+
+/**
+ * Per-path Greek estimators for one contract over a block of paths.
  *
- * where:
- *   d1 = [ln(S0/K) + (r + σ²/2)T] / (σ√T)
- *   d2 = d1 - σ√T
- *   N(x) = standard normal CDF
+ * With S(T) = S0 exp((r - σ²/2)T + σ√T Z), the payoff f(S(T)) can be
+ * differentiated path by path (the "pathwise" method). Write
+ * h = e^(-rT) f'(S(T)) S(T), which is e^(-rT) S(T) for an in-the-money
+ * call and -e^(-rT) S(T) for an in-the-money put. Then:
+ *   delta = h / S0
+ *   vega  = h (√T Z - σT)
+ *   rho   = ±e^(-rT) K T  when in the money (+ call, - put)
+ *   theta = r e^(-rT) f - h (r - σ²/2 + σZ/(2√T))        (= -dV/dT)
  *
- * This is the "gold standard" to compare Monte Carlo results against.
- * If MC and BS differ significantly, there's likely a bug somewhere.
+ * The payoff has a kink, so f'' is a point mass and the pathwise method
+ * fails for gamma. Instead the likelihood-ratio (score) method is applied
+ * to the pathwise delta: differentiating the density of Z in S0 gives
+ *   gamma = h (Z/(σ√T) - 1) / S0²
+ * This needs only the shock Z, has no kink problem and much lower
+ * variance than applying the likelihood ratio twice to the payoff.
  *
- * @param S0      Initial stock price
- * @param K       Strike price
- * @param r       Risk-free interest rate
- * @param sigma   Volatility
- * @param T       Time to maturity in years
- * @return        Exact Black-Scholes price for European call
+ * Reference: Glasserman, "Monte Carlo Methods in Financial Engineering", ch. 7
+ *
+ * @param type  OPTION_CALL or OPTION_PUT
+ * @param K     Strike price
+ * @param p     Model inputs
+ * @param z     Shocks used for the paths
+ * @param S     Terminal prices from those shocks
+ * @param n     Number of paths (at most MC_BLOCK_PATHS)
+ * @param out   out[g][i] = estimator of Greek g on path i
  */
-double price_european_call_bs(
+static void mc_greek_fill(option_type type, double K, const mc_greek_params *p,
+                          const double *z, const double *S, uint32_t n,
+                          double out[MC_N_GREEKS][MC_BLOCK_PATHS]) {
+    double sign = (type == OPTION_PUT) ? -1.0 : 1.0;
+    double sqrt_T = sqrt(p->T);
+    double inv_S0 = 1.0 / p->S0;
+    double inv_vol = 1.0 / (p->sigma * sqrt_T);
+    double drift_rate = p->r - 0.5 * p->sigma * p->sigma;
+    double shock_rate = 0.5 * p->sigma / sqrt_T;
+    double rho_itm = p->discount * sign * K * p->T;
+
+    for (uint32_t i = 0; i < n; i++) {
+        double intrinsic = sign * (S[i] - K);
+        double in_money = (intrinsic > 0.0) ? 1.0 : 0.0;
+        double h = p->discount * sign * in_money * S[i];
+
+        out[GREEK_DELTA][i] = h * inv_S0;
+        out[GREEK_GAMMA][i] = h * (z[i] * inv_vol - 1.0) * inv_S0 * inv_S0;
+        out[GREEK_VEGA][i] = h * (sqrt_T * z[i] - p->sigma * p->T);
+        out[GREEK_RHO][i] = in_money * rho_itm;
+        out[GREEK_THETA][i] = p->r * p->discount * in_money * intrinsic
+                              - h * (drift_rate + shock_rate * z[i]);
+    }
+}
+
+/**
+ * Turn accumulated Greek samples into estimates and standard errors.
+ *
+ * @param m         Statistics of the MC_N_GREEKS estimators of one contract
+ * @param value     Receives the estimates (may be NULL)
+ * @param std_error Receives their standard errors (may be NULL)
+ */
+static void mc_greeks_estimate(const mc_moments *m, option_greeks *value, option_greeks *std_error) {
+    double mean[MC_N_GREEKS], se[MC_N_GREEKS];
+    for (int g = 0; g < MC_N_GREEKS; g++) {
+        mean[g] = moments_mean(&m[g]);
+        se[g] = (m[g].n > 0) ? sqrt(moments_variance(&m[g]) / (double)m[g].n) : NAN;
+    }
+    if (value) {
+        *value = (option_greeks){ mean[GREEK_DELTA], mean[GREEK_GAMMA], mean[GREEK_VEGA],
+                                  mean[GREEK_RHO], mean[GREEK_THETA] };
+    }
+    if (std_error) {
+        *std_error = (option_greeks){ se[GREEK_DELTA], se[GREEK_GAMMA], se[GREEK_VEGA],
+                                      se[GREEK_RHO], se[GREEK_THETA] };
+    }
+}
+
+/**
+ * Shared inputs and outputs for the chunks of one engine run.
+ *
+ * One run prices a whole chain: several strikes and option types on the
+ * same underlying and maturity. Simulating S(T) is the expensive part; the
+ * payoffs are cheap, so every contract is evaluated on the same samples.
+ */
+typedef struct {
+    gbm_terminal g;             // Precomputed GBM constants
+    double forward;             // E[S(T)] = S0 * e^(rT), mean of the control variate
+    unsigned variance_reduction;
+    size_t n_contracts;
+    const option_type *types;   // Per-contract call/put
+    const double *strikes;      // Per-contract strike
+    uint32_t n_sim;
+    uint32_t first_chunk;       // Global index of the current batch's chunk 0
+    const rng_state *streams;   // streams[c] = RNG substream of batch chunk c
+    mc_moments *partial;        // partial[c * n_contracts + k] = chunk c, contract k
+    mc_greek_params greek;      // Inputs of the Greek estimators
+    mc_moments *greek_partial;  // [(c * n_contracts + k) * MC_N_GREEKS + g], or NULL
+} mc_engine_job;
+
+/**
+ * Start chunk `chunk` of a run: zero its statistics slots.
+ *
+ * @param m_out   Receives the chunk's n_contracts price slots
+ * @param gm_out  Receives its Greek slots, or NULL without Greeks
+ * @return        Paths in the chunk (MC_CHUNK_PATHS, or fewer for the last one)
+ */
+static uint32_t mc_chunk_begin(const mc_engine_job *job, uint32_t chunk, mc_moments **m_out, mc_moments **gm_out) {
+    uint32_t begin = (job->first_chunk + chunk) * MC_CHUNK_PATHS;
+    uint32_t count = job->n_sim - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, count);
+
+    mc_moments *m = job->partial + (size_t)chunk * job->n_contracts;
+    for (size_t k = 0; k < job->n_contracts; k++) {
+        m[k] = (mc_moments){0};
+    }
+    mc_moments *gm = NULL;
+    if (job->greek_partial) {
+        gm = job->greek_partial + (size_t)chunk * job->n_contracts * MC_N_GREEKS;
+        for (size_t g = 0; g < job->n_contracts * MC_N_GREEKS; g++) {
+            gm[g] = (mc_moments){0};
+        }
+    }
+    *m_out = m;
+    *gm_out = gm;
+    return count;
+}
+
+/**
+ * Add contract k's Greek samples over a block to its slots gm[k * MC_N_GREEKS + g].
+ *
+ * Greeks come from the same shocks and prices as the payoffs; no extra
+ * paths. With antithetic pairs, each sample is the average of the pair.
+ */
+static void mc_chunk_greeks(const mc_engine_job *job, size_t k, int antithetic,
+                            const double *z, const double *s_up, const double *z_down, const double *s_down,
+                            uint32_t n, mc_moments *gm) {
+    double greeks[MC_N_GREEKS][MC_BLOCK_PATHS], greeks_down[MC_N_GREEKS][MC_BLOCK_PATHS];
+    mc_greek_fill(job->types[k], job->strikes[k], &job->greek, z, s_up, n, greeks);
+    if (antithetic) {
+        mc_greek_fill(job->types[k], job->strikes[k], &job->greek, z_down, s_down, n, greeks_down);
+    }
+    for (int g = 0; g < MC_N_GREEKS; g++) {
+        if (antithetic) {
+            for (uint32_t i = 0; i < n; i++) {
+                greeks[g][i] = 0.5 * (greeks[g][i] + greeks_down[g][i]);
+            }
+        }
+        moments_add_block(&gm[k * MC_N_GREEKS + g], greeks[g], NULL, n);
+    }
+}
+
+/**
+ * mc_chunk_greeks() for float shocks and prices: the Greek estimators need
+ * double inputs and get a widened copy.
+ */
+static void mc_chunk_greeks_f32(const mc_engine_job *job, size_t k, int antithetic,
+                                const float *z, const float *s_up, const float *z_down, const float *s_down,
+                                uint32_t n, mc_moments *gm) {
+    double zd[MC_BLOCK_PATHS], sd[MC_BLOCK_PATHS], zd_down[MC_BLOCK_PATHS], sd_down[MC_BLOCK_PATHS];
+    for (uint32_t i = 0; i < n; i++) {
+        zd[i] = z[i];
+        sd[i] = s_up[i];
+        if (antithetic) {
+            zd_down[i] = z_down[i];
+            sd_down[i] = s_down[i];
+        }
+    }
+    mc_chunk_greeks(job, k, antithetic, zd, sd, zd_down, sd_down, n, gm);
+}
+
+/**
+ * Define the parallel_for task `name`: one chunk of MC_CHUNK_PATHS paths of
+ * a European chain (the last chunk may be shorter), specialized for one
+ * precision and variance-reduction combination.
+ *
+ * Each chunk writes only its own slots, so chunks can run on any thread
+ * in any order without locks.
+ *
+ * With antithetic variates, every shock Z gives two paths, Z and -Z, and
+ * the sample is the average of their payoffs. A path that ends high is
+ * paired with one that ends low, so the pair average varies much less
+ * than a single payoff does. The control variate, shared by every
+ * contract, is S(T) minus its exact mean.
+ *
+ * The model (NORMAL_FILL, TERMINAL_FILL) and both flags are fixed when the
+ * kernel is generated, and each contract's payoff loop is picked once per
+ * block (see kernel.h), so the per-path loops carry no runtime dispatch.
+ *
+ * @param real           double or float (statistics are double either way)
+ * @param NORMAL_FILL    Shock generator: normal_fill or normal_fill_f32
+ * @param TERMINAL_FILL  Terminal prices: gbm_terminal_fill or gbm_terminal_fill_f32
+ * @param MOMENTS_ADD    moments_add_block or moments_add_block_f32
+ * @param GREEKS         mc_chunk_greeks or mc_chunk_greeks_f32
+ * @param ANTITHETIC     0 or 1
+ * @param CONTROL        0 or 1
+ */
+#define MC_DEFINE_CHAIN_KERNEL(name, real, NORMAL_FILL, TERMINAL_FILL, MOMENTS_ADD, GREEKS,    \
+                               ANTITHETIC, CONTROL)                                            \
+    MC_DEFINE_PAYOFF_BLOCK(name##_call, real, MC_PAYOFF_CALL, ANTITHETIC)                      \
+    MC_DEFINE_PAYOFF_BLOCK(name##_put, real, MC_PAYOFF_PUT, ANTITHETIC)                        \
+    MC_DEFINE_CONTROL_BLOCK(name##_control, real, ANTITHETIC)                                  \
+    static void name(void *ctx, uint32_t chunk) {                                              \
+        const mc_engine_job *job = ctx;                                                        \
+        PROFILE_SCOPE(PROFILE_CHUNK);                                                          \
+        mc_moments *m, *gm;                                                                    \
+        uint32_t count = mc_chunk_begin(job, chunk, &m, &gm);                                  \
+        real z[MC_BLOCK_PATHS], z_down[MC_BLOCK_PATHS];                                        \
+        real s_up[MC_BLOCK_PATHS], s_down[MC_BLOCK_PATHS];                                     \
+        real y[MC_BLOCK_PATHS], x[MC_BLOCK_PATHS];                                             \
+        rng_state rng = job->streams[chunk];                                                   \
+                                                                                               \
+        uint32_t n_samples = ANTITHETIC ? (count + 1) / 2 : count;                             \
+        while (n_samples > 0) {                                                                \
+            uint32_t n = (n_samples < MC_BLOCK_PATHS) ? n_samples : MC_BLOCK_PATHS;            \
+            NORMAL_FILL(&rng, z, n);                                                           \
+            TERMINAL_FILL(&job->g, z, s_up, n);                                                \
+            if (ANTITHETIC) {                                                                  \
+                for (uint32_t i = 0; i < n; i++) {                                             \
+                    z_down[i] = -z[i];                                                         \
+                }                                                                              \
+                TERMINAL_FILL(&job->g, z_down, s_down, n);                                     \
+            }                                                                                  \
+            if (CONTROL) {                                                                     \
+                name##_control(s_up, s_down, n, (real)job->forward, x);                        \
+            }                                                                                  \
+            for (size_t k = 0; k < job->n_contracts; k++) {                                    \
+                real K = (real)job->strikes[k];                                                \
+                if (job->types[k] == OPTION_PUT) {                                             \
+                    name##_put(s_up, s_down, n, K, y);                                         \
+                } else {                                                                       \
+                    name##_call(s_up, s_down, n, K, y);                                        \
+                }                                                                              \
+                MOMENTS_ADD(&m[k], y, CONTROL ? x : NULL, n);                                  \
+                if (gm) {                                                                      \
+                    GREEKS(job, k, ANTITHETIC, z, s_up, z_down, s_down, n, gm);                \
+                }                                                                              \
+            }                                                                                  \
+            n_samples -= n;                                                                    \
+        }                                                                                      \
+    }
+
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel, double, normal_fill, gbm_terminal_fill, moments_add_block,
+                       mc_chunk_greeks, 0, 0)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_av, double, normal_fill, gbm_terminal_fill, moments_add_block,
+                       mc_chunk_greeks, 1, 0)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_cv, double, normal_fill, gbm_terminal_fill, moments_add_block,
+                       mc_chunk_greeks, 0, 1)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_av_cv, double, normal_fill, gbm_terminal_fill, moments_add_block,
+                       mc_chunk_greeks, 1, 1)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_f32, float, normal_fill_f32, gbm_terminal_fill_f32, moments_add_block_f32,
+                       mc_chunk_greeks_f32, 0, 0)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_f32_av, float, normal_fill_f32, gbm_terminal_fill_f32,
+                       moments_add_block_f32, mc_chunk_greeks_f32, 1, 0)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_f32_cv, float, normal_fill_f32, gbm_terminal_fill_f32,
+                       moments_add_block_f32, mc_chunk_greeks_f32, 0, 1)
+MC_DEFINE_CHAIN_KERNEL(mc_chain_kernel_f32_av_cv, float, normal_fill_f32, gbm_terminal_fill_f32,
+                       moments_add_block_f32, mc_chunk_greeks_f32, 1, 1)
+
+// Chain kernels by [precision][variance_reduction & (MC_VR_ANTITHETIC | MC_VR_CONTROL)].
+// In single precision (opts.precision = MC_PRECISION_FLOAT) every SIMD
+// kernel handles twice as many paths per instruction and the RNG is drawn
+// once per normal pair instead of twice; only the statistics stay in
+// double, so rounding does not build up over a run
+static const parallel_task_fn mc_chain_kernels[2][4] = {
+    { mc_chain_kernel, mc_chain_kernel_av, mc_chain_kernel_cv, mc_chain_kernel_av_cv },
+    { mc_chain_kernel_f32, mc_chain_kernel_f32_av, mc_chain_kernel_f32_cv, mc_chain_kernel_f32_av_cv }
+};
+
+/**
+ * Chain kernel for a run's precision and variance-reduction flags.
+ */
+static parallel_task_fn mc_chain_kernel_select(const mc_options *opts) {
+    unsigned precision = (opts->precision == MC_PRECISION_FLOAT) ? 1u : 0u;
+    return mc_chain_kernels[precision][opts->variance_reduction & (MC_VR_ANTITHETIC | MC_VR_CONTROL)];
+}
+
+/**
+ * Turn accumulated statistics into a discounted price and standard error.
+ *
+ * @param total               Statistics of all samples so far
+ * @param variance_reduction  MC_VR_* flags the samples were drawn with
+ * @param discount            e^(-rT)
+ * @return                    Price, standard error and number of paths
+ */
+static mc_result mc_estimate(const mc_moments *total, unsigned variance_reduction, double discount) {
+    double mean, variance;
+    if (variance_reduction & MC_VR_CONTROL) {
+        moments_control(total, &mean, &variance);
+    } else {
+        mean = moments_mean(total);
+        variance = moments_variance(total);
+    }
+
+    mc_result result;
+    result.price = discount * mean;
+    result.std_error = discount * sqrt(variance / (double)total->n);
+    // An antithetic sample is a pair of paths
+    result.n_paths = (variance_reduction & MC_VR_ANTITHETIC) ? 2 * total->n : total->n;
+    return result;
+}
+
+/**
+ * Has the estimate reached the caller's tolerance?
+ *
+ * The standard error must be at most abs_tol, or at most rel_tol times
+ * the price (whichever tolerances are set). Checks happen only at batch
+ * boundaries, so every estimate is based on tens of thousands of paths
+ * and the standard error itself is reliable.
+ */
+static int mc_converged(const mc_result *result, const mc_options *opts) {
+    if (opts->abs_tol > 0.0 && result->std_error <= opts->abs_tol) {
+        return 1;
+    }
+    if (opts->rel_tol > 0.0 && result->std_error <= opts->rel_tol * fabs(result->price)) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Number of chunks per batch between convergence checks.
+ *
+ * Without a tolerance everything is one batch; with one, the error is
+ * checked after every batch_paths paths (rounded up to whole chunks).
+ *
+ * @param opts      Engine options
+ * @param n_chunks  Total chunks of the run
+ * @return          Chunks per batch (at most n_chunks)
+ */
+static uint32_t mc_batch_chunks(const mc_options *opts, uint32_t n_chunks) {
+    if (opts->abs_tol <= 0.0 && opts->rel_tol <= 0.0) {
+        return n_chunks;
+    }
+    uint32_t batch_paths = opts->batch_paths ? opts->batch_paths : MC_DEFAULT_BATCH_PATHS;
+    uint32_t batch_chunks = (uint32_t)(((uint64_t)batch_paths + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    return (batch_chunks < n_chunks) ? batch_chunks : n_chunks;
+}
+
+/**
+ * Chunk tasks in the largest batch of a request: every replicate's chunks
+ * for the Sobol sampler, otherwise the chunks between tolerance checks.
+ */
+static uint32_t mc_request_tasks(const mc_options *opts) {
+    if (opts->sampler == MC_SAMPLER_SOBOL) {
+        unsigned n_rep = opts->n_replicates ? opts->n_replicates : 1;
+        uint32_t points = (uint32_t)(((uint64_t)opts->n_sim + n_rep - 1) / n_rep);
+        return n_rep * (uint32_t)(((uint64_t)points + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    }
+    uint32_t n_chunks = (uint32_t)(((uint64_t)opts->n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    return mc_batch_chunks(opts, n_chunks);
+}
+
+/**
+ * Arena bytes one call takes: a substream and a statistics slot per task
+ * and contract, the running totals, and the same again per Greek.
+ *
+ * @param n_tasks      Chunk tasks per batch (see mc_request_tasks)
+ * @param n_contracts  Contracts priced from the same paths
+ * @param greeks       Nonzero if the Greek accumulators are needed
+ * @return             Bytes, alignment included
+ */
+static size_t mc_scratch_bytes(uint32_t n_tasks, size_t n_contracts, int greeks) {
+    size_t slots = (size_t)n_tasks * n_contracts;
+    size_t bytes = mc_arena_footprint(n_tasks * sizeof(rng_state))
+                   + mc_arena_footprint(slots * sizeof(mc_moments))
+                   + mc_arena_footprint(n_contracts * sizeof(mc_moments));
+    if (greeks) {
+        bytes += mc_arena_footprint(slots * MC_N_GREEKS * sizeof(mc_moments))
+                 + mc_arena_footprint(n_contracts * MC_N_GREEKS * sizeof(mc_moments));
+    }
+    return bytes;
+}
+
+/**
+ * Arena bytes a path option's tables take: the model's (local-vol grid)
+ * and, for the Sobol sampler, the Brownian bridge.
+ */
+static size_t mc_path_table_bytes(const path_option *opt, const market_model *model, const mc_options *opts) {
+    size_t bytes = model_path_bytes(model, opt->n_steps);
+    if (opts->sampler == MC_SAMPLER_SOBOL && opt->n_steps <= SOBOL_MAX_DIM) {
+        bytes += brownian_bridge_bytes((unsigned)opt->n_steps);
+    }
+    return bytes;
+}
+
+/**
+ * Arena bytes a basket's per-asset constants and Cholesky factor take
+ * (none for a basket gbm_basket_init_arena() would reject anyway).
+ */
+static size_t mc_basket_table_bytes(const basket_option *opt) {
+    return (opt->n_assets <= GBM_BASKET_MAX_ASSETS) ? gbm_basket_bytes(opt->n_assets) : 0;
+}
+
+/**
+ * Arena for one free-function call, sized for exactly that request. If it
+ * cannot be reserved it is left empty, and the engine fails cleanly as
+ * out of memory on its first allocation.
+ *
+ * @param table_bytes  Room for the request's model tables on top of the scratch
+ */
+static void mc_call_arena(mc_arena *arena, size_t n_contracts, const mc_options *opts, int greeks,
+                          size_t table_bytes) {
+    mc_arena_init(arena, mc_scratch_bytes(mc_request_tasks(opts), n_contracts, greeks) + table_bytes);
+}
+
+/**
+ * Mark every Greek (and its standard error, if requested) as failed.
+ */
+static void mc_fail_greeks(option_greeks *greeks, option_greeks *greeks_se, size_t n) {
+    const option_greeks failed = { NAN, NAN, NAN, NAN, NAN };
+    for (size_t k = 0; k < n; k++) {
+        greeks[k] = failed;
+        if (greeks_se) {
+            greeks_se[k] = failed;
+        }
+    }
+}
+
+/**
+ * Mark every result as failed.
+ */
+static void mc_fail_results(mc_result *results, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        results[k].price = NAN;
+        results[k].std_error = NAN;
+        results[k].n_paths = 0;
+    }
+}
+
+/**
+ * Shared inputs and outputs for one randomized-QMC run.
+ *
+ * Task t covers chunk (t % chunks_per_replicate) of replicate
+ * (t / chunks_per_replicate), so replicates can be split across threads too.
+ */
+typedef struct {
+    gbm_terminal g;
+    size_t n_contracts;
+    const option_type *types;
+    const double *strikes;
+    uint32_t points_per_replicate;
+    uint32_t chunks_per_replicate;
+    const rng_state *streams;   // streams[r] = source of replicate r's digital shift
+    mc_moments *partial;        // partial[t * n_contracts + k] = task t, contract k
+    mc_greek_params greek;      // Inputs of the Greek estimators
+    mc_moments *greek_partial;  // [(t * n_contracts + k) * MC_N_GREEKS + g], or NULL
+} mc_qmc_job;
+
+/**
+ * Evaluate one chunk of one scrambled Sobol replicate.
+ *
+ * A terminal-price payoff depends on a single shock, so one Sobol
+ * dimension is enough. The uniform coordinate goes through the inverse
+ * normal CDF (not Box-Muller) so the even spacing of the points carries
+ * over to the shocks.
+ */
+static void mc_qmc_chunk(void *ctx, uint32_t task) {
+    mc_qmc_job *job = ctx;
+    uint32_t replicate = task / job->chunks_per_replicate;
+    uint32_t begin = (task % job->chunks_per_replicate) * MC_CHUNK_PATHS;
+    uint32_t count = job->points_per_replicate - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+    PROFILE_SCOPE(PROFILE_CHUNK);
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, count);
+
+    // Every chunk of a replicate recreates the same shift from the same stream
+    sobol_state sobol;
+    rng_state rng = job->streams[replicate];
+    sobol_init(&sobol, 1);
+    sobol_scramble(&sobol, &rng);
+    sobol_skip(&sobol, begin);
+
+    mc_moments *m = job->partial + (size_t)task * job->n_contracts;
+    for (size_t k = 0; k < job->n_contracts; k++) {
+        m[k] = (mc_moments){0};
+    }
+    mc_moments *gm = NULL;
+    if (job->greek_partial) {
+        gm = job->greek_partial + (size_t)task * job->n_contracts * MC_N_GREEKS;
+        for (size_t g = 0; g < job->n_contracts * MC_N_GREEKS; g++) {
+            gm[g] = (mc_moments){0};
+        }
+    }
+
+    double z[MC_BLOCK_PATHS], ST[MC_BLOCK_PATHS], y[MC_BLOCK_PATHS];
+    double greeks[MC_N_GREEKS][MC_BLOCK_PATHS];
+    while (count > 0) {
+        uint32_t n = (count < MC_BLOCK_PATHS) ? count : MC_BLOCK_PATHS;
+        for (uint32_t i = 0; i < n; i++) {
+            double u;
+            sobol_next(&sobol, &u);
+            z[i] = normal_inv_cdf(u);
+        }
+        gbm_terminal_fill(&job->g, z, ST, n);
+        for (size_t k = 0; k < job->n_contracts; k++) {
+            payoff_fill(job->types[k], ST, n, job->strikes[k], y);
+            moments_add_block(&m[k], y, NULL, n);
+            if (gm) {
+                mc_greek_fill(job->types[k], job->strikes[k], &job->greek, z, ST, n, greeks);
+                for (int g = 0; g < MC_N_GREEKS; g++) {
+                    moments_add_block(&gm[k * MC_N_GREEKS + g], greeks[g], NULL, n);
+                }
+            }
+        }
+        count -= n;
+    }
+}
+
+/**
+ * Randomized quasi-Monte Carlo pricing (and Greeks) with scrambled Sobol points.
+ *
+ * QMC points are deterministic, so the usual payoff standard deviation
+ * says nothing about the error. Instead we run R independent replicates,
+ * each with its own random digital shift. Each replicate is an unbiased
+ * estimate, and the spread of the R replicate prices gives the standard
+ * error:  SE = stdev(replicate prices) / √R.  Greeks are treated the same way.
+ *
+ * @return  0 on success, -1 if out of memory (arena too small)
+ */
+static int price_chain_qmc(
+    mc_arena *arena,
     double S0,
-    double K,
     double r,
     double sigma,
-    double T
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
 ) {
-    // Calculate d1 and d2 (the standardized distances)
-    double sqrt_T = sqrt(T);
-    double d1 = (log(S0 / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt_T);
-    double d2 = d1 - sigma * sqrt_T;
+    unsigned n_rep = opts->n_replicates;
+    uint32_t points = (uint32_t)(((uint64_t)opts->n_sim + n_rep - 1) / n_rep);
+    uint32_t chunks_per_rep = (uint32_t)(((uint64_t)points + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    uint32_t n_tasks = n_rep * chunks_per_rep;
 
-    // Black-Scholes formula:
-    // Call = S0 * N(d1) - K * e^(-rT) * N(d2)
-    double call_price = S0 * normal_cdf(d1) - K * exp(-r * T) * normal_cdf(d2);
+    size_t mark = mc_arena_mark(arena);
+    rng_state *streams = mc_arena_alloc(arena, n_rep * sizeof(*streams));
+    mc_moments *partial = mc_arena_alloc(arena, (size_t)n_tasks * n_contracts * sizeof(*partial));
+    mc_moments *greek_partial = NULL;
+    if (greeks) {
+        greek_partial = mc_arena_alloc(arena, (size_t)n_tasks * n_contracts * MC_N_GREEKS * sizeof(*greek_partial));
+    }
+    if (!streams || !partial || (greeks && !greek_partial)) {
+        mc_arena_rewind(arena, mark);
+        return -1;
+    }
 
-    return call_price;
-}
\ No newline at end of file
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+    for (unsigned rep = 0; rep < n_rep; rep++) {
+        streams[rep] = rng;
+        rng_jump(&rng);
+    }
+
+    mc_qmc_job job = {
+        .g = gbm_terminal_init(S0, r, sigma, T),
+        .n_contracts = n_contracts,
+        .types = types,
+        .strikes = strikes,
+        .points_per_replicate = points,
+        .chunks_per_replicate = chunks_per_rep,
+        .streams = streams,
+        .partial = partial,
+        .greek = { S0, r, sigma, T, exp(-r * T) },
+        .greek_partial = greek_partial
+    };
+    parallel_for(n_tasks, opts->n_threads, mc_qmc_chunk, &job);
+
+    // Each replicate's mean is one sample of the across-replicate statistics
+    double discount = exp(-r * T);
+    for (size_t k = 0; k < n_contracts; k++) {
+        mc_moments across = {0};
+        for (unsigned rep = 0; rep < n_rep; rep++) {
+            mc_moments within = {0};
+            for (uint32_t c = 0; c < chunks_per_rep; c++) {
+                moments_merge(&within, &partial[((size_t)rep * chunks_per_rep + c) * n_contracts + k]);
+            }
+            double replicate_price = discount * moments_mean(&within);
+            moments_add_block(&across, &replicate_price, NULL, 1);
+        }
+        results[k].price = moments_mean(&across);
+        results[k].std_error = sqrt(moments_variance(&across) / (double)n_rep);
+        results[k].n_paths = (uint64_t)points * n_rep;
+
+        if (greeks) {
+            mc_moments greek_across[MC_N_GREEKS] = {{0}};
+            for (unsigned rep = 0; rep < n_rep; rep++) {
+                for (int g = 0; g < MC_N_GREEKS; g++) {
+                    mc_moments within = {0};
+                    for (uint32_t c = 0; c < chunks_per_rep; c++) {
+                        size_t task = (size_t)rep * chunks_per_rep + c;
+                        moments_merge(&within, &greek_partial[(task * n_contracts + k) * MC_N_GREEKS + g]);
+                    }
+                    double replicate_greek = moments_mean(&within);
+                    moments_add_block(&greek_across[g], &replicate_greek, NULL, 1);
+                }
+            }
+            mc_greeks_estimate(greek_across, &greeks[k], greeks_se ? &greeks_se[k] : NULL);
+        }
+    }
+
+    mc_arena_rewind(arena, mark);
+    return 0;
+}
+
+#ifdef MC_GPU
+/**
+ * Price a chain on the GPU backend (see gpu.h).
+ *
+ * The device uses its own counter-based stream keyed by opts->seed, so
+ * prices agree with the CPU engine within their standard errors rather
+ * than bit for bit. n_threads has no effect here.
+ *
+ * @return  0 on success, -1 if there is no device or CUDA failed (results untouched)
+ */
+static int mc_price_chain_gpu(
+    mc_arena *arena,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results
+) {
+    if (!gpu_available()) {
+        return -1;
+    }
+    size_t mark = mc_arena_mark(arena);
+    mc_moments *totals = mc_arena_alloc(arena, n_contracts * sizeof(*totals));
+    if (!totals) {
+        return -1;
+    }
+
+    gbm_terminal g = gbm_terminal_init(S0, r, sigma, T);
+    int antithetic = (opts->variance_reduction & MC_VR_ANTITHETIC) != 0;
+    uint64_t n_samples = antithetic ? ((uint64_t)opts->n_sim + 1) / 2 : opts->n_sim;
+    int status = gpu_european_moments(&g, S0 * exp(r * T), types, strikes, n_contracts, n_samples,
+                                      opts->seed, opts->variance_reduction, totals);
+    for (size_t k = 0; status == 0 && k < n_contracts; k++) {
+        results[k] = mc_estimate(&totals[k], opts->variance_reduction, exp(-r * T));
+    }
+    mc_arena_rewind(arena, mark);
+    return status;
+}
+#endif
+
+/**
+ * Engine core behind price_european_chain_mc(), the Greek variants,
+ * price_european_resume_mc() and their mc_engine counterparts. Every
+ * buffer comes from `arena` and is released before returning.
+ *
+ * A resumed run (one contract, pseudo-random, no Greeks) starts from the
+ * statistics in `resume` and draws from substream resume->n_chunks on, so
+ * opts->n_sim counts the paths already in it; `resume` is updated in place.
+ *
+ * A sharded run (see mc_shard) simulates only this rank's share of each
+ * batch and has shard->exchange fill in the rest before the reduction, so
+ * every rank merges the same slots in the same order as a single process.
+ *
+ * @param greeks     Receives the Greek estimates per contract (NULL = skip Greeks)
+ * @param greeks_se  Receives their standard errors (may be NULL)
+ * @param resume     Run to continue (NULL = a fresh run)
+ * @param shard      Ranks sharing the run (NULL = this process alone)
+ * @return           0 on success, -1 on invalid input, a failed exchange or out of
+ *                   memory (arena too small)
+ */
+static int mc_price_chain(
+    mc_arena *arena,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se,
+    mc_run_state *resume,
+    const mc_shard *shard
+) {
+    if (n_contracts == 0) {
+        return 0;
+    }
+    mc_fail_results(results, n_contracts);
+    if (greeks) {
+        mc_fail_greeks(greeks, greeks_se, n_contracts);
+    }
+    if (opts->n_sim == 0) {
+        return -1;
+    }
+    if (resume && (n_contracts != 1 || greeks || opts->sampler != MC_SAMPLER_PSEUDO)) {
+        return -1;
+    }
+    if (shard && (shard->n_ranks == 0 || shard->rank >= shard->n_ranks || !shard->exchange
+                  || opts->sampler != MC_SAMPLER_PSEUDO)) {
+        return -1;
+    }
+    if (opts->sampler == MC_SAMPLER_SOBOL) {
+        // One replicate has no spread to measure: its error would read as 0
+        if (opts->n_replicates < 2) {
+            return -1;
+        }
+        return price_chain_qmc(arena, S0, r, sigma, T, types, strikes, n_contracts, opts, results,
+                               greeks, greeks_se);
+    }
+
+    int adaptive = (opts->abs_tol > 0.0 || opts->rel_tol > 0.0);
+#ifdef MC_GPU
+    // Fixed-length prices (no Greeks, no early stopping) run on the device
+    if (!greeks && !adaptive && !resume && !shard
+        && mc_price_chain_gpu(arena, S0, r, sigma, T, types, strikes, n_contracts, opts, results) == 0) {
+        return 0;
+    }
+#endif
+
+    // A resumed run only simulates what its earlier paths do not cover
+    uint32_t n_sim = opts->n_sim, first_stream = 0;
+    if (resume) {
+        uint64_t done_paths = (opts->variance_reduction & MC_VR_ANTITHETIC) ? 2 * resume->moments.n : resume->moments.n;
+        n_sim = (done_paths < opts->n_sim) ? (uint32_t)(opts->n_sim - done_paths) : 0u;
+        first_stream = resume->n_chunks;
+        if (resume->moments.n > 0) {
+            results[0] = mc_estimate(&resume->moments, opts->variance_reduction, exp(-r * T));
+            if (n_sim == 0 || (adaptive && mc_converged(&results[0], opts))) {
+                return 0;
+            }
+        }
+    }
+
+    uint32_t n_chunks = (uint32_t)(((uint64_t)n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    uint32_t batch_chunks = mc_batch_chunks(opts, n_chunks);
+
+    size_t mark = mc_arena_mark(arena);
+    rng_state *streams = mc_arena_alloc(arena, batch_chunks * sizeof(*streams));
+    mc_moments *partial = mc_arena_alloc(arena, (size_t)batch_chunks * n_contracts * sizeof(*partial));
+    mc_moments *totals = mc_arena_alloc(arena, n_contracts * sizeof(*totals));
+    mc_moments *greek_partial = NULL, *greek_totals = NULL;
+    if (greeks) {
+        greek_partial = mc_arena_alloc(arena, (size_t)batch_chunks * n_contracts * MC_N_GREEKS * sizeof(*greek_partial));
+        greek_totals = mc_arena_alloc(arena, n_contracts * MC_N_GREEKS * sizeof(*greek_totals));
+    }
+    int ok = streams && partial && totals && (!greeks || (greek_partial && greek_totals));
+    // Ranks fail together, so none is left waiting in an exchange
+    if (shard && shard->agree && shard->agree(shard->ctx, ok) != 1) {
+        ok = 0;
+    }
+    if (!ok) {
+        mc_arena_rewind(arena, mark);
+        return -1;
+    }
+    memset(totals, 0, n_contracts * sizeof(*totals));
+    if (greeks) {
+        memset(greek_totals, 0, n_contracts * MC_N_GREEKS * sizeof(*greek_totals));
+    }
+    if (resume) {
+        totals[0] = resume->moments;
+    }
+
+    mc_engine_job job = {
+        .g = gbm_terminal_init(S0, r, sigma, T),
+        .forward = S0 * exp(r * T),
+        .variance_reduction = opts->variance_reduction,
+        .n_contracts = n_contracts,
+        .types = types,
+        .strikes = strikes,
+        .n_sim = n_sim,
+        .streams = streams,
+        .partial = partial,
+        .greek = { S0, r, sigma, T, exp(-r * T) },
+        .greek_partial = greek_partial
+    };
+    double discount = exp(-r * T);
+    parallel_task_fn kernel = mc_chain_kernel_select(opts);
+
+    // Substream c = seed jumped c times; streams are made one batch at a
+    // time, so an early stop never pays for the substreams it did not use
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+    for (uint32_t c = 0; c < first_stream; c++) {
+        rng_jump(&rng);
+    }
+
+    uint32_t done = 0;
+    while (done < n_chunks) {
+        uint32_t batch = n_chunks - done;
+        if (batch > batch_chunks) {
+            batch = batch_chunks;
+        }
+        for (uint32_t c = 0; c < batch; c++) {
+            streams[c] = rng;
+            rng_jump(&rng);
+        }
+
+        // A rank simulates its own range of the batch and receives the rest
+        uint32_t first = 0, count = batch;
+        if (shard) {
+            mc_shard_range(batch, shard->rank, shard->n_ranks, &first, &count);
+        }
+        job.first_chunk = done + first;
+        job.streams = streams + first;
+        job.partial = partial + (size_t)first * n_contracts;
+        job.greek_partial = greeks ? greek_partial + (size_t)first * n_contracts * MC_N_GREEKS : NULL;
+        parallel_for(count, opts->n_threads, kernel, &job);
+        PROFILE_COUNT(PROFILE_BATCHES, 1);
+        done += batch;
+        if (shard
+            && (shard->exchange(shard->ctx, partial, mc_shard_slot_bytes(n_contracts, 0), batch) != 0
+                || (greeks && shard->exchange(shard->ctx, greek_partial,
+                                              mc_shard_slot_bytes(n_contracts, 1), batch) != 0))) {
+            mc_fail_results(results, n_contracts);
+            if (greeks) {
+                mc_fail_greeks(greeks, greeks_se, n_contracts);
+            }
+            mc_arena_rewind(arena, mark);
+            return -1;
+        }
+
+        // Deterministic reduction: always in chunk order
+        int converged = 1;
+        for (size_t k = 0; k < n_contracts; k++) {
+            for (uint32_t c = 0; c < batch; c++) {
+                moments_merge(&totals[k], &partial[(size_t)c * n_contracts + k]);
+            }
+            results[k] = mc_estimate(&totals[k], opts->variance_reduction, discount);
+            converged &= mc_converged(&results[k], opts);
+
+            for (int g = 0; greeks && g < MC_N_GREEKS; g++) {
+                for (uint32_t c = 0; c < batch; c++) {
+                    moments_merge(&greek_totals[k * MC_N_GREEKS + g],
+                                  &greek_partial[((size_t)c * n_contracts + k) * MC_N_GREEKS + g]);
+                }
+            }
+        }
+        if (adaptive && converged) {
+            break;
+        }
+    }
+
+    for (size_t k = 0; greeks && k < n_contracts; k++) {
+        mc_greeks_estimate(&greek_totals[k * MC_N_GREEKS], &greeks[k], greeks_se ? &greeks_se[k] : NULL);
+    }
+    if (resume) {
+        resume->moments = totals[0];
+        resume->n_chunks = first_stream + done;
+    }
+
+    mc_arena_rewind(arena, mark);
+    return 0;
+}
+
+/**
+ * Price a chain of European options on one underlying from shared paths.
+ *
+ * Runs opts->n_sim paths on opts->n_threads threads. The paths are cut
+ * into fixed chunks so that the result for a given seed is bit-identical
+ * for any thread count (see price_european_call_mc_mt).
+ *
+ * All contracts see exactly the same simulated terminal prices, so the
+ * cost of the chain is that of one option plus a cheap payoff pass per
+ * strike. Because the shocks for a seed are the same whatever the chain
+ * contains, each contract's result is bit-identical to pricing it alone
+ * with price_european_mc() - only early stopping differs, since a chain
+ * stops when all of its contracts have converged.
+ *
+ * Variance reduction (opts->variance_reduction, flags can be combined):
+ *   MC_VR_ANTITHETIC - simulate (Z, -Z) pairs; n_sim counts both paths
+ *   MC_VR_CONTROL    - use the terminal price S(T) as a control variate.
+ *                      Its discounted mean is exactly S0 (the stock is a
+ *                      traded asset), so any sampling error in S(T) tells
+ *                      us about the error in the payoff too. The weight β
+ *                      is estimated from the same run, per contract.
+ *
+ * For at-the-money calls the two together cut the variance by roughly an
+ * order of magnitude, i.e. the same standard error with ~10x fewer paths.
+ *
+ * With opts->sampler = MC_SAMPLER_SOBOL the shocks come from scrambled
+ * Sobol points instead; the error then falls close to O(1/N) rather than
+ * O(1/√N), and the standard error is measured across opts->n_replicates
+ * independent scramblings (at least 2, or the call fails). Variance-reduction
+ * flags and tolerances are ignored there.
+ *
+ * Early stopping: if opts->abs_tol or opts->rel_tol is set, n_sim becomes
+ * the maximum path count. Paths are simulated in batches of
+ * opts->batch_paths and the run stops as soon as every contract's
+ * standard error meets the tolerance. Batch boundaries fall on fixed
+ * chunks, so where a run stops (and its result) still depends only on the
+ * seed, not on threads. Easy contracts (deep in or out of the money) stop
+ * after very few paths.
+ *
+ * @param S0           Initial stock price
+ * @param r            Risk-free interest rate
+ * @param sigma        Volatility
+ * @param T            Time to maturity in years
+ * @param types        Option type of each contract
+ * @param strikes      Strike of each contract
+ * @param n_contracts  Number of contracts in the chain
+ * @param opts         Engine options (paths, seed, threads, variance reduction)
+ * @param results      Receives one result per contract
+ * @return             0 on success, -1 on invalid input or out of memory (results are NAN)
+ */
+int price_european_chain_mc(
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results
+) {
+    mc_arena arena;
+    mc_call_arena(&arena, n_contracts, opts, 0, 0);
+    int status = mc_price_chain(&arena, S0, r, sigma, T, types, strikes, n_contracts, opts, results,
+                                NULL, NULL, NULL, NULL);
+    mc_arena_free(&arena);
+    return status;
+}
+
+/**
+ * Price a chain of European options and their Greeks in one pass.
+ *
+ * Same as price_european_chain_mc(), but every path also feeds the
+ * pathwise delta, vega, rho and theta estimators and the likelihood-ratio
+ * gamma estimator (see mc_greek_fill). The Greeks use the paths already
+ * simulated for the price, so all five cost a few extra multiplies per
+ * path instead of the 5-10 full re-simulations of bump-and-reprice.
+ *
+ * Units match greeks_european_bs(): vega and rho per unit change in
+ * sigma and r (divide by 100 for "per 1%"), theta per year.
+ *
+ * The estimators use the terminal prices directly, so the control
+ * variate (which only corrects the price) does not apply to them;
+ * antithetic pairs and Sobol points do. Under early stopping the Greeks
+ * come from the same paths as the price.
+ *
+ * @param greeks     Receives the Greek estimates, one per contract
+ * @param greeks_se  Receives their standard errors, one per contract (may be NULL)
+ * @return           0 on success, -1 on invalid input or out of memory (outputs are NAN)
+ */
+int price_european_chain_greeks_mc(
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    mc_arena arena;
+    mc_call_arena(&arena, n_contracts, opts, 1, 0);
+    int status = mc_price_chain(&arena, S0, r, sigma, T, types, strikes, n_contracts, opts, results,
+                                greeks, greeks_se, NULL, NULL);
+    mc_arena_free(&arena);
+    return status;
+}
+
+/**
+ * Split a batch of chunks into n_ranks contiguous ranges of near-equal size.
+ *
+ * @param n_chunks  Chunks in the batch
+ * @param rank      Rank whose range is wanted (< n_ranks)
+ * @param n_ranks   Ranks sharing the batch
+ * @param first     Receives the rank's first chunk
+ * @param count     Receives the rank's number of chunks (may be 0)
+ */
+void mc_shard_range(uint32_t n_chunks, unsigned rank, unsigned n_ranks, uint32_t *first, uint32_t *count) {
+    uint32_t begin = (uint32_t)((uint64_t)n_chunks * rank / n_ranks);
+    uint32_t end = (uint32_t)((uint64_t)n_chunks * (rank + 1) / n_ranks);
+    *first = begin;
+    *count = end - begin;
+}
+
+size_t mc_shard_slot_bytes(size_t n_contracts, int greeks) {
+    return n_contracts * (greeks ? MC_N_GREEKS : 1) * sizeof(mc_moments);
+}
+
+/**
+ * Price a chain and, optionally, its Greeks with the paths split across ranks.
+ *
+ * Chunk c still draws from substream c of opts->seed, whichever rank
+ * simulates it, and the exchange hands every rank the statistics of every
+ * chunk (counts, means and sums of squared deviations - not just prices).
+ * Each rank then reduces them in chunk order exactly as
+ * price_european_chain_greeks_mc() does, so prices, standard errors,
+ * Greeks and even where an early-stopping run stops match the
+ * single-process run bit for bit, on every rank.
+ *
+ * opts->n_threads is per rank. Every rank must call this with the same
+ * arguments; a rank whose range of a batch is empty still joins the exchange.
+ *
+ * @param shard      Rank, number of ranks and the exchange between them
+ * @param greeks     Receives the Greek estimates (NULL = prices only)
+ * @param greeks_se  Receives their standard errors (may be NULL)
+ * @return           0 on success, -1 on invalid input, Sobol, a failed exchange
+ *                   or out of memory (outputs are NAN)
+ */
+int price_european_chain_sharded_mc(
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    const mc_shard *shard,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    mc_arena arena;
+    mc_call_arena(&arena, n_contracts, opts, greeks != NULL, 0);
+    int status = mc_price_chain(&arena, S0, r, sigma, T, types, strikes, n_contracts, opts, results,
+                                greeks, greeks_se, NULL, shard);
+    mc_arena_free(&arena);
+    return status;
+}
+
+/**
+ * Price a single European option with the full Monte Carlo engine.
+ *
+ * This is price_european_chain_mc() with a chain of one; see there for
+ * the variance reduction, QMC and early-stopping options.
+ *
+ * @param type   OPTION_CALL or OPTION_PUT
+ * @param S0     Initial stock price
+ * @param K      Strike price
+ * @param r      Risk-free interest rate
+ * @param sigma  Volatility
+ * @param T      Time to maturity in years
+ * @param opts   Engine options (paths, seed, threads, variance reduction)
+ * @return       Price, standard error and paths used (NAN on invalid input or out of memory)
+ */
+mc_result price_european_mc(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+) {
+    mc_result result;
+    price_european_chain_mc(S0, r, sigma, T, &type, &K, 1, opts, &result);
+    return result;
+}
+
+/**
+ * Extend a run of one European option with more paths.
+ *
+ * The new paths come from the substreams after the ones the state has
+ * used, so nothing is drawn twice. If every earlier chunk was full (the
+ * earlier path count a multiple of MC_CHUNK_PATHS), the extended result
+ * is bit-identical to a fresh price_european_mc() run of the total size.
+ * When the state already holds opts->n_sim paths, or already meets the
+ * tolerance, nothing is simulated and the stored estimate is returned.
+ *
+ * @param type    OPTION_CALL or OPTION_PUT
+ * @param S0      Initial stock price
+ * @param K       Strike price
+ * @param r       Risk-free interest rate
+ * @param sigma   Volatility
+ * @param T       Time to maturity in years
+ * @param opts    Engine options; n_sim is the total, including earlier paths
+ * @param state   Run to continue (zeroed for a new run); updated in place
+ * @param result  Receives the estimate from all paths so far
+ * @return        0, or -1 on failure (result NAN, state unchanged)
+ */
+int price_european_resume_mc(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    mc_run_state *state,
+    mc_result *result
+) {
+    mc_arena arena;
+    mc_call_arena(&arena, 1, opts, 0, 0);
+    int status = mc_price_chain(&arena, S0, r, sigma, T, &type, &K, 1, opts, result, NULL, NULL, state, NULL);
+    mc_arena_free(&arena);
+    return status;
+}
+
+/**
+ * Price a single European option and its Greeks in one simulation.
+ *
+ * This is price_european_chain_greeks_mc() with a chain of one.
+ *
+ * @param type       OPTION_CALL or OPTION_PUT
+ * @param S0         Initial stock price
+ * @param K          Strike price
+ * @param r          Risk-free interest rate
+ * @param sigma      Volatility
+ * @param T          Time to maturity in years
+ * @param opts       Engine options (paths, seed, threads, variance reduction)
+ * @param greeks     Receives delta, gamma, vega, rho and theta
+ * @param greeks_se  Receives their standard errors (may be NULL)
+ * @return           Price, standard error and paths used (NAN on failure)
+ */
+mc_result price_european_greeks_mc(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    mc_result result;
+    price_european_chain_greeks_mc(S0, r, sigma, T, &type, &K, 1, opts, &result, greeks, greeks_se);
+    return result;
+}
+
+/**
+ * Reserve an engine's arena for the largest request in `limits`, so that
+ * every call within them is served without allocating.
+ *
+ * The arena is reserved but not touched here: its pages are placed (on
+ * Linux, on the caller's NUMA node) when the pricing thread first writes
+ * them, so an engine created for a thread should be used by that thread.
+ *
+ * @param engine  Engine to set up
+ * @param limits  Most contracts, paths per batch, replicates, steps, assets and American paths per call
+ * @return        0, or -1 on invalid limits or out of memory (the engine is then empty)
+ */
+int mc_engine_init(mc_engine *engine, const mc_engine_limits *limits) {
+    memset(engine, 0, sizeof(*engine));
+    if (limits->max_contracts == 0 || limits->max_paths == 0) {
+        return -1;
+    }
+    uint32_t n_tasks = (uint32_t)(((uint64_t)limits->max_paths + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS)
+                       + limits->max_replicates;
+    size_t bytes = mc_scratch_bytes(n_tasks, limits->max_contracts, limits->greeks);
+
+    // One request at a time, so the arena needs room for the largest kind only
+    size_t path_bytes = mc_scratch_bytes(n_tasks, 1, 0);
+    if (limits->max_steps > 0) {
+        size_t lv = mc_arena_footprint(limits->max_steps * MODEL_LV_NODES * sizeof(double));
+        size_t steps = (limits->max_steps < SOBOL_MAX_DIM) ? limits->max_steps : SOBOL_MAX_DIM;
+        size_t bridge = brownian_bridge_bytes((unsigned)steps);
+        path_bytes += (lv > bridge) ? lv : bridge;
+    }
+    size_t basket_bytes = mc_scratch_bytes(n_tasks, 1, 0) + gbm_basket_bytes(limits->max_assets);
+    size_t american_bytes = limits->max_american_paths ? lsm_scratch_bytes(limits->max_american_paths) : 0;
+    bytes = (path_bytes > bytes) ? path_bytes : bytes;
+    bytes = (basket_bytes > bytes) ? basket_bytes : bytes;
+    bytes = (american_bytes > bytes) ? american_bytes : bytes;
+    return mc_arena_init(&engine->arena, bytes);
+}
+
+void mc_engine_free(mc_engine *engine) {
+    mc_arena_free(&engine->arena);
+}
+
+/**
+ * Does a request fit in the engine's arena?
+ *
+ * @param engine       Engine from mc_engine_init()
+ * @param n_contracts  Contracts priced from the same paths (1 for path and basket options)
+ * @param opts         Request options (n_sim, sampler, replicates, tolerance)
+ * @param greeks       Nonzero if Greeks are wanted
+ * @return             1 if it does, 0 if the call would fail
+ */
+int mc_engine_fits(const mc_engine *engine, size_t n_contracts, const mc_options *opts, int greeks) {
+    return mc_engine_room(engine, mc_scratch_bytes(mc_request_tasks(opts), n_contracts, greeks));
+}
+
+/**
+ * Does `bytes` more fit in the engine's arena?
+ *
+ * @return  1 if it does, 0 if not (or the engine is empty)
+ */
+int mc_engine_room(const mc_engine *engine, size_t bytes) {
+    const mc_arena *arena = &engine->arena;
+    return arena->base != NULL && bytes <= arena->capacity - arena->used;
+}
+
+/**
+ * Price a chain (and optionally its Greeks) on a reusable engine.
+ *
+ * Same results, bit for bit, as price_european_chain_mc() or
+ * price_european_chain_greeks_mc() with the same options.
+ *
+ * @return  0, or -1 on invalid input or a request beyond the engine's limits (outputs NAN)
+ */
+int mc_engine_price_chain(
+    mc_engine *engine,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const option_type *types,
+    const double *strikes,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    if (!mc_engine_fits(engine, n_contracts, opts, greeks != NULL)) {
+        mc_fail_results(results, n_contracts);
+        if (greeks) {
+            mc_fail_greeks(greeks, greeks_se, n_contracts);
+        }
+        return -1;
+    }
+    return mc_price_chain(&engine->arena, S0, r, sigma, T, types, strikes, n_contracts, opts, results,
+                          greeks, greeks_se, NULL, NULL);
+}
+
+/**
+ * price_european_resume_mc() on a reusable engine.
+ *
+ * @return  0, or -1 on failure or a request beyond the engine's limits (result NAN, state unchanged)
+ */
+int mc_engine_resume(
+    mc_engine *engine,
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts,
+    mc_run_state *state,
+    mc_result *result
+) {
+    if (!mc_engine_fits(engine, 1, opts, 0)) {
+        mc_fail_results(result, 1);
+        return -1;
+    }
+    return mc_price_chain(&engine->arena, S0, r, sigma, T, &type, &K, 1, opts, result, NULL, NULL, state, NULL);
+}
+
+/**
+ * Shared inputs and outputs for one path-dependent engine run.
+ */
+typedef struct {
+    const path_option *opt;
+    model_path path;            // Model constants and block simulator
+    unsigned variance_reduction;
+    int control_geometric;      // Control = geometric Asian payoff (else S(T))
+    double control_mean;        // Exact undiscounted mean of the control
+    uint32_t n_sim;
+    uint32_t first_chunk;       // Global index of the current batch's chunk 0
+    const rng_state *streams;   // streams[c] = RNG substream of batch chunk c
+    mc_moments *partial;        // partial[c] = statistics of batch chunk c
+    // Sobol sampler only
+    const brownian_bridge *bridge;
+    uint32_t points_per_replicate;
+    uint32_t chunks_per_replicate;
+} mc_path_job;
+
+/**
+ * Control-variate samples for a block of finished paths.
+ *
+ * @param job  Engine run (chooses the control)
+ * @param acc  Accumulator after the last step
+ * @param n    Number of paths
+ * @param x    Receives control minus its exact mean
+ */
+static void mc_path_control(const mc_path_job *job, const path_accumulator *acc, uint32_t n, double *x) {
+    if (job->control_geometric) {
+        path_geometric_payoff_fill(acc, n, x);
+    } else {
+        for (uint32_t i = 0; i < n; i++) {
+            x[i] = acc->last[i];
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        x[i] -= job->control_mean;
+    }
+}
+
+/**
+ * Simulate one chunk of path-dependent payoffs with pseudo-random shocks.
+ *
+ * Paths are generated a block at a time and a step at a time by the
+ * model's block simulator; each step is folded into the path_accumulator
+ * right away, so the memory per path is a handful of doubles however many
+ * monitoring dates there are.
+ */
+static void mc_path_chunk(void *ctx, uint32_t chunk) {
+    mc_path_job *job = ctx;
+    uint32_t begin = (job->first_chunk + chunk) * MC_CHUNK_PATHS;
+    uint32_t count = job->n_sim - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+    PROFILE_SCOPE(PROFILE_CHUNK);
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, count);
+
+    int antithetic = (job->variance_reduction & MC_VR_ANTITHETIC) != 0;
+    int control = (job->variance_reduction & MC_VR_CONTROL) != 0;
+
+    double y[MC_BLOCK_PATHS], y_down[MC_BLOCK_PATHS], x[MC_BLOCK_PATHS], x_down[MC_BLOCK_PATHS];
+    double state_up[PATH_ACCUMULATOR_ARRAYS * MC_BLOCK_PATHS];
+    double state_down[PATH_ACCUMULATOR_ARRAYS * MC_BLOCK_PATHS];
+    rng_state rng = job->streams[chunk];
+    mc_moments *m = &job->partial[chunk];
+    *m = (mc_moments){0};
+
+    uint32_t n_samples = antithetic ? (count + 1) / 2 : count;
+    while (n_samples > 0) {
+        uint32_t n = (n_samples < MC_BLOCK_PATHS) ? n_samples : MC_BLOCK_PATHS;
+
+        path_accumulator up, down;
+        const model_path *p = &job->path;
+        path_accumulator_init(&up, job->opt, p->S0, p->bridge_sigma, p->dt, state_up, n);
+        if (antithetic) {
+            path_accumulator_init(&down, job->opt, p->S0, p->bridge_sigma, p->dt, state_down, n);
+        }
+        model_path_simulate(p, &rng, n, &up, antithetic ? &down : NULL);
+
+        path_payoff_fill(&up, n, y);
+        if (control) {
+            mc_path_control(job, &up, n, x);
+        }
+        if (antithetic) {
+            path_payoff_fill(&down, n, y_down);
+            for (uint32_t i = 0; i < n; i++) {
+                y[i] = 0.5 * (y[i] + y_down[i]);
+            }
+            if (control) {
+                mc_path_control(job, &down, n, x_down);
+                for (uint32_t i = 0; i < n; i++) {
+                    x[i] = 0.5 * (x[i] + x_down[i]);
+                }
+            }
+        }
+        moments_add_block(m, y, control ? x : NULL, n);
+        n_samples -= n;
+    }
+}
+
+/**
+ * Evaluate one chunk of one scrambled Sobol replicate of a path payoff.
+ *
+ * Each path is one n_steps-dimensional Sobol point. The Brownian bridge
+ * assigns the first (best-distributed) coordinate to W(T), the next to
+ * W(T/2), and so on, so the dimensions that matter most for the payoff
+ * get the best points.
+ *
+ * Task t covers chunk (t % chunks_per_replicate) of replicate
+ * (t / chunks_per_replicate).
+ */
+static void mc_path_qmc_chunk(void *ctx, uint32_t task) {
+    mc_path_job *job = ctx;
+    uint32_t replicate = task / job->chunks_per_replicate;
+    uint32_t begin = (task % job->chunks_per_replicate) * MC_CHUNK_PATHS;
+    uint32_t count = job->points_per_replicate - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+    PROFILE_SCOPE(PROFILE_CHUNK);
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, count);
+
+    const gbm_path *g = &job->path.gbm;
+    size_t n_steps = g->n_steps;
+    sobol_state sobol;
+    rng_state rng = job->streams[replicate];
+    sobol_init(&sobol, (unsigned)n_steps);
+    sobol_scramble(&sobol, &rng);
+    sobol_skip(&sobol, begin);
+
+    // shocks[t * MC_BLOCK_PATHS + i] = standardized increment of step t+1 on path i
+    double shocks[SOBOL_MAX_DIM * MC_BLOCK_PATHS];
+    double point[SOBOL_MAX_DIM], dW[SOBOL_MAX_DIM];
+    double S[MC_BLOCK_PATHS], y[MC_BLOCK_PATHS];
+    double state[PATH_ACCUMULATOR_ARRAYS * MC_BLOCK_PATHS];
+    double inv_sqrt_dt = 1.0 / sqrt(g->dt);
+    mc_moments *m = &job->partial[task];
+    *m = (mc_moments){0};
+
+    while (count > 0) {
+        uint32_t n = (count < MC_BLOCK_PATHS) ? count : MC_BLOCK_PATHS;
+        for (uint32_t i = 0; i < n; i++) {
+            sobol_next(&sobol, point);
+            for (size_t d = 0; d < n_steps; d++) {
+                point[d] = normal_inv_cdf(point[d]);
+            }
+            brownian_bridge_build(job->bridge, point, dW);
+            for (size_t t = 0; t < n_steps; t++) {
+                shocks[t * MC_BLOCK_PATHS + i] = dW[t] * inv_sqrt_dt;
+            }
+        }
+
+        path_accumulator acc;
+        path_accumulator_init(&acc, job->opt, g->S0, job->path.bridge_sigma, g->dt, state, n);
+        for (uint32_t i = 0; i < n; i++) {
+            S[i] = g->S0;
+        }
+        for (size_t t = 1; t <= n_steps; t++) {
+            gbm_path_step(g, S, &shocks[(t - 1) * MC_BLOCK_PATHS], S, n);
+            path_accumulator_update(&acc, t, S, n);
+        }
+        path_payoff_fill(&acc, n, y);
+        moments_add_block(m, y, NULL, n);
+        count -= n;
+    }
+}
+
+/**
+ * Randomized-QMC driver for path payoffs (see price_chain_qmc for the method).
+ */
+static mc_result price_path_qmc(mc_arena *arena, mc_path_job *job, double r, double T, const mc_options *opts) {
+    mc_result result = { NAN, NAN, 0 };
+    unsigned n_rep = opts->n_replicates;
+    uint32_t points = (uint32_t)(((uint64_t)opts->n_sim + n_rep - 1) / n_rep);
+    uint32_t chunks_per_rep = (uint32_t)(((uint64_t)points + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    uint32_t n_tasks = n_rep * chunks_per_rep;
+
+    size_t mark = mc_arena_mark(arena);
+    brownian_bridge bridge;
+    if (brownian_bridge_init_arena(&bridge, (unsigned)job->path.n_steps, T, arena) != 0) {
+        return result;
+    }
+    rng_state *streams = mc_arena_alloc(arena, n_rep * sizeof(*streams));
+    mc_moments *partial = mc_arena_alloc(arena, (size_t)n_tasks * sizeof(*partial));
+    if (!streams || !partial) {
+        mc_arena_rewind(arena, mark);
+        return result;
+    }
+
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+    for (unsigned rep = 0; rep < n_rep; rep++) {
+        streams[rep] = rng;
+        rng_jump(&rng);
+    }
+
+    job->bridge = &bridge;
+    job->points_per_replicate = points;
+    job->chunks_per_replicate = chunks_per_rep;
+    job->streams = streams;
+    job->partial = partial;
+    parallel_for(n_tasks, opts->n_threads, mc_path_qmc_chunk, job);
+
+    double discount = exp(-r * T);
+    mc_moments across = {0};
+    for (unsigned rep = 0; rep < n_rep; rep++) {
+        mc_moments within = {0};
+        for (uint32_t c = 0; c < chunks_per_rep; c++) {
+            moments_merge(&within, &partial[(size_t)rep * chunks_per_rep + c]);
+        }
+        double replicate_price = discount * moments_mean(&within);
+        moments_add_block(&across, &replicate_price, NULL, 1);
+    }
+    result.price = moments_mean(&across);
+    result.std_error = sqrt(moments_variance(&across) / (double)n_rep);
+    result.n_paths = (uint64_t)points * n_rep;
+
+    mc_arena_rewind(arena, mark);
+    return result;
+}
+
+/**
+ * Price a path-dependent option (Asian and/or barrier) by Monte Carlo.
+ *
+ * Paths are simulated on opt->n_steps equal steps with the exact GBM step
+ * and folded into a path_accumulator as they go. Chunking, substreams,
+ * thread independence and early stopping work exactly as in
+ * price_european_chain_mc().
+ *
+ * Variance reduction:
+ *   MC_VR_ANTITHETIC - each shock vector Z is also used as -Z
+ *   MC_VR_CONTROL    - for Asian options, the geometric-average option
+ *                      with the same strike (closed form from
+ *                      price_geometric_asian_bs). Arithmetic and geometric
+ *                      averages move almost in lockstep, so for an
+ *                      arithmetic Asian this removes nearly all of the
+ *                      variance. For other payoffs S(T) is the control.
+ *
+ * Barriers with MONITOR_CONTINUOUS are corrected with the Brownian-bridge
+ * crossing probability between steps (see path_accumulator_update), so a
+ * coarse grid already gives the continuously monitored price.
+ *
+ * With opts->sampler = MC_SAMPLER_SOBOL each path is one scrambled Sobol
+ * point built through a Brownian bridge; this needs
+ * n_steps <= SOBOL_MAX_DIM and opts->n_replicates >= 2, and variance
+ * reduction and tolerances are ignored.
+ *
+ * @param opt    Option terms (payoff, barrier, monitoring dates)
+ * @param S0     Initial stock price
+ * @param r      Risk-free interest rate
+ * @param sigma  Volatility
+ * @param T      Time to maturity in years
+ * @param opts   Engine options
+ * @return       Price, standard error and paths used (NAN on invalid input or out of memory)
+ */
+mc_result price_path_mc(
+    const path_option *opt,
+    double S0,
+    double r,
+    double sigma,
+    double T,
+    const mc_options *opts
+) {
+    market_model model = model_gbm(S0, r, sigma);
+    return price_path_model_mc(opt, &model, T, opts);
+}
+
+/**
+ * Engine core behind price_path_model_mc() and mc_engine_price_path();
+ * every buffer, the model's tables and the Brownian bridge included,
+ * comes from `arena`.
+ */
+static mc_result mc_price_path(
+    mc_arena *arena,
+    const path_option *opt,
+    const market_model *model,
+    double T,
+    const mc_options *opts
+) {
+    mc_result result = { NAN, NAN, 0 };
+    if (opts->n_sim == 0 || opt->n_steps == 0) {
+        return result;
+    }
+    int gbm = (model->kind == MODEL_GBM);
+    if (!gbm && (opt->monitoring == MONITOR_CONTINUOUS || opts->sampler == MC_SAMPLER_SOBOL)) {
+        return result;
+    }
+    if (opts->sampler == MC_SAMPLER_SOBOL && opts->n_replicates < 2) {
+        return result;
+    }
+
+    mc_path_job job = {
+        .opt = opt,
+        .variance_reduction = opts->variance_reduction,
+        .n_sim = opts->n_sim
+    };
+    size_t mark = mc_arena_mark(arena);
+    if (model_path_init_arena(&job.path, model, T, opt->n_steps, arena) != 0) {
+        mc_arena_rewind(arena, mark);
+        return result;
+    }
+    double S0 = model->S0, r = model->r;
+
+    if (opts->sampler == MC_SAMPLER_SOBOL) {
+        if (opt->n_steps <= SOBOL_MAX_DIM) {
+            job.variance_reduction = MC_VR_NONE;
+            result = price_path_qmc(arena, &job, r, T, opts);
+        }
+        mc_arena_rewind(arena, mark);
+        return result;
+    }
+
+    if (opts->variance_reduction & MC_VR_CONTROL) {
+        job.control_geometric = gbm && (opt->average != AVERAGE_NONE);
+        job.control_mean = job.control_geometric
+            ? exp(r * T) * price_geometric_asian_bs(opt->type, S0, opt->strike, r, model->sigma, T, opt->n_steps)
+            : S0 * exp(r * T);
+    }
+
+    uint32_t n_chunks = (uint32_t)(((uint64_t)opts->n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    int adaptive = (opts->abs_tol > 0.0 || opts->rel_tol > 0.0);
+    uint32_t batch_chunks = mc_batch_chunks(opts, n_chunks);
+
+    rng_state *streams = mc_arena_alloc(arena, batch_chunks * sizeof(*streams));
+    mc_moments *partial = mc_arena_alloc(arena, batch_chunks * sizeof(*partial));
+    if (!streams || !partial) {
+        mc_arena_rewind(arena, mark);
+        return result;
+    }
+    job.streams = streams;
+    job.partial = partial;
+
+    double discount = exp(-r * T);
+    mc_moments total = {0};
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+
+    for (uint32_t done = 0; done < n_chunks; ) {
+        uint32_t batch = n_chunks - done;
+        if (batch > batch_chunks) {
+            batch = batch_chunks;
+        }
+        for (uint32_t c = 0; c < batch; c++) {
+            streams[c] = rng;
+            rng_jump(&rng);
+        }
+
+        job.first_chunk = done;
+        parallel_for(batch, opts->n_threads, mc_path_chunk, &job);
+        PROFILE_COUNT(PROFILE_BATCHES, 1);
+        done += batch;
+
+        for (uint32_t c = 0; c < batch; c++) {
+            moments_merge(&total, &partial[c]);
+        }
+        result = mc_estimate(&total, opts->variance_reduction, discount);
+        if (adaptive && mc_converged(&result, opts)) {
+            break;
+        }
+    }
+
+    mc_arena_rewind(arena, mark);
+    return result;
+}
+
+/**
+ * Price a path-dependent option under any market model.
+ *
+ * price_path_mc() with the stock dynamics taken from `model` (GBM, Heston
+ * or local vol, see model.h). The model is resolved once, by
+ * model_path_init(); each block of paths is then one call into that
+ * model's simulator. Chunking, substreams, thread independence, antithetic
+ * pairs and early stopping are the same for every model.
+ *
+ * Beyond GBM:
+ *   - MC_VR_CONTROL uses S(T) as the control (its mean S0 e^(rT) holds
+ *     under every model; the geometric-Asian closed form does not)
+ *   - MONITOR_CONTINUOUS is not supported (the bridge correction assumes
+ *     a constant σ) and neither is the Sobol sampler; both give NAN
+ *   - Heston and local vol are discretized, so their prices carry a
+ *     time-step bias that shrinks with opt->n_steps
+ *
+ * @param opt    Option terms (payoff, barrier, monitoring dates)
+ * @param model  Stock dynamics and parameters
+ * @param T      Time to maturity in years
+ * @param opts   Engine options
+ * @return       Price, standard error and paths used (NAN on invalid input or out of memory)
+ */
+mc_result price_path_model_mc(
+    const path_option *opt,
+    const market_model *model,
+    double T,
+    const mc_options *opts
+) {
+    mc_arena arena;
+    mc_call_arena(&arena, 1, opts, 0, mc_path_table_bytes(opt, model, opts));
+    mc_result result = mc_price_path(&arena, opt, model, T, opts);
+    mc_arena_free(&arena);
+    return result;
+}
+
+/**
+ * price_path_model_mc() on a reusable engine.
+ *
+ * @return  Price, standard error and paths used (NAN on invalid input or a
+ *          request beyond the engine's limits)
+ */
+mc_result mc_engine_price_path(
+    mc_engine *engine,
+    const path_option *opt,
+    const market_model *model,
+    double T,
+    const mc_options *opts
+) {
+    if (!mc_engine_room(engine, mc_scratch_bytes(mc_request_tasks(opts), 1, 0)
+                                + mc_path_table_bytes(opt, model, opts))) {
+        return (mc_result){ NAN, NAN, 0 };
+    }
+    return mc_price_path(&engine->arena, opt, model, T, opts);
+}
+
+/**
+ * Shared inputs and outputs for one basket engine run.
+ */
+typedef struct {
+    const basket_option *opt;
+    gbm_basket basket;          // Per-asset constants and Cholesky factor
+    size_t block_paths;         // Paths per block (MC_BASKET_BLOCK_VALUES / n_assets, at most MC_BLOCK_PATHS)
+    unsigned variance_reduction;
+    double control_mean;        // Exact undiscounted mean of the linear control
+    uint32_t n_sim;
+    uint32_t first_chunk;       // Global index of the current batch's chunk 0
+    const rng_state *streams;   // streams[c] = RNG substream of batch chunk c
+    mc_moments *partial;        // partial[c] = statistics of batch chunk c
+} mc_basket_job;
+
+/**
+ * Simulate one chunk of basket payoffs.
+ *
+ * Per block: one normal_fill() for every asset's shocks at once, the
+ * Cholesky product into correlated shocks, then one exp pass per asset
+ * row. All blocks are asset-major, so every pass is a unit-stride loop
+ * over paths and the block never leaves cache.
+ */
+static void mc_basket_chunk(void *ctx, uint32_t chunk) {
+    mc_basket_job *job = ctx;
+    uint32_t begin = (job->first_chunk + chunk) * MC_CHUNK_PATHS;
+    uint32_t count = job->n_sim - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+    PROFILE_SCOPE(PROFILE_CHUNK);
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, count);
+
+    int antithetic = (job->variance_reduction & MC_VR_ANTITHETIC) != 0;
+    int control = (job->variance_reduction & MC_VR_CONTROL) != 0;
+    size_t n_assets = job->basket.n_assets;
+
+    double z[MC_BASKET_BLOCK_VALUES], eps[MC_BASKET_BLOCK_VALUES], S[MC_BASKET_BLOCK_VALUES];
+    double y[MC_BLOCK_PATHS], y_down[MC_BLOCK_PATHS], x[MC_BLOCK_PATHS], x_down[MC_BLOCK_PATHS];
+    rng_state rng = job->streams[chunk];
+    mc_moments *m = &job->partial[chunk];
+    *m = (mc_moments){0};
+
+    uint32_t n_samples = antithetic ? (count + 1) / 2 : count;
+    while (n_samples > 0) {
+        uint32_t n = (n_samples < job->block_paths) ? n_samples : (uint32_t)job->block_paths;
+
+        normal_fill(&rng, z, n_assets * n);
+        gbm_basket_correlate(&job->basket, z, eps, n);
+        gbm_basket_terminal_fill(&job->basket, eps, 1.0, S, n);
+        basket_payoff_fill(job->opt, S, n, y);
+        if (control) {
+            basket_linear_fill(job->opt, S, n, x);
+        }
+        if (antithetic) {
+            // -Z gives -ε, so the same correlated shocks serve the mirror paths
+            gbm_basket_terminal_fill(&job->basket, eps, -1.0, eps, n);
+            basket_payoff_fill(job->opt, eps, n, y_down);
+            for (uint32_t i = 0; i < n; i++) {
+                y[i] = 0.5 * (y[i] + y_down[i]);
+            }
+            if (control) {
+                basket_linear_fill(job->opt, eps, n, x_down);
+                for (uint32_t i = 0; i < n; i++) {
+                    x[i] = 0.5 * (x[i] + x_down[i]);
+                }
+            }
+        }
+        if (control) {
+            for (uint32_t i = 0; i < n; i++) {
+                x[i] -= job->control_mean;
+            }
+        }
+        moments_add_block(m, y, control ? x : NULL, n);
+        n_samples -= n;
+    }
+}
+
+/**
+ * Engine core behind price_basket_mc() and mc_engine_price_basket();
+ * every buffer, the Cholesky factor included, comes from `arena`.
+ */
+static mc_result mc_price_basket(
+    mc_arena *arena,
+    const basket_option *opt,
+    const double *S0,
+    const double *sigma,
+    const double *corr,
+    double r,
+    double T,
+    const mc_options *opts
+) {
+    mc_result result = { NAN, NAN, 0 };
+    if (opts->n_sim == 0 || opts->sampler != MC_SAMPLER_PSEUDO
+        || (opt->kind == BASKET_SPREAD && opt->n_assets != 2)) {
+        return result;
+    }
+
+    mc_basket_job job = {
+        .opt = opt,
+        .variance_reduction = opts->variance_reduction,
+        .n_sim = opts->n_sim
+    };
+    size_t mark = mc_arena_mark(arena);
+    if (gbm_basket_init_arena(&job.basket, opt->n_assets, S0, sigma, corr, r, T, arena) != 0) {
+        return result;
+    }
+    job.block_paths = (MC_BASKET_BLOCK_VALUES / opt->n_assets) & ~(size_t)3;
+    if (job.block_paths > MC_BLOCK_PATHS) {
+        job.block_paths = MC_BLOCK_PATHS;
+    }
+
+    if (opts->variance_reduction & MC_VR_CONTROL) {
+        double c[GBM_BASKET_MAX_ASSETS];
+        basket_linear_weights(opt, c);
+        for (size_t a = 0; a < opt->n_assets; a++) {
+            job.control_mean += c[a] * S0[a];
+        }
+        job.control_mean *= exp(r * T);
+    }
+
+    uint32_t n_chunks = (uint32_t)(((uint64_t)opts->n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    int adaptive = (opts->abs_tol > 0.0 || opts->rel_tol > 0.0);
+    uint32_t batch_chunks = mc_batch_chunks(opts, n_chunks);
+
+    rng_state *streams = mc_arena_alloc(arena, batch_chunks * sizeof(*streams));
+    mc_moments *partial = mc_arena_alloc(arena, batch_chunks * sizeof(*partial));
+    if (!streams || !partial) {
+        mc_arena_rewind(arena, mark);
+        return result;
+    }
+    job.streams = streams;
+    job.partial = partial;
+
+    double discount = exp(-r * T);
+    mc_moments total = {0};
+    rng_state rng;
+    rng_seed(&rng, opts->seed);
+
+    for (uint32_t done = 0; done < n_chunks; ) {
+        uint32_t batch = n_chunks - done;
+        if (batch > batch_chunks) {
+            batch = batch_chunks;
+        }
+        for (uint32_t c = 0; c < batch; c++) {
+            streams[c] = rng;
+            rng_jump(&rng);
+        }
+
+        job.first_chunk = done;
+        parallel_for(batch, opts->n_threads, mc_basket_chunk, &job);
+        PROFILE_COUNT(PROFILE_BATCHES, 1);
+        done += batch;
+
+        for (uint32_t c = 0; c < batch; c++) {
+            moments_merge(&total, &partial[c]);
+        }
+        result = mc_estimate(&total, opts->variance_reduction, discount);
+        if (adaptive && mc_converged(&result, opts)) {
+            break;
+        }
+    }
+
+    mc_arena_rewind(arena, mark);
+    return result;
+}
+
+/**
+ * Price a European option on several correlated assets by Monte Carlo.
+ *
+ * Each asset follows its own GBM; the shocks are correlated through the
+ * Cholesky factor of `corr`, computed once per run (gbm_basket_init).
+ * Terminal prices are exact, so no time stepping is needed. Chunking,
+ * substreams, thread independence and early stopping work exactly as in
+ * price_european_chain_mc().
+ *
+ * Variance reduction:
+ *   MC_VR_ANTITHETIC - each shock vector Z is also used as -Z
+ *   MC_VR_CONTROL    - the linear part of the payoff, Σ c_a S_a(T)
+ *                      (basket_linear_weights), whose mean is
+ *                      Σ c_a S0_a e^(rT)
+ *
+ * Only the pseudo-random sampler is supported; MC_SAMPLER_SOBOL gives NAN.
+ *
+ * @param opt    Option terms (kind, strike, weights, number of assets)
+ * @param S0     Initial prices, opt->n_assets entries
+ * @param sigma  Volatilities, opt->n_assets entries
+ * @param corr   Correlation matrix, row-major n_assets × n_assets (positive semi-definite)
+ * @param r      Risk-free interest rate
+ * @param T      Time to maturity in years
+ * @param opts   Engine options
+ * @return       Price, standard error and paths used (NAN on invalid input or out of memory)
+ */
+mc_result price_basket_mc(
+    const basket_option *opt,
+    const double *S0,
+    const double *sigma,
+    const double *corr,
+    double r,
+    double T,
+    const mc_options *opts
+) {
+    mc_arena arena;
+    mc_call_arena(&arena, 1, opts, 0, mc_basket_table_bytes(opt));
+    mc_result result = mc_price_basket(&arena, opt, S0, sigma, corr, r, T, opts);
+    mc_arena_free(&arena);
+    return result;
+}
+
+/**
+ * price_basket_mc() on a reusable engine.
+ *
+ * @return  Price, standard error and paths used (NAN on invalid input or a
+ *          request beyond the engine's limits)
+ */
+mc_result mc_engine_price_basket(
+    mc_engine *engine,
+    const basket_option *opt,
+    const double *S0,
+    const double *sigma,
+    const double *corr,
+    double r,
+    double T,
+    const mc_options *opts
+) {
+    if (!mc_engine_room(engine, mc_scratch_bytes(mc_request_tasks(opts), 1, 0) + mc_basket_table_bytes(opt))) {
+        return (mc_result){ NAN, NAN, 0 };
+    }
+    return mc_price_basket(&engine->arena, opt, S0, sigma, corr, r, T, opts);
+}
+
+/**
+ * Price a European call option using multithreaded Monte Carlo simulation.
+ *
+ * Why not just give each thread n_sim / n_threads paths?
+ *   - Then the random numbers each path sees would depend on the thread
+ *     count, and so would the price.
+ *
+ * Instead the work is cut into fixed-size chunks:
+ *   1. Chunk c always covers paths [c*MC_CHUNK_PATHS, (c+1)*MC_CHUNK_PATHS)
+ *   2. Chunk c always draws from RNG substream c of the seed
+ *   3. Threads pick up chunks in whatever order, but each chunk's payoff
+ *      sums go in its own slot
+ *   4. The slots are added up in chunk order on one thread
+ *
+ * Floating-point addition is not associative, so step 4 matters: with a
+ * fixed order the result is bit-identical for 1 thread or 64.
+ *
+ * This is price_european_mc() with plain sampling, kept for callers that
+ * only need the point estimate.
+ *
+ * @param S0         Initial stock price
+ * @param K          Strike price
+ * @param r          Risk-free interest rate
+ * @param sigma      Volatility
+ * @param T          Time to maturity in years
+ * @param n_sim      Number of simulations
+ * @param seed       Seed for the RNG substreams
+ * @param n_threads  Worker threads (0 = one per core)
+ * @return           Estimated fair price of the call option (NAN if out of memory)
+ */
+double price_european_call_mc_mt(
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    uint32_t n_sim,
+    uint64_t seed,
+    unsigned n_threads
+) {
+    mc_options opts = mc_options_default();
+    opts.n_sim = n_sim;
+    opts.seed = seed;
+    opts.n_threads = n_threads;
+    return price_european_mc(OPTION_CALL, S0, K, r, sigma, T, &opts).price;
+}
+
+/**
+ * Price a European call option using the analytical Black-Scholes formula.
+ *
+ * The Black-Scholes formula gives the exact theoretical price:
+ *   C = S0 * N(d1) - K * e^(-rT) * N(d2)
+ *
+ * where:
+ *   d1 = [ln(S0/K) + (r + σ²/2)T] / (σ√T)
+ *   d2 = d1 - σ√T
+ *   N(x) = standard normal CDF
+ *
+ * This is the "gold standard" to compare Monte Carlo results against.
+ * If MC and BS differ significantly, there's likely a bug somewhere.
+ *
+ * @param S0      Initial stock price
+ * @param K       Strike price
+ * @param r       Risk-free interest rate
+ * @param sigma   Volatility
+ * @param T       Time to maturity in years
+ * @return        Exact Black-Scholes price for European call
+ */
+double price_european_call_bs(
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T
+) {
+    // Calculate d1 and d2 (the standardized distances)
+    double sqrt_T = sqrt(T);
+    double d1 = (log(S0 / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt_T);
+    double d2 = d1 - sigma * sqrt_T;
+
+    // Black-Scholes formula:
+    // Call = S0 * N(d1) - K * e^(-rT) * N(d2)
+    double call_price = S0 * normal_cdf(d1) - K * exp(-r * T) * normal_cdf(d2);
+
+    return call_price;
+}
+
+/**
+ * Closed-form Black-Scholes Greeks of a European call or put.
+ *
+ * With d1, d2 as in price_european_call_bs() and φ the normal density:
+ *   delta  call N(d1)                         put N(d1) - 1
+ *   gamma  φ(d1) / (S0 σ √T)                  (same for both)
+ *   vega   S0 φ(d1) √T                        (same for both)
+ *   rho    call K T e^(-rT) N(d2)             put -K T e^(-rT) N(-d2)
+ *   theta  -S0 φ(d1) σ / (2√T) ∓ r K e^(-rT) N(±d2)   (- call, + put)
+ *
+ * Vega and rho are per unit change in σ and r; theta is per year of
+ * calendar time (the change in value as maturity shrinks, -dV/dT).
+ * These are the reference values for the Monte Carlo estimators.
+ *
+ * @param type   OPTION_CALL or OPTION_PUT
+ * @param S0     Initial stock price
+ * @param K      Strike price
+ * @param r      Risk-free interest rate
+ * @param sigma  Volatility
+ * @param T      Time to maturity in years
+ * @return       Delta, gamma, vega, rho and theta
+ */
+option_greeks greeks_european_bs(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T
+) {
+    double sqrt_T = sqrt(T);
+    double d1 = (log(S0 / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt_T);
+    double d2 = d1 - sigma * sqrt_T;
+    double density = normal_pdf(d1);
+    double discounted_K = K * exp(-r * T);
+
+    option_greeks g;
+    g.gamma = density / (S0 * sigma * sqrt_T);
+    g.vega = S0 * density * sqrt_T;
+    double time_decay = -S0 * density * sigma / (2.0 * sqrt_T);
+    if (type == OPTION_PUT) {
+        g.delta = normal_cdf(d1) - 1.0;
+        g.rho = -discounted_K * T * normal_cdf(-d2);
+        g.theta = time_decay + r * discounted_K * normal_cdf(-d2);
+    } else {
+        g.delta = normal_cdf(d1);
+        g.rho = discounted_K * T * normal_cdf(d2);
+        g.theta = time_decay - r * discounted_K * normal_cdf(d2);
+    }
+    return g;
+}
+
+/**
+ * Closed-form price of a discretely monitored geometric-average Asian option.
+ *
+ * The geometric average G = (S(t_1) ⋯ S(t_n))^(1/n) over t_j = j*dt is a
+ * product of lognormals, hence lognormal itself:
+ *   ln G ~ N(μ, v)
+ *   μ = ln S0 + (r - σ²/2) dt (n+1)/2
+ *   v = σ² dt (n+1)(2n+1) / (6n)
+ * so the option is priced like Black-Scholes on G:
+ *   Call = e^(-rT) [e^(μ + v/2) N(d1) - K N(d2)],  d2 = (μ - ln K)/√v,  d1 = d2 + √v
+ *
+ * There is no such formula for the arithmetic average, which is why this
+ * one is the control variate for it.
+ *
+ * @param type     OPTION_CALL or OPTION_PUT
+ * @param S0       Initial stock price
+ * @param K        Strike price
+ * @param r        Risk-free interest rate
+ * @param sigma    Volatility
+ * @param T        Time to maturity in years
+ * @param n_steps  Number of equally spaced averaging dates
+ * @return         Exact price
+ */
+double price_geometric_asian_bs(
+    option_type type,
+    double S0,
+    double K,
+    double r,
+    double sigma,
+    double T,
+    size_t n_steps
+) {
+    double n = (double)n_steps;
+    double dt = T / n;
+    double mu = log(S0) + (r - 0.5 * sigma * sigma) * dt * (n + 1.0) / 2.0;
+    double v = sigma * sigma * dt * (n + 1.0) * (2.0 * n + 1.0) / (6.0 * n);
+    double sd = sqrt(v);
+    double d2 = (mu - log(K)) / sd;
+    double d1 = d2 + sd;
+    double forward_G = exp(mu + 0.5 * v);
+
+    if (type == OPTION_PUT) {
+        return exp(-r * T) * (K * normal_cdf(-d2) - forward_G * normal_cdf(-d1));
+    }
+    return exp(-r * T) * (forward_G * normal_cdf(d1) - K * normal_cdf(d2));
+}
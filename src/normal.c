@@ -1,7 +1,8 @@
 //
 // Normal Distribution Utilities
 // Provides the cumulative distribution function (CDF) for the standard normal
-// distribution, needed for analytical Black-Scholes pricing.
+// distribution, needed for analytical Black-Scholes pricing, and its inverse,
+// which turns quasi-random uniforms into normal shocks.
 //
 // Created by b2 on 12/28/25.
 //
@@ -12,14 +13,105 @@
 /**
  * Approximate the standard normal cumulative distribution function (CDF).
  *
- * Uses the error function (erf) which is available in C99's math.h.
- * This is the most accurate and simplest approach.
+ * Uses the complementary error function (erfc) from C99's math.h:
  *
- * N(x) = (1 + erf(x/√2)) / 2
+ * N(x) = erfc(-x/√2) / 2
+ *
+ * This equals (1 + erf(x/√2)) / 2, but for negative x that form subtracts
+ * two numbers close to 1 and loses the lower tail (N(-8) would come out
+ * with no correct digits). 1/√2 is a constant, so there is no sqrt or
+ * division per call.
  *
  * @param x  The value to evaluate the CDF at
  * @return   Probability that a standard normal variable is ≤ x
  */
 double normal_cdf(double x) {
-    return 0.5 * (1.0 + erf(x / sqrt(2.0)));
-}
\ No newline at end of file
+    return 0.5 * erfc(-x * 0.70710678118654752440);
+}
+
+/**
+ * Standard normal probability density function.
+ *
+ * φ(x) = e^(-x²/2) / √(2π)
+ *
+ * Needed for the Black-Scholes Greeks (gamma, vega and theta all depend
+ * on the density at d1).
+ *
+ * @param x  The value to evaluate the density at
+ * @return   Density of N(0,1) at x
+ */
+double normal_pdf(double x) {
+    return 0.39894228040143267794 * exp(-0.5 * x * x);
+}
+
+/**
+ * Inverse of the standard normal CDF (the "probit" or quantile function).
+ *
+ * Box-Muller needs two uniforms per pair of normals and mixes them
+ * non-monotonically, which destroys the even spacing of quasi-random
+ * points. Inverting the CDF maps each uniform coordinate to exactly one
+ * normal, preserving that structure.
+ *
+ * Method:
+ *   1. Acklam's rational approximation (relative error < 1.15e-9), with
+ *      separate fits for the central region and the two tails
+ *   2. One Halley step on N(x) - p using erfc, which brings the result
+ *      to full double precision
+ *
+ * Reference: P. J. Acklam, "An algorithm for computing the inverse normal
+ *            cumulative distribution function" (2003)
+ *
+ * @param p  Probability in (0, 1)
+ * @return   x such that normal_cdf(x) = p (±infinity at p = 0 or 1, NAN outside)
+ */
+double normal_inv_cdf(double p) {
+    static const double a[] = {
+        -3.969683028665376e+01,  2.209460984245205e+02, -2.759285104469687e+02,
+         1.383577518672690e+02, -3.066479806614716e+01,  2.506628277459239e+00
+    };
+    static const double b[] = {
+        -5.447609879822406e+01,  1.615858368580409e+02, -1.556989798598866e+02,
+         6.680131188771972e+01, -1.328068155288572e+01
+    };
+    static const double c[] = {
+        -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+        -2.549732539343734e+00,  4.374664141464968e+00,  2.938163982698783e+00
+    };
+    static const double d[] = {
+         7.784695709041462e-03,  3.224671290700398e-01,  2.445134137142996e+00,
+         3.754408661907416e+00
+    };
+    const double p_low = 0.02425;
+
+    if (!(p > 0.0 && p < 1.0)) {
+        if (p == 0.0) return -INFINITY;
+        if (p == 1.0) return INFINITY;
+        return NAN;
+    }
+
+    double x;
+    if (p < p_low) {
+        // Lower tail: rational function of sqrt(-2 ln p)
+        double q = sqrt(-2.0 * log(p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    } else if (p <= 1.0 - p_low) {
+        // Central region: rational function of (p - 1/2)
+        double q = p - 0.5;
+        double r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+    } else {
+        // Upper tail: mirror of the lower tail
+        double q = sqrt(-2.0 * log1p(-p));
+        x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+             ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+
+    // Halley refinement on e = N(x) - p. Both tails are computed with erfc,
+    // and in the upper half through 1 - p (exact there) to keep relative accuracy
+    double e = (p > 0.5) ? (1.0 - p) - 0.5 * erfc(x / sqrt(2.0))
+                         : 0.5 * erfc(-x / sqrt(2.0)) - p;
+    double u = e * sqrt(2.0 * 3.14159265358979323846) * exp(0.5 * x * x);
+    return x - u / (1.0 + 0.5 * x * u);
+}
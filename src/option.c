@@ -2,8 +2,16 @@
 // Option payoff functions for European options
 // These calculate how much an option is worth at expiration
 //
+// Path-dependent payoffs (Asian averages, barriers) are accumulated step
+// by step as the path is generated, so full paths never need storing.
+// Basket payoffs reduce several assets' rows to one underlying per path.
+//
 
+#include <math.h>
 #include "include/option.h"
+#include "include/simd.h"
+#include "include/profile.h"
+#include "include/vmath_avx2.h"
 
 /**
  * Calculate the payoff of a European call option at expiration.
@@ -48,3 +56,430 @@ double put_payoff(double S, double K)
     // Otherwise: option expires worthless (you wouldn't exercise)
     return (K > S) ? (K - S) : 0.0;
 }
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 payoff sum: sign = +1 for calls (S - K), -1 for puts (K - S).
+ *
+ * Four independent lane sums are kept and added at the end.
+ *
+ * @param sum_out  Receives the sum of the first (n rounded down to 4) payoffs
+ * @return         Number of prices consumed
+ */
+__attribute__((target("avx2,fma")))
+static size_t payoff_sum_avx2(const double *S, size_t n, double K, double sign, double *sum_out) {
+    __m256d strike = _mm256_set1_pd(K);
+    __m256d dir = _mm256_set1_pd(sign);
+    __m256d zero = _mm256_setzero_pd();
+    __m256d acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d intrinsic = _mm256_mul_pd(dir, _mm256_sub_pd(_mm256_loadu_pd(S + i), strike));
+        acc = _mm256_add_pd(acc, _mm256_max_pd(intrinsic, zero));
+    }
+    *sum_out = v_hsum(acc);
+    return i;
+}
+#endif
+
+/**
+ * Sum the call payoffs max(S[i] - K, 0) over a block of terminal prices.
+ *
+ * This is call_payoff() applied to a whole block at once. fmax() replaces
+ * the ternary, so the loop has no branches to mispredict when prices fall
+ * on both sides of the strike.
+ *
+ * @param S  Terminal stock prices
+ * @param n  Number of prices
+ * @param K  Strike price
+ * @return   Sum of the n payoffs (not yet averaged or discounted)
+ */
+double call_payoff_sum(const double *S, size_t n, double K)
+{
+    PROFILE_SCOPE(PROFILE_PAYOFF);
+    double sum = 0.0;
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = payoff_sum_avx2(S, n, K, 1.0, &sum);
+    }
+#endif
+    for (; i < n; i++) {
+        sum += fmax(S[i] - K, 0.0);
+    }
+    return sum;
+}
+
+/**
+ * Sum the put payoffs max(K - S[i], 0) over a block of terminal prices.
+ *
+ * @param S  Terminal stock prices
+ * @param n  Number of prices
+ * @param K  Strike price
+ * @return   Sum of the n payoffs (not yet averaged or discounted)
+ */
+double put_payoff_sum(const double *S, size_t n, double K)
+{
+    PROFILE_SCOPE(PROFILE_PAYOFF);
+    double sum = 0.0;
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = payoff_sum_avx2(S, n, K, -1.0, &sum);
+    }
+#endif
+    for (; i < n; i++) {
+        sum += fmax(K - S[i], 0.0);
+    }
+    return sum;
+}
+
+/**
+ * Evaluate the payoff of every path in a block.
+ *
+ * Used when the engine needs individual payoffs rather than just their
+ * sum (e.g. to combine antithetic pairs or accumulate squares for the
+ * standard error). The loops are branch-free so the compiler vectorizes
+ * them.
+ *
+ * @param type  OPTION_CALL or OPTION_PUT
+ * @param S     Terminal stock prices
+ * @param n     Number of prices
+ * @param K     Strike price
+ * @param out   Payoffs (may be the same buffer as S)
+ */
+void payoff_fill(option_type type, const double *S, size_t n, double K, double *out)
+{
+    PROFILE_SCOPE(PROFILE_PAYOFF);
+    if (type == OPTION_PUT) {
+        for (size_t i = 0; i < n; i++) {
+            double v = K - S[i];
+            out[i] = (v > 0.0) ? v : 0.0;
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            double v = S[i] - K;
+            out[i] = (v > 0.0) ? v : 0.0;
+        }
+    }
+}
+
+/**
+ * Single-precision payoff_fill() for the float32 engine.
+ *
+ * @param type  OPTION_CALL or OPTION_PUT
+ * @param S     Terminal prices
+ * @param n     Number of prices
+ * @param K     Strike price
+ * @param out   Undiscounted payoffs; may be the same buffer as S
+ */
+void payoff_fill_f32(option_type type, const float *S, size_t n, float K, float *out)
+{
+    PROFILE_SCOPE(PROFILE_PAYOFF);
+    if (type == OPTION_PUT) {
+        for (size_t i = 0; i < n; i++) {
+            float v = K - S[i];
+            out[i] = (v > 0.0f) ? v : 0.0f;
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            float v = S[i] - K;
+            out[i] = (v > 0.0f) ? v : 0.0f;
+        }
+    }
+}
+
+/**
+ * Set up the running state for a block of path-dependent payoffs.
+ *
+ * @param acc      Accumulator to initialize
+ * @param opt      Option terms (must outlive the accumulator)
+ * @param S0       Initial stock price (the state before step 1)
+ * @param sigma    Volatility, for the Brownian-bridge barrier correction
+ * @param dt       Length of one time step
+ * @param storage  PATH_ACCUMULATOR_ARRAYS * n_paths doubles of scratch
+ * @param n_paths  Number of paths in the block
+ */
+void path_accumulator_init(path_accumulator *acc, const path_option *opt, double S0,
+                           double sigma, double dt, double *storage, size_t n_paths)
+{
+    acc->opt = opt;
+    acc->log_barrier = (opt->barrier != BARRIER_NONE) ? log(opt->barrier_level) : 0.0;
+    acc->bridge_var = sigma * sigma * dt;
+    acc->steps_seen = 0;
+    acc->sum = storage;
+    acc->log_sum = storage + n_paths;
+    acc->log_last = storage + 2 * n_paths;
+    acc->survival = storage + 3 * n_paths;
+    acc->last = storage + 4 * n_paths;
+
+    double log_S0 = log(S0);
+    for (size_t i = 0; i < n_paths; i++) {
+        acc->sum[i] = 0.0;
+        acc->log_sum[i] = 0.0;
+        acc->log_last[i] = log_S0;
+        acc->survival[i] = 1.0;
+        acc->last[i] = S0;
+    }
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 natural log of a block of prices.
+ *
+ * @return  Number of outputs written (the scalar loop finishes the rest)
+ */
+__attribute__((target("avx2,fma")))
+static size_t log_fill_avx2(const double *S, size_t n, double *out)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, v_log(_mm256_loadu_pd(S + i)));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Fold one time step into the running state of every path.
+ *
+ * Keeps, per path: the running sum and log-sum of prices (for the
+ * averages), the latest price and its log, and the probability that the
+ * barrier has not been hit.
+ *
+ * With MONITOR_CONTINUOUS the path may also cross the barrier between two
+ * time steps without it showing at the grid points. Given the endpoints,
+ * log S between them is a Brownian bridge, and the chance it touched H is
+ *   p = exp(-2 ln(H/S_a) ln(H/S_b) / (σ² dt))
+ * (when both endpoints are on the safe side). Multiplying the survival
+ * probability by (1 - p) every step gives the exact continuous-barrier
+ * expectation from a coarse grid - instead of needing thousands of steps,
+ * which would still only converge like O(√dt).
+ *
+ * Matches gbm_step_hook, so it can be passed to gbm_path_stream() directly.
+ *
+ * @param ctx      path_accumulator to update
+ * @param step     Time step (unused)
+ * @param S        Prices of all paths at this step
+ * @param n_paths  Number of paths
+ */
+void path_accumulator_update(void *ctx, size_t step, const double *S, size_t n_paths)
+{
+    path_accumulator *acc = ctx;
+    const path_option *opt = acc->opt;
+    (void)step;
+    acc->steps_seen++;
+
+    // One log per path per step, shared by the geometric average and the bridge
+    double log_S[1024];
+    for (size_t begin = 0; begin < n_paths; begin += 1024) {
+        size_t n = (n_paths - begin < 1024) ? n_paths - begin : 1024;
+        const double *s = S + begin;
+        size_t i = 0;
+#ifdef MC_SIMD_X86
+        if (simd_active() >= SIMD_AVX2) {
+            i = log_fill_avx2(s, n, log_S);
+        }
+#endif
+        for (; i < n; i++) {
+            log_S[i] = log(s[i]);
+        }
+
+        double *sum = acc->sum + begin, *log_sum = acc->log_sum + begin;
+        double *log_last = acc->log_last + begin, *survival = acc->survival + begin;
+        double *last = acc->last + begin;
+        for (i = 0; i < n; i++) {
+            sum[i] += s[i];
+            log_sum[i] += log_S[i];
+        }
+
+        if (opt->barrier != BARRIER_NONE) {
+            int up = (opt->barrier == BARRIER_UP_OUT || opt->barrier == BARRIER_UP_IN);
+            double H = opt->barrier_level;
+            for (i = 0; i < n; i++) {
+                int breached = up ? (s[i] >= H) : (s[i] <= H);
+                if (breached) {
+                    survival[i] = 0.0;
+                } else if (opt->monitoring == MONITOR_CONTINUOUS && survival[i] > 0.0) {
+                    double a = acc->log_barrier - log_last[i];
+                    double b = acc->log_barrier - log_S[i];
+                    survival[i] *= 1.0 - exp(-2.0 * a * b / acc->bridge_var);
+                }
+            }
+        }
+
+        for (i = 0; i < n; i++) {
+            log_last[i] = log_S[i];
+            last[i] = s[i];
+        }
+    }
+}
+
+/**
+ * Payoff of every path once the last time step has been accumulated.
+ *
+ * The underlying is S(T) or the arithmetic/geometric average. The barrier
+ * enters as a weight: knock-out pays survival × vanilla and knock-in pays
+ * (1 - survival) × vanilla, so knock-in + knock-out = vanilla path by path.
+ *
+ * @param acc      Accumulator after all n_steps updates
+ * @param n_paths  Number of paths
+ * @param out      Undiscounted payoffs
+ */
+void path_payoff_fill(const path_accumulator *acc, size_t n_paths, double *out)
+{
+    PROFILE_SCOPE(PROFILE_PAYOFF);
+    const path_option *opt = acc->opt;
+    double inv_steps = 1.0 / (double)acc->steps_seen;
+    double sign = (opt->type == OPTION_PUT) ? -1.0 : 1.0;
+    int knock_in = (opt->barrier == BARRIER_UP_IN || opt->barrier == BARRIER_DOWN_IN);
+
+    for (size_t i = 0; i < n_paths; i++) {
+        double underlying;
+        if (opt->average == AVERAGE_ARITHMETIC) {
+            underlying = acc->sum[i] * inv_steps;
+        } else if (opt->average == AVERAGE_GEOMETRIC) {
+            underlying = exp(acc->log_sum[i] * inv_steps);
+        } else {
+            underlying = acc->last[i];
+        }
+
+        double v = sign * (underlying - opt->strike);
+        double payoff = (v > 0.0) ? v : 0.0;
+        if (opt->barrier != BARRIER_NONE) {
+            payoff *= knock_in ? 1.0 - acc->survival[i] : acc->survival[i];
+        }
+        out[i] = payoff;
+    }
+}
+
+/**
+ * Geometric-average payoff with the same strike and type, ignoring any barrier.
+ *
+ * The geometric average of lognormal prices is itself lognormal, so this
+ * payoff has a closed-form price (price_geometric_asian_bs) and is very
+ * strongly correlated with the arithmetic one - an ideal control variate.
+ *
+ * @param acc      Accumulator after all n_steps updates
+ * @param n_paths  Number of paths
+ * @param out      Undiscounted geometric-average payoffs
+ */
+void path_geometric_payoff_fill(const path_accumulator *acc, size_t n_paths, double *out)
+{
+    const path_option *opt = acc->opt;
+    double inv_steps = 1.0 / (double)acc->steps_seen;
+    double sign = (opt->type == OPTION_PUT) ? -1.0 : 1.0;
+
+    for (size_t i = 0; i < n_paths; i++) {
+        double v = sign * (exp(acc->log_sum[i] * inv_steps) - opt->strike);
+        out[i] = (v > 0.0) ? v : 0.0;
+    }
+}
+
+/**
+ * Weight of asset a in a basket (1 when no weights are given).
+ */
+static double basket_weight(const basket_option *opt, size_t a)
+{
+    return opt->weights ? opt->weights[a] : 1.0;
+}
+
+/**
+ * Payoff of every path of a basket, spread, best-of or worst-of option.
+ *
+ * The underlying is built a whole asset row at a time, so every loop runs
+ * over contiguous paths and vectorizes; there is no per-path gather over
+ * the assets.
+ *
+ * @param opt  Option terms
+ * @param S    n_assets rows of n terminal prices (row a at S + a * n)
+ * @param n    Number of paths
+ * @param out  Undiscounted payoffs (must not alias S)
+ */
+void basket_payoff_fill(const basket_option *opt, const double *S, size_t n, double *out)
+{
+    PROFILE_SCOPE(PROFILE_PAYOFF);
+    double w0 = basket_weight(opt, 0);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = w0 * S[i];
+    }
+    for (size_t a = 1; a < opt->n_assets; a++) {
+        const double *row = S + a * n;
+        double w = basket_weight(opt, a);
+        switch (opt->kind) {
+            case BASKET_SPREAD:
+                for (size_t i = 0; i < n; i++) out[i] -= w * row[i];
+                break;
+            case BASKET_BEST_OF:
+                for (size_t i = 0; i < n; i++) out[i] = fmax(out[i], w * row[i]);
+                break;
+            case BASKET_WORST_OF:
+                for (size_t i = 0; i < n; i++) out[i] = fmin(out[i], w * row[i]);
+                break;
+            default:
+                for (size_t i = 0; i < n; i++) out[i] += w * row[i];
+                break;
+        }
+    }
+    double sign = (opt->type == OPTION_PUT) ? -1.0 : 1.0;
+    for (size_t i = 0; i < n; i++) {
+        double v = sign * (out[i] - opt->strike);
+        out[i] = (v > 0.0) ? v : 0.0;
+    }
+}
+
+/**
+ * Coefficient of asset a in the linear combination of terminal prices
+ * that tracks a basket payoff: the basket itself for averages and spreads,
+ * and the weighted mean of the assets for best-of and worst-of.
+ */
+static double basket_coefficient(const basket_option *opt, size_t a)
+{
+    double w = basket_weight(opt, a);
+    if (opt->kind == BASKET_SPREAD) {
+        return (a > 0) ? -w : w;
+    }
+    if (opt->kind == BASKET_BEST_OF || opt->kind == BASKET_WORST_OF) {
+        return w / (double)opt->n_assets;
+    }
+    return w;
+}
+
+/**
+ * Coefficients of the linear part of a basket payoff. Its expectation is
+ * Σ c_a S0_a e^(rT) under the pricing measure, which makes it a control
+ * variate for every basket kind.
+ *
+ * @param opt  Option terms
+ * @param c    Receives n_assets coefficients
+ */
+void basket_linear_weights(const basket_option *opt, double *c)
+{
+    for (size_t a = 0; a < opt->n_assets; a++) {
+        c[a] = basket_coefficient(opt, a);
+    }
+}
+
+/**
+ * Linear part of a basket payoff for every path (see basket_linear_weights()).
+ *
+ * @param opt  Option terms
+ * @param S    n_assets rows of n terminal prices
+ * @param n    Number of paths
+ * @param out  Σ c_a S_a per path (must not alias S)
+ */
+void basket_linear_fill(const basket_option *opt, const double *S, size_t n, double *out)
+{
+    double c0 = basket_coefficient(opt, 0);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = c0 * S[i];
+    }
+    for (size_t a = 1; a < opt->n_assets; a++) {
+        const double *row = S + a * n;
+        double c = basket_coefficient(opt, a);
+        for (size_t i = 0; i < n; i++) {
+            out[i] += c * row[i];
+        }
+    }
+}
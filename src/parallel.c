@@ -0,0 +1,330 @@
+//
+// Parallel Execution Helpers
+// A work-stealing "parallel for": tasks are numbered 0..n-1 and run on a
+// pool of worker threads that is started on first use and kept for the
+// life of the process.
+//
+// Every pool thread owns a deque of task ranges; threads outside the pool
+// share deque 0. A parallel_for() call pushes its whole range and starts
+// on it. Running a range splits it in halves, pushing the upper half each
+// time, so the owner works through its own tasks from the bottom while
+// idle threads steal the biggest pending ranges from the top. A call made
+// from inside a task (a contract that splits into path chunks) pushes onto
+// the calling worker's own deque, and a thread waiting for its tasks runs
+// other pending tasks meanwhile - so a batch of contracts of very
+// different cost keeps every core busy until the last chunk is done.
+//
+// The helpers never decide what a task computes or in which order results
+// are combined - callers write each task's result into its own slot and
+// reduce the slots afterwards, which keeps results independent of timing.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "include/parallel.h"
+#include "include/profile.h"
+
+/**
+ * Shared state for one parallel_for() call (lives on the caller's stack).
+ */
+typedef struct {
+    parallel_task_fn fn;   // Work callback
+    void *ctx;             // Caller context passed to every task
+    unsigned limit;        // Most tasks of this call running at once (n_threads)
+    atomic_uint active;    // Tasks of this call running now
+    atomic_uint remaining; // Tasks not finished yet
+} parallel_group;
+
+/**
+ * Tasks [begin, end) of one call.
+ */
+typedef struct {
+    parallel_group *group;
+    uint32_t begin, end;
+} parallel_range;
+
+/**
+ * Ranges of one thread: the owner pushes and pops at the bottom, thieves
+ * take from the top. A mutex is plenty: a task is a whole path chunk.
+ */
+typedef struct {
+    _Alignas(64) pthread_mutex_t lock;
+    parallel_range *items;
+    size_t top, bottom, capacity;
+} task_deque;
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;               // Guards starting workers and sleeping
+    pthread_cond_t wake;
+    task_deque deques[PARALLEL_MAX_WORKERS + 1];  // 0 = threads outside the pool
+    atomic_uint n_workers;
+    atomic_uint epoch;                  // Bumped whenever new work may be runnable
+    atomic_uint sleepers;
+} pool = {
+    .once = PTHREAD_ONCE_INIT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER
+};
+
+// Deque of the calling thread (0 = not a pool worker)
+static _Thread_local unsigned self_id;
+
+static void pool_init(void) {
+    for (unsigned i = 0; i <= PARALLEL_MAX_WORKERS; i++) {
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+    }
+}
+
+/**
+ * Tell sleeping threads that something changed (new ranges, a freed slot
+ * or a finished call). The epoch is bumped before looking for sleepers,
+ * so a thread about to sleep either sees the new epoch or is woken.
+ */
+static void pool_notify(void) {
+    atomic_fetch_add(&pool.epoch, 1u);
+    if (atomic_load(&pool.sleepers) != 0) {
+        pthread_mutex_lock(&pool.lock);
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+/**
+ * Sleep until the epoch moves past `seen` (or *done reaches 0).
+ */
+static void pool_wait(unsigned seen, atomic_uint *done) {
+    pthread_mutex_lock(&pool.lock);
+    atomic_fetch_add(&pool.sleepers, 1u);
+    while (atomic_load(&pool.epoch) == seen && !(done && atomic_load(done) == 0)) {
+        pthread_cond_wait(&pool.wake, &pool.lock);
+    }
+    atomic_fetch_sub(&pool.sleepers, 1u);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/**
+ * Take one of a call's slots if fewer than n_threads of its tasks run.
+ */
+static int group_acquire(parallel_group *group) {
+    unsigned active = atomic_load(&group->active);
+    while (active < group->limit) {
+        if (atomic_compare_exchange_weak(&group->active, &active, active + 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Push a range at the bottom of deque d. Returns 0, or -1 out of memory.
+ */
+static int deque_push(unsigned d, parallel_range range) {
+    task_deque *q = &pool.deques[d];
+    pthread_mutex_lock(&q->lock);
+    if (q->bottom == q->capacity) {
+        if (q->top > 0) {
+            memmove(q->items, q->items + q->top, (q->bottom - q->top) * sizeof(*q->items));
+            q->bottom -= q->top;
+            q->top = 0;
+        } else {
+            size_t capacity = q->capacity ? 2 * q->capacity : 64;
+            parallel_range *items = realloc(q->items, capacity * sizeof(*items));
+            if (!items) {
+                pthread_mutex_unlock(&q->lock);
+                return -1;
+            }
+            q->items = items;
+            q->capacity = capacity;
+        }
+    }
+    q->items[q->bottom++] = range;
+    pthread_mutex_unlock(&q->lock);
+    pool_notify();
+    return 0;
+}
+
+/**
+ * Take the bottom (own = 1) or top range of deque d, if its call has a
+ * free slot; the slot is held for the caller.
+ */
+static int deque_take(unsigned d, int own, parallel_range *out) {
+    task_deque *q = &pool.deques[d];
+    pthread_mutex_lock(&q->lock);
+    int taken = 0;
+    if (q->top < q->bottom) {
+        size_t i = own ? q->bottom - 1 : q->top;
+        if (group_acquire(q->items[i].group)) {
+            *out = q->items[i];
+            if (own) {
+                q->bottom--;
+            } else {
+                q->top++;
+            }
+            if (q->top == q->bottom) {
+                q->top = q->bottom = 0;
+            }
+            taken = 1;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return taken;
+}
+
+/**
+ * Run a range whose slot the caller holds: split off upper halves until
+ * one task is left, run it, then give the slot back.
+ */
+static void run_range(parallel_range range) {
+    parallel_group *group = range.group;
+    while (range.end - range.begin > 1) {
+        uint32_t mid = range.begin + (range.end - range.begin) / 2;
+        if (deque_push(self_id, (parallel_range){ group, mid, range.end }) != 0) {
+            break;  // No room to split: run the rest here
+        }
+        range.end = mid;
+    }
+    for (uint32_t task = range.begin; task < range.end; task++) {
+        group->fn(group->ctx, task);
+    }
+
+    // Last touches of the group: it may be gone once remaining reaches 0
+    int was_full = (atomic_fetch_sub(&group->active, 1u) >= group->limit);
+    int finished = (atomic_fetch_sub(&group->remaining, range.end - range.begin) == range.end - range.begin);
+    if (was_full || finished) {
+        pool_notify();
+    }
+}
+
+/**
+ * Run one pending range: the thread's own newest first, else the oldest
+ * range of another deque.
+ *
+ * @return  1 if a range ran, 0 if nothing runnable was found
+ */
+static int pool_run_one(void) {
+    parallel_range range;
+    unsigned n = atomic_load(&pool.n_workers) + 1;
+    if (deque_take(self_id, 1, &range)) {
+        run_range(range);
+        return 1;
+    }
+    for (unsigned i = 1; i < n; i++) {
+        if (deque_take((self_id + i) % n, 0, &range)) {
+            run_range(range);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Worker loop: run pending ranges, sleep when there are none.
+ */
+static void *parallel_worker(void *arg) {
+    self_id = (unsigned)(uintptr_t)arg;
+    PROFILE_LANE_BEGIN(self_id);
+    for (;;) {
+        unsigned seen = atomic_load(&pool.epoch);
+        if (!pool_run_one()) {
+            pool_wait(seen, NULL);
+        }
+    }
+    PROFILE_LANE_END();
+    return NULL;
+}
+
+/**
+ * Grow the pool to n_workers threads (capped at PARALLEL_MAX_WORKERS).
+ * If a thread cannot be created the others simply pick up its share.
+ */
+static void pool_ensure(unsigned n_workers) {
+    if (n_workers > PARALLEL_MAX_WORKERS) {
+        n_workers = PARALLEL_MAX_WORKERS;
+    }
+    if (atomic_load(&pool.n_workers) >= n_workers) {
+        return;
+    }
+    pthread_once(&pool.once, pool_init);
+    pthread_mutex_lock(&pool.lock);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (unsigned id = atomic_load(&pool.n_workers) + 1; id <= n_workers; id++) {
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, parallel_worker, (void *)(uintptr_t)id) != 0) {
+            break;
+        }
+        atomic_store(&pool.n_workers, id);
+    }
+    pthread_attr_destroy(&attr);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/**
+ * Number of CPU cores currently online.
+ *
+ * @return  Core count (at least 1)
+ */
+unsigned parallel_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (unsigned)n : 1u;
+}
+
+/**
+ * Pool threads started so far.
+ */
+unsigned parallel_pool_workers(void) {
+    return atomic_load(&pool.n_workers);
+}
+
+/**
+ * Run fn(ctx, task) for every task in [0, n_tasks) across several threads.
+ *
+ * The calling thread works too, so n_threads = 1 runs everything inline
+ * without touching the pool. Otherwise at most n_threads of this call's
+ * tasks run at once, on the caller and the pool (grown to n_threads - 1
+ * workers if needed). Calls may be nested: a task can itself call
+ * parallel_for(), and its tasks are shared out the same way.
+ *
+ * @param n_tasks    Number of tasks to run
+ * @param n_threads  Maximum threads to use (0 = one per online core)
+ * @param fn         Task callback
+ * @param ctx        Context pointer passed to every callback
+ */
+void parallel_for(uint32_t n_tasks, unsigned n_threads, parallel_task_fn fn, void *ctx) {
+    if (n_tasks == 0) {
+        return;
+    }
+    if (n_threads == 0) {
+        n_threads = parallel_default_threads();
+    }
+    if (n_threads > n_tasks) {
+        n_threads = n_tasks;
+    }
+    if (n_threads == 1) {
+        for (uint32_t task = 0; task < n_tasks; task++) {
+            fn(ctx, task);
+        }
+        return;
+    }
+
+    pool_ensure(n_threads - 1);
+    parallel_group group = { .fn = fn, .ctx = ctx, .limit = n_threads };
+    atomic_init(&group.active, 1u);  // The caller's slot
+    atomic_init(&group.remaining, n_tasks);
+    run_range((parallel_range){ &group, 0, n_tasks });
+
+    // Help with whatever is pending until every task of this call is done
+    while (atomic_load(&group.remaining) != 0) {
+        unsigned seen = atomic_load(&pool.epoch);
+        if (!pool_run_one()) {
+            pool_wait(seen, &group.remaining);
+        }
+    }
+}
@@ -0,0 +1,253 @@
+//
+// Portfolio pricing
+//
+// An option chain is typically dozens of strikes, calls and puts, on one
+// underlying and expiry. Pricing each contract on its own repeats the
+// expensive part (normals and exp() for every path) once per strike. Here
+// contracts are grouped by (S0, sigma, r, T), and each group is priced
+// with price_european_chain_mc(), which simulates the terminal prices once
+// and evaluates every payoff against them. Groups are priced concurrently
+// on the work-stealing pool, so a book of one huge chain and many small
+// ones does not wait on the huge one with idle cores.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include "include/portfolio.h"
+#include "include/parallel.h"
+
+/**
+ * Sort key for grouping: the contract's path parameters plus its index.
+ */
+typedef struct {
+    double key[4];              // S0, sigma, r, T
+    size_t index;
+} contract_key;
+
+/**
+ * Order contracts by underlying and maturity, then by index.
+ *
+ * Equal parameters end up adjacent, so each group is one run of the
+ * sorted array. The index tie-break keeps each group in input order,
+ * which makes the result independent of the qsort implementation.
+ */
+static int compare_keys(const void *a, const void *b) {
+    const contract_key *ka = a;
+    const contract_key *kb = b;
+    for (int i = 0; i < 4; i++) {
+        if (ka->key[i] < kb->key[i]) return -1;
+        if (ka->key[i] > kb->key[i]) return 1;
+    }
+    return (ka->index > kb->index) - (ka->index < kb->index);
+}
+
+/**
+ * Do two contracts share an underlying and maturity (and so their paths)?
+ */
+static int same_group(const stock_params *a, const stock_params *b) {
+    return a->initial_price == b->initial_price && a->volatility == b->volatility &&
+           a->interest_rate == b->interest_rate && a->maturity == b->maturity;
+}
+
+/**
+ * Are the contract's path parameters and strike all finite?
+ */
+static int contract_finite(const option_contract *c) {
+    const stock_params *stock = &c->stock;
+    return isfinite(stock->initial_price) && isfinite(stock->volatility) &&
+           isfinite(stock->interest_rate) && isfinite(stock->maturity) && isfinite(c->strike);
+}
+
+/**
+ * Shared state for pricing the groups of one portfolio in parallel.
+ * Arrays indexed by sorted position hold each group as one run.
+ */
+typedef struct {
+    const option_contract *contracts;
+    size_t n_contracts;
+    const contract_key *order;      // Sorted contracts
+    const size_t *group_begin;      // [n_groups + 1] first sorted position of each group
+    const option_type *types;       // Sorted positions
+    const double *strikes;
+    const mc_options *opts;
+    mc_result *results;             // Sorted positions
+    option_greeks *greeks;          // Sorted positions, or NULL
+    option_greeks *greeks_se;       // Sorted positions, or NULL
+    int *status;                    // [n_groups]
+} portfolio_job;
+
+/**
+ * Price group `task` as one chain (parallel_for callback).
+ */
+static void portfolio_group(void *ctx, uint32_t task) {
+    const portfolio_job *job = ctx;
+    size_t begin = job->group_begin[task];
+    size_t n = job->group_begin[task + 1] - begin;
+    const stock_params *stock = &job->contracts[job->order[begin].index].stock;
+    job->status[task] = price_european_chain_greeks_mc(
+        stock->initial_price, stock->interest_rate, stock->volatility, stock->maturity,
+        job->types + begin, job->strikes + begin, n, job->opts, job->results + begin,
+        job->greeks ? job->greeks + begin : NULL, job->greeks_se ? job->greeks_se + begin : NULL);
+}
+
+/**
+ * Price a portfolio of European options, sharing paths within each group.
+ *
+ * Contracts are grouped by (S0, sigma, r, T); each group costs one
+ * simulation plus a cheap payoff pass per contract, so a 50-strike chain
+ * costs about as much as a single option.
+ *
+ * Every group is simulated from opts->seed. A contract priced here is
+ * therefore bit-identical to pricing it alone with price_european_mc() and
+ * the same options (except under early stopping, where a group runs until
+ * all of its contracts have converged). Contracts in one group share their
+ * random numbers, so their errors are correlated - which is what you want
+ * for spreads and smiles.
+ *
+ * @param contracts    Contracts to price (any order; groups need not be adjacent)
+ * @param n_contracts  Number of contracts
+ * @param opts         Engine options used for every group
+ * @param results      Receives results[i] for contracts[i]
+ * @return             0 on success, -1 if any group failed or any contract has a
+ *                     non-finite field (their results are NAN)
+ */
+int price_portfolio_mc(
+    const option_contract *contracts,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results
+) {
+    return price_portfolio_greeks_mc(contracts, n_contracts, opts, results, NULL, NULL);
+}
+
+/**
+ * Price a portfolio and the Greeks of every position in one pass.
+ *
+ * Same grouping as price_portfolio_mc(); each group runs
+ * price_european_chain_greeks_mc(), so the Greeks come from the paths
+ * already simulated for the prices.
+ *
+ * @param contracts    Contracts to price
+ * @param n_contracts  Number of contracts
+ * @param opts         Engine options used for every group
+ * @param results      Receives results[i] for contracts[i]
+ * @param greeks       Receives greeks[i] for contracts[i] (NULL = prices only)
+ * @param greeks_se    Receives their standard errors (may be NULL)
+ * @return             0 on success, -1 if any group failed or any contract has a
+ *                     non-finite field (their outputs are NAN)
+ */
+int price_portfolio_greeks_mc(
+    const option_contract *contracts,
+    size_t n_contracts,
+    const mc_options *opts,
+    mc_result *results,
+    option_greeks *greeks,
+    option_greeks *greeks_se
+) {
+    if (n_contracts == 0) {
+        return 0;
+    }
+
+    contract_key *order = malloc(n_contracts * sizeof(*order));
+    option_type *types = malloc(n_contracts * sizeof(*types));
+    double *strikes = malloc(n_contracts * sizeof(*strikes));
+    mc_result *group_results = malloc(n_contracts * sizeof(*group_results));
+    option_greeks *group_greeks = malloc(2 * n_contracts * sizeof(*group_greeks));
+    size_t *group_begin = malloc((n_contracts + 1) * sizeof(*group_begin));
+    int *group_status = malloc(n_contracts * sizeof(*group_status));
+    if (!order || !types || !strikes || !group_results || !group_greeks || !group_begin || !group_status) {
+        free(order);
+        free(group_begin);
+        free(group_status);
+        free(types);
+        free(strikes);
+        free(group_results);
+        free(group_greeks);
+        const option_greeks failed = { NAN, NAN, NAN, NAN, NAN };
+        for (size_t i = 0; i < n_contracts; i++) {
+            results[i] = (mc_result){NAN, NAN, 0};
+            if (greeks) {
+                greeks[i] = failed;
+            }
+            if (greeks && greeks_se) {
+                greeks_se[i] = failed;
+            }
+        }
+        return -1;
+    }
+
+    // A NaN key would break both the sort order and the grouping (it does
+    // not even equal itself), so non-finite contracts fail on their own
+    int status = 0;
+    size_t n_valid = 0;
+    const option_greeks failed = { NAN, NAN, NAN, NAN, NAN };
+    for (size_t i = 0; i < n_contracts; i++) {
+        const stock_params *stock = &contracts[i].stock;
+        if (!contract_finite(&contracts[i])) {
+            results[i] = (mc_result){NAN, NAN, 0};
+            if (greeks) {
+                greeks[i] = failed;
+            }
+            if (greeks && greeks_se) {
+                greeks_se[i] = failed;
+            }
+            status = -1;
+            continue;
+        }
+        order[n_valid++] = (contract_key){
+            {stock->initial_price, stock->volatility, stock->interest_rate, stock->maturity}, i
+        };
+    }
+    qsort(order, n_valid, sizeof(*order), compare_keys);
+
+    // Groups are tasks of one parallel_for: a large group splits further
+    // into path chunks inside the engine, a small one runs whole
+    size_t n_groups = 0;
+    for (size_t q = 0; q < n_valid; q++) {
+        const option_contract *c = &contracts[order[q].index];
+        if (q == 0 || !same_group(&c->stock, &contracts[order[q - 1].index].stock)) {
+            group_begin[n_groups++] = q;
+        }
+        types[q] = c->type;
+        strikes[q] = c->strike;
+    }
+    group_begin[n_groups] = n_valid;
+
+    portfolio_job job = {
+        .contracts = contracts,
+        .n_contracts = n_contracts,
+        .order = order,
+        .group_begin = group_begin,
+        .types = types,
+        .strikes = strikes,
+        .opts = opts,
+        .results = group_results,
+        .greeks = greeks ? group_greeks : NULL,
+        .greeks_se = (greeks && greeks_se) ? group_greeks + n_contracts : NULL,
+        .status = group_status
+    };
+    parallel_for((uint32_t)n_groups, opts->n_threads, portfolio_group, &job);
+
+    for (size_t g = 0; g < n_groups; g++) {
+        status |= group_status[g];
+    }
+    for (size_t q = 0; q < n_valid; q++) {
+        size_t index = order[q].index;
+        results[index] = group_results[q];
+        if (job.greeks) {
+            greeks[index] = job.greeks[q];
+        }
+        if (job.greeks_se) {
+            greeks_se[index] = job.greeks_se[q];
+        }
+    }
+
+    free(order);
+    free(group_begin);
+    free(group_status);
+    free(types);
+    free(strikes);
+    free(group_results);
+    free(group_greeks);
+    return status;
+}
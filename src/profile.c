@@ -0,0 +1,318 @@
+//
+// Hot-Path Profiling
+// Storage and reports for the PROFILE_* timers and counters (see profile.h).
+//
+// Every lane is a cache-line-aligned block of relaxed atomics: the worker
+// that owns a lane is normally its only writer, so the adds stay
+// uncontended, while two top-level callers that land on the same lane
+// still add up correctly. Ticks are converted to seconds with a rate
+// measured between program start and the report.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "include/profile.h"
+
+#ifdef MC_PROFILE
+
+static const char *const phase_names[PROFILE_N_PHASES] = { "rng", "gbm", "payoff", "chunk", "csv" };
+static const char *const counter_names[PROFILE_N_COUNTERS] = {
+    "paths", "normals", "chunks", "batches", "csv_rows"
+};
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t ticks[PROFILE_N_PHASES];
+    _Atomic uint64_t calls[PROFILE_N_PHASES];
+    _Atomic uint64_t counters[PROFILE_N_COUNTERS];
+#ifdef MC_PROFILE_HIST
+    _Atomic uint64_t hist[PROFILE_N_PHASES][PROFILE_HIST_BUCKETS];
+#endif
+} profile_lane;
+
+static profile_lane lanes[PROFILE_MAX_LANES];
+static _Thread_local unsigned current_lane;
+
+// Clock readings at start-up (or the last reset), for the tick rate
+static uint64_t start_ticks;
+static double start_seconds;
+
+/**
+ * Monotonic wall-clock time in seconds.
+ */
+static double profile_wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+#ifndef MC_SIMD_X86
+/**
+ * Monotonic clock in nanoseconds: the tick source without a TSC.
+ */
+uint64_t profile_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/**
+ * Record a finished scope: its ticks, one call, and its histogram bucket.
+ *
+ * @param scope  Phase and start time from PROFILE_SCOPE
+ */
+void profile_scope_end(const profile_scope *scope) {
+    uint64_t ticks = profile_now() - scope->start;
+    profile_lane *lane = &lanes[current_lane];
+    atomic_fetch_add_explicit(&lane->ticks[scope->phase], ticks, memory_order_relaxed);
+    atomic_fetch_add_explicit(&lane->calls[scope->phase], 1u, memory_order_relaxed);
+#ifdef MC_PROFILE_HIST
+    unsigned bucket = (ticks > 1) ? 63u - (unsigned)__builtin_clzll(ticks) : 0u;
+    if (bucket >= PROFILE_HIST_BUCKETS) {
+        bucket = PROFILE_HIST_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&lane->hist[scope->phase][bucket], 1u, memory_order_relaxed);
+#endif
+}
+
+/**
+ * Add to one of the calling thread's counters.
+ *
+ * @param counter  Which counter
+ * @param n        Amount to add
+ */
+void profile_count(profile_counter counter, uint64_t n) {
+    atomic_fetch_add_explicit(&lanes[current_lane].counters[counter], n, memory_order_relaxed);
+}
+
+/**
+ * Switch the calling thread to another lane (parallel_for() pool threads).
+ *
+ * @param lane  New lane (clamped to the last one)
+ * @return      The lane the thread was on before
+ */
+unsigned profile_lane_set(unsigned lane) {
+    unsigned prev = current_lane;
+    current_lane = (lane < PROFILE_MAX_LANES) ? lane : PROFILE_MAX_LANES - 1;
+    return prev;
+}
+
+/**
+ * Ticks per second, measured since start-up (or the last reset).
+ */
+static double profile_tick_rate(void) {
+#ifdef MC_SIMD_X86
+    double elapsed = profile_wall_seconds() - start_seconds;
+    uint64_t ticks = profile_now() - start_ticks;
+    return (elapsed > 0.0 && ticks > 0) ? (double)ticks / elapsed : 1e9;
+#else
+    return 1e9;
+#endif
+}
+
+static uint64_t lane_load(const _Atomic uint64_t *v) {
+    return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+/**
+ * Whether a lane has recorded anything.
+ */
+static int lane_used(const profile_lane *lane) {
+    for (int p = 0; p < PROFILE_N_PHASES; p++) {
+        if (lane_load(&lane->calls[p])) return 1;
+    }
+    for (int c = 0; c < PROFILE_N_COUNTERS; c++) {
+        if (lane_load(&lane->counters[c])) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Write the timers and counters of one lane, or of all lanes added up
+ * (lane = NULL), as the body of a JSON object.
+ */
+static void profile_json_totals(FILE *out, const profile_lane *lane, double tick_rate) {
+    fprintf(out, "\"phases\": {");
+    for (int p = 0; p < PROFILE_N_PHASES; p++) {
+        uint64_t ticks = 0, calls = 0;
+        for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+            if (lane && lane != &lanes[l]) continue;
+            ticks += lane_load(&lanes[l].ticks[p]);
+            calls += lane_load(&lanes[l].calls[p]);
+        }
+        fprintf(out, "%s\"%s\": {\"calls\": %llu, \"ticks\": %llu, \"seconds\": %.9f}", p ? ", " : "",
+                phase_names[p], (unsigned long long)calls, (unsigned long long)ticks, (double)ticks / tick_rate);
+    }
+    fprintf(out, "}, \"counters\": {");
+    for (int c = 0; c < PROFILE_N_COUNTERS; c++) {
+        uint64_t total = 0;
+        for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+            if (lane && lane != &lanes[l]) continue;
+            total += lane_load(&lanes[l].counters[c]);
+        }
+        fprintf(out, "%s\"%s\": %llu", c ? ", " : "", counter_names[c], (unsigned long long)total);
+    }
+    fprintf(out, "}");
+}
+
+int profile_enabled(void) {
+    return 1;
+}
+
+/**
+ * Zero every lane and restart the tick-rate measurement.
+ */
+void profile_reset(void) {
+    for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+        for (int p = 0; p < PROFILE_N_PHASES; p++) {
+            atomic_store_explicit(&lanes[l].ticks[p], 0u, memory_order_relaxed);
+            atomic_store_explicit(&lanes[l].calls[p], 0u, memory_order_relaxed);
+#ifdef MC_PROFILE_HIST
+            for (unsigned b = 0; b < PROFILE_HIST_BUCKETS; b++) {
+                atomic_store_explicit(&lanes[l].hist[p][b], 0u, memory_order_relaxed);
+            }
+#endif
+        }
+        for (int c = 0; c < PROFILE_N_COUNTERS; c++) {
+            atomic_store_explicit(&lanes[l].counters[c], 0u, memory_order_relaxed);
+        }
+    }
+    start_ticks = profile_now();
+    start_seconds = profile_wall_seconds();
+}
+
+/**
+ * Write totals, then every lane that recorded anything (with its
+ * histograms as [bucket, count] pairs when built with MC_PROFILE_HIST).
+ *
+ * @param out  Destination stream
+ */
+void profile_write_json(FILE *out) {
+    double tick_rate = profile_tick_rate();
+    fprintf(out, "{\n  \"enabled\": true,\n  \"clock\": \"%s\",\n  \"ticks_per_second\": %.1f,\n"
+            "  \"elapsed_seconds\": %.6f,\n  ",
+#ifdef MC_SIMD_X86
+            "tsc",
+#else
+            "monotonic_ns",
+#endif
+            tick_rate, profile_wall_seconds() - start_seconds);
+    profile_json_totals(out, NULL, tick_rate);
+    fprintf(out, ",\n  \"lanes\": [");
+    int first = 1;
+    for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+        if (!lane_used(&lanes[l])) continue;
+        fprintf(out, "%s\n    {\"lane\": %u, ", first ? "" : ",", l);
+        profile_json_totals(out, &lanes[l], tick_rate);
+#ifdef MC_PROFILE_HIST
+        fprintf(out, ", \"histograms\": {");
+        for (int p = 0; p < PROFILE_N_PHASES; p++) {
+            fprintf(out, "%s\"%s\": [", p ? ", " : "", phase_names[p]);
+            int first_bucket = 1;
+            for (unsigned b = 0; b < PROFILE_HIST_BUCKETS; b++) {
+                uint64_t count = lane_load(&lanes[l].hist[p][b]);
+                if (!count) continue;
+                fprintf(out, "%s[%u, %llu]", first_bucket ? "" : ", ", b, (unsigned long long)count);
+                first_bucket = 0;
+            }
+            fprintf(out, "]");
+        }
+        fprintf(out, "}");
+#endif
+        fprintf(out, "}");
+        first = 0;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+/**
+ * Print one line per phase (calls, time, share of the run, ns per call)
+ * and one per counter, summed over all lanes.
+ *
+ * @param out  Destination stream
+ */
+void profile_print(FILE *out) {
+    double tick_rate = profile_tick_rate();
+    double elapsed = profile_wall_seconds() - start_seconds;
+    unsigned used = 0;
+    for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+        used += (unsigned)lane_used(&lanes[l]);
+    }
+    fprintf(out, "=== Profile: %.3f s wall, %u lane(s), phases are inclusive ===\n", elapsed, used);
+    fprintf(out, "  %-10s %14s %12s %8s %12s\n", "Phase", "Calls", "Seconds", "% wall", "ns/call");
+    for (int p = 0; p < PROFILE_N_PHASES; p++) {
+        uint64_t ticks = 0, calls = 0;
+        for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+            ticks += lane_load(&lanes[l].ticks[p]);
+            calls += lane_load(&lanes[l].calls[p]);
+        }
+        if (!calls) continue;
+        double seconds = (double)ticks / tick_rate;
+        fprintf(out, "  %-10s %14llu %12.6f %7.1f%% %12.1f\n", phase_names[p], (unsigned long long)calls,
+                seconds, (elapsed > 0.0) ? 100.0 * seconds / elapsed : 0.0, 1e9 * seconds / (double)calls);
+    }
+    for (int c = 0; c < PROFILE_N_COUNTERS; c++) {
+        uint64_t total = 0;
+        for (unsigned l = 0; l < PROFILE_MAX_LANES; l++) {
+            total += lane_load(&lanes[l].counters[c]);
+        }
+        fprintf(out, "  %-10s %14llu\n", counter_names[c], (unsigned long long)total);
+    }
+}
+
+/**
+ * Exit report: JSON to MC_PROFILE_OUT ("-" = stderr) if it is set,
+ * otherwise the table on stderr.
+ */
+static void profile_at_exit(void) {
+    const char *path = getenv("MC_PROFILE_OUT");
+    if (!path || !*path) {
+        profile_print(stderr);
+        return;
+    }
+    if (strcmp(path, "-") == 0) {
+        profile_write_json(stderr);
+        return;
+    }
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "profile: cannot write %s\n", path);
+        profile_print(stderr);
+        return;
+    }
+    profile_write_json(out);
+    fclose(out);
+}
+
+/**
+ * Start the tick-rate measurement and register the exit report.
+ */
+__attribute__((constructor))
+static void profile_start(void) {
+    start_ticks = profile_now();
+    start_seconds = profile_wall_seconds();
+    atexit(profile_at_exit);
+}
+
+#else
+
+int profile_enabled(void) {
+    return 0;
+}
+
+void profile_reset(void) {
+}
+
+void profile_write_json(FILE *out) {
+    fprintf(out, "{\"enabled\": false}\n");
+}
+
+void profile_print(FILE *out) {
+    fprintf(out, "Profiling is compiled out (build with make profile)\n");
+}
+
+#endif
@@ -0,0 +1,502 @@
+//
+// Results Output
+// Writer thread, columnar and CSV sinks, and the columnar reader (see results.h).
+//
+// Formatting millions of rows with printf() on the pricing path costs more
+// than pricing them once the engine is fast, and a text table has to be
+// parsed again downstream. Here the pricing side only memcpy()s rows into
+// one of RESULTS_WRITER_BUFFERS batch buffers. The writer thread takes
+// full batches in order and passes each to every sink; the columnar sink
+// transposes a batch into its columns and writes it with one fwrite(), the
+// CSV sink formats the batch into one buffer and writes that.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/results.h"
+
+#define RESULTS_MAGIC "MCRES01"
+#define RESULTS_BYTE_ORDER 0x01020304u
+
+// Every batch and column starts on a cache line
+#define RESULTS_ALIGN 64u
+
+// Longest CSV line (18 fields of at most 24 characters, separators, newline)
+#define RESULTS_CSV_LINE 512u
+
+_Static_assert(sizeof(option_type) == sizeof(int32_t), "option_type column is stored as int32_t");
+_Static_assert(sizeof(results_file_header) == RESULTS_ALIGN, "results file header is one cache line");
+
+// Where each column's values sit in a result_row
+static const struct {
+    size_t offset;
+    size_t width;
+} results_columns[RESULTS_N_COLUMNS] = {
+    { offsetof(result_row, id), sizeof(uint64_t) },
+    { offsetof(result_row, ticker), RESULTS_TICKER_LEN },
+    { offsetof(result_row, type), sizeof(int32_t) },
+    { offsetof(result_row, S0), sizeof(double) },
+    { offsetof(result_row, K), sizeof(double) },
+    { offsetof(result_row, r), sizeof(double) },
+    { offsetof(result_row, sigma), sizeof(double) },
+    { offsetof(result_row, T), sizeof(double) },
+    { offsetof(result_row, market_price), sizeof(double) },
+    { offsetof(result_row, price), sizeof(double) },
+    { offsetof(result_row, std_error), sizeof(double) },
+    { offsetof(result_row, n_paths), sizeof(uint64_t) },
+    { offsetof(result_row, greeks.delta), sizeof(double) },
+    { offsetof(result_row, greeks.gamma), sizeof(double) },
+    { offsetof(result_row, greeks.vega), sizeof(double) },
+    { offsetof(result_row, greeks.rho), sizeof(double) },
+    { offsetof(result_row, greeks.theta), sizeof(double) },
+    { offsetof(result_row, seconds), sizeof(double) },
+};
+
+/**
+ * Round a size up to the batch alignment.
+ */
+static uint64_t results_align(uint64_t bytes) {
+    return (bytes + RESULTS_ALIGN - 1) & ~(uint64_t)(RESULTS_ALIGN - 1);
+}
+
+/**
+ * Compute where every column of an n_rows batch goes.
+ *
+ * @param h  Receives n_rows, the column offsets and the batch size
+ */
+static void results_layout(results_batch_header *h, uint64_t n_rows) {
+    h->n_rows = n_rows;
+    uint64_t offset = results_align(sizeof(*h));
+    for (int c = 0; c < RESULTS_N_COLUMNS; c++) {
+        h->column[c] = offset;
+        offset = results_align(offset + n_rows * results_columns[c].width);
+    }
+    h->bytes = offset;
+}
+
+// ----------------------------------------------------------------------------
+// Columnar sink
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    FILE *fp;
+    unsigned char *batch;       // Staging area for one batch, header included
+    size_t capacity;
+} columnar_sink;
+
+/**
+ * Transpose a batch into its columns and write it.
+ */
+static int columnar_write(void *ctx, const result_row *rows, size_t n_rows) {
+    columnar_sink *s = ctx;
+    results_batch_header h;
+    results_layout(&h, n_rows);
+    if (h.bytes > s->capacity) {
+        unsigned char *grown = realloc(s->batch, h.bytes);
+        if (!grown) {
+            return -1;
+        }
+        s->batch = grown;
+        s->capacity = h.bytes;
+    }
+    memset(s->batch, 0, h.bytes);
+    memcpy(s->batch, &h, sizeof(h));
+    for (int c = 0; c < RESULTS_N_COLUMNS; c++) {
+        unsigned char *out = s->batch + h.column[c];
+        size_t width = results_columns[c].width, offset = results_columns[c].offset;
+        for (size_t i = 0; i < n_rows; i++) {
+            memcpy(out + i * width, (const unsigned char *)&rows[i] + offset, width);
+        }
+    }
+    return (fwrite(s->batch, 1, h.bytes, s->fp) == h.bytes) ? 0 : -1;
+}
+
+static int columnar_close(void *ctx) {
+    columnar_sink *s = ctx;
+    int status = (fclose(s->fp) == 0) ? 0 : -1;
+    free(s->batch);
+    free(s);
+    return status;
+}
+
+/**
+ * Open a columnar results file as a sink.
+ *
+ * @param sink  Receives the sink
+ * @param path  File to create (replaced if it exists)
+ * @return      0, or -1 if the file cannot be created or written
+ */
+int results_sink_columnar(results_sink *sink, const char *path) {
+    columnar_sink *s = calloc(1, sizeof(*s));
+    if (!s || !(s->fp = fopen(path, "wb"))) {
+        free(s);
+        return -1;
+    }
+    results_file_header h = { RESULTS_MAGIC, RESULTS_BYTE_ORDER, RESULTS_N_COLUMNS, { 0 } };
+    if (fwrite(&h, sizeof(h), 1, s->fp) != 1) {
+        columnar_close(s);
+        return -1;
+    }
+    sink->write = columnar_write;
+    sink->close = columnar_close;
+    sink->ctx = s;
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// CSV sink
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    FILE *fp;
+    char *text;                 // One formatted batch
+    size_t capacity;
+} csv_sink;
+
+/**
+ * Format a batch into one buffer and write it. Doubles are printed with 17
+ * significant digits, so parsing the file gives back the exact values.
+ */
+static int csv_write(void *ctx, const result_row *rows, size_t n_rows) {
+    csv_sink *s = ctx;
+    size_t need = n_rows * RESULTS_CSV_LINE;
+    if (need > s->capacity) {
+        char *grown = realloc(s->text, need);
+        if (!grown) {
+            return -1;
+        }
+        s->text = grown;
+        s->capacity = need;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < n_rows; i++) {
+        const result_row *row = &rows[i];
+        int n = snprintf(s->text + len, RESULTS_CSV_LINE,
+                         "%llu,%s,%s,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%llu,"
+                         "%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+                         (unsigned long long)row->id, row->ticker, (row->type == OPTION_PUT) ? "put" : "call",
+                         row->S0, row->K, row->r, row->sigma, row->T, row->market_price, row->price,
+                         row->std_error, (unsigned long long)row->n_paths, row->greeks.delta,
+                         row->greeks.gamma, row->greeks.vega, row->greeks.rho, row->greeks.theta,
+                         row->seconds);
+        if (n < 0 || (size_t)n >= RESULTS_CSV_LINE) {
+            return -1;
+        }
+        len += (size_t)n;
+    }
+    return (fwrite(s->text, 1, len, s->fp) == len) ? 0 : -1;
+}
+
+static int csv_close(void *ctx) {
+    csv_sink *s = ctx;
+    int status = (fclose(s->fp) == 0) ? 0 : -1;
+    free(s->text);
+    free(s);
+    return status;
+}
+
+/**
+ * Open a CSV results file as a sink (header line written now).
+ *
+ * @param sink  Receives the sink
+ * @param path  File to create (replaced if it exists)
+ * @return      0, or -1 if the file cannot be created or written
+ */
+int results_sink_csv(results_sink *sink, const char *path) {
+    csv_sink *s = calloc(1, sizeof(*s));
+    if (!s || !(s->fp = fopen(path, "w"))) {
+        free(s);
+        return -1;
+    }
+    if (fputs("id,ticker,type,S0,K,r,sigma,T,market_price,price,std_error,n_paths,"
+              "delta,gamma,vega,rho,theta,seconds\n", s->fp) == EOF) {
+        csv_close(s);
+        return -1;
+    }
+    sink->write = csv_write;
+    sink->close = csv_close;
+    sink->ctx = s;
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Writer thread
+// ----------------------------------------------------------------------------
+
+struct results_writer {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;                       // A batch is queued, or closing
+    pthread_cond_t room;                        // A batch buffer was freed
+    results_sink sinks[RESULTS_MAX_SINKS];
+    size_t n_sinks;
+    size_t batch_rows;
+    result_row *buffer[RESULTS_WRITER_BUFFERS];
+    size_t fill[RESULTS_WRITER_BUFFERS];        // Rows in each buffer
+    unsigned head;                              // Oldest queued buffer
+    unsigned n_queued;                          // Full buffers waiting for the thread
+    unsigned current;                           // Buffer being filled (head + n_queued, mod N)
+    int closing;
+    int status;                                 // -1 once any sink failed
+};
+
+/**
+ * Write queued batches in order until the writer is closed and drained.
+ */
+static void *results_writer_main(void *arg) {
+    results_writer *w = arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (w->n_queued == 0 && !w->closing) {
+            pthread_cond_wait(&w->ready, &w->lock);
+        }
+        if (w->n_queued == 0) {
+            break;
+        }
+        unsigned b = w->head;
+        int failed = w->status != 0;
+        pthread_mutex_unlock(&w->lock);
+
+        // The buffer is ours until it is released below
+        for (size_t s = 0; !failed && s < w->n_sinks; s++) {
+            failed = w->sinks[s].write(w->sinks[s].ctx, w->buffer[b], w->fill[b]) != 0;
+        }
+
+        pthread_mutex_lock(&w->lock);
+        if (failed) {
+            w->status = -1;
+        }
+        w->fill[b] = 0;
+        w->head = (w->head + 1) % RESULTS_WRITER_BUFFERS;
+        w->n_queued--;
+        pthread_cond_broadcast(&w->room);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/**
+ * Close every sink of a writer.
+ *
+ * @return  0, or -1 if any close failed
+ */
+static int results_close_sinks(const results_sink *sinks, size_t n_sinks) {
+    int status = 0;
+    for (size_t s = 0; s < n_sinks; s++) {
+        if (sinks[s].close && sinks[s].close(sinks[s].ctx) != 0) {
+            status = -1;
+        }
+    }
+    return status;
+}
+
+/**
+ * Start a writer thread over the given sinks.
+ *
+ * @param sinks       Sinks to feed, in order (the writer owns them from here on)
+ * @param n_sinks     1..RESULTS_MAX_SINKS
+ * @param batch_rows  Rows per batch handed to the sinks (0 = RESULTS_DEFAULT_BATCH)
+ * @return            Writer, or NULL on invalid input or failure (the sinks are closed)
+ */
+results_writer *results_writer_open(const results_sink *sinks, size_t n_sinks, size_t batch_rows) {
+    if (n_sinks == 0 || n_sinks > RESULTS_MAX_SINKS) {
+        return NULL;
+    }
+    for (size_t s = 0; s < n_sinks; s++) {
+        if (!sinks[s].write) {
+            results_close_sinks(sinks, n_sinks);
+            return NULL;
+        }
+    }
+    results_writer *w = calloc(1, sizeof(*w));
+    int ok = (w != NULL);
+    if (ok) {
+        w->batch_rows = batch_rows ? batch_rows : RESULTS_DEFAULT_BATCH;
+        for (unsigned b = 0; b < RESULTS_WRITER_BUFFERS; b++) {
+            w->buffer[b] = malloc(w->batch_rows * sizeof(result_row));
+            ok &= (w->buffer[b] != NULL);
+        }
+    }
+    if (ok) {
+        memcpy(w->sinks, sinks, n_sinks * sizeof(*sinks));
+        w->n_sinks = n_sinks;
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->ready, NULL);
+        pthread_cond_init(&w->room, NULL);
+        if (pthread_create(&w->thread, NULL, results_writer_main, w) != 0) {
+            pthread_cond_destroy(&w->room);
+            pthread_cond_destroy(&w->ready);
+            pthread_mutex_destroy(&w->lock);
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        for (unsigned b = 0; w && b < RESULTS_WRITER_BUFFERS; b++) {
+            free(w->buffer[b]);
+        }
+        free(w);
+        results_close_sinks(sinks, n_sinks);
+        return NULL;
+    }
+    return w;
+}
+
+/**
+ * Queue rows behind everything pushed before them.
+ *
+ * Rows are copied, so the caller can reuse `rows` at once. A full batch
+ * goes to the writer thread; the call waits only if all
+ * RESULTS_WRITER_BUFFERS buffers are queued.
+ *
+ * @param w       Writer from results_writer_open()
+ * @param rows    Rows to write
+ * @param n_rows  Number of rows
+ * @return        0, or -1 once a sink has failed (the rows are dropped)
+ */
+int results_writer_push(results_writer *w, const result_row *rows, size_t n_rows) {
+    pthread_mutex_lock(&w->lock);
+    while (n_rows > 0 && w->status == 0) {
+        // The current buffer is the one after the queued ones; wait if it is still queued
+        while (w->n_queued == RESULTS_WRITER_BUFFERS && w->status == 0) {
+            pthread_cond_wait(&w->room, &w->lock);
+        }
+        unsigned b = w->current;
+        size_t n = w->batch_rows - w->fill[b];
+        if (n > n_rows) {
+            n = n_rows;
+        }
+        memcpy(w->buffer[b] + w->fill[b], rows, n * sizeof(*rows));
+        w->fill[b] += n;
+        rows += n;
+        n_rows -= n;
+        if (w->fill[b] == w->batch_rows) {
+            w->n_queued++;
+            w->current = (w->current + 1) % RESULTS_WRITER_BUFFERS;
+            pthread_cond_signal(&w->ready);
+        }
+    }
+    int status = w->status;
+    pthread_mutex_unlock(&w->lock);
+    return status;
+}
+
+/**
+ * Flush the last partial batch, wait for the thread and close the sinks.
+ *
+ * @param w  Writer from results_writer_open() (freed)
+ * @return   0, or -1 if any write or close failed
+ */
+int results_writer_close(results_writer *w) {
+    pthread_mutex_lock(&w->lock);
+    while (w->n_queued == RESULTS_WRITER_BUFFERS) {
+        pthread_cond_wait(&w->room, &w->lock);
+    }
+    if (w->fill[w->current] > 0) {
+        w->n_queued++;
+        w->current = (w->current + 1) % RESULTS_WRITER_BUFFERS;
+    }
+    w->closing = 1;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    int status = w->status;
+    if (results_close_sinks(w->sinks, w->n_sinks) != 0) {
+        status = -1;
+    }
+    pthread_cond_destroy(&w->room);
+    pthread_cond_destroy(&w->ready);
+    pthread_mutex_destroy(&w->lock);
+    for (unsigned b = 0; b < RESULTS_WRITER_BUFFERS; b++) {
+        free(w->buffer[b]);
+    }
+    free(w);
+    return status;
+}
+
+// ----------------------------------------------------------------------------
+// Columnar reader
+// ----------------------------------------------------------------------------
+
+/**
+ * Map a columnar results file and check its header.
+ *
+ * @param f     Receives the mapping
+ * @param path  File written by results_sink_columnar()
+ * @return      0, or -1 if it cannot be mapped or is not a results file
+ */
+int results_file_open(results_file *f, const char *path) {
+    f->map = NULL;
+    f->map_size = 0;
+    f->offset = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(results_file_header)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    const results_file_header *h = map;
+    if (memcmp(h->magic, RESULTS_MAGIC, sizeof(h->magic)) != 0 || h->byte_order != RESULTS_BYTE_ORDER
+        || h->n_columns != RESULTS_N_COLUMNS) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    f->map = map;
+    f->map_size = (size_t)st.st_size;
+    f->offset = sizeof(*h);
+    return 0;
+}
+
+/**
+ * Point `batch` at the columns of the next record batch.
+ *
+ * @return  1 = batch filled, 0 = end of file, -1 = truncated or malformed batch
+ */
+int results_file_next(results_file *f, results_batch *batch) {
+    if (f->offset == f->map_size) {
+        return 0;
+    }
+    if (f->map_size - f->offset < sizeof(results_batch_header)) {
+        return -1;
+    }
+    const unsigned char *base = (const unsigned char *)f->map + f->offset;
+    results_batch_header h, expect;
+    memcpy(&h, base, sizeof(h));
+    if (h.n_rows > f->map_size) {
+        return -1;
+    }
+    results_layout(&expect, h.n_rows);
+    if (memcmp(&h, &expect, sizeof(h)) != 0 || h.bytes > f->map_size - f->offset) {
+        return -1;
+    }
+    batch->n_rows = (size_t)h.n_rows;
+    for (int c = 0; c < RESULTS_N_COLUMNS; c++) {
+        batch->column[c] = base + h.column[c];
+    }
+    f->offset += (size_t)h.bytes;
+    return 1;
+}
+
+void results_file_close(results_file *f) {
+    if (f->map) {
+        munmap(f->map, f->map_size);
+    }
+    f->map = NULL;
+    f->map_size = 0;
+}
@@ -1,7 +1,12 @@
 //
 // Random Number Generator (RNG) module
 // Provides uniform and normal random numbers for Monte Carlo simulations.
-// Uses Xorshift32 for speed and Box-Muller for normal distribution.
+// Uses xoshiro256** for speed and Box-Muller for normal distribution.
+// normal_fill() is the batch API: it keeps both Box-Muller outputs and has
+// an AVX2 variant picked at runtime.
+//
+// All functions take an explicit rng_state, so several streams can be used
+// at the same time (e.g. one per worker thread) without sharing anything.
 //
 // Created by b2 on 12/28/25.
 //
@@ -9,75 +14,157 @@
 #include <stdint.h>
 #include <math.h>
 #include "include/rng.h"
+#include "include/simd.h"
+#include "include/profile.h"
+#include "include/vmath_avx2.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// Global RNG state - this single number holds the "position" in our random sequence
-// Static means it's private to this file (encapsulation)
-static uint32_t rng_state;
+/**
+ * Rotate a 64-bit word left by k bits.
+ */
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * SplitMix64 - turns one 64-bit seed into a well-mixed sequence of words.
+ *
+ * xoshiro needs 256 bits of state that must not be all zero. Feeding a
+ * small seed like 42 directly would give a poorly mixed starting state,
+ * so the authors recommend expanding the seed with SplitMix64 first.
+ *
+ * Reference: https://prng.di.unimi.it/splitmix64.c
+ *
+ * @param x  Pointer to the SplitMix64 counter (modified in place)
+ * @return   Next mixed 64-bit word
+ */
+static inline uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
 
 /**
- * Initialize the random number generator with a seed.
+ * Initialize a random number stream with a seed.
  *
  * The seed determines the entire sequence of random numbers.
  * Same seed = same sequence (useful for reproducible simulations).
  * Different seeds = different sequences.
  *
+ * SplitMix64 never produces four zero words in a row, so the resulting
+ * state is always valid (xoshiro would output zeros forever from 0).
+ *
+ * @param rng   Stream to initialize
  * @param seed  Starting value for RNG (use time(NULL) for "random" seed)
  */
-void rng_seed(uint32_t seed) {
-    // Xorshift doesn't work with zero (would output zeros forever)
-    // So we force any zero seed to become 1
-    if (seed == 0) {
-        seed = 1;
+void rng_seed(rng_state *rng, uint64_t seed) {
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&x);
     }
-    rng_state = seed;
 }
 
 /**
- * Xorshift32 - a fast, simple pseudo-random number generator.
+ * xoshiro256** - a fast, high-quality 64-bit pseudo-random number generator.
  *
  * How it works:
- *   1. XOR the state with itself shifted left 13 bits
- *   2. XOR with itself shifted right 17 bits  
- *   3. XOR with itself shifted left 5 bits
+ *   1. The output is a scrambled copy of one state word (multiply, rotate, multiply)
+ *   2. The 256-bit state is advanced with XORs, shifts and a rotation
+ *
+ * Why xoshiro256** instead of a 32-bit Xorshift?
+ *   - Period 2^256 - 1: it never runs out, even at billions of paths
+ *   - 64 bits per call: one call is enough for a full 53-bit double
+ *   - Supports jump(): skip 2^128 draws at once to create substreams
+ *
+ * Reference: https://prng.di.unimi.it/xoshiro256starstar.c
+ *
+ * @param rng  Stream to draw from (modified in place)
+ * @return     Next pseudo-random 64-bit unsigned integer
+ */
+uint64_t rng_next(rng_state *rng) {
+    uint64_t *s = rng->s;
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+/**
+ * Jump the stream ahead by 2^128 draws.
  *
- * These specific shift amounts (13, 17, 5) were chosen by George Marsaglia
- * to maximize the period (how long until the sequence repeats).
- * Period = 2^32 - 1 (about 4 billion numbers before repeating)
+ * This is equivalent to calling rng_next() 2^128 times, but costs
+ * only 256 calls. Starting from one seed and jumping k times gives
+ * substream k; no simulation will ever draw 2^128 numbers, so
+ * substreams never overlap.
  *
- * Why Xorshift?
- *   - Blazing fast (just 3 XORs and 3 shifts)
- *   - Good statistical properties for Monte Carlo
- *   - No division or multiplication needed
+ * @param rng  Stream to advance (modified in place)
+ */
+void rng_jump(rng_state *rng) {
+    static const uint64_t JUMP[] = {
+        0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+        0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull
+    };
+
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (1ull << b)) {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
+
+/**
+ * Initialize substream number `stream` of a seed.
  *
- * Reference: https://en.wikipedia.org/wiki/Xorshift
+ * Use this to give each worker (or each block of paths) its own
+ * non-overlapping sequence derived from a single user-visible seed.
  *
- * @param state  Pointer to the RNG state (modified in place)
- * @return       Next pseudo-random 32-bit unsigned integer
+ * @param rng     Stream to initialize
+ * @param seed    Base seed shared by all substreams
+ * @param stream  Substream index (0 = the plain seeded stream)
  */
-static inline uint32_t xorshift32(uint32_t *state) {
-    uint32_t x = *state;
-    x ^= x << 13;  // First transformation
-    x ^= x >> 17;  // Second transformation
-    x ^= x << 5;   // Third transformation
-    *state = x;    // Save new state for next call
-    return x;
+void rng_stream(rng_state *rng, uint64_t seed, uint64_t stream) {
+    rng_seed(rng, seed);
+    for (uint64_t i = 0; i < stream; i++) {
+        rng_jump(rng);
+    }
 }
 
 /**
  * Generate a uniform random double in [0.0, 1.0).
  *
- * Takes a 32-bit integer from xorshift32 and scales it to [0, 1).
- * This is the building block for all other random distributions.
+ * Takes the top 53 bits of a 64-bit draw (the precision of a double)
+ * and scales them by 2^-53. Every representable multiple of 2^-53
+ * is equally likely and 1.0 is never returned.
  *
- * @return  Random double uniformly distributed in [0.0, 1.0)
+ * @param rng  Stream to draw from
+ * @return     Random double uniformly distributed in [0.0, 1.0)
  */
-double random_double() {
-    // Divide by UINT32_MAX to scale from [0, 2^32-1] to [0, 1)
-    return (double)xorshift32(&rng_state) / (double)UINT32_MAX;
+double random_double(rng_state *rng) {
+    return (double)(rng_next(rng) >> 11) * 0x1.0p-53;
 }
 
 /**
@@ -100,15 +187,200 @@ double random_double() {
  *
  * Reference: https://en.wikipedia.org/wiki/Box%E2%80%93Muller_transform
  *
- * @return  Random double from standard normal distribution N(0,1)
+ * @param rng  Stream to draw from
+ * @return     Random double from standard normal distribution N(0,1)
  */
-double normal_random(void) {
-    double u1 = random_double();  // First uniform random
-    double u2 = random_double();  // Second uniform random
+double normal_random(rng_state *rng) {
+    PROFILE_SCOPE(PROFILE_RNG);
+    PROFILE_COUNT(PROFILE_NORMALS, 1);
+    // 1 - U maps [0,1) to (0,1], so log(u1) is always finite
+    double u1 = 1.0 - random_double(rng);  // First uniform random
+    double u2 = random_double(rng);        // Second uniform random
 
     // Box-Muller formula:
     // - sqrt(-2*ln(u1)) = radius (distance from origin)
     // - cos(2*π*u2) = x-coordinate on unit circle
     // - Product gives us one standard normal sample
     return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
-}
\ No newline at end of file
+}
+
+/**
+ * Scalar Box-Muller from output index i onward: both halves are kept.
+ *
+ * Each pair (U1, U2) gives two independent normals:
+ *   Z0 = R*cos(θ),  Z1 = R*sin(θ)   with R = sqrt(-2 ln U1), θ = 2πU2
+ *
+ * @param rng  Stream to draw from
+ * @param out  Output buffer; pair i writes out[2i] and out[2i+1] (if < n)
+ * @param n    Number of normals wanted
+ * @param i    First output index (must be even)
+ */
+static void normal_fill_scalar(rng_state *rng, double *out, size_t n, size_t i) {
+    for (; i < n; i += 2) {
+        double u1 = 1.0 - random_double(rng);
+        double u2 = random_double(rng);
+        double radius = sqrt(-2.0 * log(u1));
+        double theta = 2.0 * M_PI * u2;
+
+        out[i] = radius * cos(theta);
+        if (i + 1 < n) {
+            out[i + 1] = radius * sin(theta);  // Odd n: the last sine is dropped
+        }
+    }
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 Box-Muller: four pairs (eight normals) per iteration.
+ *
+ * Uniforms are still drawn one at a time from the single stream (so the
+ * output order matches the scalar version exactly); only the log, sqrt
+ * and sin/cos work is vectorized, which is where almost all the time goes.
+ *
+ * @return  Index of the first output not yet written (handled by the scalar tail)
+ */
+__attribute__((target("avx2,fma")))
+static size_t normal_fill_avx2(rng_state *rng, double *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        double u1[4], u2[4];
+        for (int k = 0; k < 4; k++) {
+            u1[k] = 1.0 - random_double(rng);
+            u2[k] = random_double(rng);
+        }
+
+        __m256d radius = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_set1_pd(-2.0),
+                                                      v_log(_mm256_loadu_pd(u1))));
+        __m256d sin_t, cos_t;
+        v_sincos_2pi(_mm256_loadu_pd(u2), &sin_t, &cos_t);
+        __m256d z0 = _mm256_mul_pd(radius, cos_t);
+        __m256d z1 = _mm256_mul_pd(radius, sin_t);
+
+        // Interleave to [z0_0, z1_0, z0_1, z1_1 | z0_2, z1_2, z0_3, z1_3]
+        __m256d lo = _mm256_unpacklo_pd(z0, z1);
+        __m256d hi = _mm256_unpackhi_pd(z0, z1);
+        _mm256_storeu_pd(out + i, _mm256_permute2f128_pd(lo, hi, 0x20));
+        _mm256_storeu_pd(out + i + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Fill a buffer with standard normal samples.
+ *
+ * This is the fast path for simulations: unlike normal_random(), which
+ * throws away the sine half of every Box-Muller pair, normal_fill() keeps
+ * both, halving the uniforms and transcendental calls per sample.
+ *
+ * Exactly 2*ceil(n/2) uniforms are drawn, so the stream position after the
+ * call does not depend on which kernel ran. The AVX2 and scalar kernels
+ * produce the same sequence up to last-bit rounding of log/sin/cos.
+ *
+ * @param rng  Stream to draw from
+ * @param out  Output buffer of at least n doubles
+ * @param n    Number of samples to generate
+ */
+void normal_fill(rng_state *rng, double *out, size_t n) {
+    PROFILE_SCOPE(PROFILE_RNG);
+    PROFILE_COUNT(PROFILE_NORMALS, n);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = normal_fill_avx2(rng, out, n);
+    }
+#endif
+    normal_fill_scalar(rng, out, n, i);
+}
+
+/**
+ * Scalar float Box-Muller from output index i onward.
+ *
+ * One 64-bit draw gives both uniforms of a pair: its top 24 bits are U1
+ * and the next 24 bits are U2, the full precision of a float. 1 - U1 is in
+ * (0, 1], so the radius is finite and at most sqrt(48 ln 2) ≈ 5.8: float
+ * shocks are truncated near 5.8σ, where double ones reach about 8.6σ.
+ */
+static void normal_fill_f32_scalar(rng_state *rng, float *out, size_t n, size_t i) {
+    for (; i < n; i += 2) {
+        uint64_t w = rng_next(rng);
+        float u1 = 1.0f - (float)(w >> 40) * 0x1.0p-24f;
+        float u2 = (float)((w >> 16) & 0xFFFFFFu) * 0x1.0p-24f;
+        float radius = sqrtf(-2.0f * logf(u1));
+        float theta = 2.0f * (float)M_PI * u2;
+
+        out[i] = radius * cosf(theta);
+        if (i + 1 < n) {
+            out[i + 1] = radius * sinf(theta);
+        }
+    }
+}
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 float Box-Muller: eight pairs (sixteen normals) per iteration.
+ *
+ * @return  Index of the first output not yet written
+ */
+__attribute__((target("avx2,fma")))
+static size_t normal_fill_f32_avx2(rng_state *rng, float *out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint64_t w[8];
+        for (int k = 0; k < 8; k++) {
+            w[k] = rng_next(rng);
+        }
+
+        // Bits 40-63 and 16-39 of each draw, gathered into eight 32-bit lanes
+        const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        __m256i w_lo = _mm256_loadu_si256((const __m256i *)w);
+        __m256i w_hi = _mm256_loadu_si256((const __m256i *)(w + 4));
+        __m256i mask = _mm256_set1_epi64x(0xFFFFFF);
+        __m256i top = _mm256_permute2x128_si256(
+            _mm256_permutevar8x32_epi32(_mm256_srli_epi64(w_lo, 40), low_halves),
+            _mm256_permutevar8x32_epi32(_mm256_srli_epi64(w_hi, 40), low_halves), 0x20);
+        __m256i mid = _mm256_permute2x128_si256(
+            _mm256_permutevar8x32_epi32(_mm256_and_si256(_mm256_srli_epi64(w_lo, 16), mask), low_halves),
+            _mm256_permutevar8x32_epi32(_mm256_and_si256(_mm256_srli_epi64(w_hi, 16), mask), low_halves), 0x20);
+        const __m256 scale = _mm256_set1_ps(0x1.0p-24f);
+        __m256 u1 = _mm256_fnmadd_ps(_mm256_cvtepi32_ps(top), scale, _mm256_set1_ps(1.0f));
+        __m256 u2 = _mm256_mul_ps(_mm256_cvtepi32_ps(mid), scale);
+
+        __m256 radius = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), v_logf(u1)));
+        __m256 sin_t, cos_t;
+        v_sincos_2pif(u2, &sin_t, &cos_t);
+        __m256 z0 = _mm256_mul_ps(radius, cos_t);
+        __m256 z1 = _mm256_mul_ps(radius, sin_t);
+
+        // Interleave to pair order: [z0_0, z1_0, ..., z0_3, z1_3 | z0_4, z1_4, ..., z0_7, z1_7]
+        __m256 lo = _mm256_unpacklo_ps(z0, z1);
+        __m256 hi = _mm256_unpackhi_ps(z0, z1);
+        _mm256_storeu_ps(out + i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Fill a buffer with single-precision standard normals (float32 engine).
+ *
+ * Half the uniforms of normal_fill() (one 64-bit draw per pair), and the
+ * AVX2 kernel works on eight lanes instead of four. Exactly ceil(n/2)
+ * draws are taken whichever kernel runs.
+ *
+ * @param rng  Stream to draw from
+ * @param out  Output buffer of at least n floats
+ * @param n    Number of samples to generate
+ */
+void normal_fill_f32(rng_state *rng, float *out, size_t n) {
+    PROFILE_SCOPE(PROFILE_RNG);
+    PROFILE_COUNT(PROFILE_NORMALS, n);
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = normal_fill_f32_avx2(rng, out, n);
+    }
+#endif
+    normal_fill_f32_scalar(rng, out, n, i);
+}
@@ -0,0 +1,361 @@
+//
+// Scenario grid pricing
+//
+// A risk grid reprices the same book at, say, 11 spots × 11 vols. Calling
+// the pricer once per grid point regenerates the same normals every time,
+// and with different seeds it would also add independent noise to every
+// point. Here each block of normals is drawn once and reused for every
+// scenario. For GBM only the drift and vol terms depend on the scenario:
+//   S(T) = S0' · exp((r - σ'²/2) T + σ' √T Z)
+// so one exp pass per distinct (σ', r, T) serves every spot shock on it,
+// and each spot shock is just a multiply before the payoff.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include "include/scenario.h"
+#include "include/gbm.h"
+#include "include/rng.h"
+#include "include/parallel.h"
+#include "include/profile.h"
+#include "include/stats.h"
+
+// Paths per inner block (shocks and growth factors stay in L1)
+#define SCENARIO_BLOCK_PATHS 256u
+
+// Chunks per batch: bounds the per-chunk statistics to batch × pairs
+#define SCENARIO_BATCH_CHUNKS 16u
+
+/**
+ * One (scenario, contract) pair with its shocked spot, sorted by the
+ * terminal-distribution key it shares with other pairs.
+ */
+typedef struct {
+    double key[3];              // σ', r, T: pairs with equal keys share one exp pass
+    size_t index;               // s * n_contracts + k
+} scenario_key;
+
+/**
+ * Order pairs by (σ', r, T), then by index (deterministic for any qsort).
+ */
+static int compare_scenario_keys(const void *a, const void *b) {
+    const scenario_key *ka = a;
+    const scenario_key *kb = b;
+    for (int i = 0; i < 3; i++) {
+        if (ka->key[i] < kb->key[i]) return -1;
+        if (ka->key[i] > kb->key[i]) return 1;
+    }
+    return (ka->index > kb->index) - (ka->index < kb->index);
+}
+
+/**
+ * Shared inputs and outputs for one scenario run.
+ */
+typedef struct {
+    size_t n_pairs;             // n_scenarios * n_contracts
+    size_t n_groups;            // Distinct (σ', r, T)
+    const size_t *order;        // Pair indices, grouped by key
+    const size_t *group_begin;  // Group g is order[group_begin[g] .. group_begin[g + 1])
+    const gbm_terminal *growth; // Per group: S0 = 1, so the fill gives e^(drift + vol Z)
+    const double *forward;      // Per group: e^(rT), the control's mean per unit of spot
+    const double *spot;         // Per pair: shocked S0
+    const double *strike;       // Per pair
+    const option_type *type;    // Per pair
+    unsigned variance_reduction;
+    uint32_t n_sim;
+    uint32_t first_chunk;       // Global index of the current batch's chunk 0
+    const rng_state *streams;   // streams[c] = RNG substream of batch chunk c
+    mc_moments *partial;        // partial[c * n_pairs + p] = chunk c, pair p
+} scenario_job;
+
+/**
+ * Scale growth factors to prices and evaluate the payoff in one pass.
+ *
+ * Same arithmetic as payoff_fill() on S0 * growth (K - S equals -(S - K)
+ * exactly), without a second sweep over the block.
+ *
+ * @param S  Receives the prices S0 * growth[i]
+ * @param y  Receives the payoffs
+ */
+static void scenario_payoff(option_type type, double S0, double K, const double *growth, uint32_t n,
+                            double *S, double *y) {
+    double sign = (type == OPTION_PUT) ? -1.0 : 1.0;
+    for (uint32_t i = 0; i < n; i++) {
+        S[i] = S0 * growth[i];
+        double v = sign * (S[i] - K);
+        y[i] = (v > 0.0) ? v : 0.0;
+    }
+}
+
+/**
+ * Simulate one chunk for every scenario and contract.
+ *
+ * The shocks of a block are drawn once. Each distinct terminal
+ * distribution turns them into growth factors once, and every pair on it
+ * scales those by its spot and evaluates its payoff. The scaled prices are
+ * computed exactly as gbm_terminal_fill() would, so an unshocked scenario
+ * reproduces price_european_mc() bit for bit.
+ */
+static void scenario_chunk(void *ctx, uint32_t chunk) {
+    scenario_job *job = ctx;
+    uint32_t begin = (job->first_chunk + chunk) * MC_CHUNK_PATHS;
+    uint32_t count = job->n_sim - begin;
+    if (count > MC_CHUNK_PATHS) {
+        count = MC_CHUNK_PATHS;
+    }
+    PROFILE_SCOPE(PROFILE_CHUNK);
+    PROFILE_COUNT(PROFILE_CHUNKS, 1);
+    PROFILE_COUNT(PROFILE_PATHS, count);
+
+    int antithetic = (job->variance_reduction & MC_VR_ANTITHETIC) != 0;
+    int control = (job->variance_reduction & MC_VR_CONTROL) != 0;
+
+    double z[SCENARIO_BLOCK_PATHS], z_down[SCENARIO_BLOCK_PATHS];
+    double g_up[SCENARIO_BLOCK_PATHS], g_down[SCENARIO_BLOCK_PATHS];
+    double s_up[SCENARIO_BLOCK_PATHS], s_down[SCENARIO_BLOCK_PATHS];
+    double y[SCENARIO_BLOCK_PATHS], y_down[SCENARIO_BLOCK_PATHS], x[SCENARIO_BLOCK_PATHS];
+    rng_state rng = job->streams[chunk];
+
+    mc_moments *m = job->partial + (size_t)chunk * job->n_pairs;
+    for (size_t p = 0; p < job->n_pairs; p++) {
+        m[p] = (mc_moments){0};
+    }
+
+    uint32_t n_samples = antithetic ? (count + 1) / 2 : count;
+    while (n_samples > 0) {
+        uint32_t n = (n_samples < SCENARIO_BLOCK_PATHS) ? n_samples : SCENARIO_BLOCK_PATHS;
+
+        normal_fill(&rng, z, n);
+        if (antithetic) {
+            for (uint32_t i = 0; i < n; i++) {
+                z_down[i] = -z[i];
+            }
+        }
+
+        for (size_t g = 0; g < job->n_groups; g++) {
+            gbm_terminal_fill(&job->growth[g], z, g_up, n);
+            if (antithetic) {
+                gbm_terminal_fill(&job->growth[g], z_down, g_down, n);
+            }
+
+            for (size_t q = job->group_begin[g]; q < job->group_begin[g + 1]; q++) {
+                size_t p = job->order[q];
+                double S0 = job->spot[p];
+                scenario_payoff(job->type[p], S0, job->strike[p], g_up, n, s_up, y);
+                if (antithetic) {
+                    scenario_payoff(job->type[p], S0, job->strike[p], g_down, n, s_down, y_down);
+                    for (uint32_t i = 0; i < n; i++) {
+                        y[i] = 0.5 * (y[i] + y_down[i]);
+                    }
+                }
+                // Control variate: S(T) minus its exact mean, as in the chain engine
+                if (control) {
+                    double forward = S0 * job->forward[g];
+                    for (uint32_t i = 0; i < n; i++) {
+                        double ST = antithetic ? 0.5 * (s_up[i] + s_down[i]) : s_up[i];
+                        x[i] = ST - forward;
+                    }
+                }
+                moments_add_block(&m[p], y, control ? x : NULL, n);
+            }
+        }
+        n_samples -= n;
+    }
+}
+
+/**
+ * Fill a dense spot × vol grid of shocks.
+ *
+ * @param spot_shifts  Relative spot moves (e.g. -0.1 for -10%)
+ * @param n_spot       Number of spot moves
+ * @param vol_shifts   Absolute vol moves (e.g. 0.05 for +5 vol points)
+ * @param n_vol        Number of vol moves
+ * @param out          Receives n_spot * n_vol shocks, spot-major
+ */
+void scenario_grid(const double *spot_shifts, size_t n_spot, const double *vol_shifts, size_t n_vol,
+                   scenario_shock *out) {
+    for (size_t i = 0; i < n_spot; i++) {
+        for (size_t j = 0; j < n_vol; j++) {
+            out[i * n_vol + j] = (scenario_shock){ spot_shifts[i], vol_shifts[j] };
+        }
+    }
+}
+
+/**
+ * Price a book of European contracts under every scenario of a grid.
+ *
+ * All scenarios and contracts share one set of normal shocks per chunk
+ * (contract k under scenario s sees exactly the paths of the base run,
+ * moved to the shocked S0 and σ), so a scenario P&L is the repricing
+ * difference alone, without the noise of two independent simulations.
+ * The cost is one normal draw per path, one exp pass per distinct
+ * (σ', r, T) and one multiply-and-payoff pass per (scenario, contract).
+ *
+ * Chunking, substreams and the chunk-order reduction are those of the
+ * European engine: results do not depend on the thread count, and an
+ * unshocked scenario equals price_european_mc() with the same options.
+ * Antithetic pairs and the S(T) control variate are supported. Every
+ * scenario runs the full opts->n_sim paths (tolerances are ignored, since
+ * stopping scenarios at different points would break the common random
+ * numbers), and only the pseudo-random sampler is supported.
+ *
+ * @param contracts    Book to reprice
+ * @param n_contracts  Number of contracts
+ * @param shocks       Scenarios (S0 and σ moves applied to every contract)
+ * @param n_scenarios  Number of scenarios
+ * @param opts         Engine options
+ * @param results      Receives n_scenarios * n_contracts results, scenario-major
+ * @return             0 on success, -1 on invalid input (shocked S0 <= 0 or σ < 0) or out of memory
+ */
+int price_scenarios_mc(
+    const option_contract *contracts,
+    size_t n_contracts,
+    const scenario_shock *shocks,
+    size_t n_scenarios,
+    const mc_options *opts,
+    mc_result *results
+) {
+    size_t n_pairs = n_scenarios * n_contracts;
+    if (n_pairs == 0) {
+        return 0;
+    }
+    for (size_t p = 0; p < n_pairs; p++) {
+        results[p] = (mc_result){ NAN, NAN, 0 };
+    }
+    if (opts->n_sim == 0 || opts->sampler != MC_SAMPLER_PSEUDO) {
+        return -1;
+    }
+
+    uint32_t n_chunks = (uint32_t)(((uint64_t)opts->n_sim + MC_CHUNK_PATHS - 1) / MC_CHUNK_PATHS);
+    uint32_t batch_chunks = (n_chunks < SCENARIO_BATCH_CHUNKS) ? n_chunks : SCENARIO_BATCH_CHUNKS;
+
+    scenario_key *keys = malloc(n_pairs * sizeof(*keys));
+    size_t *order = malloc(n_pairs * sizeof(*order));
+    size_t *group_begin = malloc((n_pairs + 1) * sizeof(*group_begin));
+    gbm_terminal *growth = malloc(n_pairs * sizeof(*growth));
+    double *forward = malloc(n_pairs * sizeof(*forward));
+    double *spot = malloc(n_pairs * sizeof(*spot));
+    double *strike = malloc(n_pairs * sizeof(*strike));
+    option_type *type = malloc(n_pairs * sizeof(*type));
+    rng_state *streams = malloc(batch_chunks * sizeof(*streams));
+    mc_moments *partial = malloc((size_t)batch_chunks * n_pairs * sizeof(*partial));
+    mc_moments *totals = calloc(n_pairs, sizeof(*totals));
+    int status = -1;
+    if (!keys || !order || !group_begin || !growth || !forward || !spot || !strike || !type
+        || !streams || !partial || !totals) {
+        free(keys);
+        free(order);
+        free(group_begin);
+        free(growth);
+        free(forward);
+        free(spot);
+        free(strike);
+        free(type);
+        free(streams);
+        free(partial);
+        free(totals);
+        return status;
+    }
+
+    int valid = 1;
+    for (size_t s = 0; s < n_scenarios; s++) {
+        for (size_t k = 0; k < n_contracts; k++) {
+            const stock_params *stock = &contracts[k].stock;
+            size_t p = s * n_contracts + k;
+            spot[p] = stock->initial_price * (1.0 + shocks[s].spot_shift);
+            strike[p] = contracts[k].strike;
+            type[p] = contracts[k].type;
+            double sigma = stock->volatility + shocks[s].vol_shift;
+            valid &= (spot[p] > 0.0) && (sigma >= 0.0);
+            keys[p] = (scenario_key){ { sigma, stock->interest_rate, stock->maturity }, p };
+        }
+    }
+
+    if (valid) {
+        qsort(keys, n_pairs, sizeof(*keys), compare_scenario_keys);
+        size_t n_groups = 0;
+        for (size_t q = 0; q < n_pairs; q++) {
+            const double *key = keys[q].key;
+            if (q == 0 || key[0] != keys[q - 1].key[0] || key[1] != keys[q - 1].key[1]
+                || key[2] != keys[q - 1].key[2]) {
+                group_begin[n_groups] = q;
+                growth[n_groups] = gbm_terminal_init(1.0, key[1], key[0], key[2]);
+                forward[n_groups] = exp(key[1] * key[2]);
+                n_groups++;
+            }
+            order[q] = keys[q].index;
+        }
+        group_begin[n_groups] = n_pairs;
+
+        scenario_job job = {
+            .n_pairs = n_pairs,
+            .n_groups = n_groups,
+            .order = order,
+            .group_begin = group_begin,
+            .growth = growth,
+            .forward = forward,
+            .spot = spot,
+            .strike = strike,
+            .type = type,
+            .variance_reduction = opts->variance_reduction,
+            .n_sim = opts->n_sim,
+            .streams = streams,
+            .partial = partial
+        };
+
+        rng_state rng;
+        rng_seed(&rng, opts->seed);
+        for (uint32_t done = 0; done < n_chunks; ) {
+            uint32_t batch = n_chunks - done;
+            if (batch > batch_chunks) {
+                batch = batch_chunks;
+            }
+            for (uint32_t c = 0; c < batch; c++) {
+                streams[c] = rng;
+                rng_jump(&rng);
+            }
+
+            job.first_chunk = done;
+            parallel_for(batch, opts->n_threads, scenario_chunk, &job);
+            PROFILE_COUNT(PROFILE_BATCHES, 1);
+            done += batch;
+
+            // Deterministic reduction: always in chunk order
+            for (size_t p = 0; p < n_pairs; p++) {
+                for (uint32_t c = 0; c < batch; c++) {
+                    moments_merge(&totals[p], &partial[(size_t)c * n_pairs + p]);
+                }
+            }
+        }
+
+        for (size_t p = 0; p < n_pairs; p++) {
+            const stock_params *stock = &contracts[p % n_contracts].stock;
+            double discount = exp(-stock->interest_rate * stock->maturity);
+            double mean, variance;
+            if (opts->variance_reduction & MC_VR_CONTROL) {
+                moments_control(&totals[p], &mean, &variance);
+            } else {
+                mean = moments_mean(&totals[p]);
+                variance = moments_variance(&totals[p]);
+            }
+            results[p].price = discount * mean;
+            results[p].std_error = discount * sqrt(variance / (double)totals[p].n);
+            // An antithetic sample is a pair of paths
+            results[p].n_paths = (opts->variance_reduction & MC_VR_ANTITHETIC) ? 2 * totals[p].n : totals[p].n;
+        }
+        status = 0;
+    }
+
+    free(keys);
+    free(order);
+    free(group_begin);
+    free(growth);
+    free(forward);
+    free(spot);
+    free(strike);
+    free(type);
+    free(streams);
+    free(partial);
+    free(totals);
+    return status;
+}
@@ -0,0 +1,999 @@
+//
+// Pricing Server
+// Unix-socket daemon that coalesces small pricing requests into batched
+// chain calls (see server.h).
+//
+// One event thread owns the socket: it reads whole request records into
+// the pending batch, and once the first of them has waited window_us (or
+// the batch is full) it sorts the batch by group key, hands the groups to
+// the worker pool, and queues each connection's replies. Client sockets
+// are non-blocking: the event thread writes what a socket takes, keeps
+// the rest in that connection's output buffer until pselect() reports it
+// writable, and goes on reading requests meanwhile, so a client that
+// writes a large burst before reading, or stops reading altogether, never
+// stalls the loop. A connection whose queue passes max_backlog replies is
+// dropped.
+// The workers are created once in pricing_server_open() and sleep on a
+// condition variable between batches; every buffer a batch needs is
+// allocated up front for max_batch requests. Each pricing thread also owns
+// an engine context (mc_engine) sized for max_batch contracts of
+// default_n_sim paths, so a batch of such requests never allocates; only
+// larger requests (up to max_n_sim, which bounds how long one request can
+// hold up its batch) fall back to the allocating chain call. Output buffers
+// grow (and then keep their size) only when a client falls behind.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "include/server.h"
+#include "include/monte_carlo.h"
+#include "include/option.h"
+#include "include/parallel.h"
+
+_Static_assert(sizeof(pricing_request) == 64, "pricing_request is 64 bytes on the wire");
+_Static_assert(sizeof(pricing_reply) == 40, "pricing_reply is 40 bytes on the wire");
+
+// Most simultaneous client connections
+#define SERVER_MAX_CLIENTS 64u
+
+// Most bytes taken from one connection per read
+#define SERVER_READ_BYTES 65536u
+
+// Replies an output buffer is first sized for
+#define SERVER_OUT_INITIAL 256u
+
+// How long a stopping server keeps writing queued replies to slow readers
+#define SERVER_DRAIN_SECONDS 1.0
+
+typedef struct {
+    int fd;                                     // -1 = free slot
+    uint64_t serial;                            // Tells a reused slot from the connection it replaced
+    size_t partial;                             // Bytes of an incomplete request in buf
+    unsigned char buf[sizeof(pricing_request)];
+    unsigned char *out;                         // Queued reply bytes: [out_sent, out_len) still unsent
+    size_t out_sent;
+    size_t out_len;
+    size_t out_cap;                             // Kept across connections of the slot
+} server_conn;
+
+// A request waiting in the current batch
+typedef struct {
+    pricing_request req;
+    uint32_t conn;                              // Slot in conns
+    uint64_t serial;                            // Connection it came from
+    double t_recv;                              // When its last byte was read
+} server_pending;
+
+// What requests must share to be priced from one set of paths
+typedef struct {
+    double S0, r, sigma, T;
+    uint64_t seed;
+    uint32_t n_sim;
+    uint32_t variance_reduction;
+    uint32_t index;                             // Position in the pending batch
+} server_key;
+
+// Requests pending[order[begin..end)] form one engine call
+typedef struct {
+    uint32_t begin, end;
+} server_group;
+
+// Per-thread chain arguments, max_batch entries each, and the thread's engine
+typedef struct {
+    option_type *types;
+    double *strikes;
+    mc_result *results;
+    mc_engine engine;
+} server_scratch;
+
+struct pricing_server {
+    pricing_server_config config;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int listen_fd;
+    int wake[2];                                // Self-pipe that interrupts the event loop
+    atomic_int stopping;
+    server_conn conns[SERVER_MAX_CLIENTS];
+    uint64_t next_serial;
+
+    // The batch being collected (event thread only, read by workers while priced)
+    server_pending *pending;
+    uint32_t n_pending;
+    double batch_start;
+    server_key *keys;
+    uint32_t *order;
+    server_group *groups;
+    uint32_t n_groups;
+    pricing_reply *replies;                     // replies[i] answers pending[i]
+    pricing_reply *out;                         // One connection's replies, ready to send
+    unsigned char *read_buf;
+
+    // Worker pool: n_threads - 1 workers plus the event thread
+    unsigned n_threads;
+    pthread_t *workers;
+    unsigned n_workers;
+    server_scratch *scratch;                    // [n_threads]; 0 is the event thread's
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+    uint64_t generation;                        // Bumped for every batch handed to the pool
+    unsigned busy;                              // Workers still on the current batch
+    int shutdown;
+    atomic_uint next_group;
+
+    pthread_t runner;                           // pricing_server_start()'s thread
+    int runner_started;
+    int run_status;
+
+    // Statistics (stats_lock: pricing_server_get_stats() may run on any thread)
+    pthread_mutex_t stats_lock;
+    uint64_t n_requests;
+    uint64_t n_batches;
+    uint64_t n_groups_total;
+    double *latency;                            // Ring of the last PRICING_LATENCY_SAMPLES, seconds
+    uint64_t n_latency;
+    double next_report;
+};
+
+/**
+ * Monotonic wall-clock time in seconds.
+ */
+static double server_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/**
+ * Defaults: all cores, a 200 µs window, batches of up to 4096 requests,
+ * 100000 paths when a request does not say, at most 10^6 paths per
+ * request (a few milliseconds on one core), and up to 2^18 replies
+ * (10 MB) queued for a client before it is dropped.
+ */
+pricing_server_config pricing_server_config_default(void) {
+    pricing_server_config config = {
+        .socket_path = NULL,
+        .n_threads = 0,
+        .window_us = 200,
+        .max_batch = 4096,
+        .default_n_sim = 100000u,
+        .max_n_sim = 1000000u,
+        .max_backlog = 1u << 18,
+        .report_seconds = 0.0
+    };
+    return config;
+}
+
+/**
+ * Whether a request can be priced at all (anything else gets status -1).
+ */
+static int server_request_valid(const pricing_server_config *config, const pricing_request *req) {
+    if (req->type != OPTION_CALL && req->type != OPTION_PUT) return 0;
+    if (req->reserved != 0 || (req->variance_reduction & ~(MC_VR_ANTITHETIC | MC_VR_CONTROL))) return 0;
+    if (req->n_sim > config->max_n_sim) return 0;
+    if (!isfinite(req->S0) || !isfinite(req->K) || !isfinite(req->r)) return 0;
+    if (!isfinite(req->sigma) || !isfinite(req->T)) return 0;
+    return req->S0 > 0.0 && req->K > 0.0 && req->sigma > 0.0 && req->T > 0.0;
+}
+
+/**
+ * Order keys by group, then by arrival, so each group is contiguous and
+ * keeps its requests in the order they came in.
+ */
+static int server_key_compare(const void *pa, const void *pb) {
+    const server_key *a = pa, *b = pb;
+    if (a->S0 != b->S0) return (a->S0 < b->S0) ? -1 : 1;
+    if (a->r != b->r) return (a->r < b->r) ? -1 : 1;
+    if (a->sigma != b->sigma) return (a->sigma < b->sigma) ? -1 : 1;
+    if (a->T != b->T) return (a->T < b->T) ? -1 : 1;
+    if (a->seed != b->seed) return (a->seed < b->seed) ? -1 : 1;
+    if (a->n_sim != b->n_sim) return (a->n_sim < b->n_sim) ? -1 : 1;
+    if (a->variance_reduction != b->variance_reduction) return (a->variance_reduction < b->variance_reduction) ? -1 : 1;
+    return (a->index < b->index) ? -1 : (a->index > b->index);
+}
+
+/**
+ * Whether two keys belong to the same group (arrival order aside).
+ */
+static int server_key_same_group(const server_key *a, const server_key *b) {
+    return a->S0 == b->S0 && a->r == b->r && a->sigma == b->sigma && a->T == b->T && a->seed == b->seed
+           && a->n_sim == b->n_sim && a->variance_reduction == b->variance_reduction;
+}
+
+/**
+ * Price one group as a chain, single-threaded, into the batch's replies.
+ */
+static void server_price_group(pricing_server *srv, server_scratch *scratch, const server_group *g) {
+    const pricing_request *first = &srv->pending[srv->order[g->begin]].req;
+    size_t n = g->end - g->begin;
+    for (size_t k = 0; k < n; k++) {
+        const pricing_request *req = &srv->pending[srv->order[g->begin + k]].req;
+        scratch->types[k] = (option_type)req->type;
+        scratch->strikes[k] = req->K;
+    }
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = first->n_sim ? first->n_sim : srv->config.default_n_sim;
+    opts.seed = first->seed;
+    opts.n_threads = 1;
+    opts.variance_reduction = first->variance_reduction;
+    int status = mc_engine_fits(&scratch->engine, n, &opts, 0)
+        ? mc_engine_price_chain(&scratch->engine, first->S0, first->r, first->sigma, first->T, scratch->types,
+                                scratch->strikes, n, &opts, scratch->results, NULL, NULL)
+        : price_european_chain_mc(first->S0, first->r, first->sigma, first->T, scratch->types,
+                                  scratch->strikes, n, &opts, scratch->results);
+
+    for (size_t k = 0; k < n; k++) {
+        uint32_t i = srv->order[g->begin + k];
+        const mc_result *res = &scratch->results[k];
+        srv->replies[i] = (pricing_reply){
+            .id = srv->pending[i].req.id,
+            .price = res->price,
+            .std_error = res->std_error,
+            .n_paths = res->n_paths,
+            .status = (status == 0 && !isnan(res->price)) ? 0 : -1,
+            .group_size = (uint32_t)n
+        };
+    }
+}
+
+/**
+ * Claim groups of the current batch until none are left.
+ */
+static void server_work(pricing_server *srv, server_scratch *scratch) {
+    for (;;) {
+        uint32_t g = atomic_fetch_add(&srv->next_group, 1u);
+        if (g >= srv->n_groups) {
+            break;
+        }
+        server_price_group(srv, scratch, &srv->groups[g]);
+    }
+}
+
+typedef struct {
+    pricing_server *srv;
+    unsigned index;
+} server_worker_arg;
+
+/**
+ * Worker thread: sleep until a batch is handed out, help price it, repeat.
+ */
+static void *server_worker(void *arg) {
+    server_worker_arg *wa = arg;
+    pricing_server *srv = wa->srv;
+    server_scratch *scratch = &srv->scratch[wa->index];
+    free(wa);
+
+    pthread_mutex_lock(&srv->lock);
+    uint64_t seen = srv->generation;
+    for (;;) {
+        while (!srv->shutdown && srv->generation == seen) {
+            pthread_cond_wait(&srv->work_cv, &srv->lock);
+        }
+        if (srv->shutdown) {
+            break;
+        }
+        seen = srv->generation;
+        pthread_mutex_unlock(&srv->lock);
+        server_work(srv, scratch);
+        pthread_mutex_lock(&srv->lock);
+        if (--srv->busy == 0) {
+            pthread_cond_signal(&srv->done_cv);
+        }
+    }
+    pthread_mutex_unlock(&srv->lock);
+    return NULL;
+}
+
+/**
+ * Write all n bytes to a socket (no SIGPIPE if the peer has gone).
+ *
+ * @return  0, or -1 on error
+ */
+static int server_send_all(int fd, const void *data, size_t n) {
+    const unsigned char *p = data;
+    while (n > 0) {
+        ssize_t sent = send(fd, p, n, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += sent;
+        n -= (size_t)sent;
+    }
+    return 0;
+}
+
+/**
+ * Release a connection slot. Its requests already in the batch are
+ * still priced but their replies are dropped.
+ */
+static void server_drop_conn(server_conn *c) {
+    close(c->fd);
+    c->fd = -1;
+    c->partial = 0;
+    c->out_sent = 0;
+    c->out_len = 0;
+}
+
+/**
+ * Write as much of a connection's queued replies as its socket takes now.
+ *
+ * @return  0 (even if some are left for later), or -1 if the connection
+ *          failed and was dropped
+ */
+static int server_write(server_conn *c) {
+    while (c->out_sent < c->out_len) {
+        ssize_t sent = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            server_drop_conn(c);
+            return -1;
+        }
+        c->out_sent += (size_t)sent;
+    }
+    c->out_sent = 0;
+    c->out_len = 0;
+    return 0;
+}
+
+/**
+ * Append replies to a connection's output buffer. A client that lets more
+ * than max_backlog replies pile up is not reading, and is dropped.
+ *
+ * @return  0, or -1 if the connection was dropped
+ */
+static int server_queue(pricing_server *srv, server_conn *c, const pricing_reply *replies, uint32_t n) {
+    size_t queued = c->out_len - c->out_sent;
+    size_t bytes = (size_t)n * sizeof(*replies);
+    if (queued + bytes > (size_t)srv->config.max_backlog * sizeof(*replies)) {
+        server_drop_conn(c);
+        return -1;
+    }
+    if (c->out_sent > 0) {
+        memmove(c->out, c->out + c->out_sent, queued);
+        c->out_sent = 0;
+        c->out_len = queued;
+    }
+    if (queued + bytes > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : SERVER_OUT_INITIAL * sizeof(*replies);
+        while (cap < queued + bytes) {
+            cap *= 2;
+        }
+        unsigned char *grown = realloc(c->out, cap);
+        if (!grown) {
+            server_drop_conn(c);
+            return -1;
+        }
+        c->out = grown;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, replies, bytes);
+    c->out_len += bytes;
+    return 0;
+}
+
+/**
+ * Price the pending batch and queue every reply (written now if the
+ * sockets take it).
+ */
+static void server_flush(pricing_server *srv) {
+    uint32_t n = srv->n_pending, n_keys = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const pricing_request *req = &srv->pending[i].req;
+        if (!server_request_valid(&srv->config, req)) {
+            srv->replies[i] = (pricing_reply){ .id = req->id, .price = NAN, .std_error = NAN, .status = -1 };
+            continue;
+        }
+        srv->keys[n_keys++] = (server_key){
+            req->S0, req->r, req->sigma, req->T, req->seed,
+            req->n_sim ? req->n_sim : srv->config.default_n_sim,
+            req->variance_reduction, i
+        };
+    }
+    qsort(srv->keys, n_keys, sizeof(*srv->keys), server_key_compare);
+    srv->n_groups = 0;
+    for (uint32_t j = 0; j < n_keys; j++) {
+        srv->order[j] = srv->keys[j].index;
+        if (j == 0 || !server_key_same_group(&srv->keys[j - 1], &srv->keys[j])) {
+            srv->groups[srv->n_groups++] = (server_group){ j, j + 1 };
+        } else {
+            srv->groups[srv->n_groups - 1].end = j + 1;
+        }
+    }
+
+    // Hand the groups to the pool and work alongside it
+    atomic_store(&srv->next_group, 0u);
+    pthread_mutex_lock(&srv->lock);
+    srv->generation++;
+    srv->busy = srv->n_workers;
+    pthread_cond_broadcast(&srv->work_cv);
+    pthread_mutex_unlock(&srv->lock);
+    server_work(srv, &srv->scratch[0]);
+    pthread_mutex_lock(&srv->lock);
+    while (srv->busy > 0) {
+        pthread_cond_wait(&srv->done_cv, &srv->lock);
+    }
+    pthread_mutex_unlock(&srv->lock);
+
+    // One queue append per connection, its replies in arrival order
+    uint64_t n_sent = 0;
+    for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        server_conn *conn = &srv->conns[c];
+        if (conn->fd < 0) continue;
+        uint32_t n_out = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (srv->pending[i].conn == c && srv->pending[i].serial == conn->serial) {
+                srv->out[n_out++] = srv->replies[i];
+            }
+        }
+        if (n_out == 0) continue;
+        if (server_queue(srv, conn, srv->out, n_out) != 0 || server_write(conn) != 0) {
+            continue;
+        }
+        double now = server_now();
+        pthread_mutex_lock(&srv->stats_lock);
+        for (uint32_t i = 0; i < n; i++) {
+            if (srv->pending[i].conn == c && srv->pending[i].serial == conn->serial) {
+                srv->latency[srv->n_latency++ % PRICING_LATENCY_SAMPLES] = now - srv->pending[i].t_recv;
+            }
+        }
+        pthread_mutex_unlock(&srv->stats_lock);
+        n_sent += n_out;
+    }
+
+    pthread_mutex_lock(&srv->stats_lock);
+    srv->n_requests += n_sent;
+    srv->n_batches++;
+    srv->n_groups_total += srv->n_groups;
+    pthread_mutex_unlock(&srv->stats_lock);
+    srv->n_pending = 0;
+}
+
+/**
+ * Append one complete request to the batch.
+ */
+static void server_push(pricing_server *srv, uint32_t c, const unsigned char *bytes, double t) {
+    server_pending *p = &srv->pending[srv->n_pending];
+    memcpy(&p->req, bytes, sizeof(p->req));
+    p->conn = c;
+    p->serial = srv->conns[c].serial;
+    p->t_recv = t;
+    if (srv->n_pending == 0) {
+        srv->batch_start = t;
+    }
+    srv->n_pending++;
+}
+
+/**
+ * Read what a readable connection has, up to the room left in the batch,
+ * and queue every complete request. A short read keeps its tail bytes
+ * for the next one.
+ */
+static void server_read(pricing_server *srv, uint32_t c) {
+    server_conn *conn = &srv->conns[c];
+    size_t room = (size_t)(srv->config.max_batch - srv->n_pending) * sizeof(pricing_request) - conn->partial;
+    if (room > SERVER_READ_BYTES) {
+        room = SERVER_READ_BYTES;
+    }
+    if (room == 0) {
+        return;
+    }
+    ssize_t got = read(conn->fd, srv->read_buf, room);
+    if (got < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    if (got <= 0) {
+        server_drop_conn(conn);
+        return;
+    }
+
+    double t = server_now();
+    const unsigned char *p = srv->read_buf;
+    size_t left = (size_t)got;
+    if (conn->partial > 0) {
+        size_t need = sizeof(pricing_request) - conn->partial;
+        size_t take = (left < need) ? left : need;
+        memcpy(conn->buf + conn->partial, p, take);
+        conn->partial += take;
+        p += take;
+        left -= take;
+        if (conn->partial < sizeof(pricing_request)) {
+            return;
+        }
+        server_push(srv, c, conn->buf, t);
+        conn->partial = 0;
+    }
+    for (; left >= sizeof(pricing_request); p += sizeof(pricing_request), left -= sizeof(pricing_request)) {
+        server_push(srv, c, p, t);
+    }
+    memcpy(conn->buf, p, left);
+    conn->partial = left;
+}
+
+/**
+ * Take a new connection (non-blocking), or turn it away if every slot is in use.
+ */
+static void server_accept(pricing_server *srv) {
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        close(fd);
+        return;
+    }
+    for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        if (srv->conns[c].fd < 0 && fd < FD_SETSIZE) {
+            srv->conns[c].fd = fd;
+            srv->conns[c].serial = ++srv->next_serial;
+            srv->conns[c].partial = 0;
+            return;
+        }
+    }
+    close(fd);
+}
+
+/**
+ * Print one stats line to stderr.
+ */
+static void server_report(pricing_server *srv) {
+    pricing_server_stats st;
+    pricing_server_get_stats(srv, &st);
+    fprintf(stderr, "pricing server: %llu requests in %llu batches (%llu engine calls), "
+            "latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+            (unsigned long long)st.n_requests, (unsigned long long)st.n_batches,
+            (unsigned long long)st.n_groups, st.p50_us, st.p99_us, st.max_us);
+}
+
+/**
+ * After the last batch: keep writing queued replies for up to
+ * SERVER_DRAIN_SECONDS, so clients still reading get every answer.
+ */
+static void server_drain(pricing_server *srv) {
+    double deadline = server_now() + SERVER_DRAIN_SECONDS;
+    for (;;) {
+        fd_set writable;
+        FD_ZERO(&writable);
+        int max_fd = -1;
+        for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+            const server_conn *conn = &srv->conns[c];
+            if (conn->fd >= 0 && conn->out_sent < conn->out_len) {
+                FD_SET(conn->fd, &writable);
+                if (conn->fd > max_fd) max_fd = conn->fd;
+            }
+        }
+        double wait = deadline - server_now();
+        if (max_fd < 0 || wait <= 0.0) {
+            return;
+        }
+        struct timespec timeout = { (time_t)wait, (long)(1e9 * (wait - (double)(time_t)wait)) };
+        int ready = pselect(max_fd + 1, NULL, &writable, NULL, &timeout, NULL);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        for (uint32_t c = 0; ready > 0 && c < SERVER_MAX_CLIENTS; c++) {
+            server_conn *conn = &srv->conns[c];
+            if (conn->fd >= 0 && FD_ISSET(conn->fd, &writable)) {
+                server_write(conn);
+            }
+        }
+    }
+}
+
+/**
+ * Event loop: accept, read, flush a batch once its first request has
+ * waited window_us or it is full, and write queued replies to sockets
+ * that have room. Pending requests are answered on stop.
+ *
+ * @param srv  Server from pricing_server_open()
+ * @return     0 after pricing_server_stop(), or -1 if waiting on the sockets fails
+ */
+int pricing_server_run(pricing_server *srv) {
+    double window = 1e-6 * srv->config.window_us;
+    srv->next_report = server_now() + srv->config.report_seconds;
+    int status = 0;
+
+    while (!atomic_load(&srv->stopping)) {
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(srv->listen_fd, &readable);
+        FD_SET(srv->wake[0], &readable);
+        int max_fd = (srv->listen_fd > srv->wake[0]) ? srv->listen_fd : srv->wake[0];
+        for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+            if (srv->conns[c].fd >= 0) {
+                FD_SET(srv->conns[c].fd, &readable);
+                if (srv->conns[c].out_sent < srv->conns[c].out_len) {
+                    FD_SET(srv->conns[c].fd, &writable);
+                }
+                if (srv->conns[c].fd > max_fd) max_fd = srv->conns[c].fd;
+            }
+        }
+
+        // Sleep until input, the end of the batch window, or the next report
+        double now = server_now(), wait = -1.0;
+        if (srv->n_pending > 0) {
+            wait = srv->batch_start + window - now;
+        }
+        if (srv->config.report_seconds > 0.0) {
+            double until_report = srv->next_report - now;
+            if (wait < 0.0 || until_report < wait) wait = until_report;
+        }
+        struct timespec timeout, *tp = NULL;
+        if (wait >= 0.0 || srv->n_pending > 0) {
+            if (wait < 0.0) wait = 0.0;
+            timeout.tv_sec = (time_t)wait;
+            timeout.tv_nsec = (long)(1e9 * (wait - (double)timeout.tv_sec));
+            tp = &timeout;
+        }
+        int ready = pselect(max_fd + 1, &readable, &writable, NULL, tp, NULL);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            status = -1;
+            break;
+        }
+
+        if (ready > 0) {
+            if (FD_ISSET(srv->wake[0], &readable)) {
+                char drain[64];
+                ssize_t rc = read(srv->wake[0], drain, sizeof(drain));
+                (void)rc;
+            }
+            if (FD_ISSET(srv->listen_fd, &readable)) {
+                server_accept(srv);
+            }
+            for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+                server_conn *conn = &srv->conns[c];
+                if (conn->fd >= 0 && FD_ISSET(conn->fd, &writable)) {
+                    server_write(conn);
+                }
+            }
+            for (uint32_t c = 0; c < SERVER_MAX_CLIENTS && srv->n_pending < srv->config.max_batch; c++) {
+                if (srv->conns[c].fd >= 0 && FD_ISSET(srv->conns[c].fd, &readable)) {
+                    server_read(srv, c);
+                }
+            }
+        }
+
+        now = server_now();
+        if (srv->n_pending > 0 && (srv->n_pending >= srv->config.max_batch || now >= srv->batch_start + window)) {
+            server_flush(srv);
+        }
+        if (srv->config.report_seconds > 0.0 && now >= srv->next_report) {
+            server_report(srv);
+            srv->next_report = now + srv->config.report_seconds;
+        }
+    }
+
+    if (srv->n_pending > 0) {
+        server_flush(srv);
+    }
+    server_drain(srv);
+    return status;
+}
+
+static void *server_runner(void *arg) {
+    pricing_server *srv = arg;
+    srv->run_status = pricing_server_run(srv);
+    return NULL;
+}
+
+/**
+ * Serve on a background thread (stopped and joined by pricing_server_close()).
+ *
+ * @return  0, or -1 if the thread cannot be created or is already running
+ */
+int pricing_server_start(pricing_server *srv) {
+    if (srv->runner_started || pthread_create(&srv->runner, NULL, server_runner, srv) != 0) {
+        return -1;
+    }
+    srv->runner_started = 1;
+    return 0;
+}
+
+/**
+ * Ask the event loop to stop: a flag plus one byte down the self-pipe,
+ * both async-signal-safe.
+ */
+void pricing_server_stop(pricing_server *srv) {
+    atomic_store(&srv->stopping, 1);
+    ssize_t rc = write(srv->wake[1], "", 1);
+    (void)rc;
+}
+
+/**
+ * Bind a Unix stream socket. A socket file nobody is listening on is left
+ * over from a server that died, and is replaced; a live one is not.
+ *
+ * @return  Listening descriptor, or -1
+ */
+static int server_listen(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (errno != EADDRINUSE) {
+            close(fd);
+            return -1;
+        }
+        int probe = pricing_client_connect(path);
+        if (probe >= 0) {
+            // A live server owns the path
+            pricing_client_close(probe);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Free everything pricing_server_open() set up (threads already joined).
+ */
+static void server_free(pricing_server *srv) {
+    for (unsigned t = 0; srv->scratch && t < srv->n_threads; t++) {
+        free(srv->scratch[t].types);
+        free(srv->scratch[t].strikes);
+        free(srv->scratch[t].results);
+        mc_engine_free(&srv->scratch[t].engine);
+    }
+    for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        free(srv->conns[c].out);
+    }
+    free(srv->scratch);
+    free(srv->workers);
+    free(srv->pending);
+    free(srv->keys);
+    free(srv->order);
+    free(srv->groups);
+    free(srv->replies);
+    free(srv->out);
+    free(srv->read_buf);
+    free(srv->latency);
+    free(srv);
+}
+
+/**
+ * Validate the configuration, allocate every batch buffer, bind the
+ * socket and start the worker threads.
+ *
+ * @param config  Server settings (socket_path is copied)
+ * @return        The server, or NULL on invalid configuration or failure
+ */
+pricing_server *pricing_server_open(const pricing_server_config *config) {
+    if (!config || !config->socket_path || config->max_batch == 0 || config->default_n_sim == 0
+        || config->max_n_sim < config->default_n_sim || config->max_backlog < config->max_batch
+        || !(config->report_seconds >= 0.0)) {
+        return NULL;
+    }
+    pricing_server *srv = calloc(1, sizeof(*srv));
+    if (!srv) {
+        return NULL;
+    }
+    size_t path_len = strlen(config->socket_path);
+    if (path_len == 0 || path_len >= sizeof(srv->path)) {
+        free(srv);
+        return NULL;
+    }
+    memcpy(srv->path, config->socket_path, path_len + 1);
+    srv->config = *config;
+    srv->config.socket_path = srv->path;
+    srv->n_threads = config->n_threads ? config->n_threads : parallel_default_threads();
+    atomic_init(&srv->stopping, 0);
+    atomic_init(&srv->next_group, 0u);
+    for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        srv->conns[c].fd = -1;
+    }
+
+    size_t m = config->max_batch;
+    srv->pending = malloc(m * sizeof(*srv->pending));
+    srv->keys = malloc(m * sizeof(*srv->keys));
+    srv->order = malloc(m * sizeof(*srv->order));
+    srv->groups = malloc(m * sizeof(*srv->groups));
+    srv->replies = malloc(m * sizeof(*srv->replies));
+    srv->out = malloc(m * sizeof(*srv->out));
+    srv->read_buf = malloc(SERVER_READ_BYTES);
+    srv->latency = malloc(PRICING_LATENCY_SAMPLES * sizeof(*srv->latency));
+    srv->scratch = calloc(srv->n_threads, sizeof(*srv->scratch));
+    srv->workers = malloc(srv->n_threads * sizeof(*srv->workers));
+    int ok = srv->pending && srv->keys && srv->order && srv->groups && srv->replies && srv->out
+             && srv->read_buf && srv->latency && srv->scratch && srv->workers;
+    for (unsigned t = 0; ok && t < srv->n_threads; t++) {
+        srv->scratch[t].types = malloc(m * sizeof(option_type));
+        srv->scratch[t].strikes = malloc(m * sizeof(double));
+        srv->scratch[t].results = malloc(m * sizeof(mc_result));
+        ok = srv->scratch[t].types && srv->scratch[t].strikes && srv->scratch[t].results;
+        const mc_engine_limits limits = { .max_contracts = m, .max_paths = config->default_n_sim };
+        ok = ok && mc_engine_init(&srv->scratch[t].engine, &limits) == 0;
+    }
+    if (!ok) {
+        server_free(srv);
+        return NULL;
+    }
+
+    if (pipe(srv->wake) != 0) {
+        server_free(srv);
+        return NULL;
+    }
+    srv->listen_fd = server_listen(srv->path);
+    if (srv->listen_fd < 0) {
+        close(srv->wake[0]);
+        close(srv->wake[1]);
+        server_free(srv);
+        return NULL;
+    }
+
+    pthread_mutex_init(&srv->lock, NULL);
+    pthread_cond_init(&srv->work_cv, NULL);
+    pthread_cond_init(&srv->done_cv, NULL);
+    pthread_mutex_init(&srv->stats_lock, NULL);
+
+    // Fewer workers than asked for is fine: the event thread prices too
+    for (unsigned t = 1; t < srv->n_threads; t++) {
+        server_worker_arg *wa = malloc(sizeof(*wa));
+        if (!wa) break;
+        *wa = (server_worker_arg){ srv, t };
+        if (pthread_create(&srv->workers[srv->n_workers], NULL, server_worker, wa) != 0) {
+            free(wa);
+            break;
+        }
+        srv->n_workers++;
+    }
+    return srv;
+}
+
+/**
+ * Stop the server, join its threads, close every socket and remove the
+ * socket file. Requests still pending are answered first.
+ *
+ * @param srv  Server from pricing_server_open() (may be NULL)
+ */
+void pricing_server_close(pricing_server *srv) {
+    if (!srv) {
+        return;
+    }
+    if (srv->runner_started) {
+        pricing_server_stop(srv);
+        pthread_join(srv->runner, NULL);
+    }
+    pthread_mutex_lock(&srv->lock);
+    srv->shutdown = 1;
+    pthread_cond_broadcast(&srv->work_cv);
+    pthread_mutex_unlock(&srv->lock);
+    for (unsigned t = 0; t < srv->n_workers; t++) {
+        pthread_join(srv->workers[t], NULL);
+    }
+    for (uint32_t c = 0; c < SERVER_MAX_CLIENTS; c++) {
+        if (srv->conns[c].fd >= 0) {
+            server_drop_conn(&srv->conns[c]);
+        }
+    }
+    close(srv->listen_fd);
+    unlink(srv->path);
+    close(srv->wake[0]);
+    close(srv->wake[1]);
+    pthread_mutex_destroy(&srv->lock);
+    pthread_cond_destroy(&srv->work_cv);
+    pthread_cond_destroy(&srv->done_cv);
+    pthread_mutex_destroy(&srv->stats_lock);
+    server_free(srv);
+}
+
+static int server_double_compare(const void *pa, const void *pb) {
+    double a = *(const double *)pa, b = *(const double *)pb;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Counters, and latency percentiles over the most recent replies.
+ *
+ * @param srv    Server
+ * @param stats  Receives the snapshot (percentiles 0 before the first reply)
+ */
+void pricing_server_get_stats(pricing_server *srv, pricing_server_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&srv->stats_lock);
+    stats->n_requests = srv->n_requests;
+    stats->n_batches = srv->n_batches;
+    stats->n_groups = srv->n_groups_total;
+    size_t n = (srv->n_latency < PRICING_LATENCY_SAMPLES) ? (size_t)srv->n_latency : PRICING_LATENCY_SAMPLES;
+    double *sorted = (n > 0) ? malloc(n * sizeof(double)) : NULL;
+    if (sorted) {
+        memcpy(sorted, srv->latency, n * sizeof(double));
+    }
+    pthread_mutex_unlock(&srv->stats_lock);
+    if (!sorted) {
+        return;
+    }
+    qsort(sorted, n, sizeof(double), server_double_compare);
+    stats->p50_us = 1e6 * sorted[(size_t)ceil(0.50 * (double)n) - 1];
+    stats->p99_us = 1e6 * sorted[(size_t)ceil(0.99 * (double)n) - 1];
+    stats->max_us = 1e6 * sorted[n - 1];
+    free(sorted);
+}
+
+/**
+ * Connect to a pricing server.
+ *
+ * @param socket_path  Path the server listens on
+ * @return             Connected descriptor, or -1
+ */
+int pricing_client_connect(const char *socket_path) {
+    struct sockaddr_un addr;
+    size_t len = strlen(socket_path);
+    if (len == 0 || len >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, len + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Send n requests (one write for the lot, so they tend to land in one batch).
+ */
+int pricing_client_send(int fd, const pricing_request *requests, size_t n) {
+    return server_send_all(fd, requests, n * sizeof(*requests));
+}
+
+/**
+ * Block until n replies have arrived.
+ */
+int pricing_client_recv(int fd, pricing_reply *replies, size_t n) {
+    unsigned char *p = (unsigned char *)replies;
+    size_t left = n * sizeof(*replies);
+    while (left > 0) {
+        ssize_t got = read(fd, p, left);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        p += got;
+        left -= (size_t)got;
+    }
+    return 0;
+}
+
+void pricing_client_close(int fd) {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
@@ -0,0 +1,63 @@
+//
+// SIMD Dispatch
+// Runtime CPU feature detection for the vectorized kernels.
+//
+// The Makefile builds with -march=native, but the AVX2 kernels are still
+// compiled with per-function target attributes and chosen at runtime, so a
+// binary built with a generic -march keeps its fast paths on capable CPUs.
+//
+
+#include <stdatomic.h>
+#include "include/simd.h"
+
+// Highest level callers allow kernels to use (SIMD_AVX2 = no cap)
+static atomic_int simd_cap = SIMD_AVX2;
+
+/**
+ * Detect the widest supported instruction set.
+ *
+ * @return  SIMD_AVX2 if the CPU has AVX2 and FMA, otherwise SIMD_SCALAR
+ */
+simd_level simd_detect(void) {
+#ifdef MC_SIMD_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SIMD_AVX2;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+/**
+ * Level kernels should dispatch to right now.
+ *
+ * @return  simd_detect(), lowered to the cap set with simd_limit()
+ */
+simd_level simd_active(void) {
+    simd_level detected = simd_detect();
+    simd_level cap = (simd_level)atomic_load(&simd_cap);
+    return (detected < cap) ? detected : cap;
+}
+
+/**
+ * Cap the instruction set used by all kernels.
+ *
+ * Mainly useful for benchmarks and for checking that the scalar and
+ * vectorized variants agree. Raising the cap above what the CPU supports
+ * has no effect.
+ *
+ * @param max_level  Highest level kernels may use
+ */
+void simd_limit(simd_level max_level) {
+    atomic_store(&simd_cap, (int)max_level);
+}
+
+/**
+ * Name of a SIMD level, for logs and benchmark output.
+ */
+const char *simd_level_name(simd_level level) {
+    switch (level) {
+        case SIMD_AVX2:   return "avx2";
+        case SIMD_SCALAR: return "scalar";
+    }
+    return "unknown";
+}
@@ -0,0 +1,165 @@
+//
+// Sobol Low-Discrepancy Sequence
+// Quasi-random points that fill the unit cube far more evenly than
+// pseudo-random ones, used by the quasi-Monte Carlo (QMC) engine.
+//
+// Pseudo-random sampling converges as O(1/√N) no matter how smooth the
+// payoff is. Sobol points are built so that every "elementary box" of the
+// cube gets its fair share of points, which brings the error for smooth
+// integrands close to O(1/N).
+//
+// Reference: S. Joe and F. Y. Kuo, "Constructing Sobol sequences with
+//            better two-dimensional projections", SIAM J. Sci. Comput. 2008
+//            https://web.maths.unsw.edu.au/~fkuo/sobol/
+//
+
+#include <string.h>
+#include "include/sobol.h"
+
+/**
+ * Direction-number parameters for dimensions 2..SOBOL_MAX_DIM.
+ *
+ * Each row is one primitive polynomial over GF(2):
+ *   s = degree, a = middle coefficients as a bit mask, m = initial
+ *   direction integers (odd, m[k] < 2^(k+1)).
+ * Dimension 1 is the van der Corput sequence (all m = 1).
+ */
+static const struct {
+    unsigned s;
+    unsigned a;
+    unsigned m[7];
+} SOBOL_PARAMS[SOBOL_MAX_DIM - 1] = {
+    { 1,  0, { 1 } },
+    { 2,  1, { 1, 3 } },
+    { 3,  1, { 1, 3, 1 } },
+    { 3,  2, { 1, 1, 1 } },
+    { 4,  1, { 1, 1, 3, 3 } },
+    { 4,  4, { 1, 3, 5, 13 } },
+    { 5,  2, { 1, 1, 5, 5, 17 } },
+    { 5,  4, { 1, 1, 5, 5, 5 } },
+    { 5,  7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6,  1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+    { 6, 19, { 1, 1, 1, 15, 7, 5 } },
+    { 6, 22, { 1, 3, 1, 15, 13, 25 } },
+    { 6, 25, { 1, 1, 5, 5, 19, 61 } },
+    { 7,  1, { 1, 3, 7, 11, 23, 15, 103 } },
+    { 7,  4, { 1, 3, 7, 13, 13, 15, 69 } },
+};
+
+/**
+ * Initialize an unscrambled Sobol sequence.
+ *
+ * Direction numbers v[k] (k = 0..31) are the binary fractions m_k / 2^(k+1)
+ * scaled to 32 bits. The first s come straight from the table; the rest
+ * follow the polynomial recurrence
+ *   v[k] = v[k-s] ^ (v[k-s] >> s) ^ XOR_j a_j * v[k-j]
+ *
+ * @param s    Sequence to initialize
+ * @param dim  Number of dimensions (1..SOBOL_MAX_DIM)
+ * @return     0 on success, -1 if dim is out of range
+ */
+int sobol_init(sobol_state *s, unsigned dim) {
+    if (dim == 0 || dim > SOBOL_MAX_DIM) {
+        return -1;
+    }
+    memset(s, 0, sizeof(*s));
+    s->dim = dim;
+
+    for (unsigned k = 0; k < SOBOL_BITS; k++) {
+        s->v[0][k] = 1u << (SOBOL_BITS - 1 - k);
+    }
+
+    for (unsigned d = 1; d < dim; d++) {
+        unsigned deg = SOBOL_PARAMS[d - 1].s;
+        unsigned a = SOBOL_PARAMS[d - 1].a;
+        uint32_t *v = s->v[d];
+
+        for (unsigned k = 0; k < deg; k++) {
+            v[k] = (uint32_t)SOBOL_PARAMS[d - 1].m[k] << (SOBOL_BITS - 1 - k);
+        }
+        for (unsigned k = deg; k < SOBOL_BITS; k++) {
+            uint32_t value = v[k - deg] ^ (v[k - deg] >> deg);
+            for (unsigned j = 1; j < deg; j++) {
+                if ((a >> (deg - 1 - j)) & 1u) {
+                    value ^= v[k - j];
+                }
+            }
+            v[k] = value;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Apply a random digital shift: every coordinate is XOR-ed with a random
+ * 32-bit word.
+ *
+ * The shifted points keep the equidistribution of the original sequence,
+ * but each point is now uniformly distributed, so the QMC estimate becomes
+ * unbiased. Independent shifts give independent replicates whose spread
+ * measures the error - plain QMC has no error estimate at all.
+ *
+ * @param s    Sequence to scramble
+ * @param rng  Stream that supplies the shifts
+ */
+void sobol_scramble(sobol_state *s, rng_state *rng) {
+    for (unsigned d = 0; d < s->dim; d++) {
+        s->shift[d] = (uint32_t)(rng_next(rng) >> 32);
+    }
+}
+
+/**
+ * Position the sequence at point number `index`.
+ *
+ * Point i is the XOR of the direction numbers selected by the bits of its
+ * Gray code i ^ (i >> 1). This lets each thread start its own share of
+ * points without generating the ones before it.
+ *
+ * @param s      Sequence to reposition
+ * @param index  Point to generate next
+ */
+void sobol_skip(sobol_state *s, uint32_t index) {
+    uint32_t gray = index ^ (index >> 1);
+    for (unsigned d = 0; d < s->dim; d++) {
+        uint32_t x = 0;
+        for (unsigned k = 0; k < SOBOL_BITS; k++) {
+            if (gray & (1u << k)) {
+                x ^= s->v[d][k];
+            }
+        }
+        s->x[d] = x;
+    }
+    s->index = index;
+}
+
+/**
+ * Produce the next point and advance.
+ *
+ * Consecutive Gray codes differ in one bit - the lowest zero bit of the
+ * current index - so each step is a single XOR per dimension.
+ *
+ * Coordinates are mapped to the cell midpoint (x + ½) / 2^32, so they are
+ * never exactly 0 or 1 and can be fed directly to normal_inv_cdf().
+ *
+ * @param s      Sequence to draw from
+ * @param point  Receives s->dim coordinates in (0, 1)
+ */
+void sobol_next(sobol_state *s, double *point) {
+    for (unsigned d = 0; d < s->dim; d++) {
+        point[d] = ((double)(s->x[d] ^ s->shift[d]) + 0.5) * 0x1.0p-32;
+    }
+
+    uint32_t zeros = ~s->index;
+    if (zeros != 0) {   // After the last of 2^32 points the sequence just stops moving
+        unsigned bit = (unsigned)__builtin_ctz(zeros);
+        for (unsigned d = 0; d < s->dim; d++) {
+            s->x[d] ^= s->v[d][bit];
+        }
+    }
+    s->index++;
+}
@@ -0,0 +1,303 @@
+//
+// Sample Statistics
+// Mean, variance and control-variate estimates, updated online.
+//
+// The pricing engine never stores individual payoffs; it only needs these
+// few numbers per chunk to report a price and its standard error.
+//
+// Why not just keep Σy and Σy²? Var = (Σy² - (Σy)²/n)/(n-1) subtracts two
+// huge, nearly equal numbers at large n and can lose most of its digits
+// (or even go negative). Welford's method tracks the mean and the sum of
+// squared deviations from it instead, which stays accurate at any n.
+//
+// Reference: https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
+//
+
+#include <math.h>
+#include "include/stats.h"
+#include "include/simd.h"
+#include "include/vmath_avx2.h"
+
+#ifdef MC_SIMD_X86
+/**
+ * AVX2 shifted sums of a block, four samples per iteration.
+ *
+ * sums[] receives Σdy, Σdy², Σdx, Σdx², Σdx·dy (the x terms only when x
+ * is given) over the first (n rounded down to 4) samples.
+ *
+ * @return  Number of samples consumed
+ */
+__attribute__((target("avx2,fma")))
+static size_t block_sums_avx2(const double *y, const double *x, size_t n,
+                              double cy, double cx, double sums[5]) {
+    __m256d shift_y = _mm256_set1_pd(cy);
+    __m256d sy = _mm256_setzero_pd(), syy = _mm256_setzero_pd();
+    size_t i = 0;
+
+    if (x) {
+        __m256d shift_x = _mm256_set1_pd(cx);
+        __m256d sx = _mm256_setzero_pd(), sxx = _mm256_setzero_pd(), sxy = _mm256_setzero_pd();
+        for (; i + 4 <= n; i += 4) {
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), shift_y);
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), shift_x);
+            sy = _mm256_add_pd(sy, dy);
+            syy = _mm256_fmadd_pd(dy, dy, syy);
+            sx = _mm256_add_pd(sx, dx);
+            sxx = _mm256_fmadd_pd(dx, dx, sxx);
+            sxy = _mm256_fmadd_pd(dx, dy, sxy);
+        }
+        sums[2] = v_hsum(sx);
+        sums[3] = v_hsum(sxx);
+        sums[4] = v_hsum(sxy);
+    } else {
+        // Two sets of accumulators hide the add latency of the short loop body
+        __m256d sy2 = _mm256_setzero_pd(), syy2 = _mm256_setzero_pd();
+        for (; i + 8 <= n; i += 8) {
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), shift_y);
+            __m256d dy2 = _mm256_sub_pd(_mm256_loadu_pd(y + i + 4), shift_y);
+            sy = _mm256_add_pd(sy, dy);
+            syy = _mm256_fmadd_pd(dy, dy, syy);
+            sy2 = _mm256_add_pd(sy2, dy2);
+            syy2 = _mm256_fmadd_pd(dy2, dy2, syy2);
+        }
+        for (; i + 4 <= n; i += 4) {
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), shift_y);
+            sy = _mm256_add_pd(sy, dy);
+            syy = _mm256_fmadd_pd(dy, dy, syy);
+        }
+        sy = _mm256_add_pd(sy, sy2);
+        syy = _mm256_add_pd(syy, syy2);
+    }
+    sums[0] = v_hsum(sy);
+    sums[1] = v_hsum(syy);
+    return i;
+}
+
+/**
+ * AVX2 shifted sums of a float block: each group of eight samples is
+ * widened to two vectors of doubles before it is added.
+ *
+ * @return  Number of samples consumed
+ */
+__attribute__((target("avx2,fma")))
+static size_t block_sums_f32_avx2(const float *y, const float *x, size_t n,
+                                  double cy, double cx, double sums[5]) {
+    __m256d shift_y = _mm256_set1_pd(cy), shift_x = _mm256_set1_pd(cx);
+    // One set of accumulators per half of the eight samples: two independent add chains
+    __m256d sy[2] = { _mm256_setzero_pd(), _mm256_setzero_pd() }, syy[2] = { sy[0], sy[0] };
+    __m256d sx[2] = { sy[0], sy[0] }, sxx[2] = { sy[0], sy[0] }, sxy[2] = { sy[0], sy[0] };
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 yf = _mm256_loadu_ps(y + i);
+        __m256d dy[2] = {
+            _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(yf)), shift_y),
+            _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(yf, 1)), shift_y)
+        };
+        for (int h = 0; h < 2; h++) {
+            sy[h] = _mm256_add_pd(sy[h], dy[h]);
+            syy[h] = _mm256_fmadd_pd(dy[h], dy[h], syy[h]);
+        }
+        if (x) {
+            __m256 xf = _mm256_loadu_ps(x + i);
+            __m256d dx[2] = {
+                _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(xf)), shift_x),
+                _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(xf, 1)), shift_x)
+            };
+            for (int h = 0; h < 2; h++) {
+                sx[h] = _mm256_add_pd(sx[h], dx[h]);
+                sxx[h] = _mm256_fmadd_pd(dx[h], dx[h], sxx[h]);
+                sxy[h] = _mm256_fmadd_pd(dx[h], dy[h], sxy[h]);
+            }
+        }
+    }
+    sums[0] = v_hsum(_mm256_add_pd(sy[0], sy[1]));
+    sums[1] = v_hsum(_mm256_add_pd(syy[0], syy[1]));
+    if (x) {
+        sums[2] = v_hsum(_mm256_add_pd(sx[0], sx[1]));
+        sums[3] = v_hsum(_mm256_add_pd(sxx[0], sxx[1]));
+        sums[4] = v_hsum(_mm256_add_pd(sxy[0], sxy[1]));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Turn the shifted sums of a block into its moments and merge them into m.
+ */
+static void moments_add_sums(mc_moments *m, size_t n, double cy, double cx, int has_x, const double sums[5]) {
+    double dn = (double)n;
+    mc_moments block = { .n = n };
+    block.mean_y = cy + sums[0] / dn;
+    block.m2_y = fmax(sums[1] - sums[0] * sums[0] / dn, 0.0);
+    if (has_x) {
+        block.mean_x = cx + sums[2] / dn;
+        block.m2_x = fmax(sums[3] - sums[2] * sums[2] / dn, 0.0);
+        block.c_xy = sums[4] - sums[2] * sums[0] / dn;
+    }
+
+    moments_merge(m, &block);
+}
+
+/**
+ * Accumulate a block of samples.
+ *
+ * The block is summed in one pass around a shift c (its first sample):
+ *   mean = c + Σd/n,   M2 = Σd² - (Σd)²/n     with d = y - c
+ * Shifting by a value near the mean is what removes the cancellation of
+ * the naive Σy² formula, and a short block stays well inside double
+ * precision. One pass instead of two matters when one set of paths feeds
+ * a whole chain of strikes, so there is an AVX2 variant as well.
+ *
+ * The block result is then merged into the running totals with
+ * moments_merge().
+ *
+ * @param m  Accumulator to update
+ * @param y  Estimator samples (e.g. payoffs)
+ * @param x  Control-variate samples, centred on their known mean (or NULL)
+ * @param n  Number of samples
+ */
+void moments_add_block(mc_moments *m, const double *y, const double *x, size_t n) {
+    if (n == 0) {
+        return;
+    }
+
+    const double cy = y[0];
+    const double cx = x ? x[0] : 0.0;
+    double sums[5] = {0.0};     // Σdy, Σdy², Σdx, Σdx², Σdx·dy
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = block_sums_avx2(y, x, n, cy, cx, sums);
+    }
+#endif
+    for (; i < n; i++) {
+        double dy = y[i] - cy;
+        sums[0] += dy;
+        sums[1] += dy * dy;
+        if (x) {
+            double dx = x[i] - cx;
+            sums[2] += dx;
+            sums[3] += dx * dx;
+            sums[4] += dx * dy;
+        }
+    }
+
+    moments_add_sums(m, n, cy, cx, x != NULL, sums);
+}
+
+/**
+ * Accumulate a block of float samples (float32 engine).
+ *
+ * Same one-pass shifted sums as moments_add_block(), but every sample is
+ * widened to double before it is added: float samples carry a relative
+ * rounding error of ~6e-8 each, which averages out, while a float running
+ * sum would lose digits with every block and bias the mean.
+ *
+ * @param m  Accumulator to update
+ * @param y  Estimator samples
+ * @param x  Control-variate samples, centred on their known mean (or NULL)
+ * @param n  Number of samples
+ */
+void moments_add_block_f32(mc_moments *m, const float *y, const float *x, size_t n) {
+    if (n == 0) {
+        return;
+    }
+
+    const double cy = y[0];
+    const double cx = x ? x[0] : 0.0;
+    double sums[5] = {0.0};
+    size_t i = 0;
+#ifdef MC_SIMD_X86
+    if (simd_active() >= SIMD_AVX2) {
+        i = block_sums_f32_avx2(y, x, n, cy, cx, sums);
+    }
+#endif
+    for (; i < n; i++) {
+        double dy = (double)y[i] - cy;
+        sums[0] += dy;
+        sums[1] += dy * dy;
+        if (x) {
+            double dx = (double)x[i] - cx;
+            sums[2] += dx;
+            sums[3] += dx * dx;
+            sums[4] += dx * dy;
+        }
+    }
+
+    moments_add_sums(m, n, cy, cx, x != NULL, sums);
+}
+
+/**
+ * Merge two accumulators (into += from).
+ *
+ * Chan et al.'s pairwise update: with δ = mean_b - mean_a,
+ *   mean = mean_a + δ * n_b/n
+ *   M2   = M2_a + M2_b + δ² * n_a*n_b/n
+ * and the same for the cross moment with δx*δy.
+ */
+void moments_merge(mc_moments *into, const mc_moments *from) {
+    if (from->n == 0) {
+        return;
+    }
+    if (into->n == 0) {
+        *into = *from;
+        return;
+    }
+
+    double na = (double)into->n;
+    double nb = (double)from->n;
+    double n = na + nb;
+    double dy = from->mean_y - into->mean_y;
+    double dx = from->mean_x - into->mean_x;
+    double w = na * nb / n;
+
+    into->mean_y += dy * nb / n;
+    into->mean_x += dx * nb / n;
+    into->m2_y += from->m2_y + dy * dy * w;
+    into->m2_x += from->m2_x + dx * dx * w;
+    into->c_xy += from->c_xy + dx * dy * w;
+    into->n += from->n;
+}
+
+/**
+ * Sample mean of y.
+ */
+double moments_mean(const mc_moments *m) {
+    return m->mean_y;
+}
+
+/**
+ * Unbiased sample variance of y: Σ(y - ȳ)² / (n - 1).
+ */
+double moments_variance(const mc_moments *m) {
+    return (m->n > 1) ? m->m2_y / (double)(m->n - 1) : 0.0;
+}
+
+/**
+ * Control-variate estimate of E[Y].
+ *
+ * If X is correlated with Y and E[X] is known exactly, then
+ *   Y_cv = Y - β (X - E[X])
+ * has the same mean as Y but variance Var(Y) (1 - ρ²), where ρ is the
+ * correlation of X and Y. The best β is Cov(X,Y) / Var(X), estimated here
+ * from the same samples (this adds a bias of order 1/n, negligible at MC
+ * sample sizes).
+ *
+ * @param m         Accumulator with x centred so that E[X] = 0
+ * @param mean      Receives the control-variate estimate of E[Y]
+ * @param variance  Receives the per-sample variance of Y_cv
+ */
+void moments_control(const mc_moments *m, double *mean, double *variance) {
+    if (m->n < 3) {
+        *mean = moments_mean(m);
+        *variance = moments_variance(m);
+        return;
+    }
+
+    double beta = (m->m2_x > 0.0) ? m->c_xy / m->m2_x : 0.0;
+    *mean = m->mean_y - beta * m->mean_x;
+
+    // Residual variance of Y - βX; one extra degree of freedom is spent on β
+    double resid = (m->m2_y - beta * m->c_xy) / (double)(m->n - 2);
+    *variance = (resid > 0.0) ? resid : 0.0;
+}
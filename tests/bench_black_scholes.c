@@ -0,0 +1,164 @@
+//
+// Black-Scholes Batch Benchmark
+// Times the closed-form pricer on a large synthetic chain three ways:
+//   - one option at a time through price_european_call_bs/greeks_european_bs
+//   - black_scholes_batch() capped to the scalar (libm) path
+//   - black_scholes_batch() with AVX2, if the CPU has it
+// and reports ns per option and the largest difference from the scalar code.
+// Then inverts the same chain with implied_vol_batch() (one thread), from
+// out-of-the-money prices, and reports ns per quote and the round-trip error.
+//
+// Usage: bench_black_scholes [n_quotes] [repeats]
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "include/rng.h"
+#include "include/monte_carlo.h"
+#include "include/black_scholes.h"
+#include "include/implied_vol.h"
+#include "include/simd.h"
+
+/**
+ * Monotonic wall-clock time in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/**
+ * Largest |a[i] - b[i]| over n values.
+ */
+static double max_abs_diff(const double *a, const double *b, size_t n) {
+    double worst = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double d = fabs(a[i] - b[i]);
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = (argc > 1) ? (size_t)strtoull(argv[1], NULL, 10) : 1000000;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+    if (n == 0 || repeats <= 0) {
+        fprintf(stderr, "Usage: %s [n_quotes > 0] [repeats > 0]\n", argv[0]);
+        return 1;
+    }
+
+    // Columns: 5 inputs, then calls from each method, then the batch Greeks
+    enum { N_COLUMNS = 5 + 4 + 10 };
+    double *mem = malloc(N_COLUMNS * n * sizeof(double));
+    if (!mem) {
+        fprintf(stderr, "Out of memory for %zu quotes\n", n);
+        return 1;
+    }
+    double *S0 = mem, *K = S0 + n, *r = K + n, *sigma = r + n, *T = sigma + n;
+    double *call_one = T + n, *delta_one = call_one + n, *call_batch = delta_one + n, *cols = call_batch + n;
+    double *put_batch = cols;
+
+    // A chain-like universe: strikes within ±40% of spot, 1 week to 2 years
+    rng_state rng;
+    rng_seed(&rng, 2024u);
+    for (size_t i = 0; i < n; i++) {
+        S0[i] = 50.0 + 150.0 * random_double(&rng);
+        K[i] = S0[i] * (0.6 + 0.8 * random_double(&rng));
+        r[i] = 0.05 * random_double(&rng);
+        sigma[i] = 0.1 + 0.5 * random_double(&rng);
+        T[i] = 7.0 / 365.0 + 2.0 * random_double(&rng);
+    }
+    bs_batch_inputs in = { S0, K, r, sigma, T };
+    bs_batch_outputs price_only = { .call = call_batch, .put = put_batch };
+    bs_batch_outputs full = { call_batch, put_batch, cols + n, cols + 2 * n, cols + 3 * n, cols + 4 * n,
+                              cols + 5 * n, cols + 6 * n, cols + 7 * n, cols + 8 * n };
+
+    printf("=== Black-Scholes: %zu quotes, best of %d ===\n", n, repeats);
+    printf("  %-34s %12s %10s %14s\n", "Method", "ns/option", "Speedup", "Max |Δ call|");
+
+    // Baseline: the scalar entry points, one call per quote (call + put + Greeks)
+    double base_price = INFINITY, base_full = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        double t0 = now_seconds();
+        for (size_t i = 0; i < n; i++) {
+            call_one[i] = price_european_call_bs(S0[i], K[i], r[i], sigma[i], T[i]);
+        }
+        double t1 = now_seconds();
+        for (size_t i = 0; i < n; i++) {
+            option_greeks gc = greeks_european_bs(OPTION_CALL, S0[i], K[i], r[i], sigma[i], T[i]);
+            option_greeks gp = greeks_european_bs(OPTION_PUT, S0[i], K[i], r[i], sigma[i], T[i]);
+            delta_one[i] = gc.delta + gp.theta;   // keep both calls live
+        }
+        double t2 = now_seconds();
+        if (t1 - t0 < base_price) base_price = t1 - t0;
+        if (t2 - t0 < base_full) base_full = t2 - t0;
+    }
+    printf("  %-34s %12.2f %9.1fx %14s\n", "price_european_call_bs (call)", 1e9 * base_price / n, 1.0, "-");
+    printf("  %-34s %12.2f %9.1fx %14s\n", "  + greeks_european_bs (call, put)", 1e9 * base_full / n, 1.0, "-");
+
+    simd_level best = simd_detect();
+    for (int level = SIMD_SCALAR; level <= (int)best; level++) {
+        simd_limit((simd_level)level);
+        double t_price = INFINITY, t_full = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            double t0 = now_seconds();
+            black_scholes_batch(&in, n, &price_only);
+            double t1 = now_seconds();
+            black_scholes_batch(&in, n, &full);
+            double t2 = now_seconds();
+            if (t1 - t0 < t_price) t_price = t1 - t0;
+            if (t2 - t1 < t_full) t_full = t2 - t1;
+        }
+        double diff = max_abs_diff(call_batch, call_one, n);
+        char name[64];
+        snprintf(name, sizeof(name), "batch %s (call + put)", simd_level_name((simd_level)level));
+        printf("  %-34s %12.2f %9.1fx %14.2e\n", name, 1e9 * t_price / n, base_price / t_price, diff);
+        snprintf(name, sizeof(name), "batch %s (+ all Greeks)", simd_level_name((simd_level)level));
+        printf("  %-34s %12.2f %9.1fx %14s\n", name, 1e9 * t_full / n, base_full / t_full, "");
+    }
+
+    // Implied volatility: back σ out of the out-of-the-money side of each quote
+    option_type *types = malloc(n * sizeof(option_type));
+    if (!types) {
+        fprintf(stderr, "Out of memory for %zu quote types\n", n);
+        free(mem);
+        return 1;
+    }
+    double *quote = call_one, *vol = delta_one;
+    printf("\n=== Implied volatility: %zu quotes, 1 thread, best of %d ===\n", n, repeats);
+    printf("  %-34s %12s %10s %14s\n", "Method", "ns/quote", "Evals", "Max |Δσ|/σ");
+    for (int level = SIMD_SCALAR; level <= (int)best; level++) {
+        simd_limit((simd_level)level);
+        black_scholes_batch(&in, n, &price_only);
+        for (size_t i = 0; i < n; i++) {
+            types[i] = (K[i] < S0[i]) ? OPTION_PUT : OPTION_CALL;
+            quote[i] = (types[i] == OPTION_PUT) ? put_batch[i] : call_batch[i];
+        }
+        iv_batch_inputs iv_in = { quote, S0, K, r, T, types };
+        iv_stats stats;
+        double t_iv = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            double t0 = now_seconds();
+            implied_vol_batch(&iv_in, n, 1, vol, &stats);
+            double t1 = now_seconds();
+            if (t1 - t0 < t_iv) t_iv = t1 - t0;
+        }
+        double worst = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double err = fabs(vol[i] - sigma[i]) / sigma[i];
+            if (!(err <= worst)) worst = err;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "implied_vol_batch %s", simd_level_name((simd_level)level));
+        printf("  %-34s %12.2f %10.2f %14.2e\n", name, 1e9 * t_iv / n, (double)stats.newton_steps / n, worst);
+    }
+
+    free(types);
+    free(mem);
+    return 0;
+}
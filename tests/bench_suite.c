@@ -0,0 +1,609 @@
+//
+// Benchmark Suite
+// Times each layer of the engine on its own, then the whole engine, and
+// writes one JSON document to stdout (progress goes to stderr):
+//   - rng:           ns per sample of random_double, normal_random, normal_fill(_f32)
+//   - path:          ns per path of simulate_gbm + call_payoff, and of the
+//                    block kernels (normal_fill, gbm_terminal_fill, call_payoff_sum)
+//   - kernel:        ns per path of the generated kernels (kernel.h) beside the
+//                    same loops written by hand
+//   - black_scholes: ns per option of price_european_call_bs and black_scholes_batch
+//   - engine:        options/sec and paths/sec of price_european_mc and
+//                    price_european_chain_mc for every sampler, thread count and n_sim,
+//                    and requests/sec of small single-thread requests with and
+//                    without a reusable engine context (mc_engine)
+//   - results:       ns per row of reporting results inline with fprintf and
+//                    through a results_writer (producer time; total in "extra")
+// Kernels with a vector variant are run once per SIMD level (simd_limit).
+// Every timing is the best of `repeats` runs. Records are flat and keyed by
+// (group, name, variant, threads, n), so two runs can be diffed entry by entry.
+//
+// Usage: bench_suite [--quick] [--repeats N] [--threads N]
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "include/rng.h"
+#include "include/gbm.h"
+#include "include/option.h"
+#include "include/monte_carlo.h"
+#include "include/black_scholes.h"
+#include "include/parallel.h"
+#include "include/simd.h"
+#include "include/results.h"
+#include "include/kernel.h"
+#include "include/stats.h"
+
+// Bumped whenever a record changes meaning, so old baselines are not compared blindly
+#define BENCH_SCHEMA_VERSION 1
+
+// Paths per block in the path kernels (matches the engine's block size)
+#define BENCH_BLOCK 256u
+
+// Strikes in the chain benchmark
+#define BENCH_CHAIN_STRIKES 32u
+
+// Results flow into here so the compiler cannot drop the timed work
+static volatile double bench_sink;
+
+// Records written so far (for the comma between them)
+static unsigned bench_records;
+
+/**
+ * Monotonic wall-clock time in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/**
+ * Write one result record.
+ *
+ * @param group    Layer being measured ("rng", "path", "black_scholes", "engine")
+ * @param name     Function or kernel
+ * @param variant  Kernel variant (SIMD level, sampler)
+ * @param threads  Worker threads used
+ * @param n        Items per timed run (samples, paths or options)
+ * @param seconds  Best wall-clock time of one run
+ * @param extra    Further ", \"key\": value" pairs, or "" for none
+ */
+static void emit(const char *group, const char *name, const char *variant, unsigned threads,
+                 uint64_t n, double seconds, const char *extra) {
+    printf("%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"variant\": \"%s\", \"threads\": %u, "
+           "\"n\": %llu, \"seconds\": %.9f, \"ns_per_item\": %.4f, \"items_per_sec\": %.1f%s}",
+           bench_records ? "," : "", group, name, variant, threads, (unsigned long long)n, seconds,
+           1e9 * seconds / (double)n, (double)n / seconds, extra);
+    bench_records++;
+    fprintf(stderr, "  %-14s %-24s %-20s %3u thr %10llu  %10.3f ns/item\n", group, name, variant,
+            threads, (unsigned long long)n, 1e9 * seconds / (double)n);
+}
+
+/**
+ * Best-of-repeats timings of the scalar RNG entry points and normal_fill.
+ */
+static void bench_rng(size_t n, int repeats) {
+    rng_state rng;
+    double best = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        rng_seed(&rng, 1u);
+        double sum = 0.0, t0 = now_seconds();
+        for (size_t i = 0; i < n; i++) sum += random_double(&rng);
+        double t = now_seconds() - t0;
+        bench_sink = sum;
+        if (t < best) best = t;
+    }
+    emit("rng", "random_double", "scalar", 1, n, best, "");
+
+    best = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        rng_seed(&rng, 1u);
+        double sum = 0.0, t0 = now_seconds();
+        for (size_t i = 0; i < n; i++) sum += normal_random(&rng);
+        double t = now_seconds() - t0;
+        bench_sink = sum;
+        if (t < best) best = t;
+    }
+    emit("rng", "normal_random", "scalar", 1, n, best, "");
+
+    double z[BENCH_BLOCK];
+    for (int level = SIMD_SCALAR; level <= (int)simd_detect(); level++) {
+        simd_limit((simd_level)level);
+        best = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            rng_seed(&rng, 1u);
+            double sum = 0.0, t0 = now_seconds();
+            for (size_t done = 0; done < n; done += BENCH_BLOCK) {
+                normal_fill(&rng, z, BENCH_BLOCK);
+                sum += z[0];
+            }
+            double t = now_seconds() - t0;
+            bench_sink = sum;
+            if (t < best) best = t;
+        }
+        emit("rng", "normal_fill", simd_level_name((simd_level)level), 1, n, best, "");
+
+        float zf[BENCH_BLOCK];
+        best = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            rng_seed(&rng, 1u);
+            double sum = 0.0, t0 = now_seconds();
+            for (size_t done = 0; done < n; done += BENCH_BLOCK) {
+                normal_fill_f32(&rng, zf, BENCH_BLOCK);
+                sum += zf[0];
+            }
+            double t = now_seconds() - t0;
+            bench_sink = sum;
+            if (t < best) best = t;
+        }
+        emit("rng", "normal_fill_f32", simd_level_name((simd_level)level), 1, n, best, "");
+    }
+    simd_limit(simd_detect());
+}
+
+/**
+ * Per-path cost of one terminal price plus its payoff, one path at a time
+ * and through the block kernels the engine uses.
+ */
+static void bench_path(size_t n, int repeats) {
+    const double S0 = 100.0, K = 100.0, r = 0.05, sigma = 0.2, T = 1.0;
+    rng_state rng;
+    double best = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        rng_seed(&rng, 2u);
+        double sum = 0.0, t0 = now_seconds();
+        for (size_t i = 0; i < n; i++) sum += call_payoff(simulate_gbm(&rng, S0, r, sigma, T), K);
+        double t = now_seconds() - t0;
+        bench_sink = sum;
+        if (t < best) best = t;
+    }
+    emit("path", "simulate_gbm+call_payoff", "scalar", 1, n, best, "");
+
+    gbm_terminal g = gbm_terminal_init(S0, r, sigma, T);
+    double S[BENCH_BLOCK];
+    for (int level = SIMD_SCALAR; level <= (int)simd_detect(); level++) {
+        simd_limit((simd_level)level);
+        best = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            rng_seed(&rng, 2u);
+            double sum = 0.0, t0 = now_seconds();
+            for (size_t done = 0; done < n; done += BENCH_BLOCK) {
+                normal_fill(&rng, S, BENCH_BLOCK);
+                gbm_terminal_fill(&g, S, S, BENCH_BLOCK);
+                sum += call_payoff_sum(S, BENCH_BLOCK, K);
+            }
+            double t = now_seconds() - t0;
+            bench_sink = sum;
+            if (t < best) best = t;
+        }
+        emit("path", "block_terminal+payoff", simd_level_name((simd_level)level), 1, n, best, "");
+    }
+    simd_limit(simd_detect());
+}
+
+/**
+ * Make the compiler assume *p is read here, so a timed block's stores stay.
+ */
+static inline void bench_clobber(const void *p) {
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+MC_DEFINE_PAYOFF_BLOCK(bench_call_av, double, MC_PAYOFF_CALL, 1)
+MC_DEFINE_PAYOFF_BLOCK(bench_call_av_f32, float, MC_PAYOFF_CALL, 1)
+
+/**
+ * Generated kernels (kernel.h) against the same loops written out by hand:
+ *   - payoff: antithetic call payoffs over an L1-resident block, through the
+ *     runtime-dispatched payoff_fill() + averaging pass the engine used to
+ *     run, a hand-written loop, and MC_DEFINE_PAYOFF_BLOCK
+ *   - chain:  a whole one-call antithetic + control run, hand-written from
+ *     the public block kernels, against price_european_chain_mc(); "same_bits"
+ *     says whether the two prices agree exactly
+ */
+static void bench_kernels(size_t n, int repeats) {
+    double s_up[BENCH_BLOCK], s_down[BENCH_BLOCK], y[BENCH_BLOCK], y_down[BENCH_BLOCK];
+    float s_up_f[BENCH_BLOCK], s_down_f[BENCH_BLOCK], y_f[BENCH_BLOCK];
+    rng_state rng;
+    rng_seed(&rng, 4u);
+    for (size_t i = 0; i < BENCH_BLOCK; i++) {
+        s_up[i] = 100.0 * exp(0.2 * normal_random(&rng));
+        s_down[i] = 1e4 / s_up[i];
+        s_up_f[i] = (float)s_up[i];
+        s_down_f[i] = (float)s_down[i];
+    }
+    volatile option_type runtime_type = OPTION_CALL;
+
+    for (int variant = 0; variant < 5; variant++) {
+        static const char *const names[5] = { "runtime", "hand-written", "generated",
+                                              "hand-written-f32", "generated-f32" };
+        double best = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            double sum = 0.0, t0 = now_seconds();
+            for (size_t done = 0; done < n; done += BENCH_BLOCK) {
+                double K = 95.0 + (double)(done / BENCH_BLOCK % 16);
+                float K_f = (float)K;
+                if (variant == 0) {
+                    payoff_fill(runtime_type, s_up, BENCH_BLOCK, K, y);
+                    payoff_fill(runtime_type, s_down, BENCH_BLOCK, K, y_down);
+                    for (size_t i = 0; i < BENCH_BLOCK; i++) y[i] = 0.5 * (y[i] + y_down[i]);
+                } else if (variant == 1) {
+                    for (size_t i = 0; i < BENCH_BLOCK; i++) {
+                        double a = s_up[i] - K, b = s_down[i] - K;
+                        y[i] = 0.5 * ((a > 0.0 ? a : 0.0) + (b > 0.0 ? b : 0.0));
+                    }
+                } else if (variant == 2) {
+                    bench_call_av(s_up, s_down, BENCH_BLOCK, K, y);
+                } else if (variant == 3) {
+                    for (size_t i = 0; i < BENCH_BLOCK; i++) {
+                        float a = s_up_f[i] - K_f, b = s_down_f[i] - K_f;
+                        y_f[i] = 0.5f * ((a > 0.0f ? a : 0.0f) + (b > 0.0f ? b : 0.0f));
+                    }
+                } else {
+                    bench_call_av_f32(s_up_f, s_down_f, BENCH_BLOCK, K_f, y_f);
+                }
+                bench_clobber((variant < 3) ? (const void *)y : (const void *)y_f);
+                sum += (variant < 3) ? y[done % BENCH_BLOCK] : (double)y_f[done % BENCH_BLOCK];
+            }
+            double t = now_seconds() - t0;
+            bench_sink = sum;
+            if (t < best) best = t;
+        }
+        emit("kernel", "payoff_call_av", names[variant], 1, n, best, "");
+    }
+
+    // Whole run: chunk c draws from the seed jumped c times, chunks merged in order
+    const double S0 = 100.0, K = 100.0, r = 0.05, sigma = 0.2, T = 1.0;
+    const uint32_t n_sim = (uint32_t)n;
+    gbm_terminal g = gbm_terminal_init(S0, r, sigma, T);
+    double forward = S0 * exp(r * T), z[BENCH_BLOCK], z_down[BENCH_BLOCK], x[BENCH_BLOCK];
+    double hand_price = NAN, best = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        double t0 = now_seconds();
+        mc_moments total = { 0 };
+        rng_state stream;
+        rng_seed(&stream, 5u);
+        for (uint32_t begin = 0; begin < n_sim; begin += MC_CHUNK_PATHS) {
+            uint32_t count = (n_sim - begin < MC_CHUNK_PATHS) ? n_sim - begin : MC_CHUNK_PATHS;
+            mc_moments m = { 0 };
+            rng = stream;
+            rng_jump(&stream);
+            for (uint32_t left = (count + 1) / 2; left > 0;) {
+                uint32_t b = (left < BENCH_BLOCK) ? left : BENCH_BLOCK;
+                normal_fill(&rng, z, b);
+                gbm_terminal_fill(&g, z, s_up, b);
+                for (uint32_t i = 0; i < b; i++) z_down[i] = -z[i];
+                gbm_terminal_fill(&g, z_down, s_down, b);
+                for (uint32_t i = 0; i < b; i++) {
+                    double a = s_up[i] - K, c = s_down[i] - K;
+                    y[i] = 0.5 * ((a > 0.0 ? a : 0.0) + (c > 0.0 ? c : 0.0));
+                    x[i] = 0.5 * (s_up[i] + s_down[i]) - forward;
+                }
+                moments_add_block(&m, y, x, b);
+                left -= b;
+            }
+            moments_merge(&total, &m);
+        }
+        double mean, variance;
+        moments_control(&total, &mean, &variance);
+        hand_price = exp(-r * T) * mean;
+        double t = now_seconds() - t0;
+        if (t < best) best = t;
+    }
+    emit("kernel", "chain_call_av_cv", "hand-written", 1, n, best, "");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = n_sim;
+    opts.seed = 5u;
+    opts.n_threads = 1;
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    option_type type = OPTION_CALL;
+    mc_result res = { NAN, NAN, 0 };
+    best = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        double t0 = now_seconds();
+        price_european_chain_mc(S0, r, sigma, T, &type, &K, 1, &opts, &res);
+        double t = now_seconds() - t0;
+        if (t < best) best = t;
+    }
+    bench_sink = hand_price + res.price;
+    emit("kernel", "chain_call_av_cv", "generated", 1, n, best,
+         (memcmp(&hand_price, &res.price, sizeof(double)) == 0) ? ", \"same_bits\": true" : ", \"same_bits\": false");
+}
+
+/**
+ * Closed-form pricing of a synthetic chain, one call at a time and batched.
+ * Returns 0, or -1 if out of memory.
+ */
+static int bench_black_scholes(size_t n, int repeats) {
+    double *mem = malloc(7 * n * sizeof(double));
+    if (!mem) return -1;
+    double *S0 = mem, *K = S0 + n, *r = K + n, *sigma = r + n, *T = sigma + n;
+    double *call = T + n, *put = call + n;
+    rng_state rng;
+    rng_seed(&rng, 3u);
+    for (size_t i = 0; i < n; i++) {
+        S0[i] = 50.0 + 150.0 * random_double(&rng);
+        K[i] = S0[i] * (0.6 + 0.8 * random_double(&rng));
+        r[i] = 0.05 * random_double(&rng);
+        sigma[i] = 0.1 + 0.5 * random_double(&rng);
+        T[i] = 7.0 / 365.0 + 2.0 * random_double(&rng);
+    }
+
+    double best = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        double t0 = now_seconds();
+        for (size_t i = 0; i < n; i++) call[i] = price_european_call_bs(S0[i], K[i], r[i], sigma[i], T[i]);
+        double t = now_seconds() - t0;
+        bench_sink = call[n / 2];
+        if (t < best) best = t;
+    }
+    emit("black_scholes", "price_european_call_bs", "scalar", 1, n, best, "");
+
+    bs_batch_inputs in = { S0, K, r, sigma, T };
+    bs_batch_outputs out = { .call = call, .put = put };
+    for (int level = SIMD_SCALAR; level <= (int)simd_detect(); level++) {
+        simd_limit((simd_level)level);
+        best = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            double t0 = now_seconds();
+            black_scholes_batch(&in, n, &out);
+            double t = now_seconds() - t0;
+            bench_sink = call[n / 2];
+            if (t < best) best = t;
+        }
+        emit("black_scholes", "black_scholes_batch", simd_level_name((simd_level)level), 1, n, best, "");
+    }
+    simd_limit(simd_detect());
+    free(mem);
+    return 0;
+}
+
+// Engine configurations: which sampler and variance reduction to run
+typedef struct {
+    const char *name;
+    mc_sampler sampler;
+    unsigned variance_reduction;
+    mc_precision precision;
+} bench_sampler;
+
+/**
+ * End-to-end engine throughput: one at-the-money call, and a chain of
+ * BENCH_CHAIN_STRIKES strikes from one set of paths, for every sampler,
+ * SIMD level, path count and thread count.
+ */
+static void bench_engine(const uint32_t *n_sims, size_t n_n_sims, const unsigned *threads,
+                         size_t n_threads, int repeats) {
+    static const bench_sampler samplers[] = {
+        { "pseudo", MC_SAMPLER_PSEUDO, MC_VR_NONE, MC_PRECISION_DOUBLE },
+        { "pseudo+av+cv", MC_SAMPLER_PSEUDO, MC_VR_ANTITHETIC | MC_VR_CONTROL, MC_PRECISION_DOUBLE },
+        { "pseudo-f32", MC_SAMPLER_PSEUDO, MC_VR_NONE, MC_PRECISION_FLOAT },
+        { "pseudo-f32+av+cv", MC_SAMPLER_PSEUDO, MC_VR_ANTITHETIC | MC_VR_CONTROL, MC_PRECISION_FLOAT },
+        { "sobol", MC_SAMPLER_SOBOL, MC_VR_NONE, MC_PRECISION_DOUBLE }
+    };
+    option_type types[BENCH_CHAIN_STRIKES];
+    double strikes[BENCH_CHAIN_STRIKES];
+    mc_result results[BENCH_CHAIN_STRIKES];
+    for (unsigned k = 0; k < BENCH_CHAIN_STRIKES; k++) {
+        types[k] = (k % 2) ? OPTION_PUT : OPTION_CALL;
+        strikes[k] = 70.0 + 60.0 * k / (BENCH_CHAIN_STRIKES - 1);
+    }
+
+    for (size_t s = 0; s < sizeof(samplers) / sizeof(samplers[0]); s++) {
+        for (int level = SIMD_SCALAR; level <= (int)simd_detect(); level++) {
+            simd_limit((simd_level)level);
+            char variant[48];
+            snprintf(variant, sizeof(variant), "%s/%s", samplers[s].name, simd_level_name((simd_level)level));
+            for (size_t i = 0; i < n_n_sims; i++) {
+                for (size_t t = 0; t < n_threads; t++) {
+                    mc_options opts = mc_options_default();
+                    opts.n_sim = n_sims[i];
+                    opts.n_threads = threads[t];
+                    opts.sampler = samplers[s].sampler;
+                    opts.variance_reduction = samplers[s].variance_reduction;
+                    opts.precision = samplers[s].precision;
+
+                    double best = INFINITY;
+                    mc_result res = { NAN, NAN, 0 };
+                    for (int rep = 0; rep < repeats; rep++) {
+                        double t0 = now_seconds();
+                        res = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+                        double dt = now_seconds() - t0;
+                        if (dt < best) best = dt;
+                    }
+                    char extra[160];
+                    snprintf(extra, sizeof(extra), ", \"options_per_sec\": %.3f, \"paths_per_sec\": %.1f, "
+                             "\"price\": %.10f, \"std_error\": %.3e",
+                             1.0 / best, (double)res.n_paths / best, res.price, res.std_error);
+                    emit("engine", "price_european_mc", variant, threads[t], res.n_paths, best, extra);
+
+                    best = INFINITY;
+                    for (int rep = 0; rep < repeats; rep++) {
+                        double t0 = now_seconds();
+                        price_european_chain_mc(100.0, 0.05, 0.2, 1.0, types, strikes, BENCH_CHAIN_STRIKES,
+                                                &opts, results);
+                        double dt = now_seconds() - t0;
+                        if (dt < best) best = dt;
+                    }
+                    // Items are contract-paths here: each path is priced against every strike
+                    uint64_t items = results[0].n_paths * BENCH_CHAIN_STRIKES;
+                    snprintf(extra, sizeof(extra), ", \"options_per_sec\": %.3f, \"paths_per_sec\": %.1f, "
+                             "\"contracts\": %u",
+                             BENCH_CHAIN_STRIKES / best, (double)results[0].n_paths / best, BENCH_CHAIN_STRIKES);
+                    emit("engine", "price_european_chain_mc", variant, threads[t], items, best, extra);
+                }
+            }
+        }
+    }
+    simd_limit(simd_detect());
+}
+
+/**
+ * Server-style load: many one-block requests on one thread, each through
+ * the allocating free function and through one reused mc_engine.
+ */
+static void bench_engine_context(unsigned n_requests, int repeats) {
+    const mc_engine_limits limits = { .max_contracts = 1, .max_paths = BENCH_BLOCK };
+    mc_engine engine;
+    if (mc_engine_init(&engine, &limits) != 0) {
+        fprintf(stderr, "Out of memory for the engine context\n");
+        return;
+    }
+    mc_options opts = mc_options_default();
+    opts.n_sim = BENCH_BLOCK;
+    opts.n_threads = 1;
+    option_type type = OPTION_CALL;
+    mc_result res;
+
+    // Alternate the two in every repeat so clock ramps hit both alike
+    double best[2] = { INFINITY, INFINITY };
+    for (int rep = 0; rep < repeats; rep++) {
+        for (int use_engine = 0; use_engine <= 1; use_engine++) {
+            double t0 = now_seconds();
+            for (unsigned i = 0; i < n_requests; i++) {
+                double K = 80.0 + 0.01 * (i % 4000);
+                opts.seed = i;
+                if (use_engine) {
+                    mc_engine_price_chain(&engine, 100.0, 0.05, 0.2, 1.0, &type, &K, 1, &opts, &res, NULL, NULL);
+                } else {
+                    price_european_chain_mc(100.0, 0.05, 0.2, 1.0, &type, &K, 1, &opts, &res);
+                }
+                bench_sink += res.price;
+            }
+            double dt = now_seconds() - t0;
+            if (dt < best[use_engine]) best[use_engine] = dt;
+        }
+    }
+    char extra[96];
+    snprintf(extra, sizeof(extra), ", \"paths_per_request\": %u", BENCH_BLOCK);
+    emit("engine", "small_request", "free-function", 1, n_requests, best[0], extra);
+    emit("engine", "small_request", "mc_engine", 1, n_requests, best[1], extra);
+    mc_engine_free(&engine);
+}
+
+/**
+ * Cost of reporting results, seen from the pricing thread: formatting every
+ * row inline with fprintf, against pushing rows to a results_writer whose
+ * thread formats them (CSV sink) or transposes them (columnar sink). The
+ * writer records give the producer's time and, separately, the time until
+ * close() returns with everything written. Output goes to /dev/null.
+ */
+static void bench_results_output(size_t n_rows, int repeats) {
+    result_row *rows = malloc(n_rows * sizeof(*rows));
+    if (!rows) {
+        fprintf(stderr, "Out of memory for %zu result rows\n", n_rows);
+        return;
+    }
+    for (size_t i = 0; i < n_rows; i++) {
+        rows[i] = (result_row){ .id = i, .ticker = "BENCH", .type = OPTION_CALL, .S0 = 100.0,
+                                .K = 80.0 + 0.01 * (double)(i % 4000), .r = 0.05, .sigma = 0.2, .T = 1.0,
+                                .price = 10.0 + 1e-4 * (double)i, .std_error = 0.01, .n_paths = 1u << 20,
+                                .greeks = { NAN, NAN, NAN, NAN, NAN }, .seconds = 1e-3 };
+    }
+
+    double best_inline = INFINITY;
+    for (int rep = 0; rep < repeats; rep++) {
+        FILE *fp = fopen("/dev/null", "w");
+        if (!fp) break;
+        double t0 = now_seconds();
+        for (size_t i = 0; i < n_rows; i++) {
+            const result_row *row = &rows[i];
+            fprintf(fp, "%llu,%s,call,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%llu\n",
+                    (unsigned long long)row->id, row->ticker, row->S0, row->K, row->r, row->sigma, row->T,
+                    row->market_price, row->price, row->std_error, (unsigned long long)row->n_paths);
+        }
+        fclose(fp);
+        double dt = now_seconds() - t0;
+        if (dt < best_inline) best_inline = dt;
+    }
+    emit("results", "write_rows", "fprintf-inline", 1, n_rows, best_inline, "");
+
+    // Rows arrive a request at a time, as a pricing loop would push them
+    const size_t per_push = 16;
+    for (int columnar = 0; columnar <= 1; columnar++) {
+        double best_push = INFINITY, best_total = INFINITY;
+        for (int rep = 0; rep < repeats; rep++) {
+            results_sink sink;
+            int opened = columnar ? results_sink_columnar(&sink, "/dev/null") : results_sink_csv(&sink, "/dev/null");
+            results_writer *w = (opened == 0) ? results_writer_open(&sink, 1, 0) : NULL;
+            if (!w) break;
+            double t0 = now_seconds();
+            for (size_t i = 0; i < n_rows; i += per_push) {
+                results_writer_push(w, rows + i, (n_rows - i < per_push) ? n_rows - i : per_push);
+            }
+            double t1 = now_seconds();
+            results_writer_close(w);
+            double t2 = now_seconds();
+            if (t1 - t0 < best_push) best_push = t1 - t0;
+            if (t2 - t0 < best_total) best_total = t2 - t0;
+        }
+        char extra[96];
+        snprintf(extra, sizeof(extra), ", \"total_seconds\": %.9f, \"rows_per_push\": %zu", best_total, per_push);
+        emit("results", "write_rows", columnar ? "writer-columnar" : "writer-csv", 1, n_rows, best_push, extra);
+    }
+    free(rows);
+}
+
+int main(int argc, char *argv[]) {
+    int quick = 0, repeats = 5;
+    unsigned max_threads = parallel_default_threads();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = (unsigned)atoi(argv[++i]);
+        } else {
+            repeats = 0;
+            break;
+        }
+    }
+    if (repeats <= 0 || max_threads == 0) {
+        fprintf(stderr, "Usage: %s [--quick] [--repeats N > 0] [--threads N > 0]\n", argv[0]);
+        return 1;
+    }
+
+    // Thread counts: 1, 2, 4, ... below max_threads, then max_threads itself
+    unsigned threads[32];
+    size_t n_threads = 0;
+    for (unsigned t = 1; t < max_threads && n_threads < 31; t *= 2) threads[n_threads++] = t;
+    threads[n_threads++] = max_threads;
+
+    size_t n_samples = quick ? (1u << 20) : (1u << 24);
+    size_t n_options = quick ? 100000u : 1000000u;
+    const uint32_t n_sims_full[] = { 1u << 16, 1u << 20, 1u << 22 };
+    const uint32_t n_sims_quick[] = { 1u << 14, 1u << 18 };
+    const uint32_t *n_sims = quick ? n_sims_quick : n_sims_full;
+    size_t n_n_sims = quick ? 2 : 3;
+
+    time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    printf("{\n  \"schema\": %d,\n  \"timestamp\": \"%s\",\n", BENCH_SCHEMA_VERSION, stamp);
+    printf("  \"config\": {\"quick\": %s, \"repeats\": %d, \"statistic\": \"min\", \"cores\": %u, "
+           "\"max_threads\": %u, \"simd\": \"%s\", \"chunk_paths\": %u},\n",
+           quick ? "true" : "false", repeats, parallel_default_threads(), max_threads,
+           simd_level_name(simd_detect()), MC_CHUNK_PATHS);
+    printf("  \"results\": [");
+
+    bench_rng(n_samples, repeats);
+    bench_path(n_samples / 4, repeats);
+    bench_kernels(n_samples / 4, repeats);
+    int status = bench_black_scholes(n_options, repeats);
+    bench_engine(n_sims, n_n_sims, threads, n_threads, repeats);
+    bench_engine_context(quick ? 20000u : 200000u, repeats);
+    bench_results_output(quick ? 100000u : 1000000u, repeats);
+
+    printf("\n  ]\n}\n");
+    if (status != 0) {
+        fprintf(stderr, "Out of memory for %zu Black-Scholes quotes\n", n_options);
+        return 1;
+    }
+    return 0;
+}
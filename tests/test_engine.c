@@ -0,0 +1,2271 @@
+//
+// Monte Carlo Engine Tests
+// Checks engine properties the real-stock table cannot show on its own:
+// reproducibility across thread counts and agreement with closed forms.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include "include/rng.h"
+#include "include/monte_carlo.h"
+#include "include/simd.h"
+#include "include/gbm.h"
+#include "include/option.h"
+#include "include/normal.h"
+#include "include/sobol.h"
+#include "include/brownian_bridge.h"
+#include "include/stats.h"
+#include "include/portfolio.h"
+#include "include/lsm.h"
+#include "include/philox.h"
+#include "include/black_scholes.h"
+#include "include/implied_vol.h"
+#include "include/model.h"
+#include "include/scenario.h"
+#include "include/market_data.h"
+#include "include/profile.h"
+#include "include/server.h"
+#include "include/cache.h"
+#include "include/parallel.h"
+#include "include/mlmc.h"
+#include "include/results.h"
+#include "include/kernel.h"
+#ifdef MC_GPU
+#include "include/gpu.h"
+#endif
+
+static int g_failures = 0;
+
+/**
+ * Record and print the outcome of one check.
+ */
+static void check(int ok, const char *name) {
+    printf("  [%s] %s\n", ok ? "PASS" : "FAIL", name);
+    if (!ok) {
+        g_failures++;
+    }
+}
+
+/**
+ * Two doubles are bit-identical (stricter than ==, which treats -0 == +0).
+ */
+static int same_bits(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/**
+ * Substreams must not just be the same sequence shifted by a few draws.
+ */
+static void test_rng_streams(void) {
+    printf("RNG streams\n");
+
+    rng_state a, b;
+    rng_stream(&a, 42, 0);
+    rng_stream(&b, 42, 0);
+    int same = 1;
+    for (int i = 0; i < 1000; i++) {
+        same &= (rng_next(&a) == rng_next(&b));
+    }
+    check(same, "same seed and stream give the same sequence");
+
+    rng_stream(&a, 42, 0);
+    rng_stream(&b, 42, 1);
+    uint64_t first[64];
+    for (int i = 0; i < 64; i++) {
+        first[i] = rng_next(&a);
+    }
+    int overlap = 0;
+    for (int i = 0; i < 4096; i++) {
+        uint64_t x = rng_next(&b);
+        for (int j = 0; j < 64; j++) {
+            overlap |= (x == first[j]);
+        }
+    }
+    check(!overlap, "stream 1 does not replay stream 0");
+
+    double sum = 0.0, sum_sq = 0.0;
+    rng_seed(&a, 7);
+    for (int i = 0; i < 200000; i++) {
+        double z = normal_random(&a);
+        sum += z;
+        sum_sq += z * z;
+    }
+    double mean = sum / 200000.0;
+    double var = sum_sq / 200000.0 - mean * mean;
+    check(fabs(mean) < 0.01 && fabs(var - 1.0) < 0.02, "normal_random has mean 0 and variance 1");
+}
+
+/**
+ * normal_fill() must agree with the scalar Box-Muller on every kernel.
+ */
+static void test_normal_fill(void) {
+    printf("Batch normals (%s)\n", simd_level_name(simd_active()));
+
+    enum { N = 100001 };  // Odd, and not a multiple of the SIMD width
+    static double fast[N], ref[N];
+    rng_state a, b;
+
+    rng_seed(&a, 11);
+    normal_fill(&a, fast, N);
+    simd_limit(SIMD_SCALAR);
+    rng_seed(&b, 11);
+    normal_fill(&b, ref, N);
+    simd_limit(SIMD_AVX2);
+
+    double max_diff = 0.0;
+    for (int i = 0; i < N; i++) {
+        double d = fabs(fast[i] - ref[i]);
+        if (d > max_diff) max_diff = d;
+    }
+    check(max_diff < 1e-13, "SIMD and scalar kernels agree to rounding");
+    check(rng_next(&a) == rng_next(&b), "both kernels leave the stream at the same position");
+
+    // The cosine half alone is what normal_random() returns
+    rng_seed(&b, 11);
+    check(fabs(normal_random(&b) - ref[0]) < 1e-15, "first sample matches normal_random()");
+
+    double sum = 0.0, sum_sq = 0.0, sum_cross = 0.0;
+    for (int i = 0; i < N; i++) {
+        sum += fast[i];
+        sum_sq += fast[i] * fast[i];
+        if (i % 2 == 1) sum_cross += fast[i] * fast[i - 1];
+    }
+    double mean = sum / N;
+    check(fabs(mean) < 0.01 && fabs(sum_sq / N - mean * mean - 1.0) < 0.02,
+          "batch normals have mean 0 and variance 1");
+    check(fabs(sum_cross / (N / 2)) < 0.02, "cosine and sine halves are uncorrelated");
+}
+
+/**
+ * Block kernels (terminal prices, payoff sums) must match the per-path functions.
+ */
+static void test_block_kernels(void) {
+    printf("Block kernels (%s)\n", simd_level_name(simd_active()));
+
+    enum { N = 1003 };
+    double z[N], ST[N];
+    rng_state rng;
+    rng_seed(&rng, 5);
+    normal_fill(&rng, z, N);
+
+    gbm_terminal g = gbm_terminal_init(100.0, 0.05, 0.3, 0.75);
+    gbm_terminal_fill(&g, z, ST, N);
+
+    double max_rel = 0.0, call_ref = 0.0, put_ref = 0.0;
+    for (int i = 0; i < N; i++) {
+        double ref = 100.0 * exp((0.05 - 0.5 * 0.3 * 0.3) * 0.75 + 0.3 * sqrt(0.75) * z[i]);
+        double rel = fabs(ST[i] - ref) / ref;
+        if (rel > max_rel) max_rel = rel;
+        call_ref += call_payoff(ST[i], 105.0);
+        put_ref += put_payoff(ST[i], 105.0);
+    }
+    check(max_rel < 1e-14, "gbm_terminal_fill matches the closed-form GBM price");
+    check(fabs(call_payoff_sum(ST, N, 105.0) - call_ref) < 1e-9 * call_ref, "call_payoff_sum matches call_payoff");
+    check(fabs(put_payoff_sum(ST, N, 105.0) - put_ref) < 1e-9 * put_ref, "put_payoff_sum matches put_payoff");
+}
+
+/**
+ * The threaded engine must return the same bits for any thread count.
+ */
+static void test_thread_determinism(void) {
+    printf("Threaded engine\n");
+
+    // Not a multiple of MC_CHUNK_PATHS, so the short last chunk is exercised
+    uint32_t n_sim = 5 * MC_CHUNK_PATHS + 1234;
+    double p1 = price_european_call_mc_mt(100.0, 100.0, 0.05, 0.2, 1.0, n_sim, 99u, 1);
+    double p2 = price_european_call_mc_mt(100.0, 100.0, 0.05, 0.2, 1.0, n_sim, 99u, 2);
+    double p7 = price_european_call_mc_mt(100.0, 100.0, 0.05, 0.2, 1.0, n_sim, 99u, 7);
+    check(same_bits(p1, p2) && same_bits(p1, p7), "1, 2 and 7 threads give identical prices");
+
+    double other = price_european_call_mc_mt(100.0, 100.0, 0.05, 0.2, 1.0, n_sim, 100u, 2);
+    check(!same_bits(p1, other), "a different seed gives a different price");
+
+    double bs = price_european_call_bs(100.0, 100.0, 0.05, 0.2, 1.0);
+    double mc = price_european_call_mc_mt(100.0, 100.0, 0.05, 0.2, 1.0, 1u << 20, 1u, 0);
+    check(fabs(mc - bs) / bs < 0.01, "threaded price is within 1% of Black-Scholes");
+}
+
+/**
+ * Every variance-reduction mode must stay unbiased and actually cut the error.
+ */
+static void test_variance_reduction(void) {
+    printf("Variance reduction\n");
+
+    const double S0 = 100.0, K = 100.0, r = 0.05, sigma = 0.2, T = 1.0;
+    double bs_call = price_european_call_bs(S0, K, r, sigma, T);
+    double bs_put = bs_call - S0 + K * exp(-r * T);   // Put-call parity
+
+    const unsigned modes[] = { MC_VR_NONE, MC_VR_ANTITHETIC, MC_VR_CONTROL,
+                               MC_VR_ANTITHETIC | MC_VR_CONTROL };
+    mc_result res[4];
+    int unbiased = 1;
+    for (int i = 0; i < 4; i++) {
+        mc_options opts = mc_options_default();
+        opts.n_sim = 200000;
+        opts.seed = 3;
+        opts.variance_reduction = modes[i];
+        res[i] = price_european_mc(OPTION_CALL, S0, K, r, sigma, T, &opts);
+        unbiased &= fabs(res[i].price - bs_call) < 4.0 * res[i].std_error;
+
+        mc_result put = price_european_mc(OPTION_PUT, S0, K, r, sigma, T, &opts);
+        unbiased &= fabs(put.price - bs_put) < 4.0 * put.std_error;
+    }
+    check(unbiased, "calls and puts agree with Black-Scholes within 4 standard errors");
+    check(res[1].std_error < res[0].std_error, "antithetic pairs reduce the standard error");
+    check(res[2].std_error < 0.5 * res[0].std_error, "control variate at least halves the standard error");
+    check(res[3].std_error < res[0].std_error / sqrt(5.0), "combined modes give >5x variance reduction");
+}
+
+/**
+ * Building blocks of the QMC engine: inverse CDF, Sobol points, Brownian bridge.
+ */
+static void test_qmc_building_blocks(void) {
+    printf("QMC building blocks\n");
+
+    // Compare tail probabilities with erfc: 1 + erf(x) cancels badly far out
+    double max_err = 0.0;
+    for (double p = 1e-12; p < 0.5; p *= 1.7) {
+        double lo = 0.5 * erfc(-normal_inv_cdf(p) / sqrt(2.0));
+        double upper = 1.0 - p;              // Rounded; its exact tail is 1 - upper
+        double tail = 1.0 - upper;
+        double hi = 0.5 * erfc(normal_inv_cdf(upper) / sqrt(2.0));
+        double err = fmax(fabs(lo - p) / p, fabs(hi - tail) / tail);
+        if (err > max_err) max_err = err;
+    }
+    check(max_err < 1e-12, "normal_inv_cdf inverts the normal CDF in both tails");
+    check(normal_inv_cdf(0.5) == 0.0 && fabs(normal_inv_cdf(0.975) - 1.959963984540054) < 1e-14,
+          "normal_inv_cdf hits known quantiles");
+
+    // (0,m,1)-property: the first 2^m points hit every 2^-m interval exactly once
+    enum { M = 10, N = 1 << M };
+    sobol_state sobol;
+    sobol_init(&sobol, SOBOL_MAX_DIM);
+    static int hits[SOBOL_MAX_DIM][N];
+    double point[SOBOL_MAX_DIM];
+    for (int i = 0; i < N; i++) {
+        sobol_next(&sobol, point);
+        for (unsigned d = 0; d < SOBOL_MAX_DIM; d++) {
+            hits[d][(int)(point[d] * N)]++;
+        }
+    }
+    int stratified = 1;
+    for (unsigned d = 0; d < SOBOL_MAX_DIM; d++) {
+        for (int k = 0; k < N; k++) {
+            stratified &= (hits[d][k] == 1);
+        }
+    }
+    check(stratified, "every Sobol dimension is stratified over 2^10 points");
+
+    double after[SOBOL_MAX_DIM];
+    sobol_next(&sobol, point);          // Point N
+    sobol_skip(&sobol, N);
+    sobol_next(&sobol, after);
+    int same = 1;
+    for (unsigned d = 0; d < SOBOL_MAX_DIM; d++) {
+        same &= (point[d] == after[d]);
+    }
+    check(same, "sobol_skip lands on the same point as stepping");
+
+    // The bridge is a linear map L of the normals; L L^T must be min(t_i, t_j)
+    enum { STEPS = 7 };
+    brownian_bridge bb;
+    brownian_bridge_init(&bb, STEPS, 2.0);
+    double L[STEPS][STEPS];
+    for (int k = 0; k < STEPS; k++) {
+        double z[STEPS] = {0}, dW[STEPS];
+        z[k] = 1.0;
+        brownian_bridge_build(&bb, z, dW);
+        double w = 0.0;
+        for (int i = 0; i < STEPS; i++) {
+            w += dW[i];
+            L[i][k] = w;
+        }
+    }
+    double max_cov_err = 0.0;
+    for (int i = 0; i < STEPS; i++) {
+        for (int j = 0; j < STEPS; j++) {
+            double cov = 0.0;
+            for (int k = 0; k < STEPS; k++) cov += L[i][k] * L[j][k];
+            double expected = bb.dt * ((i < j ? i : j) + 1);
+            if (fabs(cov - expected) > max_cov_err) max_cov_err = fabs(cov - expected);
+        }
+    }
+    brownian_bridge_free(&bb);
+    check(max_cov_err < 1e-12, "Brownian bridge reproduces Cov(W_s, W_t) = min(s, t)");
+}
+
+/**
+ * Randomized QMC must be unbiased and beat pseudo-random sampling by a wide margin.
+ */
+static void test_qmc_engine(void) {
+    printf("Quasi-Monte Carlo engine\n");
+
+    double bs = price_european_call_bs(100.0, 100.0, 0.05, 0.2, 1.0);
+    mc_options opts = mc_options_default();
+    opts.n_sim = 1u << 18;
+    mc_result pseudo = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+
+    opts.sampler = MC_SAMPLER_SOBOL;
+    mc_result qmc = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(fabs(qmc.price - bs) < 4.0 * qmc.std_error + 1e-6, "Sobol price agrees with Black-Scholes");
+    check(qmc.std_error < pseudo.std_error / 20.0, "Sobol standard error is >20x smaller at 2^18 paths");
+
+    opts.n_threads = 3;
+    mc_result qmc3 = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(same_bits(qmc.price, qmc3.price), "Sobol price does not depend on the thread count");
+
+    // One replicate (or none) cannot measure its own error: the call fails instead of reporting 0
+    path_option asian = { OPTION_CALL, 100.0, AVERAGE_ARITHMETIC, BARRIER_NONE, 0.0, MONITOR_DISCRETE, 8 };
+    int rejected = 1;
+    for (unsigned n_rep = 0; n_rep < 2; n_rep++) {
+        opts.n_replicates = n_rep;
+        mc_result chain;
+        rejected &= price_european_chain_mc(100.0, 0.05, 0.2, 1.0, &(option_type){ OPTION_CALL },
+                                            &(double){ 100.0 }, 1, &opts, &chain) == -1
+                    && isnan(chain.price) && isnan(chain.std_error)
+                    && isnan(price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts).std_error);
+    }
+    check(rejected, "Sobol runs with fewer than 2 replicates fail with NAN");
+}
+
+/**
+ * Welford statistics must stay exact where naive sums of squares break down.
+ */
+static void test_online_stats(void) {
+    printf("Online statistics\n");
+
+    // Values 1e9 + {0, 1, 2, 3}: variance 5/3, but Σy² ~ 4e18 loses it entirely
+    enum { N = 4000 };
+    double y[N];
+    for (int i = 0; i < N; i++) {
+        y[i] = 1e9 + (i % 4);
+    }
+    mc_moments all = {0}, parts = {0}, a = {0}, b = {0};
+    moments_add_block(&all, y, NULL, N);
+    moments_add_block(&a, y, NULL, 1000);
+    moments_add_block(&b, y + 1000, NULL, N - 1000);
+    moments_merge(&parts, &a);
+    moments_merge(&parts, &b);
+
+    double exact = 1.25 * N / (N - 1);
+    check(fabs(moments_variance(&all) - exact) < 1e-9, "variance is exact around a large mean");
+    check(fabs(moments_variance(&parts) - exact) < 1e-9 && moments_mean(&parts) == 1e9 + 1.5,
+          "merged blocks give the same mean and variance");
+}
+
+/**
+ * Adaptive runs stop once the error target is met, and stop at the same
+ * place for any thread count.
+ */
+static void test_early_stopping(void) {
+    printf("Early stopping\n");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 50000000;
+    opts.rel_tol = 1e-3;
+    opts.n_threads = 1;
+    mc_result one = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+    opts.n_threads = 4;
+    mc_result four = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+
+    check(one.std_error <= 1e-3 * one.price, "stops with std error below the relative tolerance");
+    check(one.n_paths < opts.n_sim && one.n_paths % MC_DEFAULT_BATCH_PATHS == 0,
+          "stops early, on a batch boundary");
+    check(one.n_paths == four.n_paths && same_bits(one.price, four.price),
+          "stopping point does not depend on the thread count");
+
+    // With an absolute target, a deep out-of-the-money call is far cheaper
+    opts.rel_tol = 0.0;
+    opts.abs_tol = 0.005;
+    mc_result atm = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+    mc_result otm = price_european_mc(OPTION_CALL, 100.0, 160.0, 0.05, 0.2, 1.0, &opts);
+    check(otm.n_paths * 10 < atm.n_paths, "deep OTM option needs >10x fewer paths than ATM");
+
+    opts.abs_tol = 0.0;
+    opts.n_sim = 100000;
+    check(price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts).n_paths == 100000,
+          "without a tolerance all n_sim paths are used");
+}
+
+/**
+ * A chain shares its paths: every contract must match pricing it alone,
+ * bit for bit, and the portfolio API must route results back to the
+ * input order whatever the grouping.
+ */
+static void test_option_chain(void) {
+    printf("Option chains and portfolios\n");
+
+    static const double strikes[] = {80.0, 95.0, 100.0, 100.0, 120.0, 60.0};
+    static const option_type types[] = {OPTION_CALL, OPTION_PUT, OPTION_CALL, OPTION_PUT, OPTION_CALL, OPTION_PUT};
+    enum { N = sizeof(strikes) / sizeof(strikes[0]) };
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 50000;
+    opts.n_threads = 2;
+
+    int identical = 1;
+    static const unsigned vr_modes[] = {MC_VR_NONE, MC_VR_ANTITHETIC | MC_VR_CONTROL};
+    for (int v = 0; v < 2; v++) {
+        opts.variance_reduction = vr_modes[v];
+        mc_result chain[N];
+        identical &= price_european_chain_mc(100.0, 0.05, 0.2, 1.0, types, strikes, N, &opts, chain) == 0;
+        for (int k = 0; k < N; k++) {
+            mc_result alone = price_european_mc(types[k], 100.0, strikes[k], 0.05, 0.2, 1.0, &opts);
+            identical &= same_bits(chain[k].price, alone.price) &&
+                         same_bits(chain[k].std_error, alone.std_error) &&
+                         chain[k].n_paths == alone.n_paths;
+        }
+    }
+    check(identical, "chain results are bit-identical to pricing each contract alone");
+
+    // Same paths for every strike: put-call parity holds up to the error of
+    // the simulated forward, which is the same for every strike
+    opts.variance_reduction = MC_VR_NONE;
+    mc_result pair[2];
+    static const option_type call_put[] = {OPTION_CALL, OPTION_PUT};
+    static const double same_strike[] = {110.0, 110.0};
+    price_european_chain_mc(100.0, 0.05, 0.2, 1.0, call_put, same_strike, 2, &opts, pair);
+    double gap_110 = pair[0].price - pair[1].price - (100.0 - 110.0 * exp(-0.05));
+    static const double strike_90[] = {90.0, 90.0};
+    price_european_chain_mc(100.0, 0.05, 0.2, 1.0, call_put, strike_90, 2, &opts, pair);
+    double gap_90 = pair[0].price - pair[1].price - (100.0 - 90.0 * exp(-0.05));
+    check(fabs(gap_110 - gap_90) < 1e-9, "shared paths: parity gap is the same at every strike");
+
+    // Interleaved contracts on two underlyings, grouped internally
+    option_contract book[4] = {
+        { {100.0, 0.05, 0.2, 1.0}, 100.0, OPTION_CALL },
+        { {50.0, 0.03, 0.4, 0.5},  45.0,  OPTION_PUT },
+        { {100.0, 0.05, 0.2, 1.0}, 110.0, OPTION_PUT },
+        { {50.0, 0.03, 0.4, 0.5},  55.0,  OPTION_CALL },
+    };
+    mc_result book_res[4];
+    int routed = price_portfolio_mc(book, 4, &opts, book_res) == 0;
+    for (int i = 0; i < 4; i++) {
+        const stock_params *s = &book[i].stock;
+        mc_result alone = price_european_mc(book[i].type, s->initial_price, book[i].strike,
+                                            s->interest_rate, s->volatility, s->maturity, &opts);
+        routed &= same_bits(book_res[i].price, alone.price);
+    }
+    check(routed, "portfolio groups by underlying and returns results in input order");
+
+    // A NaN underlying fails on its own; the rest of the book still prices
+    book[1].stock.volatility = NAN;
+    int failed = price_portfolio_mc(book, 4, &opts, book_res) == -1 && isnan(book_res[1].price);
+    const stock_params *s0 = &book[0].stock;
+    mc_result alone = price_european_mc(book[0].type, s0->initial_price, book[0].strike,
+                                        s0->interest_rate, s0->volatility, s0->maturity, &opts);
+    check(failed && same_bits(book_res[0].price, alone.price) && !isnan(book_res[3].price),
+          "a non-finite contract gets NAN without stalling the rest of the portfolio");
+}
+
+/**
+ * One-pass Greeks must agree with the closed-form Black-Scholes Greeks,
+ * and computing them must not change the price.
+ */
+static void test_greeks(void) {
+    printf("Greeks\n");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 400000;
+    opts.variance_reduction = MC_VR_ANTITHETIC;
+
+    int within = 1, same_price = 1;
+    for (int t = 0; t < 2; t++) {
+        option_type type = t ? OPTION_PUT : OPTION_CALL;
+        option_greeks mc, se;
+        mc_result with = price_european_greeks_mc(type, 100.0, 95.0, 0.05, 0.25, 0.75, &opts, &mc, &se);
+        mc_result without = price_european_mc(type, 100.0, 95.0, 0.05, 0.25, 0.75, &opts);
+        option_greeks bs = greeks_european_bs(type, 100.0, 95.0, 0.05, 0.25, 0.75);
+        same_price &= same_bits(with.price, without.price);
+
+        const double m[] = { mc.delta, mc.gamma, mc.vega, mc.rho, mc.theta };
+        const double e[] = { se.delta, se.gamma, se.vega, se.rho, se.theta };
+        const double b[] = { bs.delta, bs.gamma, bs.vega, bs.rho, bs.theta };
+        for (int g = 0; g < 5; g++) {
+            within &= fabs(m[g] - b[g]) < 5.0 * e[g] && e[g] < 0.01 * fabs(b[g]);
+        }
+    }
+    check(within, "delta/gamma/vega/rho/theta within 5 std errors of Black-Scholes");
+    check(same_price, "price is unchanged when Greeks are requested");
+
+    // The closed forms satisfy put-call parity: delta_C - delta_P = 1
+    option_greeks call = greeks_european_bs(OPTION_CALL, 100.0, 110.0, 0.03, 0.3, 2.0);
+    option_greeks put = greeks_european_bs(OPTION_PUT, 100.0, 110.0, 0.03, 0.3, 2.0);
+    check(fabs(call.delta - put.delta - 1.0) < 1e-12 && fabs(call.gamma - put.gamma) < 1e-15,
+          "Black-Scholes Greeks satisfy put-call parity");
+
+    // A finite difference of the closed-form price checks the vega formula
+    double h = 1e-5;
+    double fd_vega = (price_european_call_bs(100.0, 110.0, 0.03, 0.3 + h, 2.0) -
+                      price_european_call_bs(100.0, 110.0, 0.03, 0.3 - h, 2.0)) / (2.0 * h);
+    check(fabs(fd_vega - call.vega) < 1e-5, "Black-Scholes vega matches a finite difference");
+}
+
+/**
+ * Whole-path simulation: exact at the grid points, and streaming gives
+ * exactly the same paths as the stored buffer.
+ */
+static void test_path_engine(void) {
+    printf("Multi-step paths\n");
+
+    enum { N_PATHS = 1000, N_STEPS = 12 };
+    const double S0 = 100.0, r = 0.05, sigma = 0.3, T = 1.0;
+    gbm_path g = gbm_path_init(S0, r, sigma, T, N_STEPS);
+    gbm_path_buffer buf;
+    check(gbm_path_buffer_init(&buf, N_STEPS, N_PATHS) == 0, "path buffer allocates");
+
+    // The last row equals the closed form driven by the summed shocks
+    rng_state rng, replay;
+    rng_seed(&rng, 11u);
+    replay = rng;
+    gbm_path_fill(&g, &rng, &buf, N_PATHS);
+    static double shocks[N_STEPS][N_PATHS];
+    for (int t = 0; t < N_STEPS; t++) {
+        normal_fill(&replay, shocks[t], N_PATHS);
+    }
+    double worst = 0.0;
+    const double *last = gbm_path_row(&buf, N_STEPS);
+    for (int i = 0; i < N_PATHS; i++) {
+        double z_sum = 0.0;
+        for (int t = 0; t < N_STEPS; t++) {
+            z_sum += shocks[t][i];
+        }
+        double exact = S0 * exp(N_STEPS * g.drift + g.vol * z_sum);
+        worst = fmax(worst, fabs(last[i] / exact - 1.0));
+    }
+    check(worst < 1e-12, "terminal row matches the closed form for the same shocks");
+
+    // Streaming keeps only running statistics but sees identical paths
+    static double sum[N_PATHS], max[N_PATHS], min[N_PATHS], S[N_PATHS], z[N_PATHS];
+    gbm_path_stats stats = { sum, max, min };
+    gbm_path_stats_reset(&stats, N_PATHS);
+    rng_seed(&rng, 11u);
+    gbm_path_stream(&g, &rng, S, z, N_PATHS, gbm_path_stats_update, &stats);
+    int same = 1;
+    for (int i = 0; i < N_PATHS; i++) {
+        double b_sum = 0.0, b_max = -INFINITY, b_min = INFINITY;
+        for (int t = 1; t <= N_STEPS; t++) {
+            double v = gbm_path_row(&buf, t)[i];
+            b_sum += v;
+            b_max = fmax(b_max, v);
+            b_min = fmin(b_min, v);
+        }
+        same &= same_bits(sum[i], b_sum) && same_bits(max[i], b_max) && same_bits(min[i], b_min);
+    }
+    check(same, "streaming statistics equal those of the stored paths");
+
+    // Mean of the arithmetic average over the monitoring dates
+    mc_moments m = {0};
+    for (int block = 0; block < 200; block++) {
+        gbm_path_stats_reset(&stats, N_PATHS);
+        gbm_path_stream(&g, &rng, S, z, N_PATHS, gbm_path_stats_update, &stats);
+        for (int i = 0; i < N_PATHS; i++) {
+            sum[i] /= N_STEPS;
+        }
+        moments_add_block(&m, sum, NULL, N_PATHS);
+    }
+    double expected = 0.0;
+    for (int t = 1; t <= N_STEPS; t++) {
+        expected += S0 * exp(r * t * g.dt) / N_STEPS;
+    }
+    double se = sqrt(moments_variance(&m) / (double)m.n);
+    check(fabs(moments_mean(&m) - expected) < 4.0 * se, "average price matches its exact expectation");
+
+    gbm_path_buffer_free(&buf);
+}
+
+/**
+ * Continuously monitored down-and-out call, H <= K (Reiner-Rubinstein).
+ */
+static double down_and_out_call(double S0, double K, double H, double r, double sigma, double T) {
+    double lambda = (r + 0.5 * sigma * sigma) / (sigma * sigma);
+    double vol = sigma * sqrt(T);
+    double y = log(H * H / (S0 * K)) / vol + lambda * vol;
+    double down_in = S0 * pow(H / S0, 2.0 * lambda) * normal_cdf(y)
+                   - K * exp(-r * T) * pow(H / S0, 2.0 * lambda - 2.0) * normal_cdf(y - vol);
+    return price_european_call_bs(S0, K, r, sigma, T) - down_in;
+}
+
+/**
+ * Asian and barrier payoffs on the path engine, against closed forms.
+ */
+static void test_path_payoffs(void) {
+    printf("Asian and barrier options\n");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 100000;
+    path_option asian = { OPTION_CALL, 100.0, AVERAGE_GEOMETRIC, BARRIER_NONE, 0.0, MONITOR_DISCRETE, 12 };
+
+    mc_result geo = price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts);
+    double geo_exact = price_geometric_asian_bs(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, 12);
+    check(fabs(geo.price - geo_exact) < 4.0 * geo.std_error, "geometric Asian matches its closed form");
+
+    asian.average = AVERAGE_ARITHMETIC;
+    mc_result plain = price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts);
+    opts.variance_reduction = MC_VR_CONTROL;
+    mc_result cv = price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(cv.std_error * 10.0 < plain.std_error && fabs(cv.price - plain.price) < 4.0 * plain.std_error,
+          "geometric control variate cuts the arithmetic Asian std error >10x");
+
+    opts.n_threads = 1;
+    mc_result one = price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts);
+    opts.n_threads = 3;
+    mc_result three = price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(same_bits(one.price, three.price), "path engine is bit-identical across thread counts");
+
+    // A coarse grid with the bridge correction prices the continuous barrier
+    opts.variance_reduction = MC_VR_NONE;
+    path_option barrier = { OPTION_CALL, 100.0, AVERAGE_NONE, BARRIER_DOWN_OUT, 90.0, MONITOR_CONTINUOUS, 8 };
+    double exact = down_and_out_call(100.0, 100.0, 90.0, 0.05, 0.2, 1.0);
+    mc_result bridged = price_path_mc(&barrier, 100.0, 0.05, 0.2, 1.0, &opts);
+    barrier.monitoring = MONITOR_DISCRETE;
+    mc_result discrete = price_path_mc(&barrier, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(fabs(bridged.price - exact) < 4.0 * bridged.std_error,
+          "8-step bridge-corrected barrier matches the continuous closed form");
+    check(discrete.price - exact > 10.0 * discrete.std_error,
+          "8-step discrete monitoring alone is visibly biased");
+
+    // Knock-in + knock-out = vanilla on the same paths
+    barrier.monitoring = MONITOR_CONTINUOUS;
+    mc_result out = price_path_mc(&barrier, 100.0, 0.05, 0.2, 1.0, &opts);
+    barrier.barrier = BARRIER_DOWN_IN;
+    mc_result in = price_path_mc(&barrier, 100.0, 0.05, 0.2, 1.0, &opts);
+    barrier.barrier = BARRIER_NONE;
+    mc_result vanilla = price_path_mc(&barrier, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(fabs(in.price + out.price - vanilla.price) < 1e-9, "knock-in + knock-out = vanilla");
+
+    // Sobol points through the Brownian bridge
+    opts.sampler = MC_SAMPLER_SOBOL;
+    mc_result qmc = price_path_mc(&asian, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(fabs(qmc.price - cv.price) < 4.0 * (qmc.std_error + cv.std_error) && qmc.std_error * 5.0 < plain.std_error,
+          "Sobol + Brownian bridge prices the Asian with a smaller error");
+}
+
+/**
+ * Longstaff-Schwartz American pricing against the paper's test case.
+ */
+static void test_lsm(void) {
+    printf("American options (Longstaff-Schwartz)\n");
+
+    // Longstaff & Schwartz (2001), Table 1: S0 = 36, finite-difference value 4.478
+    mc_options opts = mc_options_default();
+    opts.n_sim = 100000;
+    american_option put = { OPTION_PUT, 40.0, 50, LSM_BASIS_LAGUERRE, 3 };
+    mc_result laguerre = price_american_lsm(&put, 36.0, 0.06, 0.2, 1.0, &opts);
+    check(fabs(laguerre.price - 4.478) < 4.0 * laguerre.std_error + 0.01,
+          "Laguerre basis matches the Longstaff-Schwartz put");
+    put.basis = LSM_BASIS_POLYNOMIAL;
+    mc_result poly = price_american_lsm(&put, 36.0, 0.06, 0.2, 1.0, &opts);
+    check(fabs(poly.price - 4.478) < 4.0 * poly.std_error + 0.01,
+          "polynomial basis matches the Longstaff-Schwartz put");
+
+    // European put by parity: P = C - S0 + K e^(-rT)
+    double eu_call = price_european_call_bs(36.0, 40.0, 0.06, 0.2, 1.0);
+    double european = eu_call - 36.0 + 40.0 * exp(-0.06);
+    check(poly.price > european + 0.3, "early-exercise premium over the European put");
+
+    // Without dividends an American call is never exercised early
+    american_option call = { OPTION_CALL, 40.0, 50, LSM_BASIS_POLYNOMIAL, 3 };
+    mc_result am_call = price_american_lsm(&call, 36.0, 0.06, 0.2, 1.0, &opts);
+    check(fabs(am_call.price - eu_call) < 4.0 * am_call.std_error, "American call = European call");
+
+    opts.n_threads = 1;
+    mc_result one = price_american_lsm(&put, 36.0, 0.06, 0.2, 1.0, &opts);
+    opts.n_threads = 3;
+    mc_result three = price_american_lsm(&put, 36.0, 0.06, 0.2, 1.0, &opts);
+    check(same_bits(one.price, three.price), "LSM is bit-identical across thread counts");
+}
+
+/**
+ * Philox against the Random123 known-answer vectors (the GPU backend's RNG).
+ */
+static void test_philox(void) {
+    printf("Philox counter-based RNG\n");
+
+    static const uint32_t kat[3][10] = {
+        { 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u,
+          0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u },
+        { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu,
+          0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu },
+        { 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u, 0xa4093822u, 0x299f31d0u,
+          0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u },
+    };
+    int match = 1;
+    for (int i = 0; i < 3; i++) {
+        philox_ctr c = {{ kat[i][0], kat[i][1], kat[i][2], kat[i][3] }};
+        philox_key k = {{ kat[i][4], kat[i][5] }};
+        philox_ctr out = philox4x32_10(c, k);
+        for (int j = 0; j < 4; j++) {
+            match &= (out.v[j] == kat[i][6 + j]);
+        }
+    }
+    check(match, "Philox4x32-10 matches the reference vectors");
+
+    double lo = philox_uniform(0u, 0u), hi = philox_uniform(0xffffffffu, 0xffffffffu);
+    check(lo > 0.0 && hi < 1.0, "uniforms stay strictly inside (0, 1)");
+}
+
+#ifdef MC_GPU
+/**
+ * The GPU backend (make gpu) against closed forms and the CPU-side invariants.
+ */
+static void test_gpu(void) {
+    printf("GPU backend\n");
+    if (!gpu_available()) {
+        printf("  [SKIP] no CUDA device\n");
+        return;
+    }
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 1000000;
+    option_type types[10];
+    double strikes[10];
+    mc_result res[10];
+    for (int i = 0; i < 10; i++) {
+        types[i] = (i % 2) ? OPTION_PUT : OPTION_CALL;
+        strikes[i] = 80.0 + 10.0 * (i / 2);
+    }
+    int ok = price_european_chain_mc(100.0, 0.05, 0.2, 1.0, types, strikes, 10, &opts, res) == 0;
+    for (int i = 0; ok && i < 10; i += 2) {
+        double bs = price_european_call_bs(100.0, strikes[i], 0.05, 0.2, 1.0);
+        double parity = res[i].price - res[i + 1].price - (100.0 - strikes[i] * exp(-0.05));
+        ok = fabs(res[i].price - bs) < 4.0 * res[i].std_error && fabs(parity) < 1e-9 * 100.0 + 4.0 * res[i].std_error;
+    }
+    check(ok, "10-contract chain (two device passes) matches Black-Scholes");
+
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    mc_result vr = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(fabs(vr.price - price_european_call_bs(100.0, 100.0, 0.05, 0.2, 1.0)) < 4.0 * vr.std_error &&
+          vr.std_error * 2.0 < res[4].std_error, "antithetic + control variate on the device");
+
+    mc_result again = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+    check(same_bits(vr.price, again.price), "device results are reproducible");
+
+    // Deep in the money with a small spread: the payoff mean dwarfs its standard
+    // deviation, so raw sums of squares would cancel; the shifted device sums
+    // must give the same per-path spread as the CPU's Welford statistics
+    opts.variance_reduction = MC_VR_NONE;
+    opts.n_sim = 100000000;
+    mc_result deep = price_european_mc(OPTION_CALL, 1000.0, 100.0, 0.05, 0.002, 1.0, &opts);
+    opts.n_sim = 1000000;
+    mc_result cpu;
+    option_greeks unused;
+    const option_type call = OPTION_CALL;
+    const double K = 100.0;
+    price_european_chain_greeks_mc(1000.0, 0.05, 0.002, 1.0, &call, &K, 1, &opts, &cpu, &unused, NULL);
+    double spread_gpu = deep.std_error * sqrt((double)deep.n_paths);
+    double spread_cpu = cpu.std_error * sqrt((double)cpu.n_paths);
+    check(spread_gpu > 0.0 && fabs(spread_gpu / spread_cpu - 1.0) < 0.02,
+          "deep in-the-money standard error keeps its digits on the device");
+}
+#endif
+
+/**
+ * Batch Black-Scholes (both SIMD levels) against the scalar closed forms.
+ */
+static void test_black_scholes_batch(void) {
+    printf("Batch Black-Scholes (%s)\n", simd_level_name(simd_active()));
+
+    // Strikes from deep ITM to deep OTM, odd n to exercise the scalar tail
+    enum { N = 203 };
+    double S0[N], K[N], r[N], sigma[N], T[N];
+    double call[N], put[N], cd[N], pd[N], gamma[N], vega[N], cr[N], pr[N], ct[N], pt[N];
+    for (int i = 0; i < N; i++) {
+        S0[i] = 100.0;
+        K[i] = 40.0 + 0.6 * i;
+        r[i] = 0.01 + 0.0002 * i;
+        sigma[i] = 0.1 + 0.002 * (i % 50);
+        T[i] = 0.05 + 0.01 * (i % 97);
+    }
+    bs_batch_inputs in = { S0, K, r, sigma, T };
+    bs_batch_outputs out = { call, put, cd, pd, gamma, vega, cr, pr, ct, pt };
+
+    double max_err = 0.0;
+    for (int level = SIMD_AVX2; level >= SIMD_SCALAR; level--) {
+        simd_limit((simd_level)level);
+        black_scholes_batch(&in, N, &out);
+        for (int i = 0; i < N; i++) {
+            double call_ref = price_european_call_bs(S0[i], K[i], r[i], sigma[i], T[i]);
+            double put_ref = call_ref - S0[i] + K[i] * exp(-r[i] * T[i]);
+            option_greeks gc = greeks_european_bs(OPTION_CALL, S0[i], K[i], r[i], sigma[i], T[i]);
+            option_greeks gp = greeks_european_bs(OPTION_PUT, S0[i], K[i], r[i], sigma[i], T[i]);
+            double err[] = {
+                call[i] - call_ref, put[i] - put_ref, cd[i] - gc.delta, pd[i] - gp.delta,
+                gamma[i] - gc.gamma, vega[i] - gc.vega, cr[i] - gc.rho, pr[i] - gp.rho,
+                ct[i] - gc.theta, pt[i] - gp.theta,
+            };
+            for (size_t j = 0; j < sizeof(err) / sizeof(err[0]); j++) {
+                if (!(fabs(err[j]) <= max_err)) max_err = fabs(err[j]);
+            }
+        }
+    }
+    simd_limit(SIMD_AVX2);
+    check(max_err < 1e-10, "prices and Greeks match the scalar formulas at every SIMD level");
+
+    // Far out-of-the-money put: a tiny price, still with relative accuracy
+    double S_far[4] = { 100.0, 100.0, 100.0, 100.0 }, K_far[4] = { 40.0, 40.0, 40.0, 40.0 };
+    double r_far[4] = { 0.0, 0.0, 0.0, 0.0 }, s_far[4] = { 0.1, 0.1, 0.1, 0.1 }, T_far[4] = { 1.0, 1.0, 1.0, 1.0 };
+    double put_far[4];
+    bs_batch_inputs far = { S_far, K_far, r_far, s_far, T_far };
+    black_scholes_batch(&far, 4, &(bs_batch_outputs){ .put = put_far });
+    double d1 = log(100.0 / 40.0) / 0.1 + 0.05;
+    double exact = 40.0 * 0.5 * erfc((d1 - 0.1) / sqrt(2.0)) - 100.0 * 0.5 * erfc(d1 / sqrt(2.0));
+    check(fabs(put_far[0] - exact) < 1e-6 * exact, "deep OTM put keeps its relative accuracy");
+}
+
+static void test_implied_vol(void) {
+    printf("Implied volatility (%s)\n", simd_level_name(simd_active()));
+
+    // Several chunks of quotes within ±30% of spot, quoted on the OTM side
+    enum { N = 10003 };
+    double *mem = malloc(9 * N * sizeof(double));
+    option_type *types = malloc(N * sizeof(option_type));
+    if (!mem || !types) {
+        check(0, "allocate implied volatility inputs");
+        free(mem);
+        free(types);
+        return;
+    }
+    double *S0 = mem, *K = S0 + N, *r = K + N, *sigma = r + N, *T = sigma + N;
+    double *call = T + N, *put = call + N, *price = put + N, *vol = price + N;
+    rng_state rng;
+    rng_seed(&rng, 99u);
+    for (int i = 0; i < N; i++) {
+        S0[i] = 100.0;
+        K[i] = 70.0 + 60.0 * random_double(&rng);
+        r[i] = 0.04 * random_double(&rng);
+        sigma[i] = 0.05 + 0.9 * random_double(&rng);
+        T[i] = 0.02 + 3.0 * random_double(&rng);
+        types[i] = (K[i] < S0[i]) ? OPTION_PUT : OPTION_CALL;
+    }
+    bs_batch_inputs bs = { S0, K, r, sigma, T };
+    iv_batch_inputs in = { price, S0, K, r, T, types };
+
+    double max_err = 0.0;
+    iv_stats stats = {0};
+    for (int level = SIMD_AVX2; level >= SIMD_SCALAR; level--) {
+        simd_limit((simd_level)level);
+        black_scholes_batch(&bs, N, &(bs_batch_outputs){ .call = call, .put = put });
+        for (int i = 0; i < N; i++) {
+            price[i] = (types[i] == OPTION_PUT) ? put[i] : call[i];
+        }
+        implied_vol_batch(&in, N, 0, vol, &stats);
+        for (int i = 0; i < N; i++) {
+            double err = fabs(vol[i] - sigma[i]) / sigma[i];
+            if (!(err <= max_err)) max_err = err;
+        }
+    }
+    check(max_err < 1e-10, "round trip through black_scholes_batch at every SIMD level");
+    check(stats.brent_fallbacks == 0 && stats.no_solution == 0, "every quote settles in the Newton phase");
+    check((double)stats.newton_steps / N < 4.0, "under 4 Black-Scholes evaluations per quote");
+
+    simd_limit(SIMD_AVX2);
+    black_scholes_batch(&bs, N, &(bs_batch_outputs){ .call = call, .put = put });
+    for (int i = 0; i < N; i++) {
+        price[i] = (types[i] == OPTION_PUT) ? put[i] : call[i];
+    }
+    implied_vol_batch(&in, N, 1, vol, NULL);
+    double *vol_threads = call;
+    implied_vol_batch(&in, N, 4, vol_threads, NULL);
+    int identical = 1;
+    for (int i = 0; i < N; i++) {
+        identical &= same_bits(vol[i], vol_threads[i]);
+    }
+    check(identical, "1 and 4 threads give bit-identical volatilities");
+
+    // In-the-money calls go through parity onto the put side. Skip quotes
+    // whose time value is lost in the call's rounding (no σ to recover)
+    iv_batch_inputs calls = { call, S0, K, r, T, NULL };
+    black_scholes_batch(&bs, N, &(bs_batch_outputs){ .call = call, .put = put });
+    implied_vol_batch(&calls, N, 0, vol, NULL);
+    max_err = 0.0;
+    for (int i = 0; i < N; i++) {
+        double err = fabs(vol[i] - sigma[i]) / sigma[i];
+        if (fmin(call[i], put[i]) > 1e-3 && !(err <= max_err)) max_err = err;
+    }
+    check(max_err < 1e-6, "call quotes on both sides of the money");
+
+    // Prices outside the no-arbitrage bounds have no volatility
+    double bad_price[5] = { 5.0, 100.0, 120.0, 0.0, 4.0 };
+    double bad_S[5] = { 100.0, 100.0, 100.0, 100.0, 100.0 };
+    double bad_K[5] = { 95.0, 90.0, 110.0, 100.0, 110.0 };
+    double bad_r[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 }, bad_T[5] = { 1.0, 1.0, 1.0, 1.0, 1.0 };
+    option_type bad_types[5] = { OPTION_CALL, OPTION_CALL, OPTION_PUT, OPTION_CALL, OPTION_PUT };
+    iv_batch_inputs bad = { bad_price, bad_S, bad_K, bad_r, bad_T, bad_types };
+    size_t missing = implied_vol_batch(&bad, 5, 1, vol, &stats);
+    check(missing == 5 && stats.no_solution == 5 && isnan(vol[0]) && isnan(vol[4]),
+          "prices at or beyond the arbitrage bounds give NAN");
+
+    free(mem);
+    free(types);
+}
+
+static void test_models(void) {
+    printf("Market models (%s)\n", simd_level_name(simd_active()));
+
+    const double S0 = 100.0, K = 100.0, r = 0.03, T = 1.0;
+    path_option call = { OPTION_CALL, K, AVERAGE_NONE, BARRIER_NONE, 0.0, MONITOR_DISCRETE, 50 };
+    mc_options opts = mc_options_default();
+    opts.n_sim = 200000;
+    opts.seed = 5;
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+
+    // Heston against the semi-analytic price; both schemes carry a small time-step bias
+    heston_params h = { 0.04, 1.5, 0.04, 0.5, -0.7, HESTON_QE };
+    double reference = heston_call_price(S0, K, r, T, &h);
+    check(fabs(reference - 8.80267) < 1e-4, "Heston closed form reproduces the reference price");
+    for (int scheme = HESTON_QE; scheme <= HESTON_EULER; scheme++) {
+        h.scheme = (heston_scheme)scheme;
+        market_model m = model_heston(S0, r, &h);
+        mc_result res = price_path_model_mc(&call, &m, T, &opts);
+        check(fabs(res.price - reference) < 4.0 * res.std_error + 0.02,
+              scheme == HESTON_QE ? "Heston QE matches the closed form" : "Heston Euler matches the closed form");
+    }
+
+    // With almost no vol of vol, Heston is Black-Scholes on the mean variance
+    heston_params calm = { 0.04, 1.5, 0.09, 1e-4, 0.0, HESTON_QE };
+    double v_mean = calm.theta + (calm.v0 - calm.theta) * (1.0 - exp(-calm.kappa * T)) / (calm.kappa * T);
+    check(fabs(heston_call_price(S0, 95.0, r, T, &calm) - price_european_call_bs(S0, 95.0, r, sqrt(v_mean), T)) < 1e-4,
+          "Heston closed form tends to Black-Scholes as xi -> 0");
+
+    // A flat local-vol surface is GBM
+    const double times[2] = { 0.0, 1.0 }, spots[2] = { 50.0, 200.0 };
+    const double flat[4] = { 0.25, 0.25, 0.25, 0.25 };
+    local_vol_surface surface = { 2, 2, times, spots, flat };
+    market_model lv = model_local_vol(S0, r, &surface);
+    mc_result res = price_path_model_mc(&call, &lv, T, &opts);
+    check(fabs(res.price - price_european_call_bs(S0, K, r, 0.25, T)) < 4.0 * res.std_error,
+          "flat local vol matches Black-Scholes");
+
+    // Vol depending on time only: S(T) is lognormal with the summed step variances
+    const double falling[4] = { 0.35, 0.35, 0.15, 0.15 };
+    surface.sigma = falling;
+    double var_sum = 0.0;
+    for (size_t t = 0; t < call.n_steps; t++) {
+        double sigma = local_vol_at(&surface, (double)t * T / (double)call.n_steps, S0);
+        var_sum += sigma * sigma * T / (double)call.n_steps;
+    }
+    res = price_path_model_mc(&call, &lv, T, &opts);
+    check(fabs(res.price - price_european_call_bs(S0, K, r, sqrt(var_sum / T), T)) < 4.0 * res.std_error,
+          "time-dependent local vol matches Black-Scholes on the integrated variance");
+
+    // Thread count never changes the answer
+    h.scheme = HESTON_QE;
+    market_model heston = model_heston(S0, r, &h);
+    path_option asian = { OPTION_PUT, K, AVERAGE_ARITHMETIC, BARRIER_DOWN_OUT, 70.0, MONITOR_DISCRETE, 24 };
+    opts.n_sim = 3 * MC_CHUNK_PATHS + 123;
+    opts.n_threads = 1;
+    mc_result one = price_path_model_mc(&asian, &heston, T, &opts);
+    opts.n_threads = 3;
+    mc_result three = price_path_model_mc(&asian, &heston, T, &opts);
+    check(same_bits(one.price, three.price) && same_bits(one.std_error, three.std_error),
+          "Heston paths are bit-identical for 1 and 3 threads");
+
+    // Invalid parameters and unsupported combinations
+    model_path p;
+    heston_params bad = h;
+    bad.rho = 1.5;
+    market_model bad_model = model_heston(S0, r, &bad);
+    check(model_path_init(&p, &bad_model, T, 10) == -1, "|rho| > 1 is rejected");
+    bad = h;
+    bad.kappa = 0.0;
+    bad_model = model_heston(S0, r, &bad);
+    check(model_path_init(&p, &bad_model, T, 10) == -1, "kappa = 0 is rejected");
+    const double unsorted[2] = { 1.0, 0.5 };
+    local_vol_surface bad_surface = { 2, 2, unsorted, spots, flat };
+    bad_model = model_local_vol(S0, r, &bad_surface);
+    check(model_path_init(&p, &bad_model, T, 10) == -1, "decreasing surface times are rejected");
+
+    opts.sampler = MC_SAMPLER_SOBOL;
+    check(isnan(price_path_model_mc(&call, &heston, T, &opts).price), "Sobol sampler with Heston gives NAN");
+    opts.sampler = MC_SAMPLER_PSEUDO;
+    path_option continuous = { OPTION_CALL, K, AVERAGE_NONE, BARRIER_UP_OUT, 130.0, MONITOR_CONTINUOUS, 12 };
+    check(isnan(price_path_model_mc(&continuous, &lv, T, &opts).price), "continuous barrier with local vol gives NAN");
+}
+
+static void test_basket(void) {
+    printf("Multi-asset baskets (%s)\n", simd_level_name(simd_active()));
+
+    // Cholesky shocks reproduce the target correlations
+    enum { N_CORR = 3, N_Z = 60000 };
+    const double corr3[N_CORR * N_CORR] = { 1.0, 0.6, -0.3, 0.6, 1.0, 0.2, -0.3, 0.2, 1.0 };
+    const double S3[N_CORR] = { 100.0, 50.0, 20.0 }, sigma3[N_CORR] = { 0.2, 0.3, 0.4 };
+    gbm_basket basket;
+    check(gbm_basket_init(&basket, N_CORR, S3, sigma3, corr3, 0.0, 1.0) == 0, "3-asset basket initializes");
+    double *z = malloc(2 * N_CORR * N_Z * sizeof(double));
+    if (!z) {
+        check(0, "allocate basket shocks");
+        gbm_basket_free(&basket);
+        return;
+    }
+    double *eps = z + N_CORR * N_Z;
+    rng_state rng;
+    rng_seed(&rng, 21u);
+    normal_fill(&rng, z, N_CORR * N_Z);
+    gbm_basket_correlate(&basket, z, eps, N_Z);
+    double worst = 0.0;
+    for (int a = 0; a < N_CORR; a++) {
+        for (int b = 0; b < a; b++) {
+            double sum = 0.0;
+            for (int i = 0; i < N_Z; i++) {
+                sum += eps[a * N_Z + i] * eps[b * N_Z + i];
+            }
+            worst = fmax(worst, fabs(sum / N_Z - corr3[a * N_CORR + b]));
+        }
+    }
+    check(worst < 0.02, "correlated shocks have the target sample correlations");
+    gbm_basket_free(&basket);
+    free(z);
+
+    const double r = 0.03, T = 1.0;
+    mc_options opts = mc_options_default();
+    opts.n_sim = 200000;
+    opts.seed = 8;
+
+    // Exchange option max(S_0 - S_1, 0) against Margrabe's formula
+    const double S2[2] = { 100.0, 95.0 }, sigma2[2] = { 0.3, 0.2 }, rho = 0.4;
+    const double corr2[4] = { 1.0, rho, rho, 1.0 };
+    double s = sqrt(sigma2[0] * sigma2[0] + sigma2[1] * sigma2[1] - 2.0 * rho * sigma2[0] * sigma2[1]);
+    double d1 = (log(S2[0] / S2[1]) + 0.5 * s * s * T) / (s * sqrt(T));
+    double margrabe = S2[0] * normal_cdf(d1) - S2[1] * normal_cdf(d1 - s * sqrt(T));
+    basket_option exchange = { OPTION_CALL, BASKET_SPREAD, 0.0, 2, NULL };
+    for (unsigned vr = MC_VR_NONE; vr <= (MC_VR_ANTITHETIC | MC_VR_CONTROL); vr++) {
+        opts.variance_reduction = vr;
+        mc_result res = price_basket_mc(&exchange, S2, sigma2, corr2, r, T, &opts);
+        check(fabs(res.price - margrabe) < 4.0 * res.std_error, "spread with K = 0 matches Margrabe");
+    }
+
+    // Perfectly correlated copies of one asset: worst-of = best-of = vanilla
+    const double same_S[3] = { 100.0, 100.0, 100.0 }, same_sigma[3] = { 0.25, 0.25, 0.25 };
+    const double ones[9] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+    double bs = price_european_call_bs(100.0, 105.0, r, 0.25, T);
+    basket_option worst_of = { OPTION_CALL, BASKET_WORST_OF, 105.0, 3, NULL };
+    opts.variance_reduction = MC_VR_ANTITHETIC;
+    mc_result res = price_basket_mc(&worst_of, same_S, same_sigma, ones, r, T, &opts);
+    check(fabs(res.price - bs) < 4.0 * res.std_error, "rho = 1 worst-of matches Black-Scholes");
+
+    // Best-of two calls dominates either vanilla, worst-of is below both
+    basket_option best_of = { OPTION_CALL, BASKET_BEST_OF, 100.0, 2, NULL };
+    worst_of.n_assets = 2;
+    worst_of.strike = 100.0;
+    double best = price_basket_mc(&best_of, S2, sigma2, corr2, r, T, &opts).price;
+    double worst_price = price_basket_mc(&worst_of, S2, sigma2, corr2, r, T, &opts).price;
+    check(best > price_european_call_bs(S2[0], 100.0, r, sigma2[0], T)
+          && worst_price < price_european_call_bs(S2[1], 100.0, r, sigma2[1], T),
+          "best-of above and worst-of below the single-asset calls");
+
+    // SIMD level and thread count never change the answer beyond rounding
+    enum { N_BIG = 20 };
+    double S_big[N_BIG], sigma_big[N_BIG], corr_big[N_BIG * N_BIG], weights[N_BIG];
+    for (int a = 0; a < N_BIG; a++) {
+        S_big[a] = 80.0 + 2.0 * a;
+        sigma_big[a] = 0.15 + 0.01 * a;
+        weights[a] = 1.0 / N_BIG;
+        for (int b = 0; b < N_BIG; b++) {
+            corr_big[a * N_BIG + b] = (a == b) ? 1.0 : 0.3;
+        }
+    }
+    basket_option average = { OPTION_PUT, BASKET_AVERAGE, 100.0, N_BIG, weights };
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    opts.n_sim = 3 * MC_CHUNK_PATHS + 77;
+    opts.n_threads = 1;
+    mc_result one = price_basket_mc(&average, S_big, sigma_big, corr_big, r, T, &opts);
+    opts.n_threads = 3;
+    mc_result three = price_basket_mc(&average, S_big, sigma_big, corr_big, r, T, &opts);
+    check(same_bits(one.price, three.price) && same_bits(one.std_error, three.std_error),
+          "20-asset basket is bit-identical for 1 and 3 threads");
+    simd_limit(SIMD_SCALAR);
+    mc_result scalar = price_basket_mc(&average, S_big, sigma_big, corr_big, r, T, &opts);
+    simd_limit(SIMD_AVX2);
+    check(fabs(scalar.price - one.price) < 1e-10, "scalar and SIMD baskets agree");
+
+    // Invalid input
+    const double not_psd[9] = { 1.0, 0.9, -0.9, 0.9, 1.0, 0.9, -0.9, 0.9, 1.0 };
+    basket_option three_assets = { OPTION_CALL, BASKET_AVERAGE, 100.0, 3, NULL };
+    check(isnan(price_basket_mc(&three_assets, S3, sigma3, not_psd, r, T, &opts).price),
+          "correlation matrix that is not positive semi-definite gives NAN");
+    exchange.n_assets = 3;
+    check(isnan(price_basket_mc(&exchange, S3, sigma3, corr3, r, T, &opts).price),
+          "spread on three assets gives NAN");
+}
+
+static void test_scenarios(void) {
+    printf("Scenario grids\n");
+
+    const option_contract book[3] = {
+        { { 100.0, 0.03, 0.20, 1.0 }, 105.0, OPTION_CALL },
+        { { 100.0, 0.03, 0.20, 1.0 }, 95.0, OPTION_PUT },
+        { { 40.0, 0.01, 0.45, 0.5 }, 40.0, OPTION_CALL }
+    };
+    const double spot_shifts[5] = { -0.2, -0.1, 0.0, 0.1, 0.2 }, vol_shifts[3] = { -0.05, 0.0, 0.05 };
+    enum { N_BOOK = 3, N_SCEN = 15 };
+    scenario_shock shocks[N_SCEN];
+    scenario_grid(spot_shifts, 5, vol_shifts, 3, shocks);
+    check(shocks[7].spot_shift == 0.0 && shocks[7].vol_shift == 0.0 && shocks[14].spot_shift == 0.2,
+          "grid is spot-major");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 2 * MC_CHUNK_PATHS + 321;
+    opts.seed = 17;
+    opts.variance_reduction = MC_VR_ANTITHETIC;
+    mc_result grid[N_SCEN * N_BOOK];
+    check(price_scenarios_mc(book, N_BOOK, shocks, N_SCEN, &opts, grid) == 0, "scenario grid prices");
+
+    // Every grid point is exactly the standalone price at the shocked parameters
+    int identical = 1;
+    for (int s = 0; s < N_SCEN; s++) {
+        for (int k = 0; k < N_BOOK; k++) {
+            const stock_params *stock = &book[k].stock;
+            mc_result alone = price_european_mc(book[k].type, stock->initial_price * (1.0 + shocks[s].spot_shift),
+                                                book[k].strike, stock->interest_rate,
+                                                stock->volatility + shocks[s].vol_shift, stock->maturity, &opts);
+            identical &= same_bits(alone.price, grid[s * N_BOOK + k].price)
+                      && same_bits(alone.std_error, grid[s * N_BOOK + k].std_error);
+        }
+    }
+    check(identical, "each scenario is bit-identical to price_european_mc at its shocked inputs");
+
+    // Common random numbers: every path's call payoff rises with spot, so the ladder is monotone
+    int monotone = 1;
+    for (int v = 0; v < 3; v++) {
+        for (int i = 1; i < 5; i++) {
+            monotone &= grid[(i * 3 + v) * N_BOOK].price > grid[((i - 1) * 3 + v) * N_BOOK].price;
+            monotone &= grid[(i * 3 + v) * N_BOOK + 1].price < grid[((i - 1) * 3 + v) * N_BOOK + 1].price;
+        }
+    }
+    check(monotone, "spot ladders are monotone under common random numbers");
+
+    mc_result threaded[N_SCEN * N_BOOK];
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    price_scenarios_mc(book, N_BOOK, shocks, N_SCEN, &opts, grid);
+    opts.n_threads = 3;
+    price_scenarios_mc(book, N_BOOK, shocks, N_SCEN, &opts, threaded);
+    int same = 1;
+    for (int p = 0; p < N_SCEN * N_BOOK; p++) {
+        same &= same_bits(grid[p].price, threaded[p].price);
+    }
+    check(same, "scenario grid is bit-identical for 1 and 3 threads");
+
+    const scenario_shock crash = { -0.1, -0.5 };
+    check(price_scenarios_mc(book, N_BOOK, &crash, 1, &opts, grid) == -1 && isnan(grid[0].price),
+          "a shock to negative volatility fails with NAN");
+}
+
+static void test_market_data(void) {
+    printf("Market data files\n");
+
+    // More lines than one stream buffer, plus comments, CRLF, a put, bad lines and no final newline
+    enum { N_LINES = 5000 };
+    const char *csv_path = "build/test_market.csv", *mkt_path = "build/test_market.mkt";
+    FILE *fp = fopen(csv_path, "w");
+    if (!fp) {
+        check(0, "write test CSV");
+        return;
+    }
+    fprintf(fp, "# ticker,stock_price,strike,risk_free_rate,volatility,days_to_expiry,market_price\n\n");
+    for (int i = 0; i < N_LINES; i++) {
+        fprintf(fp, "TK%d,%.2f,%.3f,0.045,%.2f,%d,%.2f%s\n", i % 37, 100.0 + i * 0.01, 90.0 + (i % 200) * 0.125,
+                0.1 + (i % 50) * 0.01, 1 + i % 365, 1.0 + (i % 100) * 0.05, (i % 3) ? "\r" : "");
+    }
+    fprintf(fp, "BAD,1.0,2.0\nALSO_BAD,x,1,1,1,1,1\nPEND,50,55,0.01,0.3,90,6.1,pending\nNONFINITE,inf,55,0.01,nan,90,6.1\n");
+    fprintf(fp, "PUTS,50,55,0.01,0.3,90,6.1,put\nLAST,20,20,0,0.5,30,2.5e0");
+    fclose(fp);
+
+    size_t n_bad = 0;
+    long n = market_data_convert_csv(csv_path, mkt_path, &n_bad);
+    check(n == N_LINES + 2 && n_bad == 4,
+          "converter keeps every valid line and counts malformed, mistyped and non-finite ones");
+
+    market_data md;
+    check(market_data_open(&md, mkt_path) == 0, "contract file maps");
+    int same = (md.n_contracts == (size_t)n) && md.n_tickers == 39;
+    char text[32];
+    for (int i = 0; same && i < N_LINES; i++) {
+        snprintf(text, sizeof(text), "%.3f", 90.0 + (i % 200) * 0.125);
+        same &= md.K[i] == strtod(text, NULL);
+        snprintf(text, sizeof(text), "%.2f", 100.0 + i * 0.01);
+        same &= md.S0[i] == strtod(text, NULL);
+        same &= md.T[i] == (double)(1 + i % 365) / 365.0 && md.type[i] == OPTION_CALL;
+        snprintf(text, sizeof(text), "TK%d", i % 37);
+        same &= strcmp(md.tickers[md.ticker_id[i]], text) == 0;
+    }
+    check(same, "columns hold the parsed CSV values, correctly rounded");
+    check(md.type[N_LINES] == OPTION_PUT && md.K[N_LINES] == 55.0 && md.market_price[N_LINES + 1] == 2.5
+          && strcmp(md.tickers[md.ticker_id[N_LINES + 1]], "LAST") == 0,
+          "optional put field and a final line without newline");
+
+    // Batch inputs point straight into the mapping
+    bs_batch_inputs in = market_data_bs_inputs(&md);
+    check(in.S0 == md.S0 && in.sigma == md.sigma && ((uintptr_t)in.K % 64) == 0,
+          "batch inputs are zero-copy, cache-line aligned columns");
+    double call[4];
+    black_scholes_batch(&in, 4, &(bs_batch_outputs){ .call = call });
+    check(fabs(call[0] - price_european_call_bs(md.S0[0], md.K[0], md.r[0], md.sigma[0], md.T[0])) < 1e-12,
+          "black_scholes_batch prices the mapped columns");
+    market_data_close(&md);
+
+    // A truncated file is rejected before anything reads through it
+    FILE *src = fopen(mkt_path, "rb");
+    FILE *dst = fopen("build/test_market_cut.mkt", "wb");
+    if (src && dst) {
+        char chunk[4096];
+        size_t got = fread(chunk, 1, sizeof(chunk), src);
+        fwrite(chunk, 1, got, dst);
+    }
+    if (src) fclose(src);
+    if (dst) fclose(dst);
+    check(market_data_open(&md, "build/test_market_cut.mkt") == -1, "truncated contract file is rejected");
+    check(market_data_open(&md, csv_path) == -1, "a CSV is not mistaken for a contract file");
+
+    remove(csv_path);
+    remove(mkt_path);
+    remove("build/test_market_cut.mkt");
+}
+
+static void test_profile(void) {
+    printf("Profiling counters (%s)\n", profile_enabled() ? "compiled in" : "compiled out");
+
+    // Counters start from a reset; 7 chunks of 16384 paths in one batch, one normal per path
+    profile_reset();
+    mc_options opts = mc_options_default();
+    opts.n_sim = 100000;
+    opts.n_threads = 2;
+    mc_result res = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, &opts);
+
+    const char *path = "build/test_profile.json";
+    FILE *fp = fopen(path, "w+");
+    if (!fp) {
+        check(0, "write profile JSON");
+        return;
+    }
+    profile_write_json(fp);
+    rewind(fp);
+    char text[4096];
+    size_t len = fread(text, 1, sizeof(text) - 1, fp);
+    text[len] = '\0';
+    fclose(fp);
+    remove(path);
+
+    if (!profile_enabled()) {
+        check(strcmp(text, "{\"enabled\": false}\n") == 0 && !isnan(res.price),
+              "compiled-out build reports itself disabled");
+        return;
+    }
+    unsigned long long paths = 0, normals = 0, chunks = 0, batches = 0;
+    const char *counters = strstr(text, "\"counters\": {");
+    int parsed = counters && sscanf(counters, "\"counters\": {\"paths\": %llu, \"normals\": %llu, \"chunks\": %llu, "
+                                    "\"batches\": %llu", &paths, &normals, &chunks, &batches) == 4;
+    check(parsed && paths == 100000 && normals == 100000 && chunks == 7 && batches == 1,
+          "paths, normals, chunks and batches count exactly what the engine ran");
+}
+
+static void test_server(void) {
+    printf("Pricing server\n");
+
+    pricing_server_config config = pricing_server_config_default();
+    config.socket_path = "build/test_server.sock";
+    config.n_threads = 2;
+    config.window_us = 5000;
+    config.max_batch = 256;
+    pricing_server *srv = pricing_server_open(&config);
+    check(srv != NULL && pricing_server_start(srv) == 0, "server binds its socket and starts");
+    if (!srv) {
+        return;
+    }
+    check(pricing_server_open(&config) == NULL, "a second server cannot take a live socket");
+
+    // Client A: 4 underlyings x 10 strikes and one invalid quote; client B: 3 against A's first underlying
+    enum { N_A = 41, N_B = 3 };
+    pricing_request a[N_A], b[N_B];
+    for (int i = 0; i < N_A - 1; i++) {
+        a[i] = (pricing_request){ .id = 100 + i, .S0 = 90.0 + 10.0 * (i / 10), .K = 80.0 + 4.0 * (i % 10),
+                                  .r = 0.03, .sigma = 0.25, .T = 0.5, .seed = 7, .n_sim = 20000,
+                                  .type = (uint8_t)((i % 2) ? OPTION_PUT : OPTION_CALL) };
+    }
+    a[N_A - 1] = a[0];
+    a[N_A - 1].id = 999;
+    a[N_A - 1].sigma = -0.2;
+    for (int i = 0; i < N_B; i++) {
+        b[i] = a[i];
+        b[i].id = 500 + i;
+        b[i].variance_reduction = MC_VR_ANTITHETIC;
+    }
+
+    int fa = pricing_client_connect(config.socket_path);
+    int fb = pricing_client_connect(config.socket_path);
+    pricing_reply ra[N_A], rb[N_B];
+    int io = fa >= 0 && fb >= 0 && pricing_client_send(fa, a, N_A) == 0 && pricing_client_send(fb, b, N_B) == 0
+             && pricing_client_recv(fa, ra, N_A) == 0 && pricing_client_recv(fb, rb, N_B) == 0;
+    check(io, "both clients get every reply");
+
+    int same = io, grouped = io;
+    for (int i = 0; io && i < N_A - 1; i++) {
+        mc_options opts = mc_options_default();
+        opts.n_sim = a[i].n_sim;
+        opts.seed = a[i].seed;
+        mc_result ref = price_european_mc((option_type)a[i].type, a[i].S0, a[i].K, a[i].r, a[i].sigma, a[i].T, &opts);
+        same &= ra[i].id == a[i].id && ra[i].status == 0 && same_bits(ra[i].price, ref.price)
+                && same_bits(ra[i].std_error, ref.std_error) && ra[i].n_paths == ref.n_paths;
+        grouped &= ra[i].group_size == 10;
+    }
+    for (int i = 0; io && i < N_B; i++) {
+        mc_options opts = mc_options_default();
+        opts.n_sim = b[i].n_sim;
+        opts.seed = b[i].seed;
+        opts.variance_reduction = MC_VR_ANTITHETIC;
+        mc_result ref = price_european_mc((option_type)b[i].type, b[i].S0, b[i].K, b[i].r, b[i].sigma, b[i].T, &opts);
+        same &= rb[i].id == b[i].id && rb[i].status == 0 && same_bits(rb[i].price, ref.price);
+    }
+    check(same, "replies come back in order, bit-identical to price_european_mc");
+    check(grouped, "contracts on one underlying are priced as one chain");
+    check(io && ra[N_A - 1].id == 999 && ra[N_A - 1].status == -1 && isnan(ra[N_A - 1].price),
+          "an invalid request gets status -1 and NAN");
+
+    pricing_client_close(fa);
+    pricing_client_close(fb);
+    pricing_server_stats st;
+    pricing_server_get_stats(srv, &st);
+    check(st.n_requests == N_A + N_B && st.n_groups < st.n_requests && st.p50_us > 0.0 && st.p99_us >= st.p50_us,
+          "stats count the requests and report latency percentiles");
+
+    // More paths than max_n_sim: refused, not priced
+    pricing_request big = a[0];
+    big.id = 777;
+    big.n_sim = config.max_n_sim + 1;
+    pricing_reply big_reply;
+    int fd_big = pricing_client_connect(config.socket_path);
+    check(fd_big >= 0 && pricing_client_send(fd_big, &big, 1) == 0 && pricing_client_recv(fd_big, &big_reply, 1) == 0
+          && big_reply.id == 777 && big_reply.status == -1 && isnan(big_reply.price) && big_reply.n_paths == 0,
+          "a request for more than max_n_sim paths gets status -1");
+    pricing_client_close(fd_big);
+
+    // One write of far more requests than the socket buffers hold, read only afterwards
+    enum { N_BURST = 200000, N_IDLE = 20000 };
+    pricing_request *burst = malloc(N_BURST * sizeof(*burst));
+    pricing_reply *burst_replies = malloc(N_BURST * sizeof(*burst_replies));
+    int fc = pricing_client_connect(config.socket_path);
+    int answered = burst && burst_replies && fc >= 0;
+    for (int i = 0; answered && i < N_BURST; i++) {
+        burst[i] = a[i % (N_A - 1)];
+        burst[i].id = (uint64_t)i;
+        burst[i].n_sim = 256;
+    }
+    answered = answered && pricing_client_send(fc, burst, N_BURST) == 0
+               && pricing_client_recv(fc, burst_replies, N_BURST) == 0;
+    for (int i = 0; answered && i < N_BURST; i++) {
+        answered &= burst_replies[i].id == (uint64_t)i && burst_replies[i].status == 0;
+    }
+    check(answered, "a burst sent in one write before reading is answered in full");
+
+    // A client that stops reading holds its own replies, not everyone else's
+    int fd_idle = pricing_client_connect(config.socket_path);
+    int fd_live = pricing_client_connect(config.socket_path);
+    int live = fd_idle >= 0 && fd_live >= 0 && answered
+               && pricing_client_send(fd_idle, burst, N_IDLE) == 0
+               && pricing_client_send(fd_live, b, N_B) == 0 && pricing_client_recv(fd_live, rb, N_B) == 0
+               && rb[0].id == b[0].id && rb[0].status == 0;
+    check(live, "other clients are served while one stops reading");
+    pricing_client_close(fd_idle);
+    pricing_client_close(fd_live);
+    pricing_client_close(fc);
+    pricing_server_close(srv);
+
+    // Past max_backlog queued replies, a client that is not reading is dropped
+    config.max_batch = 64;
+    config.max_backlog = 64;
+    srv = pricing_server_open(&config);
+    int fd_slow = (srv && pricing_server_start(srv) == 0) ? pricing_client_connect(config.socket_path) : -1;
+    int drop_ok = fd_slow >= 0 && answered && (pricing_client_send(fd_slow, burst, N_IDLE) != 0
+                                               || pricing_client_recv(fd_slow, burst_replies, N_IDLE) != 0);
+    check(drop_ok, "a client over its reply backlog is disconnected");
+    pricing_client_close(fd_slow);
+    config.max_backlog = 32;
+    check(pricing_server_open(&config) == NULL, "a backlog smaller than a batch is rejected");
+    config.max_backlog = 64;
+    config.max_n_sim = config.default_n_sim - 1;
+    check(pricing_server_open(&config) == NULL, "max_n_sim below default_n_sim is rejected");
+    pricing_server_close(srv);
+    free(burst);
+    free(burst_replies);
+}
+
+// Nested parallel_for: every (outer, inner) task runs exactly once
+typedef struct {
+    uint32_t n_inner;
+    _Atomic uint32_t *hits;
+} nested_job;
+
+typedef struct {
+    const nested_job *job;
+    uint32_t outer;
+} nested_inner;
+
+static void nested_inner_task(void *ctx, uint32_t task) {
+    const nested_inner *inner = ctx;
+    atomic_fetch_add(&inner->job->hits[inner->outer * inner->job->n_inner + task], 1u);
+}
+
+static void nested_outer_task(void *ctx, uint32_t task) {
+    const nested_job *job = ctx;
+    // Uneven work: every third outer task runs mostly inline, the rest split
+    nested_inner inner = { job, task };
+    parallel_for(task % 3 ? job->n_inner : 1, 4, nested_inner_task, &inner);
+    for (uint32_t i = (task % 3 ? job->n_inner : 1); i < job->n_inner; i++) {
+        atomic_fetch_add(&job->hits[task * job->n_inner + i], 1u);
+    }
+}
+
+static void test_work_stealing(void) {
+    printf("Work-stealing pool\n");
+
+    enum { N_OUTER = 37, N_INNER = 53 };
+    static _Atomic uint32_t hits[N_OUTER * N_INNER];
+    for (int i = 0; i < N_OUTER * N_INNER; i++) {
+        atomic_init(&hits[i], 0u);
+    }
+    nested_job job = { N_INNER, hits };
+    parallel_for(N_OUTER, 4, nested_outer_task, &job);
+    int once = 1;
+    for (int i = 0; i < N_OUTER * N_INNER; i++) {
+        once &= atomic_load(&hits[i]) == 1u;
+    }
+    check(once, "nested calls run every task exactly once");
+    check(parallel_pool_workers() >= 1 && parallel_pool_workers() <= PARALLEL_MAX_WORKERS,
+          "the pool is started on demand");
+
+    // A book of one huge chain and many one-contract groups, priced concurrently
+    enum { N_BOOK = 24 };
+    option_contract book[N_BOOK];
+    for (int i = 0; i < N_BOOK; i++) {
+        double S0 = (i < 8) ? 100.0 : 50.0 + i;
+        book[i] = (option_contract){ { S0, 0.04, 0.25, 0.75 }, S0 * (0.9 + 0.025 * (i % 8)),
+                                     (i % 2) ? OPTION_PUT : OPTION_CALL };
+    }
+    mc_options opts = mc_options_default();
+    opts.n_sim = 3 * MC_CHUNK_PATHS + 100;
+    opts.seed = 21;
+    mc_result serial[N_BOOK], pooled[N_BOOK];
+    opts.n_threads = 1;
+    int ok = price_portfolio_mc(book, N_BOOK, &opts, serial) == 0;
+    opts.n_threads = 4;
+    ok &= price_portfolio_mc(book, N_BOOK, &opts, pooled) == 0;
+    int same = ok;
+    for (int i = 0; ok && i < N_BOOK; i++) {
+        same &= same_bits(serial[i].price, pooled[i].price) && same_bits(serial[i].std_error, pooled[i].std_error);
+    }
+    check(same, "portfolio groups priced concurrently match a serial run bit for bit");
+
+    // A NaN contract among the groups fails alone; the Greeks of the rest match
+    option_greeks greeks[N_BOOK], greeks_se[N_BOOK], clean[N_BOOK];
+    ok = price_portfolio_greeks_mc(book, N_BOOK, &opts, serial, clean, NULL) == 0;
+    book[10].stock.volatility = NAN;
+    ok &= price_portfolio_greeks_mc(book, N_BOOK, &opts, pooled, greeks, greeks_se) == -1;
+    ok &= isnan(pooled[10].price) && isnan(greeks[10].delta) && isnan(greeks_se[10].vega);
+    for (int i = 0; ok && i < N_BOOK; i++) {
+        ok &= i == 10 || (same_bits(serial[i].price, pooled[i].price) && same_bits(clean[i].delta, greeks[i].delta));
+    }
+    check(ok, "a NaN contract fails alone in a pooled Greeks portfolio");
+}
+
+static void test_cache(void) {
+    printf("Result cache\n");
+
+    mc_cache cache;
+    check(mc_cache_init(&cache, 4) == 0, "cache allocates its table");
+    check(mc_cache_init(&(mc_cache){ 0 }, 0) == -1, "a zero-entry cache is rejected");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 50000;
+    opts.seed = 11;
+    mc_result ref = price_european_mc(OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    mc_result first = mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    mc_result again = mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    check(same_bits(first.price, ref.price) && same_bits(first.std_error, ref.std_error)
+          && first.n_paths == ref.n_paths, "a new entry matches price_european_mc bit for bit");
+    check(same_bits(again.price, first.price) && cache.stats.hits == 1 && cache.stats.misses == 1
+          && cache.stats.paths_simulated == 50000, "a repeated request is answered without simulating");
+
+    // Extending a run of whole chunks reproduces a fresh run of the total size
+    opts.n_sim = 4 * MC_CHUNK_PATHS;
+    opts.seed = 12;
+    mc_cache_price(&cache, OPTION_PUT, 100.0, 95.0, 0.05, 0.2, 1.0, &opts);
+    opts.n_sim = 8 * MC_CHUNK_PATHS;
+    mc_result extended = mc_cache_price(&cache, OPTION_PUT, 100.0, 95.0, 0.05, 0.2, 1.0, &opts);
+    ref = price_european_mc(OPTION_PUT, 100.0, 95.0, 0.05, 0.2, 1.0, &opts);
+    check(same_bits(extended.price, ref.price) && same_bits(extended.std_error, ref.std_error)
+          && extended.n_paths == ref.n_paths && cache.stats.extensions == 1
+          && cache.stats.paths_simulated == 50000 + 8 * MC_CHUNK_PATHS,
+          "an extension only simulates the new paths and matches a fresh run");
+
+    // Tighter tolerance refines the entry until it is met
+    opts.n_sim = 1u << 22;
+    opts.abs_tol = 0.5 * extended.std_error;
+    mc_result refined = mc_cache_price(&cache, OPTION_PUT, 100.0, 95.0, 0.05, 0.2, 1.0, &opts);
+    check(refined.std_error <= opts.abs_tol && refined.n_paths > extended.n_paths && cache.stats.extensions == 2,
+          "a tighter tolerance extends the entry until it is met");
+    opts.abs_tol = 0.0;
+
+    // Control variates are resumed from their joint moments
+    opts.n_sim = 2 * MC_CHUNK_PATHS;
+    opts.seed = 13;
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    mc_cache_price(&cache, OPTION_CALL, 100.0, 100.0, 0.05, 0.3, 0.5, &opts);
+    opts.n_sim = 6 * MC_CHUNK_PATHS;
+    mc_result cv = mc_cache_price(&cache, OPTION_CALL, 100.0, 100.0, 0.05, 0.3, 0.5, &opts);
+    ref = price_european_mc(OPTION_CALL, 100.0, 100.0, 0.05, 0.3, 0.5, &opts);
+    check(same_bits(cv.price, ref.price) && same_bits(cv.std_error, ref.std_error),
+          "antithetic and control-variate runs extend bit for bit");
+
+    // Another seed is another key; a fifth key evicts the least recently used entry
+    opts.variance_reduction = MC_VR_NONE;
+    opts.n_sim = 20000;
+    opts.seed = 11;
+    mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    uint64_t misses = cache.stats.misses;
+    opts.seed = 14;
+    mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    check(cache.stats.misses == misses + 1 && cache.n_entries == 4, "a different seed is a new entry");
+    opts.seed = 15;
+    mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    check(cache.stats.evictions == 1 && cache.n_entries == 4, "a full cache evicts to make room");
+    opts.seed = 14;
+    uint64_t hits = cache.stats.hits;
+    mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    check(cache.stats.hits == hits + 1, "recent entries survive eviction");
+
+    opts.sampler = MC_SAMPLER_SOBOL;
+    mc_cache_price(&cache, OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    check(cache.stats.bypassed == 1 && cache.n_entries == 4, "Sobol requests bypass the cache");
+
+    mc_cache_clear(&cache);
+    check(cache.n_entries == 0, "clear empties the table");
+    mc_cache_free(&cache);
+}
+
+/**
+ * The float32 kernels: same distributions and prices as the double engine
+ * to within the standard error, with double-precision statistics.
+ */
+static void test_float32(void) {
+    printf("Float32 kernels (%s)\n", simd_level_name(simd_active()));
+
+    enum { N = 100001 };
+    static float fast[N], ref[N];
+    rng_state a, b;
+    rng_seed(&a, 11);
+    normal_fill_f32(&a, fast, N);
+    simd_limit(SIMD_SCALAR);
+    rng_seed(&b, 11);
+    normal_fill_f32(&b, ref, N);
+    simd_limit(SIMD_AVX2);
+
+    double max_diff = 0.0, sum = 0.0, sum_sq = 0.0;
+    for (int i = 0; i < N; i++) {
+        double d = fabs((double)fast[i] - (double)ref[i]);
+        if (d > max_diff) max_diff = d;
+        sum += fast[i];
+        sum_sq += (double)fast[i] * fast[i];
+    }
+    check(max_diff < 2e-5, "SIMD and scalar float normals agree to float rounding");
+    rng_state c;
+    rng_seed(&c, 11);
+    for (int i = 0; i < (N + 1) / 2; i++) {
+        rng_next(&c);
+    }
+    uint64_t next_a = rng_next(&a), next_b = rng_next(&b), next_c = rng_next(&c);
+    check(next_a == next_c && next_b == next_c, "float normals take one draw per pair on every kernel");
+    double mean = sum / N;
+    check(fabs(mean) < 0.01 && fabs(sum_sq / N - mean * mean - 1.0) < 0.02,
+          "float normals have mean 0 and variance 1");
+
+    // Terminal prices to float precision; statistics accumulated in double
+    float zf[1000], sf[1000];
+    double zd[1000], sd[1000];
+    for (int i = 0; i < 1000; i++) {
+        zf[i] = fast[i];
+        zd[i] = fast[i];
+    }
+    gbm_terminal g = gbm_terminal_init(100.0, 0.05, 0.3, 0.75);
+    gbm_terminal_fill_f32(&g, zf, sf, 1000);
+    gbm_terminal_fill(&g, zd, sd, 1000);
+    double max_rel = 0.0;
+    for (int i = 0; i < 1000; i++) {
+        double rel = fabs(sf[i] - sd[i]) / sd[i];
+        if (rel > max_rel) max_rel = rel;
+        sd[i] = sf[i];
+    }
+    check(max_rel < 1e-6, "float terminal prices match the double kernel to ~1e-7");
+    mc_moments mf = {0}, md = {0};
+    moments_add_block_f32(&mf, sf, zf, 1000);
+    moments_add_block(&md, sd, zd, 1000);
+    check(fabs(mf.mean_y - md.mean_y) < 1e-12 * md.mean_y && fabs(mf.m2_y - md.m2_y) < 1e-10 * md.m2_y
+          && fabs(mf.c_xy - md.c_xy) < 1e-9 * fabs(md.c_xy), "float samples are accumulated in double");
+
+    // Prices: within the reported error of Black-Scholes, for any thread count
+    mc_options opts = mc_options_default();
+    opts.n_sim = 1000000;
+    opts.seed = 31;
+    opts.precision = MC_PRECISION_FLOAT;
+    opts.n_threads = 1;
+    mc_result one = price_european_mc(OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    opts.n_threads = 3;
+    mc_result three = price_european_mc(OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts);
+    double bs = price_european_call_bs(100.0, 105.0, 0.05, 0.2, 1.0);
+    check(same_bits(one.price, three.price) && same_bits(one.std_error, three.std_error),
+          "float engine is bit-identical for any thread count");
+    check(fabs(one.price - bs) < 4.0 * one.std_error, "float price within 4 standard errors of Black-Scholes");
+
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    mc_result vr = price_european_mc(OPTION_PUT, 100.0, 90.0, 0.03, 0.35, 0.5, &opts);
+    double put_bs = price_european_call_bs(100.0, 90.0, 0.03, 0.35, 0.5) - 100.0 + 90.0 * exp(-0.03 * 0.5);
+    check(fabs(vr.price - put_bs) < 4.0 * vr.std_error && vr.std_error < 0.5 * one.std_error,
+          "float antithetic + control variate put within 4 standard errors");
+
+    option_greeks gk, gk_se;
+    opts.variance_reduction = MC_VR_NONE;
+    price_european_greeks_mc(OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0, &opts, &gk, &gk_se);
+    option_greeks exact = greeks_european_bs(OPTION_CALL, 100.0, 105.0, 0.05, 0.2, 1.0);
+    check(fabs(gk.delta - exact.delta) < 4.0 * gk_se.delta && fabs(gk.vega - exact.vega) < 4.0 * gk_se.vega,
+          "float engine Greeks within 4 standard errors");
+}
+
+/**
+ * A reusable engine context gives the free functions' results bit for bit,
+ * rewinds its arena after every call and rejects requests beyond its limits.
+ */
+static void test_engine_context(void) {
+    printf("Engine context\n");
+
+    const mc_engine_limits limits = { .max_contracts = 4, .max_paths = 200000, .max_replicates = 16, .greeks = 1 };
+    mc_engine engine;
+    check(mc_engine_init(&engine, &limits) == 0, "engine reserves its arena up front");
+
+    const option_type types[3] = { OPTION_CALL, OPTION_PUT, OPTION_CALL };
+    const double strikes[3] = { 90.0, 100.0, 115.0 };
+    mc_options opts = mc_options_default();
+    opts.n_sim = 150000;
+    opts.seed = 17;
+    opts.n_threads = 3;
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    mc_result ref[3], got[3];
+    option_greeks ref_g[3], got_g[3], ref_se[3], got_se[3];
+    price_european_chain_greeks_mc(100.0, 0.04, 0.25, 0.8, types, strikes, 3, &opts, ref, ref_g, ref_se);
+    int same = 1;
+    for (int call = 0; call < 3; call++) {
+        same &= mc_engine_price_chain(&engine, 100.0, 0.04, 0.25, 0.8, types, strikes, 3, &opts,
+                                      got, got_g, got_se) == 0;
+        for (int k = 0; k < 3; k++) {
+            same &= same_bits(ref[k].price, got[k].price) && same_bits(ref[k].std_error, got[k].std_error)
+                    && same_bits(ref_g[k].gamma, got_g[k].gamma) && same_bits(ref_se[k].vega, got_se[k].vega);
+        }
+    }
+    check(same, "engine chain and Greeks match the free functions bit for bit, call after call");
+    check(engine.arena.used == 0 && engine.arena.peak > 0 && engine.arena.peak <= engine.arena.capacity,
+          "every call rewinds the arena");
+
+    opts.sampler = MC_SAMPLER_SOBOL;
+    price_european_chain_mc(100.0, 0.04, 0.25, 0.8, types, strikes, 3, &opts, ref);
+    mc_engine_price_chain(&engine, 100.0, 0.04, 0.25, 0.8, types, strikes, 3, &opts, got, NULL, NULL);
+    check(same_bits(ref[2].price, got[2].price) && same_bits(ref[2].std_error, got[2].std_error),
+          "engine Sobol chain matches the free function");
+
+    // A run within the limits resumes across calls like a fresh run of the total size
+    opts.sampler = MC_SAMPLER_PSEUDO;
+    opts.n_sim = 2 * MC_CHUNK_PATHS;
+    mc_run_state state = {0};
+    mc_result resumed;
+    mc_engine_resume(&engine, OPTION_PUT, 100.0, 95.0, 0.04, 0.25, 0.8, &opts, &state, &resumed);
+    opts.n_sim = 8 * MC_CHUNK_PATHS;
+    mc_engine_resume(&engine, OPTION_PUT, 100.0, 95.0, 0.04, 0.25, 0.8, &opts, &state, &resumed);
+    mc_result fresh = price_european_mc(OPTION_PUT, 100.0, 95.0, 0.04, 0.25, 0.8, &opts);
+    check(same_bits(resumed.price, fresh.price) && resumed.n_paths == fresh.n_paths,
+          "engine resume matches a fresh run");
+
+    path_option asian = { OPTION_CALL, 100.0, AVERAGE_ARITHMETIC, BARRIER_NONE, 0.0, MONITOR_DISCRETE, 12 };
+    market_model gbm = model_gbm(100.0, 0.04, 0.25);
+    mc_result path_ref = price_path_model_mc(&asian, &gbm, 0.8, &opts);
+    mc_result path_got = mc_engine_price_path(&engine, &asian, &gbm, 0.8, &opts);
+    const double S2[2] = { 100.0, 90.0 }, sigma2[2] = { 0.25, 0.35 }, corr2[4] = { 1.0, 0.4, 0.4, 1.0 };
+    basket_option spread = { OPTION_CALL, BASKET_SPREAD, 5.0, 2, NULL };
+    mc_result basket_ref = price_basket_mc(&spread, S2, sigma2, corr2, 0.04, 0.8, &opts);
+    mc_result basket_got = mc_engine_price_basket(&engine, &spread, S2, sigma2, corr2, 0.04, 0.8, &opts);
+    check(same_bits(path_ref.price, path_got.price) && same_bits(basket_ref.price, basket_got.price),
+          "engine path and basket prices match the free functions");
+
+    // Model tables, the Brownian bridge and the LSM state come from the arena too
+    const mc_engine_limits table_limits = { .max_contracts = 1, .max_paths = 200000, .max_replicates = 16,
+                                            .max_steps = 12, .max_assets = 2, .max_american_paths = 50000 };
+    mc_engine tables;
+    check(mc_engine_init(&tables, &table_limits) == 0, "engine reserves room for tables and American paths");
+    const double times[2] = { 0.0, 1.0 }, spots[2] = { 50.0, 200.0 }, skew[4] = { 0.3, 0.2, 0.32, 0.22 };
+    local_vol_surface surface = { 2, 2, times, spots, skew };
+    market_model lv = model_local_vol(100.0, 0.04, &surface);
+    mc_result lv_ref = price_path_model_mc(&asian, &lv, 0.8, &opts);
+    mc_result lv_got = mc_engine_price_path(&tables, &asian, &lv, 0.8, &opts);
+    mc_options sobol = opts;
+    sobol.sampler = MC_SAMPLER_SOBOL;
+    sobol.n_replicates = 8;
+    mc_result qmc_ref = price_path_model_mc(&asian, &gbm, 0.8, &sobol);
+    mc_result qmc_got = mc_engine_price_path(&tables, &asian, &gbm, 0.8, &sobol);
+    american_option put = { OPTION_PUT, 100.0, 20, LSM_BASIS_LAGUERRE, 3 };
+    mc_options lsm_opts = opts;
+    lsm_opts.n_sim = 40000;
+    mc_result am_ref = price_american_lsm(&put, 95.0, 0.04, 0.25, 0.8, &lsm_opts);
+    mc_result am_got = mc_engine_price_american(&tables, &put, 95.0, 0.04, 0.25, 0.8, &lsm_opts);
+    check(same_bits(lv_ref.price, lv_got.price) && same_bits(qmc_ref.price, qmc_got.price)
+          && same_bits(qmc_ref.std_error, qmc_got.std_error) && same_bits(am_ref.price, am_got.price)
+          && same_bits(am_ref.std_error, am_got.std_error),
+          "engine local-vol, Sobol path and American prices match the free functions");
+    check(tables.arena.used == 0, "table-backed calls rewind the arena too");
+    path_option long_asian = asian;
+    long_asian.n_steps = 4000;
+    lsm_opts.n_sim = 2000000;
+    check(isnan(mc_engine_price_path(&tables, &long_asian, &lv, 0.8, &opts).price)
+          && isnan(mc_engine_price_american(&tables, &put, 95.0, 0.04, 0.25, 0.8, &lsm_opts).price),
+          "tables or American paths beyond the arena fail with NAN");
+    mc_engine_free(&tables);
+
+    // With a tolerance only one batch has to fit, however many paths are allowed
+    opts.n_sim = 4000000;
+    opts.rel_tol = 0.002;
+    check(mc_engine_fits(&engine, 4, &opts, 1), "a tolerance run needs room for one batch only");
+    opts.rel_tol = 0.0;
+    opts.n_sim = 40000000;
+    check(!mc_engine_fits(&engine, 1, &opts, 0)
+          && mc_engine_price_chain(&engine, 100.0, 0.04, 0.25, 0.8, types, strikes, 3, &opts,
+                                   got, NULL, NULL) == -1 && isnan(got[0].price),
+          "a request beyond the arena fails with NAN");
+    opts.n_sim = limits.max_paths;
+    check(mc_engine_fits(&engine, 4, &opts, 1) && !mc_engine_fits(&engine, 64, &opts, 1),
+          "room is checked per contract");
+    check(isnan(mc_engine_price_path(&engine, &asian, &gbm, 0.8, &(mc_options){ .n_sim = 0 }).price),
+          "invalid requests still fail on an engine");
+
+    mc_engine_free(&engine);
+    mc_engine empty;
+    const mc_engine_limits none = { 0 };
+    check(mc_engine_init(&empty, &none) == -1 && !mc_engine_fits(&empty, 1, &opts, 0), "zero limits are rejected");
+}
+
+/**
+ * Multilevel Monte Carlo against continuous-time closed forms.
+ */
+static void test_mlmc(void) {
+    printf("Multilevel Monte Carlo\n");
+
+    mc_options opts = mc_options_default();
+    opts.n_sim = 4000000;
+    opts.abs_tol = 0.02;
+    opts.n_threads = 1;
+    mlmc_options mlmc = mlmc_options_default();
+    mlmc_report report;
+
+    // Continuous geometric average: the 10^6-date closed form is its limit to well below ε
+    path_option asian = { OPTION_CALL, 100.0, AVERAGE_GEOMETRIC, BARRIER_NONE, 0.0, MONITOR_DISCRETE, 0 };
+    mc_result geo = price_path_mlmc(&asian, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, &report);
+    double geo_exact = price_geometric_asian_bs(OPTION_CALL, 100.0, 100.0, 0.05, 0.2, 1.0, 1000000);
+    check(report.converged && fabs(geo.price - geo_exact) < 3.0 * opts.abs_tol
+          && geo.std_error <= opts.abs_tol / sqrt(2.0) * (1.0 + 1e-9),
+          "geometric Asian reaches its continuous closed form within the RMSE target");
+    check(report.n_levels >= 3 && report.variance[2] < report.variance[1]
+          && report.variance[report.n_levels - 1] < 0.1 * report.variance[1]
+          && report.n_paths[report.n_levels - 1] < report.n_paths[0],
+          "corrections shrink with the level and fine levels get fewer paths");
+
+    // One grid fine enough for the same bias would need V_0 * 2/ε² paths of the finest size
+    size_t finest = mlmc.base_steps << (report.n_levels - 1);
+    double single_level = report.variance[0] * 2.0 / (opts.abs_tol * opts.abs_tol) * (double)finest;
+    check(report.cost < 0.25 * single_level, "multilevel costs well under a single fine grid");
+
+    asian.average = AVERAGE_ARITHMETIC;
+    mc_result one = price_path_mlmc(&asian, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, NULL);
+    opts.n_threads = 3;
+    mc_result three = price_path_mlmc(&asian, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, &report);
+    check(same_bits(one.price, three.price) && one.n_paths == three.n_paths && report.converged,
+          "multilevel run is bit-identical across thread counts");
+    check(three.price < geo.price + 1.0 && three.price > geo.price, "arithmetic average is above the geometric");
+
+    // The bridge correction leaves no grid bias to remove: the run stops at three levels
+    path_option barrier = { OPTION_CALL, 100.0, AVERAGE_NONE, BARRIER_DOWN_OUT, 90.0, MONITOR_CONTINUOUS, 0 };
+    double exact = down_and_out_call(100.0, 100.0, 90.0, 0.05, 0.2, 1.0);
+    mc_result bridged = price_path_mlmc(&barrier, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, &report);
+    check(fabs(bridged.price - exact) < 3.0 * opts.abs_tol && report.n_levels == 3 && report.converged,
+          "continuous barrier matches its closed form on three levels");
+
+    // A sample cap below what the target needs is reported as not converged
+    opts.n_sim = 2048;
+    price_path_mlmc(&asian, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, &report);
+    check(!report.converged && report.n_paths[0] <= MC_CHUNK_PATHS, "n_sim caps each level (to whole chunks)");
+
+    mlmc.refinement = 1;
+    check(isnan(price_path_mlmc(&asian, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, NULL).price),
+          "invalid refinement gives NAN");
+    mlmc = mlmc_options_default();
+    opts.abs_tol = 0.0;
+    check(isnan(price_path_mlmc(&asian, 100.0, 0.05, 0.2, 1.0, &opts, &mlmc, &report).price)
+          && report.n_levels == 0, "a run without a tolerance gives NAN");
+}
+
+/**
+ * In-process "ranks": threads that swap chunk slots through shared memory.
+ */
+typedef struct {
+    mtx_t lock;
+    cnd_t turn;
+    unsigned n_ranks, arrived, generation;
+    unsigned char *gather;      // Every rank's slots of the current exchange
+} shard_world;
+
+typedef struct {
+    shard_world *world;
+    mc_shard shard;
+    int greeks;
+    mc_result results[3];
+    option_greeks g[3];
+    int status;
+} shard_rank;
+
+static void shard_barrier(shard_world *w) {
+    mtx_lock(&w->lock);
+    unsigned generation = w->generation;
+    if (++w->arrived == w->n_ranks) {
+        w->arrived = 0;
+        w->generation++;
+        cnd_broadcast(&w->turn);
+    } else {
+        while (generation == w->generation) {
+            cnd_wait(&w->turn, &w->lock);
+        }
+    }
+    mtx_unlock(&w->lock);
+}
+
+static int shard_exchange(void *ctx, void *slots, size_t slot_bytes, uint32_t n_chunks) {
+    shard_rank *self = ctx;
+    shard_world *w = self->world;
+    uint32_t first, count;
+    mc_shard_range(n_chunks, self->shard.rank, w->n_ranks, &first, &count);
+    memcpy(w->gather + first * slot_bytes, (unsigned char *)slots + first * slot_bytes, count * slot_bytes);
+    shard_barrier(w);
+    memcpy(slots, w->gather, n_chunks * slot_bytes);
+    shard_barrier(w);
+    return 0;
+}
+
+static const option_type g_shard_types[3] = { OPTION_CALL, OPTION_PUT, OPTION_CALL };
+static const double g_shard_strikes[3] = { 95.0, 100.0, 120.0 };
+static mc_options g_shard_opts;
+
+static int shard_rank_main(void *arg) {
+    shard_rank *self = arg;
+    self->status = price_european_chain_sharded_mc(100.0, 0.02, 0.3, 0.5, g_shard_types, g_shard_strikes, 3,
+                                                   &g_shard_opts, &self->shard, self->results,
+                                                   self->greeks ? self->g : NULL, NULL);
+    return 0;
+}
+
+/**
+ * Run g_shard_opts on n_ranks thread ranks; 1 if every rank matches ref bit for bit.
+ */
+static int shard_run_matches(unsigned n_ranks, int greeks, const mc_result *ref, const option_greeks *ref_g) {
+    shard_world world = { .n_ranks = n_ranks };
+    shard_rank ranks[4];
+    thrd_t threads[4];
+    world.gather = malloc((size_t)1 << 20);
+    mtx_init(&world.lock, mtx_plain);
+    cnd_init(&world.turn);
+    for (unsigned q = 0; q < n_ranks; q++) {
+        ranks[q] = (shard_rank){ .world = &world, .shard = { q, n_ranks, shard_exchange, &ranks[q], NULL }, .greeks = greeks };
+        thrd_create(&threads[q], shard_rank_main, &ranks[q]);
+    }
+    int same = 1;
+    for (unsigned q = 0; q < n_ranks; q++) {
+        thrd_join(threads[q], NULL);
+        same &= ranks[q].status == 0;
+        for (int k = 0; k < 3; k++) {
+            same &= same_bits(ranks[q].results[k].price, ref[k].price)
+                    && same_bits(ranks[q].results[k].std_error, ref[k].std_error)
+                    && ranks[q].results[k].n_paths == ref[k].n_paths;
+            if (greeks) {
+                same &= same_bits(ranks[q].g[k].gamma, ref_g[k].gamma) && same_bits(ranks[q].g[k].vega, ref_g[k].vega);
+            }
+        }
+    }
+    cnd_destroy(&world.turn);
+    mtx_destroy(&world.lock);
+    free(world.gather);
+    return same;
+}
+
+/**
+ * A chain split across ranks (threads standing in for MPI processes here).
+ */
+// Exchanges attempted after a refused agreement (there must be none)
+static int g_refused_exchanges;
+
+static int refused_exchange(void *ctx, void *slots, size_t slot_bytes, uint32_t n_chunks) {
+    (void)ctx;
+    (void)slots;
+    (void)slot_bytes;
+    (void)n_chunks;
+    g_refused_exchanges++;
+    return 0;
+}
+
+// Agreement as seen by a rank whose peer ran out of memory
+static int refused_agree(void *ctx, int ok) {
+    (void)ctx;
+    (void)ok;
+    return 0;
+}
+
+static void test_sharded_chain(void) {
+    printf("Sharded chains\n");
+
+    uint32_t first, count, next = 0;
+    int tiled = 1;
+    for (unsigned q = 0; q < 4; q++) {
+        mc_shard_range(10, q, 4, &first, &count);
+        tiled &= (first == next && (count == 2 || count == 3));
+        next = first + count;
+    }
+    check(tiled && next == 10, "shard ranges tile a batch in near-equal pieces");
+
+    g_shard_opts = mc_options_default();
+    g_shard_opts.n_sim = 300000;
+    g_shard_opts.n_threads = 1;
+    g_shard_opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    mc_result ref[3];
+    option_greeks ref_g[3];
+    price_european_chain_greeks_mc(100.0, 0.02, 0.3, 0.5, g_shard_types, g_shard_strikes, 3, &g_shard_opts,
+                                   ref, ref_g, NULL);
+    check(shard_run_matches(3, 1, ref, ref_g), "3 ranks reproduce the single-process chain and Greeks");
+
+    g_shard_opts.rel_tol = 0.003;
+    g_shard_opts.batch_paths = 2 * MC_CHUNK_PATHS;
+    price_european_chain_mc(100.0, 0.02, 0.3, 0.5, g_shard_types, g_shard_strikes, 3, &g_shard_opts, ref);
+    check(ref[0].n_paths < g_shard_opts.n_sim && shard_run_matches(4, 0, ref, NULL),
+          "4 ranks stop an early-stopping run at the same batch");
+
+    mc_shard bad = { 2, 2, shard_exchange, NULL, NULL };
+    mc_result out[3];
+    check(price_european_chain_sharded_mc(100.0, 0.02, 0.3, 0.5, g_shard_types, g_shard_strikes, 3,
+                                          &g_shard_opts, &bad, out, NULL, NULL) == -1 && isnan(out[0].price),
+          "a rank outside the shard is rejected");
+
+    mc_shard refused = { 0, 2, refused_exchange, NULL, refused_agree };
+    check(price_european_chain_sharded_mc(100.0, 0.02, 0.3, 0.5, g_shard_types, g_shard_strikes, 3,
+                                          &g_shard_opts, &refused, out, NULL, NULL) == -1
+          && isnan(out[0].price) && g_refused_exchanges == 0,
+          "a failed agreement stops every rank before its first exchange");
+}
+
+MC_DEFINE_PAYOFF_BLOCK(test_put_block, double, MC_PAYOFF_PUT, 0)
+MC_DEFINE_PAYOFF_BLOCK(test_call_av_block_f32, float, MC_PAYOFF_CALL, 1)
+
+/**
+ * One-chunk chain priced with the runtime block kernels, as the engine did
+ * before its kernels were generated per precision and variance reduction.
+ */
+static void kernel_reference(int single, unsigned vr, uint64_t seed, uint32_t n_sim, const option_type *types,
+                             const double *strikes, size_t n, mc_result *out) {
+    const double S0 = 100.0, r = 0.04, sigma = 0.3, T = 0.75;
+    int antithetic = (vr & MC_VR_ANTITHETIC) != 0, control = (vr & MC_VR_CONTROL) != 0;
+    gbm_terminal g = gbm_terminal_init(S0, r, sigma, T);
+    double forward = S0 * exp(r * T), discount = exp(-r * T);
+    double z[256], zn[256], s[256], sn[256], y[256], yn[256], x[256];
+    float zf[256], znf[256], sf[256], snf[256], yf[256], ynf[256], xf[256];
+    mc_moments m[8] = { { 0 } };
+    rng_state rng;
+    rng_seed(&rng, seed);
+    for (uint32_t left = antithetic ? (n_sim + 1) / 2 : n_sim; left > 0;) {
+        uint32_t b = (left < 256) ? left : 256;
+        if (single) {
+            normal_fill_f32(&rng, zf, b);
+            gbm_terminal_fill_f32(&g, zf, sf, b);
+            for (uint32_t i = 0; i < b; i++) znf[i] = -zf[i];
+            gbm_terminal_fill_f32(&g, znf, snf, b);
+            for (uint32_t i = 0; i < b; i++) xf[i] = (antithetic ? 0.5f * (sf[i] + snf[i]) : sf[i]) - (float)forward;
+        } else {
+            normal_fill(&rng, z, b);
+            gbm_terminal_fill(&g, z, s, b);
+            for (uint32_t i = 0; i < b; i++) zn[i] = -z[i];
+            gbm_terminal_fill(&g, zn, sn, b);
+            for (uint32_t i = 0; i < b; i++) x[i] = (antithetic ? 0.5 * (s[i] + sn[i]) : s[i]) - forward;
+        }
+        for (size_t k = 0; k < n; k++) {
+            if (single) {
+                payoff_fill_f32(types[k], sf, b, (float)strikes[k], yf);
+                payoff_fill_f32(types[k], snf, b, (float)strikes[k], ynf);
+                for (uint32_t i = 0; antithetic && i < b; i++) yf[i] = 0.5f * (yf[i] + ynf[i]);
+                moments_add_block_f32(&m[k], yf, control ? xf : NULL, b);
+            } else {
+                payoff_fill(types[k], s, b, strikes[k], y);
+                payoff_fill(types[k], sn, b, strikes[k], yn);
+                for (uint32_t i = 0; antithetic && i < b; i++) y[i] = 0.5 * (y[i] + yn[i]);
+                moments_add_block(&m[k], y, control ? x : NULL, b);
+            }
+        }
+        left -= b;
+    }
+    for (size_t k = 0; k < n; k++) {
+        double mean, variance;
+        if (control) {
+            moments_control(&m[k], &mean, &variance);
+        } else {
+            mean = moments_mean(&m[k]);
+            variance = moments_variance(&m[k]);
+        }
+        out[k] = (mc_result){ discount * mean, discount * sqrt(variance / (double)m[k].n),
+                              antithetic ? 2 * m[k].n : m[k].n };
+    }
+}
+
+static void test_specialized_kernels(void) {
+    printf("Specialized kernels\n");
+
+    // Generated payoff blocks against payoff_fill, ties at the strike included
+    double S[301], ref[301], got[301], S_down[301];
+    float Sf[301], Sf_down[301], ref_f[301], ref_fd[301], got_f[301];
+    rng_state rng;
+    rng_seed(&rng, 17);
+    for (int i = 0; i < 301; i++) {
+        S[i] = (i % 10 == 0) ? 100.0 : 100.0 * exp(0.3 * normal_random(&rng));
+        S_down[i] = 1e4 / S[i];
+        Sf[i] = (float)S[i];
+        Sf_down[i] = (float)S_down[i];
+    }
+    payoff_fill(OPTION_PUT, S, 301, 100.0, ref);
+    test_put_block(S, NULL, 301, 100.0, got);
+    int same = 1;
+    for (int i = 0; i < 301; i++) same &= same_bits(ref[i], got[i]);
+    payoff_fill_f32(OPTION_CALL, Sf, 301, 100.0f, ref_f);
+    payoff_fill_f32(OPTION_CALL, Sf_down, 301, 100.0f, ref_fd);
+    test_call_av_block_f32(Sf, Sf_down, 301, 100.0f, got_f);
+    for (int i = 0; i < 301; i++) same &= (0.5f * (ref_f[i] + ref_fd[i]) == got_f[i]);
+    check(same, "generated payoff blocks match payoff_fill bit for bit");
+
+    // Every entry of the dispatch table against the runtime reference
+    const option_type types[4] = { OPTION_CALL, OPTION_PUT, OPTION_PUT, OPTION_CALL };
+    const double strikes[4] = { 85.0, 95.0, 100.0, 120.0 };
+    int all = 1;
+    for (int single = 0; single <= 1; single++) {
+        for (unsigned vr = 0; vr < 4; vr++) {
+            mc_options opts = mc_options_default();
+            opts.n_sim = 9001;
+            opts.seed = 40 + vr;
+            opts.variance_reduction = vr;
+            opts.precision = single ? MC_PRECISION_FLOAT : MC_PRECISION_DOUBLE;
+            mc_result want[4], have[4];
+            kernel_reference(single, vr, opts.seed, opts.n_sim, types, strikes, 4, want);
+            price_european_chain_mc(100.0, 0.04, 0.3, 0.75, types, strikes, 4, &opts, have);
+            for (int k = 0; k < 4; k++) {
+                all &= same_bits(want[k].price, have[k].price) && same_bits(want[k].std_error, have[k].std_error)
+                       && want[k].n_paths == have[k].n_paths;
+            }
+        }
+    }
+    check(all, "each precision and variance-reduction kernel matches the runtime loops bit for bit");
+}
+
+// Rows seen by the counting sink of test_results_output
+typedef struct {
+    size_t rows;
+    size_t batches;
+    size_t largest;
+    int in_order;
+} results_tally;
+
+static int tally_write(void *ctx, const result_row *rows, size_t n_rows) {
+    results_tally *t = ctx;
+    for (size_t i = 0; i < n_rows; i++) {
+        t->in_order &= (rows[i].id == t->rows + i);
+    }
+    t->rows += n_rows;
+    t->batches++;
+    t->largest = (n_rows > t->largest) ? n_rows : t->largest;
+    return 0;
+}
+
+static int failing_write(void *ctx, const result_row *rows, size_t n_rows) {
+    (void)ctx;
+    (void)rows;
+    (void)n_rows;
+    return -1;
+}
+
+/**
+ * Row i of the results test: awkward values, so formats must round-trip exactly.
+ */
+static result_row results_test_row(size_t i) {
+    result_row row = { 0 };
+    row.id = i;
+    snprintf(row.ticker, sizeof(row.ticker), "T%zu", i % 97);
+    row.type = (i % 3) ? OPTION_CALL : OPTION_PUT;
+    row.S0 = 100.0 + 0.1 * (double)i;
+    row.K = row.S0 * (0.9 + 1e-5 * (double)(i % 1000));
+    row.r = 0.03;
+    row.sigma = 0.2 + 1.0 / (double)(i + 3);
+    row.T = 0.25 + (double)(i % 8) / 3.0;
+    row.market_price = 0.0;
+    row.price = sqrt((double)i + 0.5);
+    row.std_error = 1e-3 / (double)(i + 1);
+    row.n_paths = 100000 + i;
+    row.greeks = (option_greeks){ 0.5, NAN, 1.0 / 7.0, -2.0, -1e-300 };
+    row.seconds = 1e-6 * (double)i;
+    return row;
+}
+
+static void test_results_output(void) {
+    printf("Results output\n");
+    enum { N_ROWS = 10000, BATCH = 512 };
+    const char *bin_path = "build/test_results.mcres", *csv_path = "build/test_results.csv";
+
+    results_tally tally = { 0, 0, 0, 1 };
+    results_sink sinks[3];
+    int opened = (results_sink_columnar(&sinks[0], bin_path) == 0) & (results_sink_csv(&sinks[1], csv_path) == 0);
+    sinks[2] = (results_sink){ tally_write, NULL, &tally };
+    results_writer *w = opened ? results_writer_open(sinks, 3, BATCH) : NULL;
+    check(w != NULL, "a writer opens with columnar, CSV and callback sinks");
+    if (!w) {
+        return;
+    }
+
+    // Pushes of uneven sizes, some spanning several batches
+    result_row rows[1500];
+    int pushed = 1;
+    for (size_t next = 0, step = 1; next < N_ROWS; step = step * 7 % 1499 + 1) {
+        size_t n = (N_ROWS - next < step) ? N_ROWS - next : step;
+        for (size_t i = 0; i < n; i++) {
+            rows[i] = results_test_row(next + i);
+        }
+        pushed &= (results_writer_push(w, rows, n) == 0);
+        next += n;
+    }
+    check(pushed && results_writer_close(w) == 0, "pushing and closing succeed");
+    check(tally.rows == N_ROWS && tally.in_order && tally.largest == BATCH
+          && tally.batches == (N_ROWS + BATCH - 1) / BATCH,
+          "sinks see every row, in push order, in full batches plus one partial");
+
+    // Columnar file: read back in place, bit for bit
+    results_file f;
+    results_batch batch;
+    size_t seen = 0, n_batches = 0;
+    int same = 1, status = -1;
+    if (results_file_open(&f, bin_path) == 0) {
+        while ((status = results_file_next(&f, &batch)) == 1) {
+            const uint64_t *id = batch.column[RESULTS_COL_ID];
+            const char *ticker = batch.column[RESULTS_COL_TICKER];
+            const int32_t *type = batch.column[RESULTS_COL_TYPE];
+            const double *K = batch.column[RESULTS_COL_K];
+            const double *price = batch.column[RESULTS_COL_PRICE];
+            const uint64_t *n_paths = batch.column[RESULTS_COL_N_PATHS];
+            const double *gamma = batch.column[RESULTS_COL_GAMMA];
+            const double *theta = batch.column[RESULTS_COL_THETA];
+            for (size_t i = 0; i < batch.n_rows; i++) {
+                result_row want = results_test_row(seen + i);
+                same &= (id[i] == want.id && strcmp(ticker + i * RESULTS_TICKER_LEN, want.ticker) == 0
+                         && type[i] == (int32_t)want.type && same_bits(K[i], want.K)
+                         && same_bits(price[i], want.price) && n_paths[i] == want.n_paths
+                         && isnan(gamma[i]) && same_bits(theta[i], want.greeks.theta));
+            }
+            for (int c = 0; c < RESULTS_N_COLUMNS; c++) {
+                same &= ((uintptr_t)batch.column[c] % 64 == 0);
+            }
+            seen += batch.n_rows;
+            n_batches++;
+        }
+        results_file_close(&f);
+    }
+    check(status == 0 && same && seen == N_ROWS && n_batches == tally.batches,
+          "the columnar file reads back bit for bit, 64-byte aligned columns");
+
+    // CSV file: header, then values that parse back exactly
+    FILE *fp = fopen(csv_path, "r");
+    char line[1024];
+    size_t lines = 0;
+    same = fp && fgets(line, sizeof(line), fp) && strncmp(line, "id,ticker,type,", 15) == 0;
+    while (fp && fgets(line, sizeof(line), fp)) {
+        result_row want = results_test_row(lines);
+        char *field = line;
+        double value[8];
+        unsigned long long id = strtoull(field, &field, 10);
+        field = strchr(field + 1, ',');             // Skip ticker
+        int is_put = field && strncmp(field + 1, "put,", 4) == 0;
+        field = field ? strchr(field + 1, ',') : NULL;
+        for (int k = 0; k < 8 && field; k++) {
+            value[k] = strtod(field + 1, &field);
+        }
+        same &= (field != NULL && id == want.id && is_put == (want.type == OPTION_PUT)
+                 && same_bits(value[1], want.K) && same_bits(value[6], want.price)
+                 && same_bits(value[7], want.std_error));
+        lines++;
+    }
+    if (fp) fclose(fp);
+    check(same && lines == N_ROWS, "the CSV file has a header and exact values for every row");
+    check(results_file_open(&f, csv_path) == -1, "a CSV is not mistaken for a columnar file");
+
+    // A failing sink surfaces on push or close, and the writer still shuts down
+    results_sink bad = { failing_write, NULL, NULL };
+    w = results_writer_open(&bad, 1, 8);
+    int failed = 0;
+    for (size_t i = 0; w && i < 100; i++) {
+        rows[0] = results_test_row(i);
+        failed |= (results_writer_push(w, rows, 1) == -1);
+    }
+    failed |= (w && results_writer_close(w) == -1);
+    check(w && failed, "a failing sink is reported to the producer");
+    check(results_writer_open(sinks, 0, 0) == NULL, "a writer needs at least one sink");
+
+    remove(bin_path);
+    remove(csv_path);
+}
+
+int main(void) {
+    test_rng_streams();
+    test_normal_fill();
+    test_block_kernels();
+    test_thread_determinism();
+    test_variance_reduction();
+    test_qmc_building_blocks();
+    test_qmc_engine();
+    test_online_stats();
+    test_early_stopping();
+    test_option_chain();
+    test_greeks();
+    test_path_engine();
+    test_path_payoffs();
+    test_lsm();
+    test_philox();
+    test_black_scholes_batch();
+    test_implied_vol();
+    test_models();
+    test_basket();
+    test_scenarios();
+    test_market_data();
+    test_profile();
+    test_server();
+    test_cache();
+    test_work_stealing();
+    test_float32();
+    test_specialized_kernels();
+    test_engine_context();
+    test_mlmc();
+    test_sharded_chain();
+    test_results_output();
+#ifdef MC_GPU
+    test_gpu();
+#endif
+
+    if (g_failures) {
+        printf("%d check(s) FAILED\n", g_failures);
+        return 1;
+    }
+    printf("All engine checks passed\n");
+    return 0;
+}
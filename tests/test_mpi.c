@@ -0,0 +1,184 @@
+//
+// MPI Tests
+// Run under mpirun by `make test-mpi`: every rank checks the distributed
+// drivers against the single-process engine with the same seed.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "include/distributed.h"
+#include "include/monte_carlo.h"
+#include "include/portfolio.h"
+
+static int g_failures = 0;
+static int g_rank = 0;
+
+/**
+ * Record the outcome of one check on every rank; rank 0 prints it.
+ */
+static void check(int ok, const char *name) {
+    int all = 0;
+    MPI_Allreduce(&ok, &all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (g_rank == 0) {
+        printf("  [%s] %s\n", all ? "PASS" : "FAIL", name);
+    }
+    if (!all) {
+        g_failures++;
+    }
+}
+
+/**
+ * Two doubles are bit-identical (stricter than ==, which treats -0 == +0).
+ */
+static int same_bits(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/**
+ * Same prices, errors, path counts and (if given) Greeks, bit for bit.
+ */
+static int same_results(const mc_result *a, const mc_result *b, const option_greeks *ga,
+                        const option_greeks *gb, size_t n) {
+    int same = 1;
+    for (size_t k = 0; k < n; k++) {
+        same &= same_bits(a[k].price, b[k].price) && same_bits(a[k].std_error, b[k].std_error)
+                && a[k].n_paths == b[k].n_paths;
+        if (ga) {
+            same &= same_bits(ga[k].delta, gb[k].delta) && same_bits(ga[k].gamma, gb[k].gamma)
+                    && same_bits(ga[k].vega, gb[k].vega) && same_bits(ga[k].rho, gb[k].rho)
+                    && same_bits(ga[k].theta, gb[k].theta);
+        }
+    }
+    return same;
+}
+
+/**
+ * One chain with its paths split across the ranks.
+ */
+static void test_chain_paths(void) {
+    if (g_rank == 0) {
+        printf("Chain split by paths\n");
+    }
+    const option_type types[4] = { OPTION_CALL, OPTION_PUT, OPTION_CALL, OPTION_PUT };
+    const double strikes[4] = { 90.0, 100.0, 110.0, 120.0 };
+    mc_options opts = mc_options_default();
+    opts.n_sim = 1000000;
+    opts.seed = 7;
+    opts.variance_reduction = MC_VR_ANTITHETIC | MC_VR_CONTROL;
+    mc_result ref[4], got[4];
+    option_greeks ref_g[4], got_g[4];
+
+    price_european_chain_greeks_mc(100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts, ref, ref_g, NULL);
+    int status = mpi_price_chain(MPI_COMM_WORLD, 100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts,
+                                 got, got_g, NULL);
+    check(status == 0 && same_results(ref, got, ref_g, got_g, 4),
+          "prices, errors and Greeks match the single-node run bit for bit");
+
+    // Early stopping: every rank sees the same totals, so all stop together
+    opts.rel_tol = 0.002;
+    opts.batch_paths = 3 * MC_CHUNK_PATHS;
+    price_european_chain_mc(100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts, ref);
+    status = mpi_price_chain(MPI_COMM_WORLD, 100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts, got, NULL, NULL);
+    check(status == 0 && same_results(ref, got, NULL, NULL, 4) && got[0].n_paths < opts.n_sim,
+          "an early-stopping run stops at the same batch");
+
+    // Fewer chunks than ranks: some ranks simulate nothing but still reduce
+    opts.rel_tol = 0.0;
+    opts.n_sim = MC_CHUNK_PATHS;
+    opts.precision = MC_PRECISION_FLOAT;
+    price_european_chain_mc(100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts, ref);
+    status = mpi_price_chain(MPI_COMM_WORLD, 100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts, got, NULL, NULL);
+    check(status == 0 && same_results(ref, got, NULL, NULL, 4), "a one-chunk float run matches too");
+
+    // One rank short of memory: every rank learns it at the agreement, before any exchange
+    mc_shard shard;
+    mpi_shard_ctx ctx;
+    const size_t slot_bytes[1] = { 3 * sizeof(double) };
+    int init = mpi_shard_init(&shard, &ctx, MPI_COMM_WORLD, slot_bytes, 1);
+    check(init == 0 && mpi_shard_agree(&ctx, g_rank != 0) == 0 && mpi_shard_agree(&ctx, 1) == 1,
+          "ranks agree on allocation success before the first exchange");
+
+    // The batch exchange reuses the context's arrays and datatype
+    enum { N_SLOTS = 7 };
+    double slots[N_SLOTS][3];
+    uint32_t first, count;
+    mc_shard_range(N_SLOTS, shard.rank, shard.n_ranks, &first, &count);
+    for (uint32_t c = first; c < first + count; c++) {
+        slots[c][0] = slots[c][1] = slots[c][2] = (double)c;
+    }
+    int gathered = init == 0 && mpi_shard_exchange(&ctx, slots, sizeof(slots[0]), N_SLOTS) == 0;
+    for (int c = 0; gathered && c < N_SLOTS; c++) {
+        gathered = (slots[c][0] == c && slots[c][2] == c);
+    }
+    check(gathered && mpi_shard_exchange(&ctx, slots, sizeof(double), N_SLOTS) == -1,
+          "exchanges reuse the committed slot type; an unregistered size fails on every rank");
+    mpi_shard_free(&ctx);
+
+    // A setup failure on one rank fails the setup on all of them
+    const size_t bad_bytes[1] = { (g_rank == 0) ? 0 : sizeof(double) };
+    check(mpi_shard_init(&shard, &ctx, MPI_COMM_WORLD, bad_bytes, 1) == -1,
+          "a shard setup failing on one rank fails on every rank");
+
+    opts.sampler = MC_SAMPLER_SOBOL;
+    status = mpi_price_chain(MPI_COMM_WORLD, 100.0, 0.03, 0.3, 1.0, types, strikes, 4, &opts, got, NULL, NULL);
+    check(status == -1 && isnan(got[0].price), "Sobol runs are rejected on every rank");
+}
+
+/**
+ * A book with its groups split across the ranks.
+ */
+static void test_book_contracts(void) {
+    if (g_rank == 0) {
+        printf("Book split by contracts\n");
+    }
+    enum { N_BOOK = 13 };
+    option_contract book[N_BOOK];
+    for (int i = 0; i < N_BOOK; i++) {
+        double S0 = 80.0 + 10.0 * (i % 5);
+        book[i] = (option_contract){ { S0, 0.04, 0.25, 0.5 + 0.25 * (i % 2) }, S0 * (0.9 + 0.05 * (i % 4)),
+                                     (i % 3) ? OPTION_CALL : OPTION_PUT };
+    }
+    mc_options opts = mc_options_default();
+    opts.n_sim = 200000;
+    opts.variance_reduction = MC_VR_CONTROL;
+    mc_result ref[N_BOOK], got[N_BOOK];
+    option_greeks ref_g[N_BOOK], got_g[N_BOOK], ref_se[N_BOOK], got_se[N_BOOK];
+
+    price_portfolio_greeks_mc(book, N_BOOK, &opts, ref, ref_g, ref_se);
+    int status = mpi_price_portfolio(MPI_COMM_WORLD, book, N_BOOK, &opts, got, got_g, got_se);
+    check(status == 0 && same_results(ref, got, ref_g, got_g, N_BOOK) && same_results(ref, got, ref_se, got_se, N_BOOK),
+          "every contract and Greek matches the single-node book");
+
+    opts.rel_tol = 0.005;
+    opts.batch_paths = MC_CHUNK_PATHS;
+    price_portfolio_mc(book, N_BOOK, &opts, ref);
+    status = mpi_price_portfolio(MPI_COMM_WORLD, book, N_BOOK, &opts, got, NULL, NULL);
+    check(status == 0 && same_results(ref, got, NULL, NULL, N_BOOK),
+          "whole groups per rank keep early stopping identical");
+}
+
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+    int n_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &g_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+    if (g_rank == 0) {
+        printf("MPI checks on %d ranks\n", n_ranks);
+    }
+
+    test_chain_paths();
+    test_book_contracts();
+
+    if (g_rank == 0) {
+        if (g_failures) {
+            printf("%d check(s) FAILED\n", g_failures);
+        } else {
+            printf("All MPI checks passed\n");
+        }
+    }
+    MPI_Finalize();
+    return g_failures ? 1 : 0;
+}
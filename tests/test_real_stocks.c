@@ -11,16 +11,25 @@
 #include <time.h>
 #include "include/rng.h"
 #include "include/monte_carlo.h"
+#include "include/portfolio.h"
+#include "include/parallel.h"
+#include "include/implied_vol.h"
+#include "include/market_data.h"
+#include "include/results.h"
 
 // Global seed - can be fixed (reproducible) or time-based (random)
 static uint32_t g_seed = 42u;
 static int g_use_random_seed = 0;
+static unsigned g_threads = 0;  // Worker threads (0 = all cores)
+static mc_sampler g_sampler = MC_SAMPLER_PSEUDO;
+static double g_rel_tol = 0.0;      // Early-stopping tolerance (0 = use all paths)
+static mc_precision g_precision = MC_PRECISION_DOUBLE;
+static uint64_t g_paths_used = 0;   // Paths simulated over all options
 
-#define MAX_LINE_LENGTH 256
-#define MAX_TICKER_LENGTH 10
+#define MAX_TICKER_LENGTH MARKET_TICKER_LEN
 
 /**
- * Structure to hold option test data from CSV
+ * Structure to hold one option's test data (from CSV or a contract file)
  */
 typedef struct {
     char ticker[MAX_TICKER_LENGTH];
@@ -32,22 +41,107 @@ typedef struct {
     double market_price;    // Actual market price (if available)
 } OptionData;
 
+#define PRICE_BLOCK 256  // Rows priced together, then written in file order
+
+mc_options harness_options(uint32_t n_sim, int first_row);
+double report_option(const result_row *row);
+double days_to_years(int days);
+
+// Running summary of the table sink
+typedef struct {
+    int total;
+    int within_1pct;
+    double total_error;
+} table_summary;
+
 /**
- * Parse a single line of CSV data into OptionData struct
- * Returns 1 on success, 0 on failure (comment or invalid line)
+ * Fill OptionData from a parsed or mapped contract
  */
-int parse_csv_line(const char *line, OptionData *opt) {
-    // Skip comments and empty lines
-    if (line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
-        return 0;
+static void option_data_set(OptionData *opt, const char *ticker, double S0, double K, double r,
+                            double sigma, double T, double market_price) {
+    snprintf(opt->ticker, sizeof(opt->ticker), "%s", ticker);
+    opt->S0 = S0;
+    opt->K = K;
+    opt->r = r;
+    opt->sigma = sigma;
+    opt->days_to_expiry = (int)lround(T * 365.0);
+    opt->market_price = market_price;
+}
+
+/**
+ * Wall-clock seconds (C11 timespec_get, so no POSIX clock is needed)
+ */
+static double wall_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/**
+ * Price a block of options and queue their rows for the sinks.
+ *
+ * The block goes to price_portfolio_mc(), so rows that share (S0, sigma,
+ * r, T) - the strikes of one chain - are priced from one set of paths
+ * instead of simulating it again per row. Groups run concurrently on the
+ * work-stealing pool and each group's paths split further into chunks.
+ * The seed depends only on the block's first row number, so the output
+ * is the same for any thread count. Formatting and I/O happen on the
+ * writer thread while the next block is priced.
+ */
+static void run_block(const OptionData *rows, size_t n, uint32_t n_sim, int *total, results_writer *writer) {
+    option_contract book[PRICE_BLOCK];
+    mc_result priced[PRICE_BLOCK];
+    result_row out[PRICE_BLOCK];
+    for (size_t i = 0; i < n; i++) {
+        book[i] = (option_contract){
+            { rows[i].S0, rows[i].r, rows[i].sigma, days_to_years(rows[i].days_to_expiry) },
+            rows[i].K, OPTION_CALL
+        };
     }
-    
-    // Parse CSV: ticker,S0,K,r,sigma,days,market_price
-    int parsed = sscanf(line, "%9[^,],%lf,%lf,%lf,%lf,%d,%lf",
-                        opt->ticker, &opt->S0, &opt->K, &opt->r,
-                        &opt->sigma, &opt->days_to_expiry, &opt->market_price);
-    
-    return (parsed == 7) ? 1 : 0;
+    mc_options opts = harness_options(n_sim, *total);
+    double start = wall_seconds();
+    price_portfolio_mc(book, n, &opts, priced);    // Failed rows are NAN and show as such
+    double seconds = (wall_seconds() - start) / (double)n;
+
+    for (size_t i = 0; i < n; i++) {
+        const OptionData *opt = &rows[i];
+        out[i] = (result_row){
+            .id = (uint64_t)(*total + (int)i),
+            .type = OPTION_CALL,
+            .S0 = opt->S0,
+            .K = opt->K,
+            .r = opt->r,
+            .sigma = opt->sigma,
+            .T = book[i].stock.maturity,
+            .market_price = opt->market_price,
+            .price = priced[i].price,
+            .std_error = priced[i].std_error,
+            .n_paths = priced[i].n_paths,
+            .greeks = { NAN, NAN, NAN, NAN, NAN },
+            .seconds = seconds      // The block's time, shared evenly
+        };
+        snprintf(out[i].ticker, sizeof(out[i].ticker), "%s", opt->ticker);
+        g_paths_used += out[i].n_paths;
+    }
+    *total += (int)n;
+    if (writer) {
+        results_writer_push(writer, out, n);
+    }
+}
+
+/**
+ * Table sink: print each row and add it to the summary (writer thread)
+ */
+static int table_write(void *ctx, const result_row *rows, size_t n_rows) {
+    table_summary *summary = ctx;
+    for (size_t i = 0; i < n_rows; i++) {
+        double err = report_option(&rows[i]);
+        summary->total++;
+        if (fabs(err) < 1.0) summary->within_1pct++;
+        summary->total_error += fabs(err);
+    }
+    fflush(stdout);
+    return 0;
 }
 
 /**
@@ -58,18 +152,27 @@ double days_to_years(int days) {
 }
 
 /**
- * Run pricing test for a single option
+ * Engine options for the block starting at row first_row
+ */
+mc_options harness_options(uint32_t n_sim, int first_row) {
+    // One seed per block, deterministic if using fixed base seed (for any thread count)
+    mc_options opts = mc_options_default();
+    opts.n_sim = n_sim;
+    opts.seed = g_seed + first_row;
+    opts.n_threads = g_threads;
+    opts.sampler = g_sampler;
+    opts.rel_tol = g_rel_tol;
+    opts.precision = g_precision;
+    return opts;
+}
+
+/**
+ * Print one priced option against Black-Scholes and the market
  * Returns: error percentage (MC vs BS)
  */
-double test_option(const OptionData *opt, uint32_t n_sim, int test_num) {
-    double T = days_to_years(opt->days_to_expiry);
-    
-    // Use different seed per test for independence
-    // But deterministic if using fixed base seed
-    rng_seed(g_seed + test_num);
-    
-    // Price using Monte Carlo
-    double mc_price = price_european_call_mc(opt->S0, opt->K, opt->r, opt->sigma, T, n_sim);
+double report_option(const result_row *opt) {
+    double T = opt->T;
+    double mc_price = opt->price;
     
     // Price using Black-Scholes
     double bs_price = price_european_call_bs(opt->S0, opt->K, opt->r, opt->sigma, T);
@@ -77,12 +180,19 @@ double test_option(const OptionData *opt, uint32_t n_sim, int test_num) {
     // Calculate errors
     double mc_bs_error = ((mc_price - bs_price) / bs_price) * 100.0;
     
-    // Compare to market price if available
+    // Compare to market price if available, and back out its volatility
     char market_comparison[50] = "N/A";
+    char market_vol[16] = "N/A";
     if (opt->market_price > 0.01) {
         double market_error = ((mc_price - opt->market_price) / opt->market_price) * 100.0;
         snprintf(market_comparison, sizeof(market_comparison), "$%.2f (%+.1f%%)", 
                  opt->market_price, market_error);
+
+        double iv;
+        iv_batch_inputs quote = { &opt->market_price, &opt->S0, &opt->K, &opt->r, &T, NULL };
+        if (implied_vol_batch(&quote, 1, 1, &iv, NULL) == 0) {
+            snprintf(market_vol, sizeof(market_vol), "%5.1f%%", iv * 100);
+        }
     }
     
     // Determine option type (ITM/ATM/OTM)
@@ -92,9 +202,9 @@ double test_option(const OptionData *opt, uint32_t n_sim, int test_num) {
     else if (ratio < 0.98) moneyness = "OTM";
     else moneyness = "ATM";
     
-    printf("| %-5s | %3s | $%7.2f | $%7.2f | %5.1f%% | %3dd | $%7.2f | $%7.2f | %+6.2f%% | %-18s |\n",
+    printf("| %-5s | %3s | $%7.2f | $%7.2f | %5.1f%% | %3dd | $%7.2f | $%7.2f | %+6.2f%% | %-18s | %6s |\n",
            opt->ticker, moneyness, opt->S0, opt->K, opt->sigma * 100,
-           opt->days_to_expiry, mc_price, bs_price, mc_bs_error, market_comparison);
+           (int)lround(T * 365.0), mc_price, bs_price, mc_bs_error, market_comparison, market_vol);
     
     return mc_bs_error;
 }
@@ -104,22 +214,22 @@ double test_option(const OptionData *opt, uint32_t n_sim, int test_num) {
  */
 void print_header(void) {
     printf("\n");
-    printf("╔═══════════════════════════════════════════════════════════════════════════════════════════════════════════════════╗\n");
-    printf("║                              REAL STOCK OPTION PRICING TEST                                                       ║\n");
-    printf("╠═══════════════════════════════════════════════════════════════════════════════════════════════════════════════════╣\n");
-    printf("| %-5s | %-3s | %8s | %8s | %6s | %4s | %8s | %8s | %7s | %-18s |\n",
-           "Stock", "M", "Price", "Strike", "Vol", "Exp", "MC", "BS", "MC-BS", "Market (error)");
-    printf("|-------|-----|----------|----------|--------|------|----------|----------|---------|--------------------|\n");
+    printf("╔════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════╗\n");
+    printf("║                              REAL STOCK OPTION PRICING TEST                                                                ║\n");
+    printf("╠════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════╣\n");
+    printf("| %-5s | %-3s | %8s | %8s | %6s | %4s | %8s | %8s | %7s | %-18s | %6s |\n",
+           "Stock", "M", "Price", "Strike", "Vol", "Exp", "MC", "BS", "MC-BS", "Market (error)", "Mkt IV");
+    printf("|-------|-----|----------|----------|--------|------|----------|----------|---------|--------------------|--------|\n");
 }
 
 /**
  * Print table footer with summary
  */
 void print_footer(int total, int within_1pct, double avg_error) {
-    printf("╠═══════════════════════════════════════════════════════════════════════════════════════════════════════════════════╣\n");
-    printf("║ SUMMARY: %d options tested | MC within 1%% of BS: %d/%d (%.1f%%) | Avg MC-BS error: %.2f%%                           ║\n",
+    printf("╠════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════╣\n");
+    printf("║ SUMMARY: %d options tested | MC within 1%% of BS: %d/%d (%.1f%%) | Avg MC-BS error: %.2f%%                                    ║\n",
            total, within_1pct, total, (double)within_1pct/total*100, avg_error);
-    printf("╚═══════════════════════════════════════════════════════════════════════════════════════════════════════════════════╝\n");
+    printf("╚════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════════╝\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -127,6 +237,9 @@ int main(int argc, char *argv[]) {
     const char *csv_file = "tests/real_stocks.csv";
     uint32_t n_sim = 500000;  // Simulations per option
     int positional_arg = 0;   // Track which positional argument we're on
+    const char *convert_to = NULL;  // --convert: write a contract file and exit
+    const char *out_path = NULL;    // --out: also write every result to this file
+    int show_table = 1;             // --no-table: skip the human-readable table
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -137,6 +250,28 @@ int main(int argc, char *argv[]) {
             if (i + 1 < argc) {
                 g_seed = (uint32_t)atoi(argv[++i]);
             }
+        } else if (strcmp(argv[i], "--threads") == 0 || strcmp(argv[i], "-t") == 0) {
+            if (i + 1 < argc) {
+                g_threads = (unsigned)atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--qmc") == 0 || strcmp(argv[i], "-q") == 0) {
+            g_sampler = MC_SAMPLER_SOBOL;
+        } else if (strcmp(argv[i], "--float") == 0) {
+            g_precision = MC_PRECISION_FLOAT;
+        } else if (strcmp(argv[i], "--tol") == 0) {
+            if (i + 1 < argc) {
+                g_rel_tol = atof(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--convert") == 0) {
+            if (i + 1 < argc) {
+                convert_to = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--out") == 0) {
+            if (i + 1 < argc) {
+                out_path = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--no-table") == 0) {
+            show_table = 0;
         } else if (argv[i][0] != '-') {
             // Positional arguments: csv_file, then n_sim
             if (positional_arg == 0) {
@@ -149,42 +284,119 @@ int main(int argc, char *argv[]) {
         }
     }
     
-    // Open CSV file
-    FILE *fp = fopen(csv_file, "r");
-    if (!fp) {
+    if (convert_to) {
+        size_t n_bad = 0;
+        long n = market_data_convert_csv(csv_file, convert_to, &n_bad);
+        if (n < 0) {
+            fprintf(stderr, "Error: Cannot convert '%s' to '%s'\n", csv_file, convert_to);
+            return 1;
+        }
+        printf("Wrote %ld contracts to %s (%zu malformed lines skipped)\n", n, convert_to, n_bad);
+        return 0;
+    }
+
+    // A contract file is mapped as is; anything else is streamed as CSV
+    market_data md;
+    csv_stream cs;
+    int mapped = (market_data_open(&md, csv_file) == 0);
+    if (!mapped && csv_stream_open(&cs, csv_file) != 0) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", csv_file);
-        fprintf(stderr, "Usage: %s [csv_file] [n_simulations] [--random|-r] [--seed|-s N]\n", argv[0]);
-        fprintf(stderr, "  --random, -r    Use time-based random seed (different results each run)\n");
-        fprintf(stderr, "  --seed N, -s N  Use specific seed N\n");
+        fprintf(stderr, "Usage: %s [csv_file|contract_file] [n_simulations] [--random|-r] [--seed|-s N] [--threads|-t N] [--qmc|-q] [--float] [--tol X] [--convert OUT] [--out FILE] [--no-table]\n", argv[0]);
+        fprintf(stderr, "  --random, -r       Use time-based random seed (different results each run)\n");
+        fprintf(stderr, "  --seed N, -s N     Use specific seed N\n");
+        fprintf(stderr, "  --threads N, -t N  Use N worker threads (0 = all cores, same results)\n");
+        fprintf(stderr, "  --qmc, -q          Use randomized quasi-Monte Carlo (scrambled Sobol)\n");
+        fprintf(stderr, "  --float            Float32 kernels with double accumulation\n");
+        fprintf(stderr, "  --tol X            Stop each option once std error <= X * price\n");
+        fprintf(stderr, "  --convert OUT      Convert the CSV into a binary contract file OUT and exit\n");
+        fprintf(stderr, "  --out FILE         Write every result to FILE (CSV if it ends in .csv, else columnar)\n");
+        fprintf(stderr, "  --no-table         Do not print the table\n");
         return 1;
     }
     
     printf("Loading options from: %s\n", csv_file);
     printf("Simulations per option: %u\n", n_sim);
     printf("Seed: %u%s\n", g_seed, g_use_random_seed ? " (random)" : " (fixed)");
+    printf("Threads: %u\n", g_threads ? g_threads : parallel_default_threads());
+    printf("Sampler: %s\n", g_sampler == MC_SAMPLER_SOBOL ? "Sobol QMC" : "pseudo-random");
+    printf("Precision: %s\n", g_precision == MC_PRECISION_FLOAT ? "float32 (double accumulation)" : "double");
     
-    print_header();
-    
-    char line[MAX_LINE_LENGTH];
-    OptionData opt;
+    // Sinks: the table (optional) and a results file (optional)
+    results_sink sinks[2];
+    size_t n_sinks = 0;
+    table_summary summary = { 0, 0, 0.0 };
+    if (show_table) {
+        sinks[n_sinks++] = (results_sink){ table_write, NULL, &summary };
+    }
+    if (out_path) {
+        size_t len = strlen(out_path);
+        int csv = len >= 4 && strcmp(out_path + len - 4, ".csv") == 0;
+        if ((csv ? results_sink_csv : results_sink_columnar)(&sinks[n_sinks], out_path) != 0) {
+            fprintf(stderr, "Error: Cannot create '%s'\n", out_path);
+            return 1;
+        }
+        n_sinks++;
+    }
+    results_writer *writer = n_sinks ? results_writer_open(sinks, n_sinks, PRICE_BLOCK) : NULL;
+    if (n_sinks && !writer) {
+        fprintf(stderr, "Error: Cannot start the results writer\n");
+        return 1;
+    }
+
+    if (show_table) {
+        print_header();
+    }
+
+    static OptionData block[PRICE_BLOCK];
+    size_t n_block = 0;
     int total = 0;
-    int within_1pct = 0;
-    double total_error = 0.0;
-    
-    while (fgets(line, sizeof(line), fp)) {
-        if (parse_csv_line(line, &opt)) {
-            double err = test_option(&opt, n_sim, total);
-            
-            total++;
-            if (fabs(err) < 1.0) within_1pct++;
-            total_error += fabs(err);
+
+    if (mapped) {
+        for (size_t i = 0; i < md.n_contracts; i++) {
+            option_data_set(&block[n_block++], md.tickers[md.ticker_id[i]], md.S0[i], md.K[i], md.r[i],
+                            md.sigma[i], md.T[i], md.market_price[i]);
+            if (n_block == PRICE_BLOCK || i + 1 == md.n_contracts) {
+                run_block(block, n_block, n_sim, &total, writer);
+                n_block = 0;
+            }
+        }
+        market_data_close(&md);
+    } else {
+        market_record rec;
+        int more = 1;
+        while (more) {
+            more = (csv_stream_next(&cs, &rec) == 1);
+            if (more) {
+                option_data_set(&block[n_block++], rec.ticker, rec.S0, rec.K, rec.r, rec.sigma, rec.T,
+                                rec.market_price);
+            }
+            if (n_block == PRICE_BLOCK || (!more && n_block > 0)) {
+                run_block(block, n_block, n_sim, &total, writer);
+                n_block = 0;
+            }
         }
+        csv_stream_close(&cs);
     }
     
-    fclose(fp);
-    
+    if (writer && results_writer_close(writer) != 0) {
+        fprintf(stderr, "Error: Writing results failed\n");
+        return 1;
+    }
     if (total > 0) {
-        print_footer(total, within_1pct, total_error / total);
+        if (show_table) {
+            print_footer(summary.total, summary.within_1pct, summary.total_error / summary.total);
+        } else {
+            printf("Priced %d options\n", total);
+        }
+        if (out_path) {
+            printf("Results written to %s\n", out_path);
+        }
+        if (g_rel_tol > 0.0) {
+            printf("Early stopping at %.2g relative std error: %llu of %llu paths simulated (%.1f%%)\n",
+                   g_rel_tol, (unsigned long long)g_paths_used,
+                   (unsigned long long)n_sim * total,
+                   100.0 * (double)g_paths_used / ((double)n_sim * total));
+        }
     } else {
         printf("No valid option data found in file.\n");
     }